@@ -22,12 +22,19 @@
 
 #include <libreptool/rptreport.h>
 #include <libreptool/rptcommon.h>
+#include <libreptool/rptdatasource.h>
+#include <libreptool/rptdatasourcegda.h>
+#include <libreptool/rptdatasourcecsv.h>
+#include <libreptool/rptdatasourcecolumns.h>
+#include <libreptool/rptdatasourceprefetch.h>
 #include <libreptool/rptobject.h>
 #include <libreptool/rptobjectellipse.h>
 #include <libreptool/rptobjectimage.h>
+#include <libreptool/rptobjectsubreport.h>
 #include <libreptool/rptobjectline.h>
 #include <libreptool/rptobjectrect.h>
 #include <libreptool/rptobjecttext.h>
 #include <libreptool/rptprint.h>
+#include <libreptool/rpttemplatecache.h>
 
 #endif /* __LIBREPTOOL_H__ */
@@ -1,15 +1,25 @@
-%{
-#define YYSTYPE char *
+%code requires {
+#include <glib.h>
 
-#include <string.h>
+#include "rptreport.h"
 
-#include <glib.h>
+#ifndef YY_TYPEDEF_YY_SCANNER_T
+#define YY_TYPEDEF_YY_SCANNER_T
+typedef void *yyscan_t;
+#endif
+}
+
+%code {
+#include <string.h>
 
 #include "lexycal.yy.h"
 #include "rptreport_priv.h"
 
-void yyerror (RptReport *rpt_report, gchar **ret, char const *s);
-%}
+void yyerror (yyscan_t scanner, RptReport *rpt_report, gchar **ret, char const *s);
+}
+
+%define api.pure full
+%define api.value.type {char *}
 
 %token INTEGER
 %token FLOAT
@@ -24,6 +34,8 @@ void yyerror (RptReport *rpt_report, gchar **ret, char const *s);
 %left '*'
 %left '/'
 
+%lex-param {yyscan_t scanner}
+%parse-param {yyscan_t scanner}
 %parse-param {RptReport *rpt_report}
 %parse-param {gchar **ret}
 
@@ -32,26 +44,26 @@ input:    /* empty */
         | input string
 ;
 
-string: exp      { *ret = g_strdup ($1); }
+string: exp      { g_free (*ret); *ret = g_strdup ($1); }
 ;
 
 exp:      INTEGER           { $$ = $1; }
         | FLOAT             { $$ = $1; }
-        | STRING            { $$ = g_strndup ($1 + 1, strlen ($1) - 2); }
-        | FIELD             { $$ = rpt_report_get_field (rpt_report, g_strndup ($1 + 1, strlen ($1) - 2)); }
-        | SPECIAL           { $$ = rpt_report_get_special (rpt_report, $1); }
-		| exp '+' exp		{ $$ = g_strdup_printf ("%f", strtod ($1, NULL) + strtod ($3, NULL)); }
-		| exp '-' exp		{ $$ = g_strdup_printf ("%f", strtod ($1, NULL) - strtod ($3, NULL)); }
-		| exp '*' exp		{ $$ = g_strdup_printf ("%f", strtod ($1, NULL) * strtod ($3, NULL)); }
-		| exp '/' exp		{ $$ = g_strdup_printf ("%f", strtod ($1, NULL) / strtod ($3, NULL)); }
-		| exp '&' exp		{ $$ = g_strconcat ($1, $3, NULL); }
+        | STRING            { $$ = rpt_report_scratch_strndup ($1 + 1, strlen ($1) - 2); }
+        | FIELD             { $$ = rpt_report_get_field (rpt_report, rpt_report_scratch_strndup ($1 + 1, strlen ($1) - 2)); }
+        | SPECIAL           { $$ = rpt_report_scratch_take (rpt_report_get_special (rpt_report, $1)); }
+		| exp '+' exp		{ $$ = rpt_report_scratch_take (g_strdup_printf ("%f", strtod ($1, NULL) + strtod ($3, NULL))); }
+		| exp '-' exp		{ $$ = rpt_report_scratch_take (g_strdup_printf ("%f", strtod ($1, NULL) - strtod ($3, NULL))); }
+		| exp '*' exp		{ $$ = rpt_report_scratch_take (g_strdup_printf ("%f", strtod ($1, NULL) * strtod ($3, NULL))); }
+		| exp '/' exp		{ $$ = rpt_report_scratch_take (g_strdup_printf ("%f", strtod ($1, NULL) / strtod ($3, NULL))); }
+		| exp '&' exp		{ $$ = rpt_report_scratch_take (g_strconcat ($1, $3, NULL)); }
         | '(' exp ')'       { $$ = $2; }
 ;
 %%
 
 /* Called by yyparse on error.  */
 void
-yyerror (RptReport *rpt_report, gchar **ret, char const *s)
+yyerror (yyscan_t scanner, RptReport *rpt_report, gchar **ret, char const *s)
 {
 	g_warning ("Bison error: %s", s);
 }
@@ -23,6 +23,8 @@
 
 static GArray *rpt_common_parse_style (const gchar *style);
 static gchar *rpt_common_style_to_string (const GArray *style);
+static void rpt_common_set_prop_double (xmlNode *xnode, const gchar *name, gdouble value);
+static void rpt_common_set_prop_take (xmlNode *xnode, const gchar *name, gchar *value);
 
 
 /**
@@ -307,6 +309,14 @@ rpt_common_stroutputtype_to_enum (const gchar *output_type)
 				{
 					ret = RPT_OUTPUT_GTK_DEFAULT_PRINTER;
 				}
+			else if (g_ascii_strcasecmp (real_outputtype, "pam") == 0)
+				{
+					ret = RPT_OUTPUT_PAM;
+				}
+			else if (g_ascii_strcasecmp (real_outputtype, "raw") == 0)
+				{
+					ret = RPT_OUTPUT_RAW;
+				}
 			else
 				{
 					g_warning ("Output type «%s» not available.", real_outputtype);
@@ -353,6 +363,14 @@ const gchar
 				ret = g_strdup ("gtk-default");
 				break;
 
+			case RPT_OUTPUT_PAM:
+				ret = g_strdup ("pam");
+				break;
+
+			case RPT_OUTPUT_RAW:
+				ret = g_strdup ("raw");
+				break;
+
 			default:
 				g_warning ("Output type «%d» not available.", output_type);
 				ret = g_strdup ("pdf");
@@ -436,8 +454,8 @@ rpt_common_set_position (xmlNode *xnode, const RptPoint *position)
 {
 	if (position != NULL)
 		{
-			xmlSetProp (xnode, "x", g_strdup_printf ("%f", position->x));
-			xmlSetProp (xnode, "y", g_strdup_printf ("%f", position->y));
+			rpt_common_set_prop_double (xnode, "x", position->x);
+			rpt_common_set_prop_double (xnode, "y", position->y);
 		}
 }
 
@@ -513,8 +531,8 @@ rpt_common_set_size (xmlNode *xnode, const RptSize *size)
 {
 	if (size != NULL)
 		{
-			xmlSetProp (xnode, "width", g_strdup_printf ("%f", size->width));
-			xmlSetProp (xnode, "height", g_strdup_printf ("%f", size->height));
+			rpt_common_set_prop_double (xnode, "width", size->width);
+			rpt_common_set_prop_double (xnode, "height", size->height);
 		}
 }
 
@@ -624,8 +642,8 @@ rpt_common_set_translation (xmlNode *xnode, const RptTranslation *translation)
 
 			if (_node != NULL)
 				{
-					xmlSetProp (_node, "x", g_strdup_printf ("%f", translation->x));
-					xmlSetProp (_node, "y", g_strdup_printf ("%f", translation->y));
+					rpt_common_set_prop_double (_node, "x", translation->x);
+					rpt_common_set_prop_double (_node, "y", translation->y);
 				}
 		}
 }
@@ -697,7 +715,7 @@ rpt_common_set_rotation (xmlNode *xnode, const RptRotation *rotation)
 {
 	if (rotation != NULL)
 		{
-			xmlSetProp (xnode, "rotation", g_strdup_printf ("%f", rotation->angle));
+			rpt_common_set_prop_double (xnode, "rotation", rotation->angle);
 		}
 }
 
@@ -796,10 +814,10 @@ rpt_common_set_margin (xmlNode *xnode, const RptMargin *margin)
 {
 	if (margin != NULL)
 		{
-			xmlSetProp (xnode, "margin-top", g_strdup_printf ("%f", margin->top));
-			xmlSetProp (xnode, "margin-right", g_strdup_printf ("%f", margin->right));
-			xmlSetProp (xnode, "margin-bottom", g_strdup_printf ("%f", margin->bottom));
-			xmlSetProp (xnode, "margin-left", g_strdup_printf ("%f", margin->left));
+			rpt_common_set_prop_double (xnode, "margin-top", margin->top);
+			rpt_common_set_prop_double (xnode, "margin-right", margin->right);
+			rpt_common_set_prop_double (xnode, "margin-bottom", margin->bottom);
+			rpt_common_set_prop_double (xnode, "margin-left", margin->left);
 		}
 }
 
@@ -818,6 +836,49 @@ RptFont
 	return font;
 }
 
+/**
+ * rpt_common_rptfont_copy:
+ * @font: an #RptFont struct.
+ *
+ * Returns: a new allocated copy of @font, with its name and color; NULL
+ * if @font is NULL.
+ */
+RptFont
+*rpt_common_rptfont_copy (const RptFont *font)
+{
+	RptFont *copy;
+
+	if (font == NULL)
+		{
+			return NULL;
+		}
+
+	copy = g_memdup (font, sizeof (RptFont));
+	copy->name = g_strdup (font->name);
+	copy->color = g_memdup (font->color, sizeof (RptColor));
+
+	return copy;
+}
+
+/**
+ * rpt_common_rptfont_free:
+ * @font: an #RptFont struct.
+ *
+ * Frees @font, with its name and color.
+ */
+void
+rpt_common_rptfont_free (RptFont *font)
+{
+	if (font == NULL)
+		{
+			return;
+		}
+
+	g_free (font->name);
+	g_free (font->color);
+	g_free (font);
+}
+
 /**
  * rpt_common_get_font:
  * @xnode: an #xmlNode.
@@ -843,25 +904,30 @@ RptFont
 	prop = xmlGetProp (xnode, "font-name");
 	if (prop != NULL)
 		{
+			g_free (font->name);
 			font->name = g_strdup (prop);
+			xmlFree (prop);
 		}
 
 	prop = xmlGetProp (xnode, "font-size");
 	if (prop != NULL)
 		{
 			font->size = strtod (prop, NULL);
+			xmlFree (prop);
 		}
 
 	prop = xmlGetProp (xnode, "font-bold");
 	if (prop != NULL)
 		{
 			font->bold = (strcmp (g_strstrip (prop), "y") == 0);
+			xmlFree (prop);
 		}
 
 	prop = xmlGetProp (xnode, "font-italic");
 	if (prop != NULL)
 		{
 			font->italic = (strcmp (g_strstrip (prop), "y") == 0);
+			xmlFree (prop);
 		}
 
 	prop = xmlGetProp (xnode, "font-underline");
@@ -885,18 +951,21 @@ RptFont
 				{
 					font->underline = PANGO_UNDERLINE_ERROR;
 				}
+			xmlFree (prop);
 		}
 
 	prop = xmlGetProp (xnode, "font-strike");
 	if (prop != NULL)
 		{
 			font->strike = (strcmp (g_strstrip (prop), "y") == 0);
+			xmlFree (prop);
 		}
 
 	prop = xmlGetProp (xnode, "font-color");
 	if (prop != NULL)
 		{
 			font->color = rpt_common_parse_color (prop);
+			xmlFree (prop);
 		}
 
 	return font;
@@ -914,7 +983,7 @@ rpt_common_set_font (xmlNode *xnode, const RptFont *font)
 	if (font != NULL)
 		{
 			xmlSetProp (xnode, "font-name", font->name);
-			xmlSetProp (xnode, "font-size", g_strdup_printf ("%f", font->size));
+			rpt_common_set_prop_double (xnode, "font-size", font->size);
 			if (font->bold)
 				{
 					xmlSetProp (xnode, "font-bold", "y");
@@ -950,7 +1019,7 @@ rpt_common_set_font (xmlNode *xnode, const RptFont *font)
 				}
 			if (font->color != NULL)
 				{
-					xmlSetProp (xnode, "font-color", rpt_common_rptcolor_to_string (font->color));
+					rpt_common_set_prop_take (xnode, "font-color", rpt_common_rptcolor_to_string (font->color));
 				}
 		}
 }
@@ -996,6 +1065,90 @@ RptBorder
 	return border;
 }
 
+/* a copy of the dashes of a border or a stroke */
+static GArray
+*rpt_common_style_copy (const GArray *style)
+{
+	GArray *copy;
+
+	if (style == NULL)
+		{
+			return NULL;
+		}
+
+	copy = g_array_sized_new (FALSE, FALSE, sizeof (gdouble), style->len);
+	g_array_append_vals (copy, style->data, style->len);
+
+	return copy;
+}
+
+/**
+ * rpt_common_rptborder_copy:
+ * @border: an #RptBorder struct.
+ *
+ * Returns: a new allocated copy of @border, with its colors and styles;
+ * NULL if @border is NULL.
+ */
+RptBorder
+*rpt_common_rptborder_copy (const RptBorder *border)
+{
+	RptBorder *copy;
+
+	if (border == NULL)
+		{
+			return NULL;
+		}
+
+	copy = g_memdup (border, sizeof (RptBorder));
+	copy->top_color = g_memdup (border->top_color, sizeof (RptColor));
+	copy->right_color = g_memdup (border->right_color, sizeof (RptColor));
+	copy->bottom_color = g_memdup (border->bottom_color, sizeof (RptColor));
+	copy->left_color = g_memdup (border->left_color, sizeof (RptColor));
+	copy->top_style = rpt_common_style_copy (border->top_style);
+	copy->right_style = rpt_common_style_copy (border->right_style);
+	copy->bottom_style = rpt_common_style_copy (border->bottom_style);
+	copy->left_style = rpt_common_style_copy (border->left_style);
+
+	return copy;
+}
+
+/**
+ * rpt_common_rptborder_free:
+ * @border: an #RptBorder struct.
+ *
+ * Frees @border, with its colors and styles.
+ */
+void
+rpt_common_rptborder_free (RptBorder *border)
+{
+	if (border == NULL)
+		{
+			return;
+		}
+
+	g_free (border->top_color);
+	g_free (border->right_color);
+	g_free (border->bottom_color);
+	g_free (border->left_color);
+	if (border->top_style != NULL)
+		{
+			g_array_free (border->top_style, TRUE);
+		}
+	if (border->right_style != NULL)
+		{
+			g_array_free (border->right_style, TRUE);
+		}
+	if (border->bottom_style != NULL)
+		{
+			g_array_free (border->bottom_style, TRUE);
+		}
+	if (border->left_style != NULL)
+		{
+			g_array_free (border->left_style, TRUE);
+		}
+	g_free (border);
+}
+
 /**
  * rpt_common_get_border:
  * @xnode: an #xmlNode.
@@ -1128,38 +1281,38 @@ rpt_common_set_border (xmlNode *xnode, const RptBorder *border)
 		{
 			if (border->top_width > 0.0 && border->top_color != NULL)
 				{
-					xmlSetProp (xnode, "border-top-width", g_strdup_printf ("%f", border->top_width));
-					xmlSetProp (xnode, "border-top-color", rpt_common_rptcolor_to_string (border->top_color));
+					rpt_common_set_prop_double (xnode, "border-top-width", border->top_width);
+					rpt_common_set_prop_take (xnode, "border-top-color", rpt_common_rptcolor_to_string (border->top_color));
 					if (border->top_style != NULL)
 						{
-							xmlSetProp (xnode, "border-top-style", rpt_common_style_to_string (border->top_style));
+							rpt_common_set_prop_take (xnode, "border-top-style", rpt_common_style_to_string (border->top_style));
 						}
 				}
 			if (border->right_width > 0.0 && border->right_color != NULL)
 				{
-					xmlSetProp (xnode, "border-right-width", g_strdup_printf ("%f", border->right_width));
-					xmlSetProp (xnode, "border-right-color", rpt_common_rptcolor_to_string (border->right_color));
+					rpt_common_set_prop_double (xnode, "border-right-width", border->right_width);
+					rpt_common_set_prop_take (xnode, "border-right-color", rpt_common_rptcolor_to_string (border->right_color));
 					if (border->right_style != NULL)
 						{
-							xmlSetProp (xnode, "border-right-style", rpt_common_style_to_string (border->right_style));
+							rpt_common_set_prop_take (xnode, "border-right-style", rpt_common_style_to_string (border->right_style));
 						}
 				}
 			if (border->bottom_width > 0.0 && border->bottom_color != NULL)
 				{
-					xmlSetProp (xnode, "border-bottom-width", g_strdup_printf ("%f", border->bottom_width));
-					xmlSetProp (xnode, "border-bottom-color", rpt_common_rptcolor_to_string (border->bottom_color));
+					rpt_common_set_prop_double (xnode, "border-bottom-width", border->bottom_width);
+					rpt_common_set_prop_take (xnode, "border-bottom-color", rpt_common_rptcolor_to_string (border->bottom_color));
 					if (border->bottom_style != NULL)
 						{
-							xmlSetProp (xnode, "border-bottom-style", rpt_common_style_to_string (border->bottom_style));
+							rpt_common_set_prop_take (xnode, "border-bottom-style", rpt_common_style_to_string (border->bottom_style));
 						}
 				}
 			if (border->left_width > 0.0 && border->left_color != NULL)
 				{
-					xmlSetProp (xnode, "border-left-width", g_strdup_printf ("%f", border->left_width));
-					xmlSetProp (xnode, "border-left-color", rpt_common_rptcolor_to_string (border->left_color));
+					rpt_common_set_prop_double (xnode, "border-left-width", border->left_width);
+					rpt_common_set_prop_take (xnode, "border-left-color", rpt_common_rptcolor_to_string (border->left_color));
 					if (border->left_style != NULL)
 						{
-							xmlSetProp (xnode, "border-left-style", rpt_common_style_to_string (border->left_style));
+							rpt_common_set_prop_take (xnode, "border-left-style", rpt_common_style_to_string (border->left_style));
 						}
 				}
 		}
@@ -1290,6 +1443,52 @@ RptStroke
 	return stroke;
 }
 
+/**
+ * rpt_common_rptstroke_copy:
+ * @stroke: an #RptStroke struct.
+ *
+ * Returns: a new allocated copy of @stroke, with its color and style; NULL
+ * if @stroke is NULL.
+ */
+RptStroke
+*rpt_common_rptstroke_copy (const RptStroke *stroke)
+{
+	RptStroke *copy;
+
+	if (stroke == NULL)
+		{
+			return NULL;
+		}
+
+	copy = g_memdup (stroke, sizeof (RptStroke));
+	copy->color = g_memdup (stroke->color, sizeof (RptColor));
+	copy->style = rpt_common_style_copy (stroke->style);
+
+	return copy;
+}
+
+/**
+ * rpt_common_rptstroke_free:
+ * @stroke: an #RptStroke struct.
+ *
+ * Frees @stroke, with its color and style.
+ */
+void
+rpt_common_rptstroke_free (RptStroke *stroke)
+{
+	if (stroke == NULL)
+		{
+			return;
+		}
+
+	g_free (stroke->color);
+	if (stroke->style != NULL)
+		{
+			g_array_free (stroke->style, TRUE);
+		}
+	g_free (stroke);
+}
+
 /**
  * rpt_common_get_stroke:
  * @xnode: an #xmlNode.
@@ -1348,12 +1547,12 @@ rpt_common_set_stroke (xmlNode *xnode, const RptStroke *stroke)
 		{
 			if (stroke->width != 0.0)
 				{
-					xmlSetProp (xnode, "stroke-width", g_strdup_printf ("%f", stroke->width));
+					rpt_common_set_prop_double (xnode, "stroke-width", stroke->width);
 				}
-			xmlSetProp (xnode, "stroke-color", rpt_common_rptcolor_to_string (stroke->color));
+			rpt_common_set_prop_take (xnode, "stroke-color", rpt_common_rptcolor_to_string (stroke->color));
 			if (stroke->style != NULL)
 				{
-					xmlSetProp (xnode, "stroke-style", rpt_common_style_to_string (stroke->style));
+					rpt_common_set_prop_take (xnode, "stroke-style", rpt_common_style_to_string (stroke->style));
 				}
 		}
 }
@@ -1448,63 +1647,16 @@ gchar
 
 	if (color != NULL)
 		{
-			ret = g_strdup  ("#");
-
-			ret = g_strconcat (ret, g_strdup_printf ("%.2X", (gint)(color->r * 255)), NULL);
-			ret = g_strconcat (ret, g_strdup_printf ("%.2X", (gint)(color->g * 255)), NULL);
-			ret = g_strconcat (ret, g_strdup_printf ("%.2X", (gint)(color->b * 255)), NULL);
-			ret = g_strconcat (ret, g_strdup_printf ("%.2X", (gint)(color->a * 255)), NULL);
+			ret = g_strdup_printf ("#%.2X%.2X%.2X%.2X",
+			                       (gint)(color->r * 255),
+			                       (gint)(color->g * 255),
+			                       (gint)(color->b * 255),
+			                       (gint)(color->a * 255));
 		}
 
 	return ret;
 }
 
-/**
- * rpt_common_rptcolor_to_gdkcolor:
- * @color: an #RptColor value.
- *
- * Converts an #RptColor value to a #GdkColor.
- *
- * Returns: the #GdkColor correspondent to @color.
- */
-GdkColor
-*rpt_common_rptcolor_to_gdkcolor (const RptColor *color)
-{
-	GdkColor *gdk_color;
-
-	gdk_color = (GdkColor *)g_malloc0 (sizeof (GdkColor));
-	
-	gdk_color->red = color->r * 65535;
-	gdk_color->green = color->g * 65535;
-	gdk_color->blue = color->b * 65535;
-
-	return gdk_color;
-}
-
-/**
- * rpt_common_gdkcolor_to_rptcolor:
- * @gdk_color: a #GdkColor.
- * @alpha: the alpha value.
- *
- * Converts an #GdkColor value to a #RptColor.
- *
- * Returns: the #GdkColor correspondent to @color.
- */
-RptColor
-*rpt_common_gdkcolor_to_rptcolor (const GdkColor *gdk_color, guint16 alpha)
-{
-	RptColor *color;
-
-	color = rpt_common_rptcolor_new ();
-
-	color->r = gdk_color->red / 65535.0;
-	color->g = gdk_color->green / 65535.0;
-	color->b = gdk_color->blue / 65535.0;
-	color->a = alpha / 65535.0;
-
-	return color;
-}
-
 static GArray
 *rpt_common_parse_style (const gchar *style)
 {
@@ -1537,18 +1689,20 @@ static gchar
 *rpt_common_style_to_string (const GArray *style)
 {
 	gint i;
-	gchar *ret = NULL;
+	GString *ret;
 
-	if (style != NULL)
+	if (style == NULL)
 		{
-			ret = g_strdup ("");
-			for (i = 0; i < style->len; i++)
-				{
-					ret = g_strconcat (ret, g_strdup_printf ("%f;", g_array_index (style, gdouble, i)), NULL);
-				}
+			return NULL;
 		}
 
-	return ret;
+	ret = g_string_new (NULL);
+	for (i = 0; i < style->len; i++)
+		{
+			g_string_append_printf (ret, "%f;", g_array_index (style, gdouble, i));
+		}
+
+	return g_string_free (ret, FALSE);
 }
 
 /**
@@ -1571,3 +1725,28 @@ gdouble
 
 	return ret;
 }
+
+/* sets the property @name of @xnode to @value, as "%f" writes it, without
+ * a string of its own */
+static void
+rpt_common_set_prop_double (xmlNode *xnode, const gchar *name, gdouble value)
+{
+	gchar buf[64];
+
+	if (g_snprintf (buf, sizeof (buf), "%f", value) < (gint)sizeof (buf))
+		{
+			xmlSetProp (xnode, name, buf);
+		}
+	else
+		{
+			rpt_common_set_prop_take (xnode, name, g_strdup_printf ("%f", value));
+		}
+}
+
+/* sets the property @name of @xnode to @value, and frees @value */
+static void
+rpt_common_set_prop_take (xmlNode *xnode, const gchar *name, gchar *value)
+{
+	xmlSetProp (xnode, name, value);
+	g_free (value);
+}
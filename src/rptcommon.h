@@ -21,7 +21,6 @@
 #define __RPT_COMMON_H__
 
 #include <glib.h>
-#include <gdk/gdk.h>
 #include <libxml/tree.h>
 
 #include <pango/pango-attributes.h>
@@ -45,9 +44,22 @@ typedef enum
 	RPT_OUTPUT_PS,
 	RPT_OUTPUT_SVG,
 	RPT_OUTPUT_GTK,
-	RPT_OUTPUT_GTK_DEFAULT_PRINTER
+	RPT_OUTPUT_GTK_DEFAULT_PRINTER,
+	RPT_OUTPUT_PAM,
+	RPT_OUTPUT_RAW
 } eRptOutputType;
 
+typedef enum
+{
+	RPT_PNG_FILTER_DEFAULT,
+	RPT_PNG_FILTER_NONE,
+	RPT_PNG_FILTER_SUB,
+	RPT_PNG_FILTER_UP,
+	RPT_PNG_FILTER_AVG,
+	RPT_PNG_FILTER_PAETH,
+	RPT_PNG_FILTER_ALL
+} eRptPngFilter;
+
 /**
  * RptColor:
  * @r: the red channel; value from 0 to 1.
@@ -245,12 +257,16 @@ void rpt_common_set_margin (xmlNode *xnode,
                             const RptMargin *margin);
 
 RptFont *rpt_common_rptfont_new (void);
+RptFont *rpt_common_rptfont_copy (const RptFont *font);
+void rpt_common_rptfont_free (RptFont *font);
 RptFont *rpt_common_get_font (xmlNode *xnode);
 void rpt_common_set_font (xmlNode *xnode,
                           const RptFont *font);
 RptFont *rpt_common_rptfont_from_pango_description (const PangoFontDescription *description);
 
 RptBorder *rpt_common_rptborder_new (void);
+RptBorder *rpt_common_rptborder_copy (const RptBorder *border);
+void rpt_common_rptborder_free (RptBorder *border);
 RptBorder *rpt_common_get_border (xmlNode *xnode);
 void rpt_common_set_border (xmlNode *xnode,
                             const RptBorder *border);
@@ -261,6 +277,8 @@ void rpt_common_set_align (xmlNode *xnode,
                            const RptAlign *align);
 
 RptStroke *rpt_common_rptstroke_new (void);
+RptStroke *rpt_common_rptstroke_copy (const RptStroke *stroke);
+void rpt_common_rptstroke_free (RptStroke *stroke);
 RptStroke *rpt_common_get_stroke (xmlNode *xnode);
 void rpt_common_set_stroke (xmlNode *xnode,
                             const RptStroke *stroke);
@@ -268,8 +286,6 @@ void rpt_common_set_stroke (xmlNode *xnode,
 RptColor *rpt_common_rptcolor_new (void);
 RptColor *rpt_common_parse_color (const gchar *str_color);
 gchar *rpt_common_rptcolor_to_string (const RptColor *color);
-GdkColor *rpt_common_rptcolor_to_gdkcolor (const RptColor *color);
-RptColor *rpt_common_gdkcolor_to_rptcolor (const GdkColor *gdk_color, guint16 alpha);
 
 gdouble *rpt_common_style_to_array (const GArray *style);
 
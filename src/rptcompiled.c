@@ -0,0 +1,487 @@
+/*
+ * Copyright (C) 2007-2014 Andrea Zagli <azagli@libero.it>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <string.h>
+
+#ifdef HAVE_CONFIG_H
+	#include <config.h>
+#endif
+
+#include "rptcompiled.h"
+#include "rptreport.h"
+
+/*
+ * A compiled template is the xml tree of a report definition, already
+ * parsed, in native-endian 32 bits words:
+ *
+ *   header       magic "RPTC", layout version, version of the library,
+ *                byte order mark,
+ *                number of strings, number of nodes, size of the strings
+ *   offsets      the start of every string in the strings' blob
+ *   strings      every distinct name and value, once, nul terminated,
+ *                padded to 4 bytes
+ *   nodes        the elements in preorder: name, content (or NONE),
+ *                number of attributes, number of children, and a couple
+ *                name, value for every attribute
+ *
+ * Whitespace between elements, comments and processing instructions are
+ * not kept; an element without children elements keeps its text.
+ */
+
+#define RPT_COMPILED_MAGIC "RPTC"
+#define RPT_COMPILED_BYTE_ORDER 0x01020304
+#define RPT_COMPILED_NONE 0xFFFFFFFF
+
+/* deeper trees are surely broken files */
+#define RPT_COMPILED_MAX_DEPTH 256
+
+#ifdef PACKAGE_VERSION
+	#define RPT_COMPILED_LIBRARY_VERSION PACKAGE_VERSION
+#else
+	#define RPT_COMPILED_LIBRARY_VERSION "unknown"
+#endif
+
+typedef struct
+{
+	gchar magic[4];
+	guint32 version;
+	gchar library_version[16];
+	guint32 byte_order;
+	guint32 n_strings;
+	guint32 n_nodes;
+	guint32 strings_size;
+} RptCompiledHeader;
+
+typedef struct
+{
+	GHashTable *indexes;
+	GArray *offsets;
+	GString *strings;
+	GArray *nodes;
+	guint32 n_nodes;
+} RptCompiledWriter;
+
+typedef struct
+{
+	const guint32 *offsets;
+	const gchar *strings;
+	guint32 n_strings;
+	const gchar *nodes;
+	gsize n_words;
+	gsize pos;
+	guint32 n_nodes;
+	guint32 n_read;
+} RptCompiledReader;
+
+static guint32 rpt_compiled_writer_intern (RptCompiledWriter *writer, const gchar *str);
+static void rpt_compiled_writer_add_node (RptCompiledWriter *writer, xmlNode *xnode);
+
+static gboolean rpt_compiled_reader_word (RptCompiledReader *reader, guint32 *word);
+static gboolean rpt_compiled_reader_string (RptCompiledReader *reader, gboolean allow_none, const gchar **str);
+static xmlNode *rpt_compiled_reader_node (RptCompiledReader *reader, xmlDoc *xdoc, guint depth);
+
+/**
+ * rpt_compiled_is_compiled:
+ * @data: the start of a file.
+ * @length: the length of @data.
+ *
+ * Returns: TRUE if @data starts like a compiled template, of any version.
+ */
+gboolean
+rpt_compiled_is_compiled (const gchar *data, gsize length)
+{
+	return data != NULL
+	       && length >= sizeof (RptCompiledHeader)
+	       && memcmp (data, RPT_COMPILED_MAGIC, 4) == 0;
+}
+
+static guint32
+rpt_compiled_writer_intern (RptCompiledWriter *writer, const gchar *str)
+{
+	gpointer value;
+	guint32 index;
+	guint32 offset;
+
+	if (str == NULL)
+		{
+			return RPT_COMPILED_NONE;
+		}
+
+	if (g_hash_table_lookup_extended (writer->indexes, str, NULL, &value))
+		{
+			return GPOINTER_TO_UINT (value);
+		}
+
+	index = writer->offsets->len;
+	offset = writer->strings->len;
+	g_array_append_val (writer->offsets, offset);
+	g_string_append_len (writer->strings, str, strlen (str) + 1);
+	g_hash_table_insert (writer->indexes, g_strdup (str), GUINT_TO_POINTER (index));
+
+	return index;
+}
+
+static void
+rpt_compiled_writer_add_node (RptCompiledWriter *writer, xmlNode *xnode)
+{
+	xmlNode *cur;
+	xmlAttr *attr;
+	xmlChar *value;
+	guint32 words[4];
+	guint32 pair[2];
+	guint pos;
+	gboolean leaf;
+
+	leaf = TRUE;
+	for (cur = xnode->children; cur != NULL; cur = cur->next)
+		{
+			if (cur->type == XML_ELEMENT_NODE)
+				{
+					leaf = FALSE;
+					break;
+				}
+		}
+
+	writer->n_nodes++;
+
+	words[0] = rpt_compiled_writer_intern (writer, (const gchar *)xnode->name);
+	words[1] = RPT_COMPILED_NONE;
+	words[2] = 0;
+	words[3] = 0;
+	if (leaf && xnode->children != NULL)
+		{
+			value = xmlNodeGetContent (xnode);
+			words[1] = rpt_compiled_writer_intern (writer, (const gchar *)value);
+			xmlFree (value);
+		}
+
+	/* the counts are filled after the attributes and the children */
+	pos = writer->nodes->len;
+	g_array_append_vals (writer->nodes, words, 4);
+
+	for (attr = xnode->properties; attr != NULL; attr = attr->next)
+		{
+			value = xmlGetProp (xnode, attr->name);
+			pair[0] = rpt_compiled_writer_intern (writer, (const gchar *)attr->name);
+			pair[1] = rpt_compiled_writer_intern (writer, value != NULL ? (const gchar *)value : "");
+			g_array_append_vals (writer->nodes, pair, 2);
+			g_array_index (writer->nodes, guint32, pos + 2)++;
+			xmlFree (value);
+		}
+
+	for (cur = xnode->children; cur != NULL; cur = cur->next)
+		{
+			if (cur->type == XML_ELEMENT_NODE)
+				{
+					rpt_compiled_writer_add_node (writer, cur);
+					g_array_index (writer->nodes, guint32, pos + 3)++;
+				}
+		}
+}
+
+/**
+ * rpt_compiled_write:
+ * @xdoc: a report definition.
+ * @filename: the path of the compiled template to write.
+ * @error: return location for a #GError, or NULL.
+ *
+ * Writes @xdoc as a compiled template; the file is replaced atomically.
+ *
+ * Returns: TRUE on success.
+ */
+gboolean
+rpt_compiled_write (xmlDoc *xdoc, const gchar *filename, GError **error)
+{
+	RptCompiledWriter writer;
+	RptCompiledHeader header;
+	xmlNode *xroot;
+	GString *out;
+	gboolean ret;
+
+	g_return_val_if_fail (xdoc != NULL, FALSE);
+	g_return_val_if_fail (filename != NULL, FALSE);
+
+	xroot = xmlDocGetRootElement (xdoc);
+	if (xroot == NULL)
+		{
+			g_set_error (error, RPT_REPORT_ERROR, RPT_REPORT_ERROR_INVALID_XML,
+			             "The document is empty.");
+			return FALSE;
+		}
+
+	writer.indexes = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	writer.offsets = g_array_new (FALSE, FALSE, sizeof (guint32));
+	writer.strings = g_string_new (NULL);
+	writer.nodes = g_array_new (FALSE, FALSE, sizeof (guint32));
+	writer.n_nodes = 0;
+
+	rpt_compiled_writer_add_node (&writer, xroot);
+
+	while (writer.strings->len % 4 != 0)
+		{
+			g_string_append_c (writer.strings, '\0');
+		}
+
+	memset (&header, 0, sizeof (header));
+	memcpy (header.magic, RPT_COMPILED_MAGIC, 4);
+	header.version = RPT_COMPILED_VERSION;
+	g_strlcpy (header.library_version, RPT_COMPILED_LIBRARY_VERSION, sizeof (header.library_version));
+	header.byte_order = RPT_COMPILED_BYTE_ORDER;
+	header.n_strings = writer.offsets->len;
+	header.n_nodes = writer.n_nodes;
+	header.strings_size = writer.strings->len;
+
+	out = g_string_sized_new (sizeof (header)
+	                          + writer.offsets->len * 4
+	                          + writer.strings->len
+	                          + writer.nodes->len * 4);
+	g_string_append_len (out, (const gchar *)&header, sizeof (header));
+	g_string_append_len (out, writer.offsets->data, writer.offsets->len * 4);
+	g_string_append_len (out, writer.strings->str, writer.strings->len);
+	g_string_append_len (out, writer.nodes->data, writer.nodes->len * 4);
+
+	ret = g_file_set_contents (filename, out->str, out->len, error);
+
+	g_string_free (out, TRUE);
+	g_hash_table_destroy (writer.indexes);
+	g_array_free (writer.offsets, TRUE);
+	g_string_free (writer.strings, TRUE);
+	g_array_free (writer.nodes, TRUE);
+
+	return ret;
+}
+
+/* the data isn't always aligned, so the words are copied */
+static gboolean
+rpt_compiled_reader_word (RptCompiledReader *reader, guint32 *word)
+{
+	if (reader->pos >= reader->n_words)
+		{
+			return FALSE;
+		}
+
+	memcpy (word, reader->nodes + reader->pos * 4, 4);
+	reader->pos++;
+
+	return TRUE;
+}
+
+static gboolean
+rpt_compiled_reader_string (RptCompiledReader *reader, gboolean allow_none, const gchar **str)
+{
+	guint32 index;
+	guint32 offset;
+
+	if (!rpt_compiled_reader_word (reader, &index))
+		{
+			return FALSE;
+		}
+
+	if (index == RPT_COMPILED_NONE)
+		{
+			*str = NULL;
+			return allow_none;
+		}
+	if (index >= reader->n_strings)
+		{
+			return FALSE;
+		}
+
+	/* the offsets are checked once, when the file is opened */
+	memcpy (&offset, reader->offsets + index, 4);
+	*str = reader->strings + offset;
+
+	return TRUE;
+}
+
+static xmlNode
+*rpt_compiled_reader_node (RptCompiledReader *reader, xmlDoc *xdoc, guint depth)
+{
+	xmlNode *xnode;
+	xmlNode *xchild;
+	const gchar *name;
+	const gchar *content;
+	const gchar *value;
+	guint32 n_attrs;
+	guint32 n_children;
+	guint32 i;
+
+	if (depth > RPT_COMPILED_MAX_DEPTH
+	    || reader->n_read >= reader->n_nodes
+	    || !rpt_compiled_reader_string (reader, FALSE, &name)
+	    || !rpt_compiled_reader_string (reader, TRUE, &content)
+	    || !rpt_compiled_reader_word (reader, &n_attrs)
+	    || !rpt_compiled_reader_word (reader, &n_children)
+	    || n_attrs > (reader->n_words - reader->pos) / 2)
+		{
+			return NULL;
+		}
+	reader->n_read++;
+
+	/* the raw node takes the content as it is, without entities */
+	xnode = xmlNewDocRawNode (xdoc, NULL, (const xmlChar *)name, (const xmlChar *)content);
+
+	for (i = 0; i < n_attrs; i++)
+		{
+			if (!rpt_compiled_reader_string (reader, FALSE, &name)
+			    || !rpt_compiled_reader_string (reader, FALSE, &value))
+				{
+					xmlFreeNode (xnode);
+					return NULL;
+				}
+			xmlNewProp (xnode, (const xmlChar *)name, (const xmlChar *)value);
+		}
+
+	for (i = 0; i < n_children; i++)
+		{
+			xchild = rpt_compiled_reader_node (reader, xdoc, depth + 1);
+			if (xchild == NULL)
+				{
+					xmlFreeNode (xnode);
+					return NULL;
+				}
+			xmlAddChild (xnode, xchild);
+		}
+
+	return xnode;
+}
+
+/**
+ * rpt_compiled_read:
+ * @data: the content of a compiled template, e.g. a mapped file.
+ * @length: the length of @data.
+ * @error: return location for a #GError, or NULL.
+ *
+ * Rebuilds the xml tree from a compiled template; nothing is parsed, the
+ * names and the values are taken from the strings' table. The report is
+ * then built from the tree as from one read from an xml file.
+ *
+ * Returns: the new #xmlDoc; NULL, with @error set, if @data isn't a valid
+ * compiled template or was written by another version.
+ */
+xmlDoc
+*rpt_compiled_read (const gchar *data, gsize length, GError **error)
+{
+	RptCompiledHeader header;
+	RptCompiledReader reader;
+	xmlDoc *xdoc;
+	xmlNode *xroot;
+	gsize size;
+	guint32 offset;
+	guint32 i;
+
+	if (!rpt_compiled_is_compiled (data, length))
+		{
+			g_set_error (error, RPT_REPORT_ERROR, RPT_REPORT_ERROR_INVALID_COMPILED,
+			             "It isn't a compiled template.");
+			return NULL;
+		}
+
+	/* the version comes first: the layout of the rest depends on it */
+	memcpy (&header, data, sizeof (header));
+	if (header.version != RPT_COMPILED_VERSION
+	    && GUINT32_SWAP_LE_BE (header.version) == RPT_COMPILED_VERSION)
+		{
+			g_set_error (error, RPT_REPORT_ERROR, RPT_REPORT_ERROR_VERSION_MISMATCH,
+			             "The compiled template was written on a machine with another byte order.");
+			return NULL;
+		}
+	if (header.version != RPT_COMPILED_VERSION)
+		{
+			g_set_error (error, RPT_REPORT_ERROR, RPT_REPORT_ERROR_VERSION_MISMATCH,
+			             "The compiled template has version %u, instead of %u; it must be compiled again.",
+			             header.version, RPT_COMPILED_VERSION);
+			return NULL;
+		}
+	if (strncmp (header.library_version, RPT_COMPILED_LIBRARY_VERSION, sizeof (header.library_version)) != 0)
+		{
+			g_set_error (error, RPT_REPORT_ERROR, RPT_REPORT_ERROR_VERSION_MISMATCH,
+			             "The compiled template was written by libreptool %.*s, instead of %s; it must be compiled again.",
+			             (gint)sizeof (header.library_version), header.library_version,
+			             RPT_COMPILED_LIBRARY_VERSION);
+			return NULL;
+		}
+	if (header.byte_order != RPT_COMPILED_BYTE_ORDER)
+		{
+			g_set_error (error, RPT_REPORT_ERROR, RPT_REPORT_ERROR_INVALID_COMPILED,
+			             "The header of the compiled template is corrupted.");
+			return NULL;
+		}
+
+	/* every section must be inside the data */
+	size = sizeof (header);
+	if (header.n_strings > (length - size) / 4
+	    || header.strings_size > length - size - header.n_strings * 4
+	    || header.strings_size % 4 != 0
+	    || (header.strings_size > 0 && header.n_strings == 0)
+	    || (header.n_strings > 0 && header.strings_size == 0))
+		{
+			g_set_error (error, RPT_REPORT_ERROR, RPT_REPORT_ERROR_INVALID_COMPILED,
+			             "The compiled template is truncated.");
+			return NULL;
+		}
+
+	reader.offsets = (const guint32 *)(data + size);
+	reader.n_strings = header.n_strings;
+	size += header.n_strings * 4;
+	reader.strings = data + size;
+	size += header.strings_size;
+	reader.nodes = data + size;
+	reader.n_words = (length - size) / 4;
+	reader.pos = 0;
+	reader.n_nodes = header.n_nodes;
+	reader.n_read = 0;
+
+	/* with the last byte nul, every string ends inside the blob */
+	if (header.strings_size > 0 && reader.strings[header.strings_size - 1] != '\0')
+		{
+			g_set_error (error, RPT_REPORT_ERROR, RPT_REPORT_ERROR_INVALID_COMPILED,
+			             "The strings' table of the compiled template is corrupted.");
+			return NULL;
+		}
+	for (i = 0; i < header.n_strings; i++)
+		{
+			memcpy (&offset, reader.offsets + i, 4);
+			if (offset >= header.strings_size)
+				{
+					g_set_error (error, RPT_REPORT_ERROR, RPT_REPORT_ERROR_INVALID_COMPILED,
+					             "The strings' table of the compiled template is corrupted.");
+					return NULL;
+				}
+		}
+
+	xdoc = xmlNewDoc ((const xmlChar *)"1.0");
+	xroot = rpt_compiled_reader_node (&reader, xdoc, 0);
+	if (xroot == NULL
+	    || reader.n_read != header.n_nodes
+	    || reader.pos != reader.n_words
+	    || (length - size) % 4 != 0)
+		{
+			if (xroot != NULL)
+				{
+					xmlFreeNode (xroot);
+				}
+			xmlFreeDoc (xdoc);
+			g_set_error (error, RPT_REPORT_ERROR, RPT_REPORT_ERROR_INVALID_COMPILED,
+			             "The nodes of the compiled template are corrupted.");
+			return NULL;
+		}
+	xmlDocSetRootElement (xdoc, xroot);
+
+	return xdoc;
+}
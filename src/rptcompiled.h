@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2007-2014 Andrea Zagli <azagli@libero.it>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef __RPT_COMPILED_H__
+#define __RPT_COMPILED_H__
+
+#include <glib.h>
+#include <libxml/tree.h>
+
+G_BEGIN_DECLS
+
+
+/* bumped on every change of the layout; the loader refuses the others,
+ * and the files written by another version of the library */
+#define RPT_COMPILED_VERSION 2
+
+gboolean rpt_compiled_is_compiled (const gchar *data, gsize length);
+
+gboolean rpt_compiled_write (xmlDoc *xdoc,
+                             const gchar *filename,
+                             GError **error);
+
+xmlDoc *rpt_compiled_read (const gchar *data,
+                           gsize length,
+                           GError **error);
+
+
+G_END_DECLS
+
+#endif /* __RPT_COMPILED_H__ */
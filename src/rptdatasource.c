@@ -0,0 +1,541 @@
+/*
+ * Copyright (C) 2007-2014 Andrea Zagli <azagli@libero.it>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <string.h>
+
+#include "rptdatasource.h"
+
+/* a string that the source doesn't copy, e.g. a piece of a mapped file */
+typedef struct
+{
+	const gchar *str;
+	gsize length;
+} RptDataSlice;
+
+struct _RptDataBatch
+{
+	gint n_columns;
+	guint n_rows;
+
+	/* the rows the arrays have room for */
+	guint allocated;
+
+	/* the position in the source of the first row */
+	guint64 first_row;
+
+	/* n_columns values for every row; a value not set is a null */
+	GValue *values;
+
+	/* like values, only when the source sets slices; a slice becomes a
+	 * value the first time it's read */
+	RptDataSlice *slices;
+
+	/* what the source keeps of every row (e.g. an iterator) */
+	gsize row_data_size;
+	guint8 *row_data;
+};
+
+static gint rpt_data_source_default_get_column_index (RptDataSource *source,
+                                                      const gchar *name);
+
+static void rpt_data_batch_unset_values (RptDataBatch *batch);
+
+G_DEFINE_INTERFACE (RptDataSource, rpt_data_source, G_TYPE_OBJECT)
+
+static void
+rpt_data_source_default_init (RptDataSourceInterface *iface)
+{
+	iface->get_column_index = rpt_data_source_default_get_column_index;
+}
+
+static gint
+rpt_data_source_default_get_column_index (RptDataSource *source, const gchar *name)
+{
+	gint n_columns;
+	gint col;
+
+	n_columns = rpt_data_source_get_n_columns (source);
+	for (col = 0; col < n_columns; col++)
+		{
+			if (g_strcmp0 (rpt_data_source_get_column_name (source, col), name) == 0)
+				{
+					return col;
+				}
+		}
+
+	return -1;
+}
+
+/**
+ * rpt_data_source_error_quark:
+ *
+ * Returns: the #GQuark of the #RptDataSource errors.
+ */
+GQuark
+rpt_data_source_error_quark (void)
+{
+	return g_quark_from_static_string ("rpt-data-source-error-quark");
+}
+
+/**
+ * rpt_data_source_get_n_columns:
+ * @source: an #RptDataSource.
+ *
+ * Returns: the number of columns of every row.
+ */
+gint
+rpt_data_source_get_n_columns (RptDataSource *source)
+{
+	g_return_val_if_fail (IS_RPT_DATA_SOURCE (source), 0);
+
+	return RPT_DATA_SOURCE_GET_INTERFACE (source)->get_n_columns (source);
+}
+
+/**
+ * rpt_data_source_get_column_name:
+ * @source: an #RptDataSource.
+ * @column: the column's index, from 0.
+ *
+ * Returns: the name of @column, the one used by the fields of the
+ * templates; NULL if the column has no name.
+ */
+const gchar
+*rpt_data_source_get_column_name (RptDataSource *source, gint column)
+{
+	g_return_val_if_fail (IS_RPT_DATA_SOURCE (source), NULL);
+
+	return RPT_DATA_SOURCE_GET_INTERFACE (source)->get_column_name (source, column);
+}
+
+/**
+ * rpt_data_source_get_column_type:
+ * @source: an #RptDataSource.
+ * @column: the column's index, from 0.
+ *
+ * Returns: the #GType of the values of @column.
+ */
+GType
+rpt_data_source_get_column_type (RptDataSource *source, gint column)
+{
+	g_return_val_if_fail (IS_RPT_DATA_SOURCE (source), G_TYPE_INVALID);
+
+	return RPT_DATA_SOURCE_GET_INTERFACE (source)->get_column_type (source, column);
+}
+
+/**
+ * rpt_data_source_get_column_index:
+ * @source: an #RptDataSource.
+ * @name: a field's name.
+ *
+ * Returns: the index of the column for the field @name; -1 if @source
+ * doesn't have it.
+ */
+gint
+rpt_data_source_get_column_index (RptDataSource *source, const gchar *name)
+{
+	g_return_val_if_fail (IS_RPT_DATA_SOURCE (source), -1);
+	g_return_val_if_fail (name != NULL, -1);
+
+	return RPT_DATA_SOURCE_GET_INTERFACE (source)->get_column_index (source, name);
+}
+
+/**
+ * rpt_data_source_rewind:
+ * @source: an #RptDataSource.
+ * @error: return location for a #GError, or NULL.
+ *
+ * Starts again from the first row; every run of a report calls it before
+ * the first rpt_data_source_next_batch().
+ *
+ * Returns: FALSE, with @error set, if @source cannot start again.
+ */
+gboolean
+rpt_data_source_rewind (RptDataSource *source, GError **error)
+{
+	g_return_val_if_fail (IS_RPT_DATA_SOURCE (source), FALSE);
+
+	return RPT_DATA_SOURCE_GET_INTERFACE (source)->rewind (source, error);
+}
+
+/**
+ * rpt_data_source_next_batch:
+ * @source: an #RptDataSource.
+ * @batch: the #RptDataBatch to fill; its previous rows are dropped.
+ * @n_rows: the most rows to fetch.
+ * @error: return location for a #GError, or NULL.
+ *
+ * Fetches the next rows, up to @n_rows, in @batch: a source is read once
+ * for many rows, not once for every value.
+ *
+ * Returns: the rows fetched; 0 at the end of the rows or on error, with
+ * @error set.
+ */
+guint
+rpt_data_source_next_batch (RptDataSource *source,
+                            RptDataBatch *batch,
+                            guint n_rows,
+                            GError **error)
+{
+	g_return_val_if_fail (IS_RPT_DATA_SOURCE (source), 0);
+	g_return_val_if_fail (batch != NULL, 0);
+
+	return RPT_DATA_SOURCE_GET_INTERFACE (source)->next_batch (source, batch, n_rows, error);
+}
+
+/**
+ * rpt_data_source_get_row_origin:
+ * @source: an #RptDataSource.
+ * @batch: an #RptDataBatch filled by @source.
+ * @row: a row of @batch.
+ * @data_model: (out): the #GdaDataModel of @row, or NULL.
+ * @model_row: (out): the row of @data_model, or -1.
+ * @tree_model: (out): the #GtkTreeModel of @row, or NULL.
+ * @iter: (out): the #GtkTreeIter of @row, or NULL.
+ *
+ * Tells the model @row comes from, the way the RptReport::field-request
+ * signal shows it; the iter is valid as long as @batch isn't reset.
+ */
+void
+rpt_data_source_get_row_origin (RptDataSource *source,
+                                RptDataBatch *batch,
+                                guint row,
+                                GdaDataModel **data_model,
+                                gint *model_row,
+                                GObject **tree_model,
+                                gpointer *iter)
+{
+	RptDataSourceInterface *iface;
+
+	g_return_if_fail (IS_RPT_DATA_SOURCE (source));
+
+	*data_model = NULL;
+	*model_row = -1;
+	*tree_model = NULL;
+	*iter = NULL;
+
+	iface = RPT_DATA_SOURCE_GET_INTERFACE (source);
+	if (iface->get_row_origin != NULL)
+		{
+			iface->get_row_origin (source, batch, row, data_model, model_row, tree_model, iter);
+		}
+}
+
+/**
+ * rpt_data_batch_new:
+ *
+ * Returns: a new, empty, #RptDataBatch; the same batch should be filled
+ * again and again, so its memory is reused.
+ */
+RptDataBatch
+*rpt_data_batch_new (void)
+{
+	return g_new0 (RptDataBatch, 1);
+}
+
+static void
+rpt_data_batch_unset_values (RptDataBatch *batch)
+{
+	guint i;
+
+	for (i = 0; i < batch->n_rows * batch->n_columns; i++)
+		{
+			if (G_IS_VALUE (&batch->values[i]))
+				{
+					g_value_unset (&batch->values[i]);
+				}
+		}
+	if (batch->slices != NULL)
+		{
+			memset (batch->slices, 0, batch->n_rows * batch->n_columns * sizeof (RptDataSlice));
+		}
+	batch->n_rows = 0;
+}
+
+/**
+ * rpt_data_batch_free:
+ * @batch: an #RptDataBatch.
+ *
+ */
+void
+rpt_data_batch_free (RptDataBatch *batch)
+{
+	if (batch == NULL)
+		{
+			return;
+		}
+
+	rpt_data_batch_unset_values (batch);
+	g_free (batch->values);
+	g_free (batch->slices);
+	g_free (batch->row_data);
+	g_free (batch);
+}
+
+/**
+ * rpt_data_batch_reset:
+ * @batch: an #RptDataBatch.
+ * @n_columns: the columns of every row.
+ * @first_row: the position in the source of the first row that will be
+ * added.
+ * @row_data_size: the bytes the source keeps for every row; 0 for none.
+ *
+ * Empties @batch before a source fills it with rpt_data_batch_add_row().
+ */
+void
+rpt_data_batch_reset (RptDataBatch *batch,
+                      gint n_columns,
+                      guint64 first_row,
+                      gsize row_data_size)
+{
+	g_return_if_fail (batch != NULL);
+	g_return_if_fail (n_columns >= 0);
+
+	rpt_data_batch_unset_values (batch);
+
+	if (n_columns != batch->n_columns || row_data_size != batch->row_data_size)
+		{
+			g_free (batch->values);
+			g_free (batch->slices);
+			g_free (batch->row_data);
+			batch->values = NULL;
+			batch->slices = NULL;
+			batch->row_data = NULL;
+			batch->allocated = 0;
+		}
+
+	batch->n_columns = n_columns;
+	batch->row_data_size = row_data_size;
+	batch->first_row = first_row;
+}
+
+/**
+ * rpt_data_batch_add_row:
+ * @batch: an #RptDataBatch.
+ *
+ * Adds a row at the end of @batch.
+ *
+ * Returns: the new row's values, n_columns zero-filled #GValue to
+ * initialize and set; the ones left as they are become nulls.
+ */
+GValue
+*rpt_data_batch_add_row (RptDataBatch *batch)
+{
+	guint allocated;
+
+	g_return_val_if_fail (batch != NULL, NULL);
+
+	if (batch->n_rows == batch->allocated)
+		{
+			allocated = MAX (16, batch->allocated * 2);
+			batch->values = g_renew (GValue, batch->values, allocated * batch->n_columns);
+			memset (batch->values + batch->allocated * batch->n_columns, 0,
+			        (allocated - batch->allocated) * batch->n_columns * sizeof (GValue));
+			if (batch->slices != NULL)
+				{
+					batch->slices = g_renew (RptDataSlice, batch->slices, allocated * batch->n_columns);
+					memset (batch->slices + batch->allocated * batch->n_columns, 0,
+					        (allocated - batch->allocated) * batch->n_columns * sizeof (RptDataSlice));
+				}
+			if (batch->row_data_size > 0)
+				{
+					batch->row_data = g_realloc (batch->row_data, allocated * batch->row_data_size);
+				}
+			batch->allocated = allocated;
+		}
+
+	return batch->values + batch->n_rows++ * batch->n_columns;
+}
+
+/**
+ * rpt_data_batch_swap:
+ * @batch: an #RptDataBatch.
+ * @other: another #RptDataBatch.
+ *
+ * Exchanges the rows of @batch and @other, without copying them; e.g. a
+ * source that fetches in advance gives its rows this way.
+ */
+void
+rpt_data_batch_swap (RptDataBatch *batch, RptDataBatch *other)
+{
+	RptDataBatch tmp;
+
+	g_return_if_fail (batch != NULL);
+	g_return_if_fail (other != NULL);
+
+	tmp = *batch;
+	*batch = *other;
+	*other = tmp;
+}
+
+/**
+ * rpt_data_batch_get_n_rows:
+ * @batch: an #RptDataBatch.
+ *
+ */
+guint
+rpt_data_batch_get_n_rows (RptDataBatch *batch)
+{
+	g_return_val_if_fail (batch != NULL, 0);
+
+	return batch->n_rows;
+}
+
+/**
+ * rpt_data_batch_get_first_row:
+ * @batch: an #RptDataBatch.
+ *
+ * Returns: the position in the source of the first row of @batch.
+ */
+guint64
+rpt_data_batch_get_first_row (RptDataBatch *batch)
+{
+	g_return_val_if_fail (batch != NULL, 0);
+
+	return batch->first_row;
+}
+
+/**
+ * rpt_data_batch_get_value:
+ * @batch: an #RptDataBatch.
+ * @row: a row of @batch.
+ * @column: a column.
+ *
+ * Returns: the value, owned by @batch; a value that isn't set (see
+ * gda_value_is_null()) is a null. A slice is copied in a string value
+ * here, so only the values read are copied.
+ */
+const GValue
+*rpt_data_batch_get_value (RptDataBatch *batch, guint row, gint column)
+{
+	guint i;
+
+	g_return_val_if_fail (batch != NULL, NULL);
+
+	if (row >= batch->n_rows || column < 0 || column >= batch->n_columns)
+		{
+			return NULL;
+		}
+
+	i = row * batch->n_columns + column;
+	if (batch->slices != NULL
+	    && batch->slices[i].str != NULL
+	    && !G_IS_VALUE (&batch->values[i]))
+		{
+			g_value_init (&batch->values[i], G_TYPE_STRING);
+			g_value_take_string (&batch->values[i],
+			                     g_strndup (batch->slices[i].str, batch->slices[i].length));
+		}
+
+	return &batch->values[i];
+}
+
+/**
+ * rpt_data_batch_set_slice:
+ * @batch: an #RptDataBatch.
+ * @row: a row of @batch.
+ * @column: a column.
+ * @str: a string that stays valid until @batch is reset; it doesn't need
+ * the nul.
+ * @length: the bytes of @str.
+ *
+ * Sets the value as a string without copying it; the source doesn't
+ * allocate anything for the values that aren't read.
+ */
+void
+rpt_data_batch_set_slice (RptDataBatch *batch,
+                          guint row,
+                          gint column,
+                          const gchar *str,
+                          gsize length)
+{
+	guint i;
+
+	g_return_if_fail (batch != NULL);
+	g_return_if_fail (row < batch->n_rows);
+	g_return_if_fail (column >= 0 && column < batch->n_columns);
+	g_return_if_fail (str != NULL);
+
+	if (batch->slices == NULL)
+		{
+			batch->slices = g_new0 (RptDataSlice, batch->allocated * batch->n_columns);
+		}
+
+	i = row * batch->n_columns + column;
+	batch->slices[i].str = str;
+	batch->slices[i].length = length;
+}
+
+/**
+ * rpt_data_batch_get_slice:
+ * @batch: an #RptDataBatch.
+ * @row: a row of @batch.
+ * @column: a column.
+ * @str: (out): the start of the string, not nul terminated.
+ * @length: (out): the bytes of @str.
+ *
+ * Returns: TRUE if the value was set with rpt_data_batch_set_slice().
+ */
+gboolean
+rpt_data_batch_get_slice (RptDataBatch *batch,
+                          guint row,
+                          gint column,
+                          const gchar **str,
+                          gsize *length)
+{
+	guint i;
+
+	g_return_val_if_fail (batch != NULL, FALSE);
+
+	if (batch->slices == NULL
+	    || row >= batch->n_rows || column < 0 || column >= batch->n_columns)
+		{
+			return FALSE;
+		}
+
+	i = row * batch->n_columns + column;
+	if (batch->slices[i].str == NULL)
+		{
+			return FALSE;
+		}
+
+	*str = batch->slices[i].str;
+	*length = batch->slices[i].length;
+
+	return TRUE;
+}
+
+/**
+ * rpt_data_batch_get_row_data:
+ * @batch: an #RptDataBatch.
+ * @row: a row of @batch.
+ *
+ * Returns: the row_data_size bytes the source keeps for @row.
+ */
+gpointer
+rpt_data_batch_get_row_data (RptDataBatch *batch, guint row)
+{
+	g_return_val_if_fail (batch != NULL, NULL);
+	g_return_val_if_fail (row < batch->n_rows, NULL);
+
+	if (batch->row_data_size == 0)
+		{
+			return NULL;
+		}
+
+	return batch->row_data + row * batch->row_data_size;
+}
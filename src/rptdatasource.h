@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2007-2011 Andrea Zagli <azagli@libero.it>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ */
+
+#ifndef __RPT_DATA_SOURCE_H__
+#define __RPT_DATA_SOURCE_H__
+
+#include <glib.h>
+#include <glib-object.h>
+#include <libgda/libgda.h>
+
+G_BEGIN_DECLS
+
+
+#define TYPE_RPT_DATA_SOURCE                 (rpt_data_source_get_type ())
+#define RPT_DATA_SOURCE(obj)                 (G_TYPE_CHECK_INSTANCE_CAST ((obj), TYPE_RPT_DATA_SOURCE, RptDataSource))
+#define IS_RPT_DATA_SOURCE(obj)              (G_TYPE_CHECK_INSTANCE_TYPE ((obj), TYPE_RPT_DATA_SOURCE))
+#define RPT_DATA_SOURCE_GET_INTERFACE(obj)   (G_TYPE_INSTANCE_GET_INTERFACE ((obj), TYPE_RPT_DATA_SOURCE, RptDataSourceInterface))
+
+
+typedef struct _RptDataSource RptDataSource;
+typedef struct _RptDataSourceInterface RptDataSourceInterface;
+
+typedef struct _RptDataBatch RptDataBatch;
+
+#define RPT_DATA_SOURCE_ERROR rpt_data_source_error_quark ()
+
+typedef enum
+{
+	RPT_DATA_SOURCE_ERROR_INVALID_DATA
+} RptDataSourceError;
+
+GQuark rpt_data_source_error_quark (void);
+
+struct _RptDataSourceInterface
+	{
+		GTypeInterface parent_iface;
+
+		gint (*get_n_columns) (RptDataSource *source);
+		const gchar *(*get_column_name) (RptDataSource *source, gint column);
+		GType (*get_column_type) (RptDataSource *source, gint column);
+
+		/* optional: the default looks for the name between the columns */
+		gint (*get_column_index) (RptDataSource *source, const gchar *name);
+
+		gboolean (*rewind) (RptDataSource *source, GError **error);
+		guint (*next_batch) (RptDataSource *source,
+		                     RptDataBatch *batch,
+		                     guint n_rows,
+		                     GError **error);
+
+		/* optional: where the row comes from, for RptReport::field-request */
+		void (*get_row_origin) (RptDataSource *source,
+		                        RptDataBatch *batch,
+		                        guint row,
+		                        GdaDataModel **data_model,
+		                        gint *model_row,
+		                        GObject **tree_model,
+		                        gpointer *iter);
+	};
+
+GType rpt_data_source_get_type (void) G_GNUC_CONST;
+
+
+gint rpt_data_source_get_n_columns (RptDataSource *source);
+const gchar *rpt_data_source_get_column_name (RptDataSource *source, gint column);
+GType rpt_data_source_get_column_type (RptDataSource *source, gint column);
+gint rpt_data_source_get_column_index (RptDataSource *source, const gchar *name);
+
+gboolean rpt_data_source_rewind (RptDataSource *source, GError **error);
+guint rpt_data_source_next_batch (RptDataSource *source,
+                                  RptDataBatch *batch,
+                                  guint n_rows,
+                                  GError **error);
+
+void rpt_data_source_get_row_origin (RptDataSource *source,
+                                     RptDataBatch *batch,
+                                     guint row,
+                                     GdaDataModel **data_model,
+                                     gint *model_row,
+                                     GObject **tree_model,
+                                     gpointer *iter);
+
+
+RptDataBatch *rpt_data_batch_new (void);
+void rpt_data_batch_free (RptDataBatch *batch);
+
+void rpt_data_batch_reset (RptDataBatch *batch,
+                           gint n_columns,
+                           guint64 first_row,
+                           gsize row_data_size);
+GValue *rpt_data_batch_add_row (RptDataBatch *batch);
+void rpt_data_batch_swap (RptDataBatch *batch, RptDataBatch *other);
+
+guint rpt_data_batch_get_n_rows (RptDataBatch *batch);
+guint64 rpt_data_batch_get_first_row (RptDataBatch *batch);
+const GValue *rpt_data_batch_get_value (RptDataBatch *batch,
+                                        guint row,
+                                        gint column);
+gpointer rpt_data_batch_get_row_data (RptDataBatch *batch, guint row);
+
+void rpt_data_batch_set_slice (RptDataBatch *batch,
+                               guint row,
+                               gint column,
+                               const gchar *str,
+                               gsize length);
+gboolean rpt_data_batch_get_slice (RptDataBatch *batch,
+                                   guint row,
+                                   gint column,
+                                   const gchar **str,
+                                   gsize *length);
+
+
+G_END_DECLS
+
+#endif /* __RPT_DATA_SOURCE_H__ */
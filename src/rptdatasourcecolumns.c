@@ -0,0 +1,366 @@
+/*
+ * Copyright (C) 2007-2014 Andrea Zagli <azagli@libero.it>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "rptdatasourcecolumns.h"
+
+typedef struct
+{
+	gchar *name;
+	GType type;
+
+	/* the application's arrays, never copied */
+	gconstpointer values;
+	const gsize *lengths;
+	const guint8 *nulls;
+} RptDataSourceColumn;
+
+static void rpt_data_source_columns_interface_init (RptDataSourceInterface *iface);
+
+static void rpt_data_source_columns_finalize (GObject *object);
+
+static void rpt_data_source_columns_add (RptDataSourceColumns *source,
+                                         const gchar *name,
+                                         GType type,
+                                         gconstpointer values,
+                                         const gsize *lengths,
+                                         const guint8 *nulls);
+
+static gint rpt_data_source_columns_get_n_columns (RptDataSource *source);
+static const gchar *rpt_data_source_columns_get_column_name (RptDataSource *source,
+                                                             gint column);
+static GType rpt_data_source_columns_get_column_type (RptDataSource *source,
+                                                      gint column);
+static gint rpt_data_source_columns_get_column_index (RptDataSource *source,
+                                                      const gchar *name);
+static gboolean rpt_data_source_columns_rewind (RptDataSource *source,
+                                                GError **error);
+static guint rpt_data_source_columns_next_batch (RptDataSource *source,
+                                                 RptDataBatch *batch,
+                                                 guint n_rows,
+                                                 GError **error);
+
+#define RPT_DATA_SOURCE_COLUMNS_GET_PRIVATE(obj) (G_TYPE_INSTANCE_GET_PRIVATE ((obj), TYPE_RPT_DATA_SOURCE_COLUMNS, RptDataSourceColumnsPrivate))
+
+typedef struct _RptDataSourceColumnsPrivate RptDataSourceColumnsPrivate;
+struct _RptDataSourceColumnsPrivate
+	{
+		guint n_rows;
+
+		/* RptDataSourceColumn */
+		GArray *columns;
+		/* column's name -> index + 1 */
+		GHashTable *indexes;
+
+		/* the next row to fetch */
+		guint row;
+	};
+
+G_DEFINE_TYPE_WITH_CODE (RptDataSourceColumns, rpt_data_source_columns, G_TYPE_OBJECT,
+                         G_IMPLEMENT_INTERFACE (TYPE_RPT_DATA_SOURCE,
+                                                rpt_data_source_columns_interface_init))
+
+static void
+rpt_data_source_columns_class_init (RptDataSourceColumnsClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+	g_type_class_add_private (object_class, sizeof (RptDataSourceColumnsPrivate));
+
+	object_class->finalize = rpt_data_source_columns_finalize;
+}
+
+static void
+rpt_data_source_columns_interface_init (RptDataSourceInterface *iface)
+{
+	iface->get_n_columns = rpt_data_source_columns_get_n_columns;
+	iface->get_column_name = rpt_data_source_columns_get_column_name;
+	iface->get_column_type = rpt_data_source_columns_get_column_type;
+	iface->get_column_index = rpt_data_source_columns_get_column_index;
+	iface->rewind = rpt_data_source_columns_rewind;
+	iface->next_batch = rpt_data_source_columns_next_batch;
+}
+
+static void
+rpt_data_source_columns_init (RptDataSourceColumns *rpt_data_source_columns)
+{
+	RptDataSourceColumnsPrivate *priv = RPT_DATA_SOURCE_COLUMNS_GET_PRIVATE (rpt_data_source_columns);
+
+	priv->n_rows = 0;
+	priv->columns = g_array_new (FALSE, FALSE, sizeof (RptDataSourceColumn));
+	priv->indexes = g_hash_table_new (g_str_hash, g_str_equal);
+	priv->row = 0;
+}
+
+/**
+ * rpt_data_source_columns_new:
+ * @n_rows: the number of rows, the length of every column.
+ *
+ * Creates a source over the application's own arrays, one for every
+ * column, added with rpt_data_source_columns_add_int64() and the others:
+ * the arrays aren't copied, and must stay valid and unchanged as long as
+ * the source is alive.
+ *
+ * Every column can have a bitmap of the nulls: the bit (row % 8) of the
+ * byte (row / 8) is set if the row's value is null.
+ *
+ * Returns: a new #RptDataSource.
+ */
+RptDataSource
+*rpt_data_source_columns_new (guint n_rows)
+{
+	RptDataSourceColumns *source;
+
+	source = RPT_DATA_SOURCE_COLUMNS (g_object_new (rpt_data_source_columns_get_type (), NULL));
+
+	RptDataSourceColumnsPrivate *priv = RPT_DATA_SOURCE_COLUMNS_GET_PRIVATE (source);
+
+	priv->n_rows = n_rows;
+
+	return RPT_DATA_SOURCE (source);
+}
+
+static void
+rpt_data_source_columns_add (RptDataSourceColumns *source,
+                             const gchar *name,
+                             GType type,
+                             gconstpointer values,
+                             const gsize *lengths,
+                             const guint8 *nulls)
+{
+	RptDataSourceColumn column;
+
+	RptDataSourceColumnsPrivate *priv = RPT_DATA_SOURCE_COLUMNS_GET_PRIVATE (source);
+
+	if (g_hash_table_lookup (priv->indexes, name) != NULL)
+		{
+			g_warning ("The column «%s» already exists.", name);
+			return;
+		}
+
+	column.name = g_strdup (name);
+	column.type = type;
+	column.values = values;
+	column.lengths = lengths;
+	column.nulls = nulls;
+	g_array_append_val (priv->columns, column);
+
+	g_hash_table_insert (priv->indexes, column.name, GUINT_TO_POINTER (priv->columns->len));
+}
+
+/**
+ * rpt_data_source_columns_add_int64:
+ * @source: an #RptDataSourceColumns.
+ * @name: the column's name, the field of the templates.
+ * @values: n_rows values.
+ * @nulls: the nulls' bitmap; NULL if there aren't nulls.
+ *
+ */
+void
+rpt_data_source_columns_add_int64 (RptDataSourceColumns *source,
+                                   const gchar *name,
+                                   const gint64 *values,
+                                   const guint8 *nulls)
+{
+	g_return_if_fail (IS_RPT_DATA_SOURCE_COLUMNS (source));
+	g_return_if_fail (name != NULL);
+	g_return_if_fail (values != NULL);
+
+	rpt_data_source_columns_add (source, name, G_TYPE_INT64, values, NULL, nulls);
+}
+
+/**
+ * rpt_data_source_columns_add_double:
+ * @source: an #RptDataSourceColumns.
+ * @name: the column's name, the field of the templates.
+ * @values: n_rows values.
+ * @nulls: the nulls' bitmap; NULL if there aren't nulls.
+ *
+ */
+void
+rpt_data_source_columns_add_double (RptDataSourceColumns *source,
+                                    const gchar *name,
+                                    const gdouble *values,
+                                    const guint8 *nulls)
+{
+	g_return_if_fail (IS_RPT_DATA_SOURCE_COLUMNS (source));
+	g_return_if_fail (name != NULL);
+	g_return_if_fail (values != NULL);
+
+	rpt_data_source_columns_add (source, name, G_TYPE_DOUBLE, values, NULL, nulls);
+}
+
+/**
+ * rpt_data_source_columns_add_string:
+ * @source: an #RptDataSourceColumns.
+ * @name: the column's name, the field of the templates.
+ * @values: n_rows strings; a NULL string is a null.
+ * @lengths: the bytes of every string, that then doesn't need the nul;
+ * NULL if the strings are nul terminated.
+ * @nulls: the nulls' bitmap; NULL if there aren't nulls.
+ *
+ */
+void
+rpt_data_source_columns_add_string (RptDataSourceColumns *source,
+                                    const gchar *name,
+                                    const gchar * const *values,
+                                    const gsize *lengths,
+                                    const guint8 *nulls)
+{
+	g_return_if_fail (IS_RPT_DATA_SOURCE_COLUMNS (source));
+	g_return_if_fail (name != NULL);
+	g_return_if_fail (values != NULL);
+
+	rpt_data_source_columns_add (source, name, G_TYPE_STRING, values, lengths, nulls);
+}
+
+static gint
+rpt_data_source_columns_get_n_columns (RptDataSource *source)
+{
+	RptDataSourceColumnsPrivate *priv = RPT_DATA_SOURCE_COLUMNS_GET_PRIVATE (source);
+
+	return priv->columns->len;
+}
+
+static const gchar
+*rpt_data_source_columns_get_column_name (RptDataSource *source, gint column)
+{
+	RptDataSourceColumnsPrivate *priv = RPT_DATA_SOURCE_COLUMNS_GET_PRIVATE (source);
+
+	if (column < 0 || column >= (gint)priv->columns->len)
+		{
+			return NULL;
+		}
+
+	return g_array_index (priv->columns, RptDataSourceColumn, column).name;
+}
+
+static GType
+rpt_data_source_columns_get_column_type (RptDataSource *source, gint column)
+{
+	RptDataSourceColumnsPrivate *priv = RPT_DATA_SOURCE_COLUMNS_GET_PRIVATE (source);
+
+	if (column < 0 || column >= (gint)priv->columns->len)
+		{
+			return G_TYPE_INVALID;
+		}
+
+	return g_array_index (priv->columns, RptDataSourceColumn, column).type;
+}
+
+static gint
+rpt_data_source_columns_get_column_index (RptDataSource *source, const gchar *name)
+{
+	RptDataSourceColumnsPrivate *priv = RPT_DATA_SOURCE_COLUMNS_GET_PRIVATE (source);
+
+	return GPOINTER_TO_INT (g_hash_table_lookup (priv->indexes, name)) - 1;
+}
+
+static gboolean
+rpt_data_source_columns_rewind (RptDataSource *source, GError **error)
+{
+	RptDataSourceColumnsPrivate *priv = RPT_DATA_SOURCE_COLUMNS_GET_PRIVATE (source);
+
+	priv->row = 0;
+
+	return TRUE;
+}
+
+static guint
+rpt_data_source_columns_next_batch (RptDataSource *source,
+                                    RptDataBatch *batch,
+                                    guint n_rows,
+                                    GError **error)
+{
+	RptDataSourceColumn *column;
+	GValue *values;
+	const gchar *str;
+	guint last;
+	guint row;
+	guint col;
+
+	RptDataSourceColumnsPrivate *priv = RPT_DATA_SOURCE_COLUMNS_GET_PRIVATE (source);
+
+	rpt_data_batch_reset (batch, priv->columns->len, priv->row, 0);
+
+	last = priv->row + MIN (n_rows, priv->n_rows - priv->row);
+	for (row = priv->row; row < last; row++)
+		{
+			values = rpt_data_batch_add_row (batch);
+			for (col = 0; col < priv->columns->len; col++)
+				{
+					column = &g_array_index (priv->columns, RptDataSourceColumn, col);
+					if (column->nulls != NULL
+					    && (column->nulls[row / 8] & (1 << (row % 8))))
+						{
+							/* left unset */
+							continue;
+						}
+
+					/* the numbers are in the value, the strings are pointed */
+					if (column->type == G_TYPE_INT64)
+						{
+							g_value_init (&values[col], G_TYPE_INT64);
+							g_value_set_int64 (&values[col], ((const gint64 *)column->values)[row]);
+						}
+					else if (column->type == G_TYPE_DOUBLE)
+						{
+							g_value_init (&values[col], G_TYPE_DOUBLE);
+							g_value_set_double (&values[col], ((const gdouble *)column->values)[row]);
+						}
+					else
+						{
+							str = ((const gchar * const *)column->values)[row];
+							if (str == NULL)
+								{
+									continue;
+								}
+							if (column->lengths != NULL)
+								{
+									rpt_data_batch_set_slice (batch, row - priv->row, col, str, column->lengths[row]);
+								}
+							else
+								{
+									g_value_init (&values[col], G_TYPE_STRING);
+									g_value_set_static_string (&values[col], str);
+								}
+						}
+				}
+		}
+
+	n_rows = last - priv->row;
+	priv->row = last;
+
+	return n_rows;
+}
+
+static void
+rpt_data_source_columns_finalize (GObject *object)
+{
+	guint col;
+
+	RptDataSourceColumnsPrivate *priv = RPT_DATA_SOURCE_COLUMNS_GET_PRIVATE (object);
+
+	g_hash_table_destroy (priv->indexes);
+	for (col = 0; col < priv->columns->len; col++)
+		{
+			g_free (g_array_index (priv->columns, RptDataSourceColumn, col).name);
+		}
+	g_array_free (priv->columns, TRUE);
+
+	G_OBJECT_CLASS (rpt_data_source_columns_parent_class)->finalize (object);
+}
@@ -0,0 +1,453 @@
+/*
+ * Copyright (C) 2007-2014 Andrea Zagli <azagli@libero.it>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <string.h>
+
+#include "rptdatasourcecsv.h"
+
+static void rpt_data_source_csv_interface_init (RptDataSourceInterface *iface);
+
+static void rpt_data_source_csv_finalize (GObject *object);
+
+static gint rpt_data_source_csv_get_n_columns (RptDataSource *source);
+static const gchar *rpt_data_source_csv_get_column_name (RptDataSource *source,
+                                                         gint column);
+static GType rpt_data_source_csv_get_column_type (RptDataSource *source,
+                                                  gint column);
+static gboolean rpt_data_source_csv_rewind (RptDataSource *source,
+                                            GError **error);
+static guint rpt_data_source_csv_next_batch (RptDataSource *source,
+                                             RptDataBatch *batch,
+                                             guint n_rows,
+                                             GError **error);
+
+static const gchar *rpt_data_source_csv_find (const gchar *p,
+                                              const gchar *end,
+                                              gchar c1,
+                                              gchar c2);
+static const gchar *rpt_data_source_csv_read_field (RptDataSourceCsv *source,
+                                                    const gchar *p,
+                                                    const gchar **str,
+                                                    gsize *length,
+                                                    gchar **unescaped);
+
+#define RPT_DATA_SOURCE_CSV_GET_PRIVATE(obj) (G_TYPE_INSTANCE_GET_PRIVATE ((obj), TYPE_RPT_DATA_SOURCE_CSV, RptDataSourceCsvPrivate))
+
+typedef struct _RptDataSourceCsvPrivate RptDataSourceCsvPrivate;
+struct _RptDataSourceCsvPrivate
+	{
+		gchar *filename;
+		GMappedFile *mapped;
+
+		const gchar *data;
+		const gchar *end;
+
+		/* the first record after the header, and the next to read */
+		const gchar *first;
+		const gchar *pos;
+		guint64 row;
+
+		gchar delimiter;
+
+		gint n_columns;
+		gchar **names;
+	};
+
+G_DEFINE_TYPE_WITH_CODE (RptDataSourceCsv, rpt_data_source_csv, G_TYPE_OBJECT,
+                         G_IMPLEMENT_INTERFACE (TYPE_RPT_DATA_SOURCE,
+                                                rpt_data_source_csv_interface_init))
+
+static void
+rpt_data_source_csv_class_init (RptDataSourceCsvClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+	g_type_class_add_private (object_class, sizeof (RptDataSourceCsvPrivate));
+
+	object_class->finalize = rpt_data_source_csv_finalize;
+}
+
+static void
+rpt_data_source_csv_interface_init (RptDataSourceInterface *iface)
+{
+	iface->get_n_columns = rpt_data_source_csv_get_n_columns;
+	iface->get_column_name = rpt_data_source_csv_get_column_name;
+	iface->get_column_type = rpt_data_source_csv_get_column_type;
+	iface->rewind = rpt_data_source_csv_rewind;
+	iface->next_batch = rpt_data_source_csv_next_batch;
+}
+
+static void
+rpt_data_source_csv_init (RptDataSourceCsv *rpt_data_source_csv)
+{
+	RptDataSourceCsvPrivate *priv = RPT_DATA_SOURCE_CSV_GET_PRIVATE (rpt_data_source_csv);
+
+	priv->filename = NULL;
+	priv->mapped = NULL;
+	priv->data = NULL;
+	priv->end = NULL;
+	priv->first = NULL;
+	priv->pos = NULL;
+	priv->row = 0;
+	priv->delimiter = ',';
+	priv->n_columns = 0;
+	priv->names = NULL;
+}
+
+/**
+ * rpt_data_source_csv_new:
+ * @filename: the path of a csv or tsv file.
+ * @delimiter: the fields' delimiter; 0 for a tab if @filename ends with
+ * ".tsv" or ".tab", a comma otherwise.
+ * @error: return location for a #GError, or NULL.
+ *
+ * Maps @filename; its first record has the columns' names, that are the
+ * fields of the templates. The records are split when they are fetched,
+ * and the fields are pieces of the mapping: only the fields with doubled
+ * quotes are copied, to remove them, and a field is copied in a string
+ * only when a template reads it.
+ *
+ * Returns: a new #RptDataSource; NULL, with @error set, if @filename
+ * cannot be read or hasn't the header.
+ */
+RptDataSource
+*rpt_data_source_csv_new (const gchar *filename, gchar delimiter, GError **error)
+{
+	RptDataSourceCsv *source;
+	GMappedFile *mapped;
+	GPtrArray *names;
+	const gchar *p;
+	const gchar *str;
+	gsize length;
+	gchar *unescaped;
+
+	g_return_val_if_fail (filename != NULL, NULL);
+
+	mapped = g_mapped_file_new (filename, FALSE, error);
+	if (mapped == NULL)
+		{
+			return NULL;
+		}
+
+	source = RPT_DATA_SOURCE_CSV (g_object_new (rpt_data_source_csv_get_type (), NULL));
+
+	RptDataSourceCsvPrivate *priv = RPT_DATA_SOURCE_CSV_GET_PRIVATE (source);
+
+	priv->filename = g_strdup (filename);
+	priv->mapped = mapped;
+	priv->data = g_mapped_file_get_contents (mapped);
+	priv->end = priv->data + g_mapped_file_get_length (mapped);
+
+	if (delimiter == '\0')
+		{
+			delimiter = g_str_has_suffix (filename, ".tsv") || g_str_has_suffix (filename, ".tab") ? '\t' : ',';
+		}
+	priv->delimiter = delimiter;
+
+	p = priv->data;
+	if (p != NULL && priv->end - p >= 3 && memcmp (p, "\xEF\xBB\xBF", 3) == 0)
+		{
+			/* utf-8 bom */
+			p += 3;
+		}
+	if (p == NULL || p == priv->end)
+		{
+			g_set_error (error, RPT_DATA_SOURCE_ERROR, RPT_DATA_SOURCE_ERROR_INVALID_DATA,
+			             "«%s» hasn't the columns' names.", filename);
+			g_object_unref (source);
+			return NULL;
+		}
+
+	/* the header */
+	names = g_ptr_array_new ();
+	for (;;)
+		{
+			p = rpt_data_source_csv_read_field (source, p, &str, &length, &unescaped);
+			if (p == NULL)
+				{
+					g_set_error (error, RPT_DATA_SOURCE_ERROR, RPT_DATA_SOURCE_ERROR_INVALID_DATA,
+					             "«%s» has a quote without its end.", filename);
+					g_ptr_array_add (names, NULL);
+					g_strfreev ((gchar **)g_ptr_array_free (names, FALSE));
+					g_object_unref (source);
+					return NULL;
+				}
+			g_ptr_array_add (names, unescaped != NULL ? unescaped : g_strndup (str, length));
+
+			if (p < priv->end && *p == priv->delimiter)
+				{
+					p++;
+					continue;
+				}
+			if (p < priv->end)
+				{
+					/* the newline */
+					p++;
+				}
+			break;
+		}
+	priv->n_columns = names->len;
+	g_ptr_array_add (names, NULL);
+	priv->names = (gchar **)g_ptr_array_free (names, FALSE);
+
+	priv->first = p;
+	priv->pos = p;
+
+	return RPT_DATA_SOURCE (source);
+}
+
+/* the first c1 or c2 from p; eight bytes at a time, with the bits trick
+ * that finds a zero byte in a word, applied to the word xor the char */
+static const gchar
+*rpt_data_source_csv_find (const gchar *p, const gchar *end, gchar c1, gchar c2)
+{
+	const guint64 ones = G_GUINT64_CONSTANT (0x0101010101010101);
+	const guint64 highs = G_GUINT64_CONSTANT (0x8080808080808080);
+	guint64 m1;
+	guint64 m2;
+	guint64 word;
+	guint64 x1;
+	guint64 x2;
+
+	m1 = ones * (guchar)c1;
+	m2 = ones * (guchar)c2;
+	while (end - p >= 8)
+		{
+			memcpy (&word, p, 8);
+			x1 = word ^ m1;
+			x2 = word ^ m2;
+			if ((((x1 - ones) & ~x1) | ((x2 - ones) & ~x2)) & highs)
+				{
+					break;
+				}
+			p += 8;
+		}
+
+	while (p < end && *p != c1 && *p != c2)
+		{
+			p++;
+		}
+
+	return p;
+}
+
+/* reads the field at p: a slice of the mapping in str and length, or, if
+ * the field has doubled quotes, a new string in unescaped; returns where
+ * the field ends (a delimiter, a newline or the end), NULL if a quote
+ * doesn't end */
+static const gchar
+*rpt_data_source_csv_read_field (RptDataSourceCsv *source,
+                                 const gchar *p,
+                                 const gchar **str,
+                                 gsize *length,
+                                 gchar **unescaped)
+{
+	const gchar *q;
+	GString *buf;
+
+	RptDataSourceCsvPrivate *priv = RPT_DATA_SOURCE_CSV_GET_PRIVATE (source);
+
+	*unescaped = NULL;
+
+	if (p >= priv->end || *p != '"')
+		{
+			q = rpt_data_source_csv_find (p, priv->end, priv->delimiter, '\n');
+			*str = p;
+			*length = q - p;
+			if (q < priv->end && *q == '\n' && q > p && q[-1] == '\r')
+				{
+					(*length)--;
+				}
+			return q;
+		}
+
+	p++;
+	q = memchr (p, '"', priv->end - p);
+	if (q == NULL)
+		{
+			return NULL;
+		}
+	if (q + 1 < priv->end && q[1] == '"')
+		{
+			/* the doubled quotes become one: the only copy */
+			buf = g_string_new_len (p, q - p + 1);
+			p = q + 2;
+			for (;;)
+				{
+					q = memchr (p, '"', priv->end - p);
+					if (q == NULL)
+						{
+							g_string_free (buf, TRUE);
+							return NULL;
+						}
+					if (q + 1 < priv->end && q[1] == '"')
+						{
+							g_string_append_len (buf, p, q - p + 1);
+							p = q + 2;
+						}
+					else
+						{
+							g_string_append_len (buf, p, q - p);
+							break;
+						}
+				}
+			*unescaped = g_string_free (buf, FALSE);
+			*str = *unescaped;
+			*length = strlen (*unescaped);
+		}
+	else
+		{
+			*str = p;
+			*length = q - p;
+		}
+
+	/* what is between the quote and the delimiter is ignored */
+	return rpt_data_source_csv_find (q + 1, priv->end, priv->delimiter, '\n');
+}
+
+static gint
+rpt_data_source_csv_get_n_columns (RptDataSource *source)
+{
+	RptDataSourceCsvPrivate *priv = RPT_DATA_SOURCE_CSV_GET_PRIVATE (source);
+
+	return priv->n_columns;
+}
+
+static const gchar
+*rpt_data_source_csv_get_column_name (RptDataSource *source, gint column)
+{
+	RptDataSourceCsvPrivate *priv = RPT_DATA_SOURCE_CSV_GET_PRIVATE (source);
+
+	if (column < 0 || column >= priv->n_columns)
+		{
+			return NULL;
+		}
+
+	return priv->names[column];
+}
+
+static GType
+rpt_data_source_csv_get_column_type (RptDataSource *source, gint column)
+{
+	return G_TYPE_STRING;
+}
+
+static gboolean
+rpt_data_source_csv_rewind (RptDataSource *source, GError **error)
+{
+	RptDataSourceCsvPrivate *priv = RPT_DATA_SOURCE_CSV_GET_PRIVATE (source);
+
+	priv->pos = priv->first;
+	priv->row = 0;
+
+	return TRUE;
+}
+
+static guint
+rpt_data_source_csv_next_batch (RptDataSource *source,
+                                RptDataBatch *batch,
+                                guint n_rows,
+                                GError **error)
+{
+	GValue *values;
+	const gchar *p;
+	const gchar *str;
+	gsize length;
+	gchar *unescaped;
+	guint row;
+	gint col;
+
+	RptDataSourceCsvPrivate *priv = RPT_DATA_SOURCE_CSV_GET_PRIVATE (source);
+
+	rpt_data_batch_reset (batch, priv->n_columns, priv->row, 0);
+
+	p = priv->pos;
+	for (row = 0; row < n_rows; )
+		{
+			/* empty lines aren't records */
+			while (p < priv->end && (*p == '\n' || *p == '\r'))
+				{
+					p++;
+				}
+			if (p >= priv->end)
+				{
+					break;
+				}
+
+			values = rpt_data_batch_add_row (batch);
+			for (col = 0; ; col++)
+				{
+					p = rpt_data_source_csv_read_field (RPT_DATA_SOURCE_CSV (source), p, &str, &length, &unescaped);
+					if (p == NULL)
+						{
+							g_set_error (error, RPT_DATA_SOURCE_ERROR, RPT_DATA_SOURCE_ERROR_INVALID_DATA,
+							             "«%s» has a quote without its end, at the record %" G_GUINT64_FORMAT ".",
+							             priv->filename, priv->row + row + 1);
+							priv->pos = priv->end;
+							return 0;
+						}
+
+					/* the fields over the header's ones are dropped, the
+					 * missing ones are nulls */
+					if (col < priv->n_columns)
+						{
+							if (unescaped != NULL)
+								{
+									g_value_init (&values[col], G_TYPE_STRING);
+									g_value_take_string (&values[col], unescaped);
+								}
+							else
+								{
+									rpt_data_batch_set_slice (batch, row, col, str, length);
+								}
+						}
+					else
+						{
+							g_free (unescaped);
+						}
+
+					if (p < priv->end && *p == priv->delimiter)
+						{
+							p++;
+							continue;
+						}
+					break;
+				}
+			row++;
+		}
+
+	priv->pos = p;
+	priv->row += row;
+
+	return row;
+}
+
+static void
+rpt_data_source_csv_finalize (GObject *object)
+{
+	RptDataSourceCsvPrivate *priv = RPT_DATA_SOURCE_CSV_GET_PRIVATE (object);
+
+	g_free (priv->filename);
+	g_strfreev (priv->names);
+	if (priv->mapped != NULL)
+		{
+			g_mapped_file_unref (priv->mapped);
+		}
+
+	G_OBJECT_CLASS (rpt_data_source_csv_parent_class)->finalize (object);
+}
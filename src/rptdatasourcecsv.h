@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2007-2011 Andrea Zagli <azagli@libero.it>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ */
+
+#ifndef __RPT_DATA_SOURCE_CSV_H__
+#define __RPT_DATA_SOURCE_CSV_H__
+
+#include <glib.h>
+#include <glib-object.h>
+
+#include "rptdatasource.h"
+
+G_BEGIN_DECLS
+
+
+#define TYPE_RPT_DATA_SOURCE_CSV                 (rpt_data_source_csv_get_type ())
+#define RPT_DATA_SOURCE_CSV(obj)                 (G_TYPE_CHECK_INSTANCE_CAST ((obj), TYPE_RPT_DATA_SOURCE_CSV, RptDataSourceCsv))
+#define RPT_DATA_SOURCE_CSV_CLASS(klass)         (G_TYPE_CHECK_CLASS_CAST ((klass), TYPE_RPT_DATA_SOURCE_CSV, RptDataSourceCsvClass))
+#define IS_RPT_DATA_SOURCE_CSV(obj)              (G_TYPE_CHECK_INSTANCE_TYPE ((obj), TYPE_RPT_DATA_SOURCE_CSV))
+#define IS_RPT_DATA_SOURCE_CSV_CLASS(klass)      (G_TYPE_CHECK_CLASS_TYPE ((klass), TYPE_RPT_DATA_SOURCE_CSV))
+#define RPT_DATA_SOURCE_CSV_GET_CLASS(obj)       (G_TYPE_INSTANCE_GET_CLASS ((obj), TYPE_RPT_DATA_SOURCE_CSV, RptDataSourceCsvClass))
+
+
+typedef struct _RptDataSourceCsv RptDataSourceCsv;
+typedef struct _RptDataSourceCsvClass RptDataSourceCsvClass;
+
+struct _RptDataSourceCsv
+	{
+		GObject parent;
+	};
+
+struct _RptDataSourceCsvClass
+	{
+		GObjectClass parent_class;
+	};
+
+GType rpt_data_source_csv_get_type (void) G_GNUC_CONST;
+
+
+RptDataSource *rpt_data_source_csv_new (const gchar *filename,
+                                        gchar delimiter,
+                                        GError **error);
+
+
+G_END_DECLS
+
+#endif /* __RPT_DATA_SOURCE_CSV_H__ */
@@ -0,0 +1,250 @@
+/*
+ * Copyright (C) 2007-2014 Andrea Zagli <azagli@libero.it>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "rptdatasourcegda.h"
+
+static void rpt_data_source_gda_interface_init (RptDataSourceInterface *iface);
+
+static void rpt_data_source_gda_finalize (GObject *object);
+
+static gint rpt_data_source_gda_get_n_columns (RptDataSource *source);
+static const gchar *rpt_data_source_gda_get_column_name (RptDataSource *source,
+                                                         gint column);
+static GType rpt_data_source_gda_get_column_type (RptDataSource *source,
+                                                  gint column);
+static gint rpt_data_source_gda_get_column_index (RptDataSource *source,
+                                                  const gchar *name);
+static gboolean rpt_data_source_gda_rewind (RptDataSource *source,
+                                            GError **error);
+static guint rpt_data_source_gda_next_batch (RptDataSource *source,
+                                             RptDataBatch *batch,
+                                             guint n_rows,
+                                             GError **error);
+static void rpt_data_source_gda_get_row_origin (RptDataSource *source,
+                                                RptDataBatch *batch,
+                                                guint row,
+                                                GdaDataModel **data_model,
+                                                gint *model_row,
+                                                GObject **tree_model,
+                                                gpointer *iter);
+
+#define RPT_DATA_SOURCE_GDA_GET_PRIVATE(obj) (G_TYPE_INSTANCE_GET_PRIVATE ((obj), TYPE_RPT_DATA_SOURCE_GDA, RptDataSourceGdaPrivate))
+
+typedef struct _RptDataSourceGdaPrivate RptDataSourceGdaPrivate;
+struct _RptDataSourceGdaPrivate
+	{
+		GdaDataModel *data_model;
+
+		/* the next row to fetch */
+		gint row;
+	};
+
+G_DEFINE_TYPE_WITH_CODE (RptDataSourceGda, rpt_data_source_gda, G_TYPE_OBJECT,
+                         G_IMPLEMENT_INTERFACE (TYPE_RPT_DATA_SOURCE,
+                                                rpt_data_source_gda_interface_init))
+
+static void
+rpt_data_source_gda_class_init (RptDataSourceGdaClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+	g_type_class_add_private (object_class, sizeof (RptDataSourceGdaPrivate));
+
+	object_class->finalize = rpt_data_source_gda_finalize;
+}
+
+static void
+rpt_data_source_gda_interface_init (RptDataSourceInterface *iface)
+{
+	iface->get_n_columns = rpt_data_source_gda_get_n_columns;
+	iface->get_column_name = rpt_data_source_gda_get_column_name;
+	iface->get_column_type = rpt_data_source_gda_get_column_type;
+	iface->get_column_index = rpt_data_source_gda_get_column_index;
+	iface->rewind = rpt_data_source_gda_rewind;
+	iface->next_batch = rpt_data_source_gda_next_batch;
+	iface->get_row_origin = rpt_data_source_gda_get_row_origin;
+}
+
+static void
+rpt_data_source_gda_init (RptDataSourceGda *rpt_data_source_gda)
+{
+	RptDataSourceGdaPrivate *priv = RPT_DATA_SOURCE_GDA_GET_PRIVATE (rpt_data_source_gda);
+
+	priv->data_model = NULL;
+	priv->row = 0;
+}
+
+/**
+ * rpt_data_source_gda_new:
+ * @data_model: a #GdaDataModel.
+ *
+ * Returns: a new #RptDataSource with the rows of @data_model.
+ */
+RptDataSource
+*rpt_data_source_gda_new (GdaDataModel *data_model)
+{
+	RptDataSourceGda *source;
+
+	g_return_val_if_fail (GDA_IS_DATA_MODEL (data_model), NULL);
+
+	source = RPT_DATA_SOURCE_GDA (g_object_new (rpt_data_source_gda_get_type (), NULL));
+
+	RptDataSourceGdaPrivate *priv = RPT_DATA_SOURCE_GDA_GET_PRIVATE (source);
+
+	priv->data_model = g_object_ref (data_model);
+
+	return RPT_DATA_SOURCE (source);
+}
+
+/**
+ * rpt_data_source_gda_get_data_model:
+ * @source: an #RptDataSourceGda.
+ *
+ * Returns: the #GdaDataModel of @source, owned by it.
+ */
+GdaDataModel
+*rpt_data_source_gda_get_data_model (RptDataSourceGda *source)
+{
+	g_return_val_if_fail (IS_RPT_DATA_SOURCE_GDA (source), NULL);
+
+	RptDataSourceGdaPrivate *priv = RPT_DATA_SOURCE_GDA_GET_PRIVATE (source);
+
+	return priv->data_model;
+}
+
+static gint
+rpt_data_source_gda_get_n_columns (RptDataSource *source)
+{
+	RptDataSourceGdaPrivate *priv = RPT_DATA_SOURCE_GDA_GET_PRIVATE (source);
+
+	return gda_data_model_get_n_columns (priv->data_model);
+}
+
+static const gchar
+*rpt_data_source_gda_get_column_name (RptDataSource *source, gint column)
+{
+	RptDataSourceGdaPrivate *priv = RPT_DATA_SOURCE_GDA_GET_PRIVATE (source);
+
+	return gda_data_model_get_column_name (priv->data_model, column);
+}
+
+static GType
+rpt_data_source_gda_get_column_type (RptDataSource *source, gint column)
+{
+	GdaColumn *gda_column;
+
+	RptDataSourceGdaPrivate *priv = RPT_DATA_SOURCE_GDA_GET_PRIVATE (source);
+
+	gda_column = gda_data_model_describe_column (priv->data_model, column);
+
+	return gda_column != NULL ? gda_column_get_g_type (gda_column) : G_TYPE_INVALID;
+}
+
+static gint
+rpt_data_source_gda_get_column_index (RptDataSource *source, const gchar *name)
+{
+	RptDataSourceGdaPrivate *priv = RPT_DATA_SOURCE_GDA_GET_PRIVATE (source);
+
+	return gda_data_model_get_column_index (priv->data_model, name);
+}
+
+static gboolean
+rpt_data_source_gda_rewind (RptDataSource *source, GError **error)
+{
+	RptDataSourceGdaPrivate *priv = RPT_DATA_SOURCE_GDA_GET_PRIVATE (source);
+
+	priv->row = 0;
+
+	return TRUE;
+}
+
+static guint
+rpt_data_source_gda_next_batch (RptDataSource *source,
+                                RptDataBatch *batch,
+                                guint n_rows,
+                                GError **error)
+{
+	GError *my_error;
+	GValue *values;
+	const GValue *gval;
+	gint n_columns;
+	gint rows;
+	gint last;
+	gint col;
+
+	RptDataSourceGdaPrivate *priv = RPT_DATA_SOURCE_GDA_GET_PRIVATE (source);
+
+	n_columns = gda_data_model_get_n_columns (priv->data_model);
+	rpt_data_batch_reset (batch, n_columns, priv->row, 0);
+
+	rows = gda_data_model_get_n_rows (priv->data_model);
+	last = MIN ((gint64)priv->row + n_rows, rows);
+	for (; priv->row < last; priv->row++)
+		{
+			values = rpt_data_batch_add_row (batch);
+			for (col = 0; col < n_columns; col++)
+				{
+					my_error = NULL;
+					gval = gda_data_model_get_value_at (priv->data_model, col, priv->row, &my_error);
+					if (my_error != NULL)
+						{
+							/* the value is left null, the other values are good */
+							g_warning ("Error on retrieving field «%s» value: %s.",
+							           gda_data_model_get_column_name (priv->data_model, col),
+							           my_error->message != NULL ? my_error->message : "no details");
+							g_error_free (my_error);
+							continue;
+						}
+					if (gval != NULL && G_VALUE_TYPE (gval) != G_TYPE_INVALID)
+						{
+							g_value_init (&values[col], G_VALUE_TYPE (gval));
+							g_value_copy (gval, &values[col]);
+						}
+				}
+		}
+
+	return rpt_data_batch_get_n_rows (batch);
+}
+
+static void
+rpt_data_source_gda_get_row_origin (RptDataSource *source,
+                                    RptDataBatch *batch,
+                                    guint row,
+                                    GdaDataModel **data_model,
+                                    gint *model_row,
+                                    GObject **tree_model,
+                                    gpointer *iter)
+{
+	RptDataSourceGdaPrivate *priv = RPT_DATA_SOURCE_GDA_GET_PRIVATE (source);
+
+	*data_model = priv->data_model;
+	*model_row = rpt_data_batch_get_first_row (batch) + row;
+}
+
+static void
+rpt_data_source_gda_finalize (GObject *object)
+{
+	RptDataSourceGdaPrivate *priv = RPT_DATA_SOURCE_GDA_GET_PRIVATE (object);
+
+	if (priv->data_model != NULL)
+		{
+			g_object_unref (priv->data_model);
+		}
+
+	G_OBJECT_CLASS (rpt_data_source_gda_parent_class)->finalize (object);
+}
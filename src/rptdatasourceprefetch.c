@@ -0,0 +1,386 @@
+/*
+ * Copyright (C) 2007-2014 Andrea Zagli <azagli@libero.it>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "rptdatasourceprefetch.h"
+
+/* the batches fetched in advance when n_batches is 0 */
+#define RPT_DATA_SOURCE_PREFETCH_BATCHES 4
+
+static void rpt_data_source_prefetch_interface_init (RptDataSourceInterface *iface);
+
+static void rpt_data_source_prefetch_finalize (GObject *object);
+
+static gpointer rpt_data_source_prefetch_thread (gpointer data);
+static void rpt_data_source_prefetch_stop (RptDataSourcePrefetch *prefetch);
+
+static gint rpt_data_source_prefetch_get_n_columns (RptDataSource *source);
+static const gchar *rpt_data_source_prefetch_get_column_name (RptDataSource *source,
+                                                              gint column);
+static GType rpt_data_source_prefetch_get_column_type (RptDataSource *source,
+                                                       gint column);
+static gint rpt_data_source_prefetch_get_column_index (RptDataSource *source,
+                                                       const gchar *name);
+static gboolean rpt_data_source_prefetch_rewind (RptDataSource *source,
+                                                 GError **error);
+static guint rpt_data_source_prefetch_next_batch (RptDataSource *source,
+                                                  RptDataBatch *batch,
+                                                  guint n_rows,
+                                                  GError **error);
+
+#define RPT_DATA_SOURCE_PREFETCH_GET_PRIVATE(obj) (G_TYPE_INSTANCE_GET_PRIVATE ((obj), TYPE_RPT_DATA_SOURCE_PREFETCH, RptDataSourcePrefetchPrivate))
+
+typedef struct _RptDataSourcePrefetchPrivate RptDataSourcePrefetchPrivate;
+struct _RptDataSourcePrefetchPrivate
+	{
+		RptDataSource *source;
+
+		/* a ring of n_batches batches, with one producer, the thread, and
+		 * one consumer, next_batch; head and tail only grow, and each is
+		 * written by one side only, so pushing and popping take no lock.
+		 * A side that finds the ring full (or empty) sets its waiting
+		 * flag and sleeps under the mutex; the other side, after moving
+		 * head (or tail), takes the mutex to wake it only if the flag is
+		 * set */
+		RptDataBatch **ring;
+		guint n_batches;
+		volatile gint head;
+		volatile gint tail;
+
+		GMutex mutex;
+		GCond cond;
+		volatile gint producer_waiting;
+		volatile gint consumer_waiting;
+
+		GThread *thread;
+		guint batch_rows;
+		volatile gint stop;
+
+		/* set by the thread at the end of the rows, with the error, if any */
+		volatile gint finished;
+		GError *error;
+	};
+
+G_DEFINE_TYPE_WITH_CODE (RptDataSourcePrefetch, rpt_data_source_prefetch, G_TYPE_OBJECT,
+                         G_IMPLEMENT_INTERFACE (TYPE_RPT_DATA_SOURCE,
+                                                rpt_data_source_prefetch_interface_init))
+
+static void
+rpt_data_source_prefetch_class_init (RptDataSourcePrefetchClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+	g_type_class_add_private (object_class, sizeof (RptDataSourcePrefetchPrivate));
+
+	object_class->finalize = rpt_data_source_prefetch_finalize;
+}
+
+static void
+rpt_data_source_prefetch_interface_init (RptDataSourceInterface *iface)
+{
+	iface->get_n_columns = rpt_data_source_prefetch_get_n_columns;
+	iface->get_column_name = rpt_data_source_prefetch_get_column_name;
+	iface->get_column_type = rpt_data_source_prefetch_get_column_type;
+	iface->get_column_index = rpt_data_source_prefetch_get_column_index;
+	iface->rewind = rpt_data_source_prefetch_rewind;
+	iface->next_batch = rpt_data_source_prefetch_next_batch;
+	/* no get_row_origin: the model is being read by the thread */
+}
+
+static void
+rpt_data_source_prefetch_init (RptDataSourcePrefetch *rpt_data_source_prefetch)
+{
+	RptDataSourcePrefetchPrivate *priv = RPT_DATA_SOURCE_PREFETCH_GET_PRIVATE (rpt_data_source_prefetch);
+
+	priv->source = NULL;
+	priv->ring = NULL;
+	priv->n_batches = 0;
+	priv->head = 0;
+	priv->tail = 0;
+	g_mutex_init (&priv->mutex);
+	g_cond_init (&priv->cond);
+	priv->producer_waiting = 0;
+	priv->consumer_waiting = 0;
+	priv->thread = NULL;
+	priv->batch_rows = 0;
+	priv->stop = 0;
+	priv->finished = 0;
+	priv->error = NULL;
+}
+
+/**
+ * rpt_data_source_prefetch_new:
+ * @source: the #RptDataSource to read.
+ * @n_batches: the most batches fetched in advance; 0 for the default.
+ *
+ * Creates a source that reads @source in a thread of its own, while the
+ * report lays out the rows already read: with a database over the network
+ * the fetching doesn't stop the layout any more.
+ *
+ * @source is read in the other thread, so it must not be a source that
+ * can be used only in the main thread (e.g. a #GtkTreeModel). For the same
+ * reason the rows don't tell their model: the RptReport::field-request
+ * signal gets a NULL #GdaDataModel, that the thread is still reading.
+ *
+ * Returns: a new #RptDataSource.
+ */
+RptDataSource
+*rpt_data_source_prefetch_new (RptDataSource *source, guint n_batches)
+{
+	RptDataSourcePrefetch *prefetch;
+	guint i;
+
+	g_return_val_if_fail (IS_RPT_DATA_SOURCE (source), NULL);
+
+	prefetch = RPT_DATA_SOURCE_PREFETCH (g_object_new (rpt_data_source_prefetch_get_type (), NULL));
+
+	RptDataSourcePrefetchPrivate *priv = RPT_DATA_SOURCE_PREFETCH_GET_PRIVATE (prefetch);
+
+	priv->source = g_object_ref (source);
+	priv->n_batches = n_batches > 0 ? n_batches : RPT_DATA_SOURCE_PREFETCH_BATCHES;
+	priv->ring = g_new (RptDataBatch *, priv->n_batches);
+	for (i = 0; i < priv->n_batches; i++)
+		{
+			priv->ring[i] = rpt_data_batch_new ();
+		}
+
+	return RPT_DATA_SOURCE (prefetch);
+}
+
+/**
+ * rpt_data_source_prefetch_get_source:
+ * @prefetch: an #RptDataSourcePrefetch.
+ *
+ * Returns: the #RptDataSource read by @prefetch.
+ */
+RptDataSource
+*rpt_data_source_prefetch_get_source (RptDataSourcePrefetch *prefetch)
+{
+	g_return_val_if_fail (IS_RPT_DATA_SOURCE_PREFETCH (prefetch), NULL);
+
+	RptDataSourcePrefetchPrivate *priv = RPT_DATA_SOURCE_PREFETCH_GET_PRIVATE (prefetch);
+
+	return priv->source;
+}
+
+static gpointer
+rpt_data_source_prefetch_thread (gpointer data)
+{
+	RptDataBatch *batch;
+	GError *error;
+	guint head;
+
+	RptDataSourcePrefetchPrivate *priv = RPT_DATA_SOURCE_PREFETCH_GET_PRIVATE (data);
+
+	head = (guint)g_atomic_int_get (&priv->head);
+	for (;;)
+		{
+			if (head - (guint)g_atomic_int_get (&priv->tail) == priv->n_batches)
+				{
+					/* full; the flag is set before tail is read again, so the
+					 * consumer either sees it or has already moved tail */
+					g_mutex_lock (&priv->mutex);
+					g_atomic_int_set (&priv->producer_waiting, 1);
+					while (!g_atomic_int_get (&priv->stop)
+					       && head - (guint)g_atomic_int_get (&priv->tail) == priv->n_batches)
+						{
+							g_cond_wait (&priv->cond, &priv->mutex);
+						}
+					g_atomic_int_set (&priv->producer_waiting, 0);
+					g_mutex_unlock (&priv->mutex);
+				}
+			if (g_atomic_int_get (&priv->stop))
+				{
+					break;
+				}
+
+			/* the consumer doesn't touch the free slots */
+			batch = priv->ring[head % priv->n_batches];
+			error = NULL;
+			if (rpt_data_source_next_batch (priv->source, batch, priv->batch_rows, &error) == 0)
+				{
+					g_mutex_lock (&priv->mutex);
+					priv->error = error;
+					g_atomic_int_set (&priv->finished, 1);
+					g_cond_signal (&priv->cond);
+					g_mutex_unlock (&priv->mutex);
+					break;
+				}
+
+			head++;
+			g_atomic_int_set (&priv->head, (gint)head);
+			if (g_atomic_int_get (&priv->consumer_waiting))
+				{
+					g_mutex_lock (&priv->mutex);
+					g_cond_signal (&priv->cond);
+					g_mutex_unlock (&priv->mutex);
+				}
+		}
+
+	return NULL;
+}
+
+/* ends the thread, dropping the batches fetched and not read */
+static void
+rpt_data_source_prefetch_stop (RptDataSourcePrefetch *prefetch)
+{
+	RptDataSourcePrefetchPrivate *priv = RPT_DATA_SOURCE_PREFETCH_GET_PRIVATE (prefetch);
+
+	if (priv->thread == NULL)
+		{
+			return;
+		}
+
+	g_mutex_lock (&priv->mutex);
+	g_atomic_int_set (&priv->stop, 1);
+	g_cond_signal (&priv->cond);
+	g_mutex_unlock (&priv->mutex);
+
+	g_thread_join (priv->thread);
+	priv->thread = NULL;
+
+	priv->head = 0;
+	priv->tail = 0;
+	priv->stop = 0;
+	priv->finished = 0;
+	g_clear_error (&priv->error);
+}
+
+static gint
+rpt_data_source_prefetch_get_n_columns (RptDataSource *source)
+{
+	RptDataSourcePrefetchPrivate *priv = RPT_DATA_SOURCE_PREFETCH_GET_PRIVATE (source);
+
+	return rpt_data_source_get_n_columns (priv->source);
+}
+
+static const gchar
+*rpt_data_source_prefetch_get_column_name (RptDataSource *source, gint column)
+{
+	RptDataSourcePrefetchPrivate *priv = RPT_DATA_SOURCE_PREFETCH_GET_PRIVATE (source);
+
+	return rpt_data_source_get_column_name (priv->source, column);
+}
+
+static GType
+rpt_data_source_prefetch_get_column_type (RptDataSource *source, gint column)
+{
+	RptDataSourcePrefetchPrivate *priv = RPT_DATA_SOURCE_PREFETCH_GET_PRIVATE (source);
+
+	return rpt_data_source_get_column_type (priv->source, column);
+}
+
+static gint
+rpt_data_source_prefetch_get_column_index (RptDataSource *source, const gchar *name)
+{
+	RptDataSourcePrefetchPrivate *priv = RPT_DATA_SOURCE_PREFETCH_GET_PRIVATE (source);
+
+	return rpt_data_source_get_column_index (priv->source, name);
+}
+
+static gboolean
+rpt_data_source_prefetch_rewind (RptDataSource *source, GError **error)
+{
+	RptDataSourcePrefetchPrivate *priv = RPT_DATA_SOURCE_PREFETCH_GET_PRIVATE (source);
+
+	rpt_data_source_prefetch_stop (RPT_DATA_SOURCE_PREFETCH (source));
+
+	/* the thread starts again at the first next_batch */
+	return rpt_data_source_rewind (priv->source, error);
+}
+
+static guint
+rpt_data_source_prefetch_next_batch (RptDataSource *source,
+                                     RptDataBatch *batch,
+                                     guint n_rows,
+                                     GError **error)
+{
+	guint tail;
+
+	RptDataSourcePrefetchPrivate *priv = RPT_DATA_SOURCE_PREFETCH_GET_PRIVATE (source);
+
+	if (priv->thread == NULL)
+		{
+			priv->batch_rows = n_rows;
+			priv->thread = g_thread_new ("rpt-prefetch", rpt_data_source_prefetch_thread, source);
+		}
+
+	tail = (guint)priv->tail;
+	if ((guint)g_atomic_int_get (&priv->head) == tail)
+		{
+			/* empty */
+			g_mutex_lock (&priv->mutex);
+			g_atomic_int_set (&priv->consumer_waiting, 1);
+			while (!g_atomic_int_get (&priv->finished)
+			       && (guint)g_atomic_int_get (&priv->head) == tail)
+				{
+					g_cond_wait (&priv->cond, &priv->mutex);
+				}
+			g_atomic_int_set (&priv->consumer_waiting, 0);
+			g_mutex_unlock (&priv->mutex);
+
+			if ((guint)g_atomic_int_get (&priv->head) == tail)
+				{
+					/* the end of the rows */
+					if (priv->error != NULL)
+						{
+							g_propagate_error (error, priv->error);
+							priv->error = NULL;
+						}
+					rpt_data_batch_reset (batch, rpt_data_source_get_n_columns (priv->source), 0, 0);
+					return 0;
+				}
+		}
+
+	/* the rows are handed over, not copied; the batch given back becomes
+	 * a free slot for the thread */
+	rpt_data_batch_swap (batch, priv->ring[tail % priv->n_batches]);
+
+	g_atomic_int_set (&priv->tail, (gint)(tail + 1));
+	if (g_atomic_int_get (&priv->producer_waiting))
+		{
+			g_mutex_lock (&priv->mutex);
+			g_cond_signal (&priv->cond);
+			g_mutex_unlock (&priv->mutex);
+		}
+
+	return rpt_data_batch_get_n_rows (batch);
+}
+
+static void
+rpt_data_source_prefetch_finalize (GObject *object)
+{
+	guint i;
+
+	RptDataSourcePrefetchPrivate *priv = RPT_DATA_SOURCE_PREFETCH_GET_PRIVATE (object);
+
+	rpt_data_source_prefetch_stop (RPT_DATA_SOURCE_PREFETCH (object));
+
+	for (i = 0; i < priv->n_batches; i++)
+		{
+			rpt_data_batch_free (priv->ring[i]);
+		}
+	g_free (priv->ring);
+	if (priv->source != NULL)
+		{
+			g_object_unref (priv->source);
+		}
+	g_mutex_clear (&priv->mutex);
+	g_cond_clear (&priv->cond);
+
+	G_OBJECT_CLASS (rpt_data_source_prefetch_parent_class)->finalize (object);
+}
@@ -0,0 +1,880 @@
+/*
+ * Copyright (C) 2007-2014 Andrea Zagli <azagli@libero.it>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <locale.h>
+
+#include <libgda/libgda.h>
+
+#include "rptformat.h"
+
+/* the biggest number of decimals a mask can ask for */
+#define RPT_FORMAT_MAX_DECIMALS 20
+
+typedef enum
+{
+	RPT_FORMAT_NUMBER,
+	RPT_FORMAT_DATE
+} eRptFormatType;
+
+typedef enum
+{
+	RPT_FORMAT_TOKEN_LITERAL,
+	RPT_FORMAT_TOKEN_YEAR,
+	RPT_FORMAT_TOKEN_YEAR_SHORT,
+	RPT_FORMAT_TOKEN_MONTH,
+	RPT_FORMAT_TOKEN_MONTH_PADDED,
+	RPT_FORMAT_TOKEN_MONTH_ABBR,
+	RPT_FORMAT_TOKEN_MONTH_NAME,
+	RPT_FORMAT_TOKEN_DAY,
+	RPT_FORMAT_TOKEN_DAY_PADDED,
+	RPT_FORMAT_TOKEN_HOUR,
+	RPT_FORMAT_TOKEN_HOUR_PADDED,
+	RPT_FORMAT_TOKEN_HOUR12,
+	RPT_FORMAT_TOKEN_HOUR12_PADDED,
+	RPT_FORMAT_TOKEN_MINUTE,
+	RPT_FORMAT_TOKEN_MINUTE_PADDED,
+	RPT_FORMAT_TOKEN_SECOND,
+	RPT_FORMAT_TOKEN_SECOND_PADDED
+} eRptFormatToken;
+
+typedef struct
+{
+	eRptFormatToken type;
+	gchar *literal;
+} RptFormatToken;
+
+typedef struct
+{
+	gint year;
+	gint month;
+	gint day;
+	gint hour;
+	gint minute;
+	gint second;
+} RptFormatDate;
+
+struct _RptFormat
+{
+	eRptFormatType type;
+
+	/* numbers */
+	gchar *prefix;
+	gchar *suffix;
+	gboolean grouping;
+	gboolean percent;
+	guint min_integers;
+	guint min_decimals;
+	guint max_decimals;
+	gchar printf_format[16];
+	gchar *decimal_point;
+	gchar *thousands_sep;
+
+	/* dates */
+	GArray *tokens;
+	gchar *month_names[12];
+	gchar *month_abbrs[12];
+};
+
+static eRptFormatType rpt_format_mask_type (const gchar *mask);
+static const gchar *rpt_format_skip_quoted (const gchar *c);
+static gchar *rpt_format_unquote (const gchar *str, gsize len, gboolean *percent);
+static void rpt_format_compile_number (RptFormat *format, const gchar *mask);
+static void rpt_format_compile_date (RptFormat *format, const gchar *mask);
+static gchar *rpt_format_date (const RptFormat *format, const RptFormatDate *date);
+static gboolean rpt_format_parse_date (const gchar *str, RptFormatDate *date);
+
+/**
+ * rpt_format_new:
+ * @mask: a numeric mask, like "#,##0.00" or "€ #,##0.00" or "0.0%", or a
+ * date mask, like "dd/MM/yyyy HH:mm".
+ *
+ * Compiles @mask. Text between single quotes is copied as is, and ''
+ * is a single quote. A mask with a '#', or with a '0' and none of the
+ * date letters "yMdHhms", is a numeric mask: the text before and after
+ * the digits is copied as is, ',' in the integer part enables grouping,
+ * and the '0' and '#' after '.' are the mandatory and the optional
+ * decimals. Otherwise it is a date mask. So a literal '0' in a date
+ * mask needs no quotes, while the letters of a numeric mask without '#'
+ * do, as in "0.0' h'".
+ *
+ * Returns: the compiled #RptFormat; NULL if @mask is empty.
+ */
+RptFormat
+*rpt_format_new (const gchar *mask)
+{
+	RptFormat *format;
+
+	if (mask == NULL || mask[0] == '\0')
+		{
+			return NULL;
+		}
+
+	format = g_new0 (RptFormat, 1);
+
+	format->type = rpt_format_mask_type (mask);
+	if (format->type == RPT_FORMAT_NUMBER)
+		{
+			rpt_format_compile_number (format, mask);
+		}
+	else
+		{
+			rpt_format_compile_date (format, mask);
+		}
+
+	return format;
+}
+
+/**
+ * rpt_format_free:
+ * @format: an #RptFormat.
+ *
+ */
+void
+rpt_format_free (RptFormat *format)
+{
+	guint i;
+
+	if (format == NULL)
+		{
+			return;
+		}
+
+	g_free (format->prefix);
+	g_free (format->suffix);
+	g_free (format->decimal_point);
+	g_free (format->thousands_sep);
+
+	if (format->tokens != NULL)
+		{
+			for (i = 0; i < format->tokens->len; i++)
+				{
+					g_free (g_array_index (format->tokens, RptFormatToken, i).literal);
+				}
+			g_array_free (format->tokens, TRUE);
+		}
+	for (i = 0; i < 12; i++)
+		{
+			g_free (format->month_names[i]);
+			g_free (format->month_abbrs[i]);
+		}
+
+	g_free (format);
+}
+
+/**
+ * rpt_format_value:
+ * @format: an #RptFormat.
+ * @value: a #GValue.
+ *
+ * Formats @value straight from its type; a value of a type that doesn't
+ * match @format is converted to string without formatting.
+ *
+ * Returns: a newly allocated string.
+ */
+gchar
+*rpt_format_value (const RptFormat *format, const GValue *value)
+{
+	GType type;
+	gchar *str;
+	gchar *ret;
+
+	if (value == NULL || gda_value_is_null (value))
+		{
+			return g_strdup ("");
+		}
+
+	type = G_VALUE_TYPE (value);
+
+	if (format->type == RPT_FORMAT_NUMBER)
+		{
+			if (type == G_TYPE_INT)
+				{
+					return rpt_format_double (format, g_value_get_int (value));
+				}
+			else if (type == G_TYPE_UINT)
+				{
+					return rpt_format_double (format, g_value_get_uint (value));
+				}
+			else if (type == G_TYPE_INT64)
+				{
+					return rpt_format_double (format, g_value_get_int64 (value));
+				}
+			else if (type == G_TYPE_UINT64)
+				{
+					return rpt_format_double (format, g_value_get_uint64 (value));
+				}
+			else if (type == G_TYPE_LONG)
+				{
+					return rpt_format_double (format, g_value_get_long (value));
+				}
+			else if (type == G_TYPE_ULONG)
+				{
+					return rpt_format_double (format, g_value_get_ulong (value));
+				}
+			else if (type == G_TYPE_DOUBLE)
+				{
+					return rpt_format_double (format, g_value_get_double (value));
+				}
+			else if (type == G_TYPE_FLOAT)
+				{
+					return rpt_format_double (format, g_value_get_float (value));
+				}
+			else if (type == GDA_TYPE_SHORT)
+				{
+					return rpt_format_double (format, gda_value_get_short (value));
+				}
+			else if (type == GDA_TYPE_USHORT)
+				{
+					return rpt_format_double (format, gda_value_get_ushort (value));
+				}
+			else if (type == GDA_TYPE_NUMERIC)
+				{
+					return rpt_format_double (format, gda_numeric_get_double ((GdaNumeric *)gda_value_get_numeric (value)));
+				}
+		}
+	else
+		{
+			RptFormatDate date = { 0, 0, 0, 0, 0, 0 };
+
+			if (type == G_TYPE_DATE)
+				{
+					const GDate *gdate = (const GDate *)g_value_get_boxed (value);
+
+					if (gdate != NULL && g_date_valid (gdate))
+						{
+							date.year = g_date_get_year (gdate);
+							date.month = g_date_get_month (gdate);
+							date.day = g_date_get_day (gdate);
+							return rpt_format_date (format, &date);
+						}
+				}
+			else if (type == GDA_TYPE_TIMESTAMP)
+				{
+					const GdaTimestamp *ts = gda_value_get_timestamp (value);
+
+					if (ts != NULL)
+						{
+							date.year = ts->year;
+							date.month = ts->month;
+							date.day = ts->day;
+							date.hour = ts->hour;
+							date.minute = ts->minute;
+							date.second = ts->second;
+							return rpt_format_date (format, &date);
+						}
+				}
+			else if (type == GDA_TYPE_TIME)
+				{
+					const GdaTime *t = gda_value_get_time (value);
+
+					if (t != NULL)
+						{
+							date.hour = t->hour;
+							date.minute = t->minute;
+							date.second = t->second;
+							return rpt_format_date (format, &date);
+						}
+				}
+			else if (type == G_TYPE_DATE_TIME)
+				{
+					GDateTime *dt = (GDateTime *)g_value_get_boxed (value);
+
+					if (dt != NULL)
+						{
+							date.year = g_date_time_get_year (dt);
+							date.month = g_date_time_get_month (dt);
+							date.day = g_date_time_get_day_of_month (dt);
+							date.hour = g_date_time_get_hour (dt);
+							date.minute = g_date_time_get_minute (dt);
+							date.second = g_date_time_get_second (dt);
+							return rpt_format_date (format, &date);
+						}
+				}
+		}
+
+	/* strings and types that don't match the mask */
+	if (type == G_TYPE_STRING)
+		{
+			return rpt_format_string (format, g_value_get_string (value));
+		}
+
+	str = gda_value_stringify (value);
+	ret = rpt_format_string (format, str);
+	g_free (str);
+
+	return ret;
+}
+
+/**
+ * rpt_format_string:
+ * @format: an #RptFormat.
+ * @str: a number written with '.' as decimal point, or a date written as
+ * "yyyy-MM-dd", "yyyy-MM-dd HH:mm:ss" or "HH:mm:ss".
+ *
+ * Returns: @str formatted, or a copy of @str if it cannot be read as a
+ * number or a date.
+ */
+gchar
+*rpt_format_string (const RptFormat *format, const gchar *str)
+{
+	gchar *end;
+	gdouble number;
+	RptFormatDate date;
+
+	if (str == NULL)
+		{
+			return g_strdup ("");
+		}
+
+	if (format->type == RPT_FORMAT_NUMBER)
+		{
+			while (g_ascii_isspace (*str)) str++;
+			if (*str != '\0')
+				{
+					number = g_ascii_strtod (str, &end);
+					while (g_ascii_isspace (*end)) end++;
+					if (*end == '\0')
+						{
+							return rpt_format_double (format, number);
+						}
+				}
+		}
+	else if (rpt_format_parse_date (str, &date))
+		{
+			return rpt_format_date (format, &date);
+		}
+
+	return g_strdup (str);
+}
+
+/**
+ * rpt_format_double:
+ * @format: an #RptFormat.
+ * @number:
+ *
+ * Returns: @number formatted.
+ */
+gchar
+*rpt_format_double (const RptFormat *format, gdouble number)
+{
+	GString *ret;
+	gchar buf[400];
+	gchar *dot;
+	gchar *integers;
+	gchar *decimals;
+	gboolean negative;
+	gsize len;
+	gsize i;
+
+	if (format->type != RPT_FORMAT_NUMBER)
+		{
+			g_ascii_formatd (buf, sizeof (buf), "%f", number);
+			return g_strdup (buf);
+		}
+
+	if (format->percent)
+		{
+			number *= 100.0;
+		}
+
+	negative = number < 0.0;
+	g_ascii_formatd (buf, sizeof (buf), format->printf_format, fabs (number));
+
+	integers = buf;
+	dot = strchr (buf, '.');
+	if (dot != NULL)
+		{
+			*dot = '\0';
+			decimals = dot + 1;
+
+			/* drop the optional decimals that are zero */
+			len = strlen (decimals);
+			while (len > format->min_decimals && decimals[len - 1] == '0')
+				{
+					decimals[--len] = '\0';
+				}
+		}
+	else
+		{
+			decimals = "";
+		}
+
+	/* a rounded zero has no sign */
+	if (negative && strspn (integers, "0") == strlen (integers) && strspn (decimals, "0") == strlen (decimals))
+		{
+			negative = FALSE;
+		}
+
+	if (format->min_integers == 0 && strcmp (integers, "0") == 0)
+		{
+			integers = "";
+		}
+
+	ret = g_string_sized_new (64);
+
+	if (negative)
+		{
+			g_string_append_c (ret, '-');
+		}
+	g_string_append (ret, format->prefix);
+
+	len = strlen (integers);
+	for (i = len; i < format->min_integers; i++)
+		{
+			g_string_append_c (ret, '0');
+		}
+	for (i = 0; i < len; i++)
+		{
+			if (format->grouping && i > 0 && (len - i) % 3 == 0)
+				{
+					g_string_append (ret, format->thousands_sep);
+				}
+			g_string_append_c (ret, integers[i]);
+		}
+
+	if (decimals[0] != '\0')
+		{
+			g_string_append (ret, format->decimal_point);
+			g_string_append (ret, decimals);
+		}
+
+	g_string_append (ret, format->suffix);
+
+	return g_string_free (ret, FALSE);
+}
+
+/* date letters come before the digits: a date mask can have a literal
+ * '0', like "dd/MM/yyyy 00:00", never a '#' */
+static eRptFormatType
+rpt_format_mask_type (const gchar *mask)
+{
+	const gchar *c;
+	gboolean date = FALSE;
+	gboolean zero = FALSE;
+
+	c = mask;
+	while (*c != '\0')
+		{
+			if (*c == '\'')
+				{
+					c = rpt_format_skip_quoted (c);
+					continue;
+				}
+
+			if (*c == '#')
+				{
+					return RPT_FORMAT_NUMBER;
+				}
+			else if (*c == '0')
+				{
+					zero = TRUE;
+				}
+			else if (strchr ("yMdHhms", *c) != NULL)
+				{
+					date = TRUE;
+				}
+			c++;
+		}
+
+	return zero && !date ? RPT_FORMAT_NUMBER : RPT_FORMAT_DATE;
+}
+
+/* returns the character after the quoted text that starts at @c */
+static const gchar
+*rpt_format_skip_quoted (const gchar *c)
+{
+	for (c++; *c != '\0'; c++)
+		{
+			if (*c == '\'' && *(c + 1) == '\'')
+				{
+					c++;
+				}
+			else if (*c == '\'')
+				{
+					return c + 1;
+				}
+		}
+
+	return c;
+}
+
+/* copies the first @len bytes of @str without the quotes; @percent is
+ * set if there's a '%' outside them */
+static gchar
+*rpt_format_unquote (const gchar *str, gsize len, gboolean *percent)
+{
+	GString *ret;
+	const gchar *end;
+	const gchar *c;
+	gboolean quoted = FALSE;
+
+	ret = g_string_sized_new (len);
+	end = str + len;
+	for (c = str; c < end; c++)
+		{
+			if (*c == '\'' && c + 1 < end && *(c + 1) == '\'')
+				{
+					g_string_append_c (ret, '\'');
+					c++;
+				}
+			else if (*c == '\'')
+				{
+					quoted = !quoted;
+				}
+			else
+				{
+					if (*c == '%' && !quoted)
+						{
+							*percent = TRUE;
+						}
+					g_string_append_c (ret, *c);
+				}
+		}
+
+	return g_string_free (ret, FALSE);
+}
+
+static void
+rpt_format_compile_number (RptFormat *format, const gchar *mask)
+{
+	const gchar *start;
+	const gchar *end;
+	const gchar *c;
+	gboolean in_decimals = FALSE;
+	struct lconv *lc;
+
+	/* the digits pattern goes from the first to the last of "#0,."
+	 * outside the quotes */
+	start = mask;
+	while (*start != '\0' && strchr ("#0,.", *start) == NULL)
+		{
+			start = *start == '\'' ? rpt_format_skip_quoted (start) : start + 1;
+		}
+	end = start;
+	c = start;
+	while (*c != '\0')
+		{
+			if (*c == '\'')
+				{
+					c = rpt_format_skip_quoted (c);
+					continue;
+				}
+			if (strchr ("#0,.", *c) != NULL)
+				{
+					end = c + 1;
+				}
+			c++;
+		}
+
+	format->prefix = rpt_format_unquote (mask, start - mask, &format->percent);
+	format->suffix = rpt_format_unquote (end, strlen (end), &format->percent);
+
+	for (c = start; c < end; c++)
+		{
+			switch (*c)
+				{
+					case '.':
+						in_decimals = TRUE;
+						break;
+
+					case ',':
+						if (!in_decimals)
+							{
+								format->grouping = TRUE;
+							}
+						break;
+
+					case '0':
+						if (in_decimals)
+							{
+								format->min_decimals++;
+								format->max_decimals++;
+							}
+						else
+							{
+								format->min_integers++;
+							}
+						break;
+
+					case '#':
+						if (in_decimals)
+							{
+								format->max_decimals++;
+							}
+						break;
+				}
+		}
+	format->max_decimals = MIN (format->max_decimals, RPT_FORMAT_MAX_DECIMALS);
+	format->min_decimals = MIN (format->min_decimals, format->max_decimals);
+
+	g_snprintf (format->printf_format, sizeof (format->printf_format), "%%.%uf", format->max_decimals);
+
+	/* separators are taken from the locale once, when the mask is compiled */
+	lc = localeconv ();
+	format->decimal_point = g_strdup (lc->decimal_point != NULL && lc->decimal_point[0] != '\0' ? lc->decimal_point : ".");
+	if (lc->thousands_sep != NULL && lc->thousands_sep[0] != '\0')
+		{
+			format->thousands_sep = g_strdup (lc->thousands_sep);
+		}
+	else
+		{
+			format->thousands_sep = g_strdup (strcmp (format->decimal_point, ",") == 0 ? "." : ",");
+		}
+}
+
+static void
+rpt_format_compile_date (RptFormat *format, const gchar *mask)
+{
+	RptFormatToken token;
+	GString *literal;
+	const gchar *c;
+	gsize run;
+	guint i;
+
+	format->tokens = g_array_new (FALSE, FALSE, sizeof (RptFormatToken));
+	literal = g_string_new ("");
+
+	c = mask;
+	while (*c != '\0')
+		{
+			if (*c == '\'')
+				{
+					/* quoted text; '' is a single quote */
+					c++;
+					while (*c != '\0')
+						{
+							if (*c == '\'' && *(c + 1) == '\'')
+								{
+									g_string_append_c (literal, '\'');
+									c += 2;
+								}
+							else if (*c == '\'')
+								{
+									c++;
+									break;
+								}
+							else
+								{
+									g_string_append_c (literal, *c);
+									c++;
+								}
+						}
+					continue;
+				}
+
+			if (strchr ("yMdHhms", *c) == NULL)
+				{
+					g_string_append_c (literal, *c);
+					c++;
+					continue;
+				}
+
+			for (run = 1; c[run] == *c; run++);
+
+			switch (*c)
+				{
+					case 'y':
+						token.type = run == 2 ? RPT_FORMAT_TOKEN_YEAR_SHORT : RPT_FORMAT_TOKEN_YEAR;
+						break;
+
+					case 'M':
+						token.type = run == 1 ? RPT_FORMAT_TOKEN_MONTH :
+						             run == 2 ? RPT_FORMAT_TOKEN_MONTH_PADDED :
+						             run == 3 ? RPT_FORMAT_TOKEN_MONTH_ABBR : RPT_FORMAT_TOKEN_MONTH_NAME;
+						break;
+
+					case 'd':
+						token.type = run == 1 ? RPT_FORMAT_TOKEN_DAY : RPT_FORMAT_TOKEN_DAY_PADDED;
+						break;
+
+					case 'H':
+						token.type = run == 1 ? RPT_FORMAT_TOKEN_HOUR : RPT_FORMAT_TOKEN_HOUR_PADDED;
+						break;
+
+					case 'h':
+						token.type = run == 1 ? RPT_FORMAT_TOKEN_HOUR12 : RPT_FORMAT_TOKEN_HOUR12_PADDED;
+						break;
+
+					case 'm':
+						token.type = run == 1 ? RPT_FORMAT_TOKEN_MINUTE : RPT_FORMAT_TOKEN_MINUTE_PADDED;
+						break;
+
+					case 's':
+						token.type = run == 1 ? RPT_FORMAT_TOKEN_SECOND : RPT_FORMAT_TOKEN_SECOND_PADDED;
+						break;
+				}
+			c += run;
+
+			if (literal->len > 0)
+				{
+					RptFormatToken lit;
+
+					lit.type = RPT_FORMAT_TOKEN_LITERAL;
+					lit.literal = g_strdup (literal->str);
+					g_array_append_val (format->tokens, lit);
+					g_string_truncate (literal, 0);
+				}
+
+			token.literal = NULL;
+			g_array_append_val (format->tokens, token);
+
+			/* month names come from the locale */
+			if ((token.type == RPT_FORMAT_TOKEN_MONTH_ABBR || token.type == RPT_FORMAT_TOKEN_MONTH_NAME)
+			    && format->month_names[0] == NULL)
+				{
+					for (i = 0; i < 12; i++)
+						{
+							GDateTime *dt = g_date_time_new_local (2000, i + 1, 1, 0, 0, 0);
+
+							format->month_names[i] = g_date_time_format (dt, "%B");
+							format->month_abbrs[i] = g_date_time_format (dt, "%b");
+							g_date_time_unref (dt);
+						}
+				}
+		}
+
+	if (literal->len > 0)
+		{
+			token.type = RPT_FORMAT_TOKEN_LITERAL;
+			token.literal = g_strdup (literal->str);
+			g_array_append_val (format->tokens, token);
+		}
+	g_string_free (literal, TRUE);
+}
+
+static gchar
+*rpt_format_date (const RptFormat *format, const RptFormatDate *date)
+{
+	GString *ret;
+	RptFormatToken *token;
+	guint i;
+	gint hour12;
+
+	ret = g_string_sized_new (32);
+
+	hour12 = date->hour % 12 == 0 ? 12 : date->hour % 12;
+
+	for (i = 0; i < format->tokens->len; i++)
+		{
+			token = &g_array_index (format->tokens, RptFormatToken, i);
+			switch (token->type)
+				{
+					case RPT_FORMAT_TOKEN_LITERAL:
+						g_string_append (ret, token->literal);
+						break;
+
+					case RPT_FORMAT_TOKEN_YEAR:
+						g_string_append_printf (ret, "%04d", date->year);
+						break;
+
+					case RPT_FORMAT_TOKEN_YEAR_SHORT:
+						g_string_append_printf (ret, "%02d", date->year % 100);
+						break;
+
+					case RPT_FORMAT_TOKEN_MONTH:
+						g_string_append_printf (ret, "%d", date->month);
+						break;
+
+					case RPT_FORMAT_TOKEN_MONTH_PADDED:
+						g_string_append_printf (ret, "%02d", date->month);
+						break;
+
+					case RPT_FORMAT_TOKEN_MONTH_ABBR:
+						if (date->month >= 1 && date->month <= 12)
+							{
+								g_string_append (ret, format->month_abbrs[date->month - 1]);
+							}
+						break;
+
+					case RPT_FORMAT_TOKEN_MONTH_NAME:
+						if (date->month >= 1 && date->month <= 12)
+							{
+								g_string_append (ret, format->month_names[date->month - 1]);
+							}
+						break;
+
+					case RPT_FORMAT_TOKEN_DAY:
+						g_string_append_printf (ret, "%d", date->day);
+						break;
+
+					case RPT_FORMAT_TOKEN_DAY_PADDED:
+						g_string_append_printf (ret, "%02d", date->day);
+						break;
+
+					case RPT_FORMAT_TOKEN_HOUR:
+						g_string_append_printf (ret, "%d", date->hour);
+						break;
+
+					case RPT_FORMAT_TOKEN_HOUR_PADDED:
+						g_string_append_printf (ret, "%02d", date->hour);
+						break;
+
+					case RPT_FORMAT_TOKEN_HOUR12:
+						g_string_append_printf (ret, "%d", hour12);
+						break;
+
+					case RPT_FORMAT_TOKEN_HOUR12_PADDED:
+						g_string_append_printf (ret, "%02d", hour12);
+						break;
+
+					case RPT_FORMAT_TOKEN_MINUTE:
+						g_string_append_printf (ret, "%d", date->minute);
+						break;
+
+					case RPT_FORMAT_TOKEN_MINUTE_PADDED:
+						g_string_append_printf (ret, "%02d", date->minute);
+						break;
+
+					case RPT_FORMAT_TOKEN_SECOND:
+						g_string_append_printf (ret, "%d", date->second);
+						break;
+
+					case RPT_FORMAT_TOKEN_SECOND_PADDED:
+						g_string_append_printf (ret, "%02d", date->second);
+						break;
+				}
+		}
+
+	return g_string_free (ret, FALSE);
+}
+
+static gboolean
+rpt_format_parse_date (const gchar *str, RptFormatDate *date)
+{
+	gint n;
+
+	memset (date, 0, sizeof (RptFormatDate));
+
+	while (g_ascii_isspace (*str)) str++;
+
+	n = sscanf (str, "%d-%d-%d%*[ T]%d:%d:%d",
+	            &date->year, &date->month, &date->day,
+	            &date->hour, &date->minute, &date->second);
+	if (n >= 3)
+		{
+			return date->month >= 1 && date->month <= 12 && date->day >= 1 && date->day <= 31;
+		}
+
+	memset (date, 0, sizeof (RptFormatDate));
+	n = sscanf (str, "%d:%d:%d", &date->hour, &date->minute, &date->second);
+
+	return n >= 2;
+}
@@ -0,0 +1,40 @@
+/*
+ * Copyright (C) 2007-2014 Andrea Zagli <azagli@libero.it>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef __RPT_FORMAT_H__
+#define __RPT_FORMAT_H__
+
+#include <glib.h>
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+
+typedef struct _RptFormat RptFormat;
+
+RptFormat *rpt_format_new (const gchar *mask);
+void rpt_format_free (RptFormat *format);
+
+gchar *rpt_format_value (const RptFormat *format, const GValue *value);
+gchar *rpt_format_string (const RptFormat *format, const gchar *str);
+gchar *rpt_format_double (const RptFormat *format, gdouble number);
+
+
+G_END_DECLS
+
+#endif /* __RPT_FORMAT_H__ */
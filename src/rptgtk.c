@@ -0,0 +1,758 @@
+/*
+ * Copyright (C) 2007-2014 Andrea Zagli <azagli@libero.it>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "rptgtk.h"
+#include "rptreport_priv.h"
+#include "rptobjecttext.h"
+#include "rptobjectline.h"
+
+/* key of the #GtkPrintSettings set on an #RptPrint */
+#define RPT_GTK_PRINT_SETTINGS "rpt-gtk-print-settings"
+
+/* the rows of a #GtkTreeModel, as an #RptDataSource */
+#define TYPE_RPT_GTK_TREE_MODEL_SOURCE (rpt_gtk_tree_model_source_get_type ())
+#define RPT_GTK_TREE_MODEL_SOURCE(obj) (G_TYPE_CHECK_INSTANCE_CAST ((obj), TYPE_RPT_GTK_TREE_MODEL_SOURCE, RptGtkTreeModelSource))
+
+typedef struct
+{
+	GObject parent;
+
+	GtkTreeModel *model;
+	gint n_columns;
+
+	/* field's name -> column + 1 */
+	GHashTable *columns;
+	/* column -> the name of its first field, or NULL if no field reads it */
+	gchar **names;
+
+	/* the next row */
+	GtkTreeIter iter;
+	gboolean valid;
+	guint64 row;
+} RptGtkTreeModelSource;
+
+typedef struct
+{
+	GObjectClass parent_class;
+} RptGtkTreeModelSourceClass;
+
+static void rpt_gtk_tree_model_source_interface_init (RptDataSourceInterface *iface);
+static void rpt_gtk_tree_model_source_finalize (GObject *object);
+
+static RptDataSource *rpt_gtk_tree_model_source_new (GtkTreeModel *model,
+                                                     GHashTable *columns_names);
+
+static gint rpt_gtk_tree_model_source_get_n_columns (RptDataSource *source);
+static const gchar *rpt_gtk_tree_model_source_get_column_name (RptDataSource *source,
+                                                               gint column);
+static GType rpt_gtk_tree_model_source_get_column_type (RptDataSource *source,
+                                                        gint column);
+static gint rpt_gtk_tree_model_source_get_column_index (RptDataSource *source,
+                                                        const gchar *name);
+static gboolean rpt_gtk_tree_model_source_rewind (RptDataSource *source,
+                                                  GError **error);
+static guint rpt_gtk_tree_model_source_next_batch (RptDataSource *source,
+                                                   RptDataBatch *batch,
+                                                   guint n_rows,
+                                                   GError **error);
+static void rpt_gtk_tree_model_source_get_row_origin (RptDataSource *source,
+                                                      RptDataBatch *batch,
+                                                      guint row,
+                                                      GdaDataModel **data_model,
+                                                      gint *model_row,
+                                                      GObject **tree_model,
+                                                      gpointer *iter);
+
+static void rpt_print_gtk_begin_print (GtkPrintOperation *operation,
+                                       GtkPrintContext *context,
+                                       gpointer user_data);
+static void rpt_print_gtk_request_page_setup (GtkPrintOperation *operation,
+                                              GtkPrintContext *context,
+                                              gint page_nr,
+                                              GtkPageSetup *setup,
+                                              gpointer user_data);
+static void rpt_print_gtk_draw_page (GtkPrintOperation *operation,
+                                     GtkPrintContext *context,
+                                     gint page_nr,
+                                     gpointer user_data);
+
+G_DEFINE_TYPE_WITH_CODE (RptGtkTreeModelSource, rpt_gtk_tree_model_source, G_TYPE_OBJECT,
+                         G_IMPLEMENT_INTERFACE (TYPE_RPT_DATA_SOURCE,
+                                                rpt_gtk_tree_model_source_interface_init))
+
+/**
+ * rpt_common_rptcolor_to_gdkcolor:
+ * @color: an #RptColor value.
+ *
+ * Converts an #RptColor value to a #GdkColor.
+ *
+ * Returns: the #GdkColor correspondent to @color.
+ */
+GdkColor
+*rpt_common_rptcolor_to_gdkcolor (const RptColor *color)
+{
+	GdkColor *gdk_color;
+
+	gdk_color = (GdkColor *)g_malloc0 (sizeof (GdkColor));
+	
+	gdk_color->red = color->r * 65535;
+	gdk_color->green = color->g * 65535;
+	gdk_color->blue = color->b * 65535;
+
+	return gdk_color;
+}
+
+/**
+ * rpt_common_gdkcolor_to_rptcolor:
+ * @gdk_color: a #GdkColor.
+ * @alpha: the alpha value.
+ *
+ * Converts an #GdkColor value to a #RptColor.
+ *
+ * Returns: the #GdkColor correspondent to @color.
+ */
+RptColor
+*rpt_common_gdkcolor_to_rptcolor (const GdkColor *gdk_color, guint16 alpha)
+{
+	RptColor *color;
+
+	color = rpt_common_rptcolor_new ();
+
+	color->r = gdk_color->red / 65535.0;
+	color->g = gdk_color->green / 65535.0;
+	color->b = gdk_color->blue / 65535.0;
+	color->a = alpha / 65535.0;
+
+	return color;
+}
+
+/**
+ * rpt_report_new_from_gtktreeview:
+ * @view:
+ * @title:
+ *
+ * Returns: the newly created #RptReport object.
+ */
+RptReport
+*rpt_report_new_from_gtktreeview (GtkTreeView *view,
+                                  const gchar *title)
+{
+	RptReport *ret;
+
+	GtkStyle *style;
+	PangoFontDescription *pango_font;
+
+	GList *columns;
+	GHashTable *columns_names;
+
+	GList *lst_cells;
+
+	RptSize *page_size;
+	RptMargin *page_margin;
+
+	RptPoint *point;
+	RptSize *size;
+	RptFont *font;
+	RptAlign *align;
+	RptObject *obj;
+
+	guint x;
+	GtkTreeViewColumn *col;
+	gfloat col_width;
+	const gchar *col_title;
+	gchar *field_name;
+
+	guint idx;
+	gint col_idx;
+	gpointer ptr_col_idx;
+
+	gint iheight;
+	gdouble height;
+
+	g_return_val_if_fail (GTK_IS_TREE_VIEW (view), NULL);
+
+	style = gtk_widget_get_style (GTK_WIDGET (view));
+	pango_font = pango_font_description_copy (style->font_desc);
+	if (pango_font == NULL)
+		{
+			g_warning ("No font from GtkTreeView. Default to Arial 10.");
+
+			pango_font = pango_font_description_new ();
+			pango_font_description_set_family (pango_font, "Arial");
+			pango_font_description_set_absolute_size (pango_font, 10 * PANGO_SCALE);
+		}
+
+	ret = rpt_report_new ();
+
+	columns = gtk_tree_view_get_columns (view);
+	if (columns == NULL) return NULL;
+
+	/* find the height to use as defaul height from gtkcellrenderer */
+	lst_cells = gtk_cell_layout_get_cells (GTK_CELL_LAYOUT (columns->data));
+	gtk_cell_renderer_get_size ((GtkCellRenderer *)lst_cells->data, GTK_WIDGET (view),
+	                            NULL, NULL, NULL, NULL, &iheight);
+	height = rpt_common_points_to_value (RPT_UNIT_MILLIMETRE, (iheight * 72.0) / 96.0);
+
+	g_object_set (G_OBJECT (ret), "unit-length", RPT_UNIT_MILLIMETRE, NULL);
+
+	page_size = rpt_common_rptsize_new_with_values (297, 210);
+	rpt_report_set_page_size (ret, *page_size);
+
+	page_margin = rpt_common_rptmargin_new_with_values (10, 10, 10, 10);
+	rpt_report_set_page_margins_struct (ret, *page_margin);
+
+	rpt_report_set_section_height (ret, RPTREPORT_SECTION_PAGE_HEADER, (height * 3) + 2);
+	rpt_report_set_page_header_first_last_page (ret, TRUE, TRUE);
+
+	rpt_report_set_section_height (ret, RPTREPORT_SECTION_BODY, height);
+
+	if (title != NULL)
+		{
+			point = rpt_common_rptpoint_new_with_values (0, 0);
+			obj = rpt_obj_text_new ("title", *point);
+
+			size = rpt_common_rptsize_new_with_values (page_size->width - page_margin->left - page_margin->right, height);
+			font = rpt_common_rptfont_from_pango_description (pango_font);
+			font->size += 2;
+			font->bold = TRUE;
+
+			g_object_set (obj,
+			              "source", title,
+			              "size", size,
+			              "font", font,
+			              NULL);
+
+			g_free (point);
+			g_free (size);
+
+			rpt_report_add_object_to_section (ret, obj, RPTREPORT_SECTION_PAGE_HEADER);
+		}
+
+	columns_names = g_hash_table_new (g_str_hash, g_str_equal);
+
+	x = 0;
+	idx = 0;
+	while (columns != NULL)
+		{
+			col = (GtkTreeViewColumn *)columns->data;
+
+			if (gtk_tree_view_column_get_visible (col))
+				{
+					col_title = g_strdup_printf ("\"%s\"", gtk_tree_view_column_get_title (col));
+					col_width = rpt_common_points_to_value (RPT_UNIT_MILLIMETRE, (gtk_tree_view_column_get_width (col) * 72.0) / 96.0);
+
+					point = rpt_common_rptpoint_new_with_values (x, height * 2);
+					if (columns->next == NULL && x < page_size->width)
+						{
+							/* the last column is always large until the end of the page */
+							size = rpt_common_rptsize_new_with_values ((page_size->width - page_margin->left - page_margin->right) - x, height);
+						}
+					else
+						{
+							size = rpt_common_rptsize_new_with_values (col_width, height);
+						}
+					font = rpt_common_rptfont_from_pango_description (pango_font);
+					font->bold = TRUE;
+
+					obj = rpt_obj_text_new (g_strdup_printf ("title_%d", idx), *point);
+
+					g_object_set (obj,
+					              "source", col_title,
+					              "size", size,
+					              "font", font,
+					              NULL);
+
+					rpt_report_add_object_to_section (ret, obj, RPTREPORT_SECTION_PAGE_HEADER);
+
+					g_free (point);
+
+					point = rpt_common_rptpoint_new_with_values (x, 0);
+					font = rpt_common_rptfont_from_pango_description (pango_font);
+
+					field_name = g_strdup_printf ("field_%d", idx);
+					obj = rpt_obj_text_new (field_name, *point);
+
+					g_object_set (obj,
+					              "source", g_strdup_printf ("[%s]", field_name),
+					              "size", size,
+					              "font", font,
+					              "ellipsize", RPT_ELLIPSIZE_END,
+					              NULL);
+
+					rpt_report_add_object_to_section (ret, obj, RPTREPORT_SECTION_BODY);
+
+					g_free (point);
+					g_free (size);
+
+					/* it's not possible to read column attribute that represents the source from liststore */
+					col_idx = idx;
+					ptr_col_idx = g_object_get_data (G_OBJECT (col), "rpt_text_col_idx");
+					if (ptr_col_idx != NULL)
+						{
+							col_idx = strtol ((gchar *)ptr_col_idx, NULL, 10);
+						}
+
+					g_hash_table_insert (columns_names, field_name, g_strdup_printf ("%d", col_idx));
+
+					x += col_width;
+				}
+
+			idx++;
+
+			columns = g_list_next (columns);
+		}
+
+	point = rpt_common_rptpoint_new_with_values (0, (height * 3) + 1);
+	obj = rpt_obj_line_new ("line1", *point);
+
+	size = rpt_common_rptsize_new_with_values (page_size->width - page_margin->left - page_margin->right, 0);
+
+	g_object_set (obj,
+	              "size", size,
+	              NULL);
+
+	g_free (point);
+	g_free (size);
+
+	rpt_report_add_object_to_section (ret, obj, RPTREPORT_SECTION_PAGE_HEADER);
+
+	rpt_report_set_section_height (ret, RPTREPORT_SECTION_PAGE_FOOTER, height + 2);
+
+	point = rpt_common_rptpoint_new_with_values (0, 0);
+	obj = rpt_obj_line_new ("line2", *point);
+
+	size = rpt_common_rptsize_new_with_values (page_size->width - page_margin->left - page_margin->right, 0);
+
+	g_object_set (obj,
+	              "size", size,
+	              NULL);
+
+	g_free (point);
+	g_free (size);
+
+	rpt_report_add_object_to_section (ret, obj, RPTREPORT_SECTION_PAGE_FOOTER);
+	rpt_report_set_page_footer_first_last_page (ret, TRUE, TRUE);
+
+	point = rpt_common_rptpoint_new_with_values (0, 2);
+	obj = rpt_obj_text_new ("pages", *point);
+
+	size = rpt_common_rptsize_new_with_values (page_size->width - page_margin->left - page_margin->right, height);
+	align = rpt_common_rptalign_new ();
+	align->h_align = RPT_HALIGN_RIGHT;
+	font = rpt_common_rptfont_from_pango_description (pango_font);
+	font->size -= 1;
+
+	g_object_set (obj,
+	              "source", "\"Page \" & @Page & \" of \" & @Pages",
+	              "size", size,
+	              "font", font,
+	              "align", align,
+	              NULL);
+
+	g_free (point);
+	g_free (size);
+
+	rpt_report_add_object_to_section (ret, obj, RPTREPORT_SECTION_PAGE_FOOTER);
+
+	rpt_report_set_database_as_gtktreemodel (ret, gtk_tree_view_get_model (view), columns_names);
+	g_hash_table_unref (columns_names);
+
+	return ret;
+}
+
+/**
+ * rpt_report_set_database_as_gtktreemodel:
+ * @rpt_report: an #RptReport object.
+ * @model: a #GtkTreeModel (for now only #GtkListStore is supported).
+ * @columns_names:
+ *
+ */
+void
+rpt_report_set_database_as_gtktreemodel (RptReport *rpt_report,
+                                         GtkTreeModel *model,
+                                         GHashTable *columns_names)
+{
+	RptDataSource *source;
+
+	g_return_if_fail (IS_RPT_REPORT (rpt_report));
+	g_return_if_fail (GTK_IS_TREE_MODEL (model));
+	g_return_if_fail (columns_names != NULL);
+
+	source = rpt_gtk_tree_model_source_new (model, columns_names);
+	rpt_report_set_data_source (rpt_report, source);
+	g_object_unref (source);
+}
+
+/**
+ * rpt_print_set_gtkprintsettings:
+ * @rpt_print: an #RptPrint object.
+ * @settings: a #GtkPrintSettings object.
+ *
+ */
+void
+rpt_print_set_gtkprintsettings (RptPrint *rpt_print, GtkPrintSettings *settings)
+{
+	g_return_if_fail (IS_RPT_PRINT (rpt_print));
+	g_return_if_fail (GTK_IS_PRINT_SETTINGS (settings));
+
+	g_object_set_data_full (G_OBJECT (rpt_print), RPT_GTK_PRINT_SETTINGS,
+	                        gtk_print_settings_copy (settings), g_object_unref);
+	rpt_print_set_copies (rpt_print, gtk_print_settings_get_n_copies (settings));
+}
+
+/**
+ * rpt_print_gtk_print:
+ * @rpt_print: an #RptPrint object.
+ * @transient: the #GtkWindow the print dialog is transient for; or NULL.
+ *
+ * Prints @rpt_print with a #GtkPrintOperation; rpt_print_print() calls it
+ * for #RPT_OUTPUT_GTK and #RPT_OUTPUT_GTK_DEFAULT_PRINTER.
+ */
+void
+rpt_print_gtk_print (RptPrint *rpt_print, GtkWindow *transient)
+{
+	GtkPrintOperation *operation;
+	GError *error;
+	GtkPrintSettings *settings;
+	GtkPrintOperationResult res;
+
+	eRptOutputType output_type;
+	guint copies;
+	guint first;
+	guint last;
+	gdouble width;
+	gdouble height;
+
+	g_return_if_fail (IS_RPT_PRINT (rpt_print));
+
+	if (!gtk_init_check (NULL, NULL))
+		{
+			g_warning ("Unable to initialize gtk; is there a display?");
+			return;
+		}
+
+	if (rpt_print_get_n_pages (rpt_print) == 0)
+		{
+			return;
+		}
+
+	g_object_get (G_OBJECT (rpt_print),
+	              "output-type", &output_type,
+	              "copies", &copies,
+	              NULL);
+
+	operation = gtk_print_operation_new ();
+
+	g_signal_connect (G_OBJECT (operation), "begin-print",
+	                  G_CALLBACK (rpt_print_gtk_begin_print), (gpointer)rpt_print);
+	g_signal_connect (G_OBJECT (operation), "request-page-setup",
+	                  G_CALLBACK (rpt_print_gtk_request_page_setup), (gpointer)rpt_print);
+	g_signal_connect (G_OBJECT (operation), "draw-page",
+	                  G_CALLBACK (rpt_print_gtk_draw_page), (gpointer)rpt_print);
+
+	settings = (GtkPrintSettings *)g_object_get_data (G_OBJECT (rpt_print), RPT_GTK_PRINT_SETTINGS);
+	if (settings != NULL)
+		{
+			settings = gtk_print_settings_copy (settings);
+		}
+	else
+		{
+			settings = gtk_print_settings_new ();
+		}
+	gtk_print_settings_set_n_copies (settings, copies);
+
+	if (rpt_print_get_page_range (rpt_print, &first, &last))
+		{
+			GtkPageRange range;
+
+			/* GtkPageRange starts from 0 */
+			range.start = first - 1;
+			range.end = (last == 0 ? rpt_print_get_n_pages (rpt_print) : (gint)last) - 1;
+			gtk_print_settings_set_print_pages (settings, GTK_PRINT_PAGES_RANGES);
+			gtk_print_settings_set_page_ranges (settings, &range, 1);
+		}
+
+	rpt_print_get_page_size (rpt_print, 0, &width, &height);
+	if (width > height)
+		{
+			gtk_print_settings_set_orientation (settings, GTK_PAGE_ORIENTATION_LANDSCAPE);
+		}
+	gtk_print_operation_set_print_settings (operation, settings);
+
+	gtk_print_operation_set_unit (operation, GTK_UNIT_POINTS);
+
+	error = NULL;
+	res = gtk_print_operation_run (operation,
+	                               output_type == RPT_OUTPUT_GTK ? GTK_PRINT_OPERATION_ACTION_PRINT_DIALOG : GTK_PRINT_OPERATION_ACTION_PRINT,
+	                               transient, &error);
+
+	if (error != NULL)
+		{
+			if (error->message != NULL)
+				{
+					g_warning ("Error on starting print operation: %s.\n", error->message);
+				}
+			g_error_free (error);
+		}
+
+	g_object_unref (settings);
+	g_object_unref (operation);
+}
+
+static void
+rpt_gtk_tree_model_source_class_init (RptGtkTreeModelSourceClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+	object_class->finalize = rpt_gtk_tree_model_source_finalize;
+}
+
+static void
+rpt_gtk_tree_model_source_interface_init (RptDataSourceInterface *iface)
+{
+	iface->get_n_columns = rpt_gtk_tree_model_source_get_n_columns;
+	iface->get_column_name = rpt_gtk_tree_model_source_get_column_name;
+	iface->get_column_type = rpt_gtk_tree_model_source_get_column_type;
+	iface->get_column_index = rpt_gtk_tree_model_source_get_column_index;
+	iface->rewind = rpt_gtk_tree_model_source_rewind;
+	iface->next_batch = rpt_gtk_tree_model_source_next_batch;
+	iface->get_row_origin = rpt_gtk_tree_model_source_get_row_origin;
+}
+
+static void
+rpt_gtk_tree_model_source_init (RptGtkTreeModelSource *source)
+{
+	source->model = NULL;
+	source->n_columns = 0;
+	source->columns = NULL;
+	source->names = NULL;
+	source->valid = FALSE;
+	source->row = 0;
+}
+
+static RptDataSource
+*rpt_gtk_tree_model_source_new (GtkTreeModel *model, GHashTable *columns_names)
+{
+	RptGtkTreeModelSource *source;
+	GHashTableIter hiter;
+	gpointer key;
+	gpointer value;
+	gchar *str_col;
+	gint n_columns;
+	gint col;
+
+	source = RPT_GTK_TREE_MODEL_SOURCE (g_object_new (TYPE_RPT_GTK_TREE_MODEL_SOURCE, NULL));
+	source->model = g_object_ref (model);
+
+	n_columns = gtk_tree_model_get_n_columns (model);
+	source->n_columns = n_columns;
+	source->columns = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	source->names = g_new0 (gchar *, n_columns);
+
+	/* the columns are given as strings; they are converted once */
+	g_hash_table_iter_init (&hiter, columns_names);
+	while (g_hash_table_iter_next (&hiter, &key, &value))
+		{
+			if (value == NULL)
+				{
+					continue;
+				}
+			str_col = g_strstrip (g_strdup ((gchar *)value));
+			if (g_strcmp0 (str_col, "") != 0)
+				{
+					col = strtol (str_col, NULL, 10);
+					if (col >= 0 && col < n_columns)
+						{
+							g_hash_table_insert (source->columns, g_strdup ((gchar *)key), GINT_TO_POINTER (col + 1));
+							if (source->names[col] == NULL)
+								{
+									source->names[col] = g_strdup ((gchar *)key);
+								}
+						}
+				}
+			g_free (str_col);
+		}
+
+	return RPT_DATA_SOURCE (source);
+}
+
+static gint
+rpt_gtk_tree_model_source_get_n_columns (RptDataSource *source)
+{
+	return RPT_GTK_TREE_MODEL_SOURCE (source)->n_columns;
+}
+
+static const gchar
+*rpt_gtk_tree_model_source_get_column_name (RptDataSource *source, gint column)
+{
+	RptGtkTreeModelSource *tms = RPT_GTK_TREE_MODEL_SOURCE (source);
+
+	if (column < 0 || column >= tms->n_columns)
+		{
+			return NULL;
+		}
+
+	return tms->names[column];
+}
+
+static GType
+rpt_gtk_tree_model_source_get_column_type (RptDataSource *source, gint column)
+{
+	return gtk_tree_model_get_column_type (RPT_GTK_TREE_MODEL_SOURCE (source)->model, column);
+}
+
+static gint
+rpt_gtk_tree_model_source_get_column_index (RptDataSource *source, const gchar *name)
+{
+	return GPOINTER_TO_INT (g_hash_table_lookup (RPT_GTK_TREE_MODEL_SOURCE (source)->columns, name)) - 1;
+}
+
+static gboolean
+rpt_gtk_tree_model_source_rewind (RptDataSource *source, GError **error)
+{
+	RptGtkTreeModelSource *tms = RPT_GTK_TREE_MODEL_SOURCE (source);
+
+	tms->valid = gtk_tree_model_get_iter_first (tms->model, &tms->iter);
+	tms->row = 0;
+
+	return TRUE;
+}
+
+static guint
+rpt_gtk_tree_model_source_next_batch (RptDataSource *source,
+                                      RptDataBatch *batch,
+                                      guint n_rows,
+                                      GError **error)
+{
+	GValue *values;
+	gint col;
+
+	RptGtkTreeModelSource *tms = RPT_GTK_TREE_MODEL_SOURCE (source);
+
+	/* every row keeps its iter, for RptReport::field-request */
+	rpt_data_batch_reset (batch, tms->n_columns, tms->row, sizeof (GtkTreeIter));
+
+	for (; tms->valid && rpt_data_batch_get_n_rows (batch) < n_rows;
+	     tms->valid = gtk_tree_model_iter_next (tms->model, &tms->iter))
+		{
+			values = rpt_data_batch_add_row (batch);
+
+			/* only the columns read by some field */
+			for (col = 0; col < tms->n_columns; col++)
+				{
+					if (tms->names[col] != NULL)
+						{
+							gtk_tree_model_get_value (tms->model, &tms->iter, col, &values[col]);
+						}
+				}
+			memcpy (rpt_data_batch_get_row_data (batch, rpt_data_batch_get_n_rows (batch) - 1),
+			        &tms->iter, sizeof (GtkTreeIter));
+			tms->row++;
+		}
+
+	return rpt_data_batch_get_n_rows (batch);
+}
+
+static void
+rpt_gtk_tree_model_source_get_row_origin (RptDataSource *source,
+                                          RptDataBatch *batch,
+                                          guint row,
+                                          GdaDataModel **data_model,
+                                          gint *model_row,
+                                          GObject **tree_model,
+                                          gpointer *iter)
+{
+	*tree_model = G_OBJECT (RPT_GTK_TREE_MODEL_SOURCE (source)->model);
+	*iter = rpt_data_batch_get_row_data (batch, row);
+}
+
+static void
+rpt_gtk_tree_model_source_finalize (GObject *object)
+{
+	gint col;
+
+	RptGtkTreeModelSource *tms = RPT_GTK_TREE_MODEL_SOURCE (object);
+
+	g_object_unref (tms->model);
+	g_hash_table_destroy (tms->columns);
+	for (col = 0; col < tms->n_columns; col++)
+		{
+			g_free (tms->names[col]);
+		}
+	g_free (tms->names);
+
+	G_OBJECT_CLASS (rpt_gtk_tree_model_source_parent_class)->finalize (object);
+}
+
+static void
+rpt_print_gtk_begin_print (GtkPrintOperation *operation,
+                           GtkPrintContext *context,
+                           gpointer user_data)
+{
+	RptPrint *rpt_print = (RptPrint *)user_data;
+
+	gtk_print_operation_set_n_pages (operation, rpt_print_get_n_pages (rpt_print));
+}
+
+static void
+rpt_print_gtk_request_page_setup (GtkPrintOperation *operation,
+                                  GtkPrintContext *context,
+                                  gint page_nr,
+                                  GtkPageSetup *setup,
+                                  gpointer user_data)
+{
+	GtkPaperSize *paper_size;
+
+	gdouble width;
+	gdouble height;
+
+	RptPrint *rpt_print = (RptPrint *)user_data;
+
+	rpt_print_get_page_size (rpt_print, page_nr, &width, &height);
+
+	paper_size = gtk_paper_size_new_custom ("reptool",
+	                                        "RepTool",
+	                                        width > height ? height : width,
+	                                        width > height ? width : height,
+	                                        GTK_UNIT_POINTS);
+
+	gtk_page_setup_set_paper_size (setup, paper_size);
+	gtk_paper_size_free (paper_size);
+
+	gtk_page_setup_set_top_margin (setup, 0.0, GTK_UNIT_POINTS);
+	gtk_page_setup_set_bottom_margin (setup, 0.0, GTK_UNIT_POINTS);
+	gtk_page_setup_set_left_margin (setup, 0.0, GTK_UNIT_POINTS);
+	gtk_page_setup_set_right_margin (setup, 0.0, GTK_UNIT_POINTS);
+}
+
+static void
+rpt_print_gtk_draw_page (GtkPrintOperation *operation,
+                         GtkPrintContext *context,
+                         gint page_nr,
+                         gpointer user_data)
+{
+	RptPrint *rpt_print = (RptPrint *)user_data;
+
+	rpt_print_render_page (rpt_print, page_nr,
+	                       gtk_print_context_get_cairo_context (context),
+	                       gtk_print_context_get_width (context),
+	                       gtk_print_context_get_height (context));
+}
@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2007-2014 Andrea Zagli <azagli@libero.it>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef __RPT_GTK_H__
+#define __RPT_GTK_H__
+
+#include <glib.h>
+#include <gtk/gtk.h>
+
+#include "rptcommon.h"
+#include "rptreport.h"
+#include "rptprint.h"
+
+G_BEGIN_DECLS
+
+
+GdkColor *rpt_common_rptcolor_to_gdkcolor (const RptColor *color);
+RptColor *rpt_common_gdkcolor_to_rptcolor (const GdkColor *gdk_color, guint16 alpha);
+
+RptReport *rpt_report_new_from_gtktreeview (GtkTreeView *view,
+                                            const gchar *title);
+
+void rpt_report_set_database_as_gtktreemodel (RptReport *rpt_report,
+                                              GtkTreeModel *model,
+                                              GHashTable *columns_names);
+
+void rpt_print_set_gtkprintsettings (RptPrint *rpt_print, GtkPrintSettings *settings);
+
+void rpt_print_gtk_print (RptPrint *rpt_print, GtkWindow *transient);
+
+
+G_END_DECLS
+
+#endif /* __RPT_GTK_H__ */
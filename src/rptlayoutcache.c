@@ -0,0 +1,529 @@
+/*
+ * Copyright (C) 2007-2014 Andrea Zagli <azagli@libero.it>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib/gstdio.h>
+
+#include "rptlayoutcache.h"
+
+/* maximum number of shaped layouts kept for each thread */
+#define RPT_LAYOUT_CACHE_MAX_ENTRIES 512
+
+/* maximum number of decoded images kept for each thread */
+#define RPT_LAYOUT_CACHE_MAX_IMAGES 64
+
+typedef struct
+{
+	PangoContext *context;
+	GHashTable *layouts;
+	GQueue lru;
+	GHashTable *images;
+} RptLayoutCache;
+
+typedef struct
+{
+	cairo_surface_t *surface;
+	gint64 mtime;
+	goffset size;
+} RptLayoutCacheImage;
+
+typedef struct
+{
+	gchar *key;
+	PangoLayout *layout;
+} RptLayoutCacheEntry;
+
+static RptLayoutCache *rpt_layout_cache_get_default (void);
+static void rpt_layout_cache_free (gpointer data);
+static void rpt_layout_cache_entry_free (RptLayoutCacheEntry *entry);
+static void rpt_layout_cache_image_free (RptLayoutCacheImage *image);
+static gchar *rpt_layout_cache_key (const gchar *text,
+                                    const RptLayoutAttrs *attrs);
+static PangoLayout *rpt_layout_cache_build (PangoContext *context,
+                                            const gchar *text,
+                                            const RptLayoutAttrs *attrs);
+
+static GPrivate rpt_layout_cache_private = G_PRIVATE_INIT (rpt_layout_cache_free);
+
+/**
+ * rpt_layout_attrs_new_from_xml:
+ * @xnode: a text #xmlNode.
+ * @unit: the unit of length used by @xnode.
+ *
+ * Reads from @xnode all the attributes that affect how a text is shaped.
+ * Lengths are converted to points.
+ *
+ * Returns: a newly allocated #RptLayoutAttrs.
+ */
+RptLayoutAttrs
+*rpt_layout_attrs_new_from_xml (xmlNode *xnode, eRptUnitLength unit)
+{
+	RptLayoutAttrs *attrs;
+	RptSize *size;
+	gchar *prop;
+
+	attrs = g_new0 (RptLayoutAttrs, 1);
+
+	attrs->font = rpt_common_get_font (xnode);
+	attrs->align = rpt_common_get_align (xnode);
+
+	prop = xmlGetProp (xnode, (const xmlChar *)"padding-top");
+	if (prop != NULL)
+		{
+			attrs->padding_top = rpt_common_value_to_points (unit, g_strtod (prop, NULL));
+			xmlFree (prop);
+		}
+	prop = xmlGetProp (xnode, (const xmlChar *)"padding-right");
+	if (prop != NULL)
+		{
+			attrs->padding_right = rpt_common_value_to_points (unit, g_strtod (prop, NULL));
+			xmlFree (prop);
+		}
+	prop = xmlGetProp (xnode, (const xmlChar *)"padding-bottom");
+	if (prop != NULL)
+		{
+			attrs->padding_bottom = rpt_common_value_to_points (unit, g_strtod (prop, NULL));
+			xmlFree (prop);
+		}
+	prop = xmlGetProp (xnode, (const xmlChar *)"padding-left");
+	if (prop != NULL)
+		{
+			attrs->padding_left = rpt_common_value_to_points (unit, g_strtod (prop, NULL));
+			xmlFree (prop);
+		}
+
+	size = rpt_common_get_size (xnode);
+	if (size != NULL)
+		{
+			attrs->width = rpt_common_value_to_points (unit, size->width) - attrs->padding_left - attrs->padding_right;
+			g_free (size);
+		}
+	else
+		{
+			attrs->width = -1.0;
+		}
+
+	prop = xmlGetProp (xnode, (const xmlChar *)"ellipsize");
+	if (prop != NULL)
+		{
+			attrs->ellipsize = rpt_common_strellipsize_to_enum (prop);
+			xmlFree (prop);
+		}
+
+	prop = xmlGetProp (xnode, (const xmlChar *)"letter-spacing");
+	if (prop != NULL)
+		{
+			attrs->letter_spacing = strtol (prop, NULL, 10);
+			xmlFree (prop);
+		}
+
+	return attrs;
+}
+
+/**
+ * rpt_layout_attrs_free:
+ * @attrs: an #RptLayoutAttrs.
+ *
+ */
+void
+rpt_layout_attrs_free (RptLayoutAttrs *attrs)
+{
+	if (attrs == NULL)
+		{
+			return;
+		}
+
+	rpt_common_rptfont_free (attrs->font);
+	g_free (attrs->align);
+	g_free (attrs);
+}
+
+/**
+ * rpt_layout_cache_get:
+ * @text: the text to shape.
+ * @attrs: an #RptLayoutAttrs.
+ *
+ * Looks for a #PangoLayout already shaped with the same text, font, width
+ * and attributes; if there isn't one, it is created and stored.
+ * The same layout is used to measure a text at layout time and to draw it,
+ * so a text is shaped only once.
+ * The layout must not be modified.
+ *
+ * Returns: a new reference to the cached #PangoLayout.
+ */
+PangoLayout
+*rpt_layout_cache_get (const gchar *text, const RptLayoutAttrs *attrs)
+{
+	RptLayoutCache *cache;
+	RptLayoutCacheEntry *entry;
+	GList *link;
+	gchar *key;
+
+	cache = rpt_layout_cache_get_default ();
+
+	key = rpt_layout_cache_key (text, attrs);
+
+	link = (GList *)g_hash_table_lookup (cache->layouts, key);
+	if (link != NULL)
+		{
+			g_free (key);
+
+			/* move to the front of the lru list */
+			g_queue_unlink (&cache->lru, link);
+			g_queue_push_head_link (&cache->lru, link);
+
+			entry = (RptLayoutCacheEntry *)link->data;
+			return g_object_ref (entry->layout);
+		}
+
+	entry = g_new0 (RptLayoutCacheEntry, 1);
+	entry->key = key;
+	entry->layout = rpt_layout_cache_build (cache->context, text, attrs);
+
+	g_queue_push_head (&cache->lru, entry);
+	g_hash_table_insert (cache->layouts, entry->key, cache->lru.head);
+
+	while (cache->lru.length > RPT_LAYOUT_CACHE_MAX_ENTRIES)
+		{
+			RptLayoutCacheEntry *old;
+
+			old = (RptLayoutCacheEntry *)g_queue_pop_tail (&cache->lru);
+			g_hash_table_remove (cache->layouts, old->key);
+			rpt_layout_cache_entry_free (old);
+		}
+
+	return g_object_ref (entry->layout);
+}
+
+/**
+ * rpt_layout_cache_new_layout:
+ * @text: the text to shape.
+ * @attrs: an #RptLayoutAttrs.
+ *
+ * Creates a #PangoLayout like rpt_layout_cache_get() does, but without
+ * storing it, so the caller is free to change it.
+ *
+ * Returns: a newly created #PangoLayout.
+ */
+PangoLayout
+*rpt_layout_cache_new_layout (const gchar *text, const RptLayoutAttrs *attrs)
+{
+	RptLayoutCache *cache;
+
+	cache = rpt_layout_cache_get_default ();
+
+	return rpt_layout_cache_build (cache->context, text, attrs);
+}
+
+/**
+ * rpt_layout_cache_get_text_height:
+ * @text: the text to measure.
+ * @attrs: an #RptLayoutAttrs.
+ *
+ * Returns: the height, in points and paddings included, needed to show
+ * the whole @text.
+ */
+gdouble
+rpt_layout_cache_get_text_height (const gchar *text, const RptLayoutAttrs *attrs)
+{
+	PangoLayout *playout;
+	gint height;
+
+	playout = rpt_layout_cache_get (text, attrs);
+	pango_layout_get_size (playout, NULL, &height);
+	g_object_unref (playout);
+
+	return (gdouble)height / PANGO_SCALE + attrs->padding_top + attrs->padding_bottom;
+}
+
+/**
+ * rpt_layout_cache_clear:
+ *
+ * Drops all the layouts cached by the calling thread.
+ */
+void
+rpt_layout_cache_clear (void)
+{
+	RptLayoutCache *cache;
+	RptLayoutCacheEntry *entry;
+
+	cache = (RptLayoutCache *)g_private_get (&rpt_layout_cache_private);
+	if (cache == NULL)
+		{
+			return;
+		}
+
+	g_hash_table_remove_all (cache->layouts);
+	while ((entry = (RptLayoutCacheEntry *)g_queue_pop_head (&cache->lru)) != NULL)
+		{
+			rpt_layout_cache_entry_free (entry);
+		}
+	g_hash_table_remove_all (cache->images);
+}
+
+/**
+ * rpt_layout_cache_get_image:
+ * @filename: the path of a png image.
+ *
+ * Decodes @filename only the first time it's asked by the calling thread,
+ * or when the file changed since then.
+ *
+ * Returns: a new reference to the image's surface; or NULL if @filename
+ * cannot be loaded.
+ */
+cairo_surface_t
+*rpt_layout_cache_get_image (const gchar *filename)
+{
+	RptLayoutCache *cache;
+	RptLayoutCacheImage *image;
+	GStatBuf st;
+
+	g_return_val_if_fail (filename != NULL, NULL);
+
+	if (g_stat (filename, &st) != 0)
+		{
+			return NULL;
+		}
+
+	cache = rpt_layout_cache_get_default ();
+
+	image = (RptLayoutCacheImage *)g_hash_table_lookup (cache->images, filename);
+	if (image != NULL
+	    && image->mtime == (gint64)st.st_mtime
+	    && image->size == (goffset)st.st_size)
+		{
+			return cairo_surface_reference (image->surface);
+		}
+
+	image = g_new0 (RptLayoutCacheImage, 1);
+	image->surface = cairo_image_surface_create_from_png (filename);
+	image->mtime = (gint64)st.st_mtime;
+	image->size = (goffset)st.st_size;
+	if (cairo_surface_status (image->surface) != CAIRO_STATUS_SUCCESS)
+		{
+			rpt_layout_cache_image_free (image);
+			return NULL;
+		}
+
+	if (g_hash_table_size (cache->images) >= RPT_LAYOUT_CACHE_MAX_IMAGES)
+		{
+			g_hash_table_remove_all (cache->images);
+		}
+	g_hash_table_replace (cache->images, g_strdup (filename), image);
+
+	return cairo_surface_reference (image->surface);
+}
+
+static RptLayoutCache
+*rpt_layout_cache_get_default (void)
+{
+	RptLayoutCache *cache;
+	cairo_font_options_t *options;
+
+	cache = (RptLayoutCache *)g_private_get (&rpt_layout_cache_private);
+	if (cache == NULL)
+		{
+			cache = g_new0 (RptLayoutCache, 1);
+
+			/* layouts are shaped once and drawn on any surface, so metrics
+			 * must not depend on the surface's hinting */
+			cache->context = pango_font_map_create_context (pango_cairo_font_map_get_default ());
+			options = cairo_font_options_create ();
+			cairo_font_options_set_hint_metrics (options, CAIRO_HINT_METRICS_OFF);
+			cairo_font_options_set_hint_style (options, CAIRO_HINT_STYLE_NONE);
+			pango_cairo_context_set_font_options (cache->context, options);
+			cairo_font_options_destroy (options);
+
+			cache->layouts = g_hash_table_new (g_str_hash, g_str_equal);
+			g_queue_init (&cache->lru);
+
+			cache->images = g_hash_table_new_full (g_str_hash, g_str_equal,
+			                                       g_free, (GDestroyNotify)rpt_layout_cache_image_free);
+
+			g_private_set (&rpt_layout_cache_private, cache);
+		}
+
+	return cache;
+}
+
+static void
+rpt_layout_cache_free (gpointer data)
+{
+	RptLayoutCache *cache = (RptLayoutCache *)data;
+	RptLayoutCacheEntry *entry;
+
+	g_hash_table_destroy (cache->layouts);
+	while ((entry = (RptLayoutCacheEntry *)g_queue_pop_head (&cache->lru)) != NULL)
+		{
+			rpt_layout_cache_entry_free (entry);
+		}
+	g_hash_table_destroy (cache->images);
+	g_object_unref (cache->context);
+	g_free (cache);
+}
+
+static void
+rpt_layout_cache_image_free (RptLayoutCacheImage *image)
+{
+	cairo_surface_destroy (image->surface);
+	g_free (image);
+}
+
+static void
+rpt_layout_cache_entry_free (RptLayoutCacheEntry *entry)
+{
+	g_object_unref (entry->layout);
+	g_free (entry->key);
+	g_free (entry);
+}
+
+static gchar
+*rpt_layout_cache_key (const gchar *text, const RptLayoutAttrs *attrs)
+{
+	return g_strdup_printf ("%s|%d|%d|%d|%d|%d|%d|%d|%d|%u|%s",
+	                        attrs->font->name,
+	                        (int)attrs->font->size,
+	                        attrs->font->bold,
+	                        attrs->font->italic,
+	                        attrs->font->underline,
+	                        attrs->font->strike,
+	                        attrs->width > 0.0 ? (gint)(attrs->width * PANGO_SCALE) : -1,
+	                        attrs->align->h_align,
+	                        attrs->ellipsize,
+	                        attrs->letter_spacing,
+	                        text);
+}
+
+static PangoLayout
+*rpt_layout_cache_build (PangoContext *context, const gchar *text, const RptLayoutAttrs *attrs)
+{
+	PangoLayout *playout;
+	PangoFontDescription *pfdesc;
+	PangoAttribute *pattr;
+	PangoAttrList *lpattr = NULL;
+
+	playout = pango_layout_new (context);
+
+	if (attrs->width > 0.0)
+		{
+			pango_layout_set_width (playout, attrs->width * PANGO_SCALE);
+		}
+
+	/* creating pango font description */
+	pfdesc = pango_font_description_new ();
+
+	pango_font_description_set_family (pfdesc, attrs->font->name);
+	if (attrs->font->bold)
+		{
+			pango_font_description_set_weight (pfdesc, PANGO_WEIGHT_BOLD);
+		}
+	if (attrs->font->italic)
+		{
+			pango_font_description_set_style (pfdesc, PANGO_STYLE_ITALIC);
+		}
+	if (attrs->font->size > 0.0f)
+		{
+			pango_font_description_set_absolute_size (pfdesc, (int)attrs->font->size * PANGO_SCALE);
+		}
+	else
+		{
+			pango_font_description_set_absolute_size (pfdesc, 12 * PANGO_SCALE);
+		}
+
+	pango_layout_set_font_description (playout, pfdesc);
+	pango_font_description_free (pfdesc);
+
+	/* setting layout attributes; they cover the whole text */
+	if (attrs->font->underline != PANGO_UNDERLINE_NONE)
+		{
+			pattr = pango_attr_underline_new (attrs->font->underline);
+			if (lpattr == NULL)
+				{
+					lpattr = pango_attr_list_new ();
+				}
+			pango_attr_list_insert (lpattr, pattr);
+		}
+	if (attrs->font->strike)
+		{
+			pattr = pango_attr_strikethrough_new (TRUE);
+			if (lpattr == NULL)
+				{
+					lpattr = pango_attr_list_new ();
+				}
+			pango_attr_list_insert (lpattr, pattr);
+		}
+	if (attrs->letter_spacing > 0)
+		{
+			pattr = pango_attr_letter_spacing_new (attrs->letter_spacing * PANGO_SCALE);
+			if (lpattr == NULL)
+				{
+					lpattr = pango_attr_list_new ();
+				}
+			pango_attr_list_insert (lpattr, pattr);
+		}
+
+	if (lpattr != NULL)
+		{
+			pango_layout_set_attributes (playout, lpattr);
+			pango_attr_list_unref (lpattr);
+		}
+
+	/* setting horizontal alignment */
+	switch (attrs->align->h_align)
+		{
+			case RPT_HALIGN_LEFT:
+				break;
+
+			case RPT_HALIGN_CENTER:
+				pango_layout_set_alignment (playout, PANGO_ALIGN_CENTER);
+				break;
+
+			case RPT_HALIGN_RIGHT:
+				pango_layout_set_alignment (playout, PANGO_ALIGN_RIGHT);
+				break;
+
+			case RPT_HALIGN_JUSTIFIED:
+				pango_layout_set_justify (playout, TRUE);
+				break;
+		}
+
+	/* ellipsize */
+	switch (attrs->ellipsize)
+		{
+			case RPT_ELLIPSIZE_START:
+				pango_layout_set_ellipsize (playout, PANGO_ELLIPSIZE_START);
+				break;
+
+			case RPT_ELLIPSIZE_MIDDLE:
+				pango_layout_set_ellipsize (playout, PANGO_ELLIPSIZE_MIDDLE);
+				break;
+
+			case RPT_ELLIPSIZE_END:
+				pango_layout_set_ellipsize (playout, PANGO_ELLIPSIZE_END);
+				break;
+
+			default:
+				break;
+		}
+
+	pango_layout_set_text (playout, text, -1);
+
+	return playout;
+}
@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2007-2014 Andrea Zagli <azagli@libero.it>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef __RPT_LAYOUT_CACHE_H__
+#define __RPT_LAYOUT_CACHE_H__
+
+#include <glib.h>
+#include <libxml/tree.h>
+#include <pango/pangocairo.h>
+
+#include "rptcommon.h"
+
+G_BEGIN_DECLS
+
+
+typedef struct
+{
+	RptFont *font;
+	RptAlign *align;
+	gdouble width;
+	gdouble padding_top;
+	gdouble padding_right;
+	gdouble padding_bottom;
+	gdouble padding_left;
+	eRptEllipsize ellipsize;
+	guint letter_spacing;
+} RptLayoutAttrs;
+
+RptLayoutAttrs *rpt_layout_attrs_new_from_xml (xmlNode *xnode, eRptUnitLength unit);
+void rpt_layout_attrs_free (RptLayoutAttrs *attrs);
+
+PangoLayout *rpt_layout_cache_get (const gchar *text, const RptLayoutAttrs *attrs);
+PangoLayout *rpt_layout_cache_new_layout (const gchar *text, const RptLayoutAttrs *attrs);
+
+gdouble rpt_layout_cache_get_text_height (const gchar *text, const RptLayoutAttrs *attrs);
+
+cairo_surface_t *rpt_layout_cache_get_image (const gchar *filename);
+
+void rpt_layout_cache_clear (void);
+
+
+G_END_DECLS
+
+#endif /* __RPT_LAYOUT_CACHE_H__ */
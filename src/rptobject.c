@@ -37,6 +37,7 @@ static void rpt_object_get_property (GObject *object,
                                      guint property_id,
                                      GValue *value,
                                      GParamSpec *pspec);
+static void rpt_object_finalize (GObject *object);
 
 
 #define RPT_OBJECT_GET_PRIVATE(obj) (G_TYPE_INSTANCE_GET_PRIVATE ((obj), TYPE_RPT_OBJECT, RptObjectPrivate))
@@ -62,6 +63,7 @@ rpt_object_class_init (RptObjectClass *klass)
 
 	object_class->set_property = rpt_object_set_property;
 	object_class->get_property = rpt_object_get_property;
+	object_class->finalize = rpt_object_finalize;
 
 	g_object_class_install_property (object_class, PROP_NAME,
 	                                 g_param_spec_string ("name",
@@ -165,10 +167,12 @@ rpt_object_set_property (GObject *object, guint property_id, const GValue *value
 	switch (property_id)
 		{
 			case PROP_NAME:
+				g_free (priv->name);
 				priv->name = g_strstrip (g_strdup (g_value_get_string (value)));
 				break;
 
 			case PROP_POSITION:
+				g_free (priv->position);
 				priv->position = g_memdup (g_value_get_pointer (value), sizeof (RptPoint));
 				break;
 
@@ -207,3 +211,14 @@ rpt_object_get_property (GObject *object, guint property_id, GValue *value, GPar
 				break;
 		}
 }
+
+static void
+rpt_object_finalize (GObject *object)
+{
+	RptObjectPrivate *priv = RPT_OBJECT_GET_PRIVATE (object);
+
+	g_free (priv->name);
+	g_free (priv->position);
+
+	G_OBJECT_CLASS (rpt_object_parent_class)->finalize (object);
+}
@@ -118,6 +118,7 @@ RptObject
 	                      "position", &position,
 	                      NULL);
 		}
+	g_free (name_);
 
 	return rpt_obj_ellipse;
 }
@@ -134,7 +135,7 @@ RptObject
 	gchar *name;
 	RptObject *rpt_obj_ellipse = NULL;
 
-	name = g_strdup ((gchar *)xmlGetProp (xnode, "name"));
+	name = (gchar *)xmlGetProp (xnode, "name");
 	if (name != NULL && strcmp (g_strstrip (name), "") != 0)
 		{
 			RptPoint *position;
@@ -143,10 +144,11 @@ RptObject
 			position = rpt_common_get_position (xnode);
 
 			rpt_obj_ellipse = rpt_obj_ellipse_new ((const gchar *)name, *position);
+			g_free (position);
 
 			if (rpt_obj_ellipse != NULL)
 				{
-					const gchar *prop;
+					gchar *prop;
 					RptSize *size;
 					RptStroke *stroke;
 
@@ -160,17 +162,22 @@ RptObject
 					              "size", size,
 					              "stroke", stroke,
 					              NULL);
+					g_free (size);
+					rpt_common_rptstroke_free (stroke);
 
-					prop = (const gchar *)xmlGetProp (xnode, "fill-color");
+					prop = (gchar *)xmlGetProp (xnode, "fill-color");
 					if (prop != NULL)
 						{
 							RptColor *color;
 
 							color = rpt_common_parse_color (prop);
 							g_object_set (rpt_obj_ellipse, "fill-color", color, NULL);
+							g_free (color);
+							xmlFree (prop);
 						}
 				}
 		}
+	if (name != NULL) xmlFree (name);
 
 	return rpt_obj_ellipse;
 }
@@ -40,6 +40,9 @@ static void rpt_obj_image_get_property (GObject *object,
                                         guint property_id,
                                         GValue *value,
                                         GParamSpec *pspec);
+static void rpt_obj_image_finalize (GObject *object);
+
+static GObjectClass *parent_class = NULL;
 
 
 #define RPT_OBJ_IMAGE_GET_PRIVATE(obj) (G_TYPE_INSTANCE_GET_PRIVATE ((obj), TYPE_RPT_OBJ_IMAGE, RptObjImagePrivate))
@@ -90,8 +93,11 @@ rpt_obj_image_class_init (RptObjImageClass *klass)
 
 	g_type_class_add_private (object_class, sizeof (RptObjImagePrivate));
 
+	parent_class = g_type_class_peek_parent (klass);
+
 	object_class->set_property = rpt_obj_image_set_property;
 	object_class->get_property = rpt_obj_image_get_property;
+	object_class->finalize = rpt_obj_image_finalize;
 
 	rptobject_class->get_xml = rpt_obj_image_get_xml;
 
@@ -162,6 +168,7 @@ RptObject
 	                      "position", &position,
 	                      NULL);
 		}
+	g_free (name_);
 
 	return rpt_obj_image;
 }
@@ -178,15 +185,17 @@ RptObject
 	gchar *name;
 	RptObject *rpt_obj_image = NULL;
 
-	name = g_strdup ((gchar *)xmlGetProp (xnode, "name"));
+	name = (gchar *)xmlGetProp (xnode, "name");
 	if (name != NULL && strcmp (g_strstrip (name), "") != 0)
 		{
 			RptPoint *position;
 			RptObjImagePrivate *priv;
+			gchar *prop;
 
 			position = rpt_common_get_position (xnode);
 
 			rpt_obj_image = rpt_obj_image_new ((const gchar *)name, *position);
+			g_free (position);
 
 			if (rpt_obj_image != NULL)
 				{
@@ -194,22 +203,29 @@ RptObject
 
 					rpt_object_set_from_xml (RPT_OBJECT (rpt_obj_image), xnode);
 
+					g_free (priv->size);
 					priv->size = rpt_common_get_size (xnode);
 					priv->rotation = rpt_common_get_rotation (xnode);
 					priv->border = rpt_common_get_border (xnode);
 
-					priv->source = (gchar *)xmlGetProp (xnode, "source");
+					g_free (priv->source);
+					prop = (gchar *)xmlGetProp (xnode, "source");
+					priv->source = g_strdup (prop);
+					if (prop != NULL) xmlFree (prop);
 
-					if (xmlStrcasecmp (xmlGetProp (xnode, "adapt"), (const xmlChar *)"to-box") == 0)
+					prop = (gchar *)xmlGetProp (xnode, "adapt");
+					if (xmlStrcasecmp (prop, (const xmlChar *)"to-box") == 0)
 						{
 							priv->adapt = RPT_OBJ_IMAGE_ADAPT_TO_BOX;
 						}
-					else if (xmlStrcasecmp (xmlGetProp (xnode, "adapt"), (const xmlChar *)"to-image") == 0)
+					else if (xmlStrcasecmp (prop, (const xmlChar *)"to-image") == 0)
 						{
 							priv->adapt = RPT_OBJ_IMAGE_ADAPT_TO_IMAGE;
 						}
+					if (prop != NULL) xmlFree (prop);
 				}
 		}
+	if (name != NULL) xmlFree (name);
 
 	return rpt_obj_image;
 }
@@ -255,18 +271,22 @@ rpt_obj_image_set_property (GObject *object, guint property_id, const GValue *va
 	switch (property_id)
 		{
 			case PROP_SIZE:
+				g_free (priv->size);
 				priv->size = g_memdup (g_value_get_pointer (value), sizeof (RptSize));
 				break;
 
 			case PROP_ROTATION:
+				g_free (priv->rotation);
 				priv->rotation = g_memdup (g_value_get_pointer (value), sizeof (RptRotation));
 				break;
 
 			case PROP_BORDER:
-				priv->border = g_memdup (g_value_get_pointer (value), sizeof (RptBorder));
+				rpt_common_rptborder_free (priv->border);
+				priv->border = rpt_common_rptborder_copy (g_value_get_pointer (value));
 				break;
 
 			case PROP_SOURCE:
+				g_free (priv->source);
 				priv->source = g_strstrip (g_strdup (g_value_get_string (value)));
 				break;
 
@@ -298,7 +318,7 @@ rpt_obj_image_get_property (GObject *object, guint property_id, GValue *value, G
 				break;
 
 			case PROP_BORDER:
-				g_value_set_pointer (value, g_memdup (priv->border, sizeof (RptBorder)));
+				g_value_set_pointer (value, rpt_common_rptborder_copy (priv->border));
 				break;
 
 			case PROP_SOURCE:
@@ -314,3 +334,16 @@ rpt_obj_image_get_property (GObject *object, guint property_id, GValue *value, G
 				break;
 		}
 }
+
+static void
+rpt_obj_image_finalize (GObject *object)
+{
+	RptObjImagePrivate *priv = RPT_OBJ_IMAGE_GET_PRIVATE (object);
+
+	g_free (priv->size);
+	g_free (priv->rotation);
+	rpt_common_rptborder_free (priv->border);
+	g_free (priv->source);
+
+	parent_class->finalize (object);
+}
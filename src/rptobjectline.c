@@ -38,6 +38,9 @@ static void rpt_obj_line_get_property (GObject *object,
                                        guint property_id,
                                        GValue *value,
                                        GParamSpec *pspec);
+static void rpt_obj_line_finalize (GObject *object);
+
+static GObjectClass *parent_class = NULL;
 
 
 #define RPT_OBJ_LINE_GET_PRIVATE(obj) (G_TYPE_INSTANCE_GET_PRIVATE ((obj), TYPE_RPT_OBJ_LINE, RptObjLinePrivate))
@@ -86,8 +89,11 @@ rpt_obj_line_class_init (RptObjLineClass *klass)
 
 	g_type_class_add_private (object_class, sizeof (RptObjLinePrivate));
 
+	parent_class = g_type_class_peek_parent (klass);
+
 	object_class->set_property = rpt_obj_line_set_property;
 	object_class->get_property = rpt_obj_line_get_property;
+	object_class->finalize = rpt_obj_line_finalize;
 
 	rptobject_class->get_xml = rpt_obj_line_get_xml;
 
@@ -146,6 +152,7 @@ RptObject
 	                      "position", &position,
 	                      NULL);
 		}
+	g_free (name_);
 
 	return rpt_obj_line;
 }
@@ -162,7 +169,7 @@ RptObject
 	gchar *name;
 	RptObject *rpt_obj_line = NULL;
 
-	name = g_strdup ((gchar *)xmlGetProp (xnode, "name"));
+	name = (gchar *)xmlGetProp (xnode, "name");
 	if (name != NULL && strcmp (g_strstrip (name), "") != 0)
 		{
 			RptPoint *position;
@@ -171,6 +178,7 @@ RptObject
 			position = rpt_common_get_position (xnode);
 
 			rpt_obj_line = rpt_obj_line_new ((const gchar *)name, *position);
+			g_free (position);
 
 			if (rpt_obj_line != NULL)
 				{
@@ -178,11 +186,13 @@ RptObject
 
 					priv = RPT_OBJ_LINE_GET_PRIVATE (rpt_obj_line);
 
+					g_free (priv->size);
 					priv->size = rpt_common_get_size (xnode);
 					priv->rotation = rpt_common_get_rotation (xnode);
 					priv->stroke = rpt_common_get_stroke (xnode);
 				}
 		}
+	if (name != NULL) xmlFree (name);
 
 	return rpt_obj_line;
 }
@@ -215,15 +225,18 @@ rpt_obj_line_set_property (GObject *object, guint property_id, const GValue *val
 	switch (property_id)
 		{
 			case PROP_SIZE:
+				g_free (priv->size);
 				priv->size = g_memdup (g_value_get_pointer (value), sizeof (RptSize));
 				break;
 
 			case PROP_ROTATION:
+				g_free (priv->rotation);
 				priv->rotation = g_memdup (g_value_get_pointer (value), sizeof (RptRotation));
 				break;
 
 			case PROP_STROKE:
-				priv->stroke = g_memdup (g_value_get_pointer (value), sizeof (RptStroke));
+				rpt_common_rptstroke_free (priv->stroke);
+				priv->stroke = rpt_common_rptstroke_copy (g_value_get_pointer (value));
 				break;
 
 			default:
@@ -258,11 +271,11 @@ rpt_obj_line_get_property (GObject *object, guint property_id, GValue *value, GP
 						stroke->color = rpt_common_rptcolor_new ();
 						stroke->color->a = 1.0;
 
-						g_value_set_pointer (value, g_memdup (stroke, sizeof (RptStroke)));
+						g_value_set_pointer (value, stroke);
 					}
 				else
 					{
-						g_value_set_pointer (value, g_memdup (priv->stroke, sizeof (RptStroke)));
+						g_value_set_pointer (value, rpt_common_rptstroke_copy (priv->stroke));
 					}
 				break;
 
@@ -271,3 +284,15 @@ rpt_obj_line_get_property (GObject *object, guint property_id, GValue *value, GP
 				break;
 		}
 }
+
+static void
+rpt_obj_line_finalize (GObject *object)
+{
+	RptObjLinePrivate *priv = RPT_OBJ_LINE_GET_PRIVATE (object);
+
+	g_free (priv->size);
+	g_free (priv->rotation);
+	rpt_common_rptstroke_free (priv->stroke);
+
+	parent_class->finalize (object);
+}
@@ -36,6 +36,9 @@ static void rpt_obj_rect_get_property (GObject *object,
                                        guint property_id,
                                        GValue *value,
                                        GParamSpec *pspec);
+static void rpt_obj_rect_finalize (GObject *object);
+
+static GObjectClass *parent_class = NULL;
 
 
 #define RPT_OBJ_RECT_GET_PRIVATE(obj) (G_TYPE_INSTANCE_GET_PRIVATE ((obj), TYPE_RPT_OBJ_RECT, RptObjRectPrivate))
@@ -82,8 +85,11 @@ rpt_obj_rect_class_init (RptObjRectClass *klass)
 
 	g_type_class_add_private (object_class, sizeof (RptObjRectPrivate));
 
+	parent_class = g_type_class_peek_parent (klass);
+
 	object_class->set_property = rpt_obj_rect_set_property;
 	object_class->get_property = rpt_obj_rect_get_property;
+	object_class->finalize = rpt_obj_rect_finalize;
 
 	rptobject_class->get_xml = rpt_obj_rect_get_xml;
 
@@ -127,6 +133,7 @@ RptObject
 	                      "position", &position,
 	                      NULL);
 		}
+	g_free (name_);
 
 	return rpt_obj_rect;
 }
@@ -143,7 +150,7 @@ RptObject
 	gchar *name;
 	RptObject *rpt_obj_rect = NULL;
 
-	name = g_strdup ((gchar *)xmlGetProp (xnode, "name"));
+	name = (gchar *)xmlGetProp (xnode, "name");
 	if (name != NULL && strcmp (g_strstrip (name), "") != 0)
 		{
 			RptPoint *position;
@@ -152,10 +159,11 @@ RptObject
 			position = rpt_common_get_position (xnode);
 
 			rpt_obj_rect = rpt_obj_rect_new ((const gchar *)name, *position);
+			g_free (position);
 
 			if (rpt_obj_rect != NULL)
 				{
-					const gchar *prop;
+					gchar *prop;
 					RptSize *size;
 					RptRotation *rotation;
 					RptStroke *stroke;
@@ -172,14 +180,19 @@ RptObject
 					              "stroke", stroke,
 					              "rotation", rotation,
 					              NULL);
+					g_free (size);
+					g_free (rotation);
+					rpt_common_rptstroke_free (stroke);
 
-					prop = (const gchar *)xmlGetProp (xnode, "fill-color");
+					prop = (gchar *)xmlGetProp (xnode, "fill-color");
 					if (prop != NULL)
 						{
 							priv->fill_color = rpt_common_parse_color (prop);
+							xmlFree (prop);
 						}
 				}
 		}
+	if (name != NULL) xmlFree (name);
 
 	return rpt_obj_rect;
 }
@@ -193,6 +206,8 @@ RptObject
 void
 rpt_obj_rect_get_xml (RptObject *rpt_object, xmlNode *xnode)
 {
+	gchar *str;
+
 	RptObjRectPrivate *priv = RPT_OBJ_RECT_GET_PRIVATE (RPT_OBJ_RECT (rpt_object));
 
 	rpt_obj_line_get_xml (rpt_object, xnode);
@@ -201,7 +216,9 @@ rpt_obj_rect_get_xml (RptObject *rpt_object, xmlNode *xnode)
 
 	if (priv->fill_color != NULL)
 		{
-			xmlSetProp (xnode, "fill-color", rpt_common_rptcolor_to_string (priv->fill_color));
+			str = rpt_common_rptcolor_to_string (priv->fill_color);
+			xmlSetProp (xnode, "fill-color", str);
+			g_free (str);
 		}
 }
 
@@ -215,6 +232,7 @@ rpt_obj_rect_set_property (GObject *object, guint property_id, const GValue *val
 	switch (property_id)
 		{
 			case PROP_FILL_COLOR:
+				g_free (priv->fill_color);
 				priv->fill_color = g_memdup (g_value_get_pointer (value), sizeof (RptColor));
 				break;
 
@@ -243,7 +261,7 @@ rpt_obj_rect_get_property (GObject *object, guint property_id, GValue *value, GP
 						color->b = 1.0;
 						color->a = 1.0;
 
-						g_value_set_pointer (value, g_memdup (color, sizeof (RptColor)));
+						g_value_set_pointer (value, color);
 					}
 				else
 					{
@@ -256,3 +274,13 @@ rpt_obj_rect_get_property (GObject *object, guint property_id, GValue *value, GP
 				break;
 		}
 }
+
+static void
+rpt_obj_rect_finalize (GObject *object)
+{
+	RptObjRectPrivate *priv = RPT_OBJ_RECT_GET_PRIVATE (object);
+
+	g_free (priv->fill_color);
+
+	parent_class->finalize (object);
+}
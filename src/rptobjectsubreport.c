@@ -0,0 +1,311 @@
+/*
+ * Copyright (C) 2007-2014 Andrea Zagli <azagli@libero.it>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <string.h>
+
+#include "rptobjectsubreport.h"
+#include "rptcommon.h"
+
+enum
+{
+	PROP_0,
+	PROP_SIZE,
+	PROP_TEMPLATE,
+	PROP_PARAMETERS
+};
+
+static void rpt_obj_subreport_class_init (RptObjSubreportClass *klass);
+static void rpt_obj_subreport_init (RptObjSubreport *rpt_obj_subreport);
+
+static void rpt_obj_subreport_set_property (GObject *object,
+                                            guint property_id,
+                                            const GValue *value,
+                                            GParamSpec *pspec);
+static void rpt_obj_subreport_get_property (GObject *object,
+                                            guint property_id,
+                                            GValue *value,
+                                            GParamSpec *pspec);
+static void rpt_obj_subreport_finalize (GObject *object);
+
+static GObjectClass *parent_class = NULL;
+
+
+#define RPT_OBJ_SUBREPORT_GET_PRIVATE(obj) (G_TYPE_INSTANCE_GET_PRIVATE ((obj), TYPE_RPT_OBJ_SUBREPORT, RptObjSubreportPrivate))
+
+typedef struct _RptObjSubreportPrivate RptObjSubreportPrivate;
+struct _RptObjSubreportPrivate
+	{
+		RptSize *size;
+		gchar *template;
+		gchar *parameters;
+	};
+
+GType
+rpt_obj_subreport_get_type (void)
+{
+	static GType rpt_obj_subreport_type = 0;
+
+	if (!rpt_obj_subreport_type)
+		{
+			static const GTypeInfo rpt_obj_subreport_info =
+			{
+				sizeof (RptObjSubreportClass),
+				NULL,	/* base_init */
+				NULL,	/* base_finalize */
+				(GClassInitFunc) rpt_obj_subreport_class_init,
+				NULL,	/* class_finalize */
+				NULL,	/* class_data */
+				sizeof (RptObjSubreport),
+				0,	/* n_preallocs */
+				(GInstanceInitFunc) rpt_obj_subreport_init,
+				NULL
+			};
+
+			rpt_obj_subreport_type = g_type_register_static (TYPE_RPT_OBJECT, "RptObjSubreport",
+			                                                 &rpt_obj_subreport_info, 0);
+		}
+
+	return rpt_obj_subreport_type;
+}
+
+static void
+rpt_obj_subreport_class_init (RptObjSubreportClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	RptObjectClass *rptobject_class = RPT_OBJECT_CLASS (klass);
+
+	g_type_class_add_private (object_class, sizeof (RptObjSubreportPrivate));
+
+	parent_class = g_type_class_peek_parent (klass);
+
+	object_class->set_property = rpt_obj_subreport_set_property;
+	object_class->get_property = rpt_obj_subreport_get_property;
+	object_class->finalize = rpt_obj_subreport_finalize;
+
+	rptobject_class->get_xml = rpt_obj_subreport_get_xml;
+
+	g_object_class_install_property (object_class, PROP_SIZE,
+	                                 g_param_spec_pointer ("size",
+	                                                       "Size",
+	                                                       "The object's size.",
+	                                                       G_PARAM_READWRITE));
+	g_object_class_install_property (object_class, PROP_TEMPLATE,
+	                                 g_param_spec_string ("template",
+	                                                      "Template",
+	                                                      "The path of the detail's report definition.",
+	                                                      "",
+	                                                      G_PARAM_READWRITE | G_PARAM_CONSTRUCT));
+	g_object_class_install_property (object_class, PROP_PARAMETERS,
+	                                 g_param_spec_string ("parameters",
+	                                                      "Parameters",
+	                                                      "The detail's query parameters, as name=source separated by ';'.",
+	                                                      "",
+	                                                      G_PARAM_READWRITE | G_PARAM_CONSTRUCT));
+}
+
+static void
+rpt_obj_subreport_init (RptObjSubreport *rpt_obj_subreport)
+{
+	RptObjSubreportPrivate *priv = RPT_OBJ_SUBREPORT_GET_PRIVATE (rpt_obj_subreport);
+
+	priv->size = (RptSize *)g_malloc0 (sizeof (RptSize));
+	priv->size->width = 0.0;
+	priv->size->height = 0.0;
+
+	priv->template = NULL;
+	priv->parameters = NULL;
+}
+
+/**
+ * rpt_obj_subreport_new:
+ * @name: the #RptObjSubreport's name.
+ * @position: an #RptPoint.
+ *
+ * Creates a new #RptObjSubreport object and sets its position to @position.
+ *
+ * A subreport lays out, for every row of the report that contains it, the
+ * body of another report definition (the "template" property) once for
+ * every row of its query. The query's parameters (e.g. "##order::gint")
+ * are bound from the current row with the "parameters" property, e.g.
+ * "order=[id]", and it runs on the connection of the report that contains
+ * it, when it has one; the rows are read once for every different set of
+ * parameters' values during a run.
+ *
+ * The rows of the detail are placed one after the other from the
+ * subreport's position, so the section grows if it can.
+ *
+ * Returns: the newly created #RptObject object.
+ */
+RptObject
+*rpt_obj_subreport_new (const gchar *name, RptPoint position)
+{
+	RptObject *rpt_obj_subreport = NULL;
+
+	gchar *name_ = g_strstrip (g_strdup (name));
+
+	if (strcmp (name_, "") != 0)
+		{
+			rpt_obj_subreport = RPT_OBJECT (g_object_new (rpt_obj_subreport_get_type (), NULL));
+
+			g_object_set (G_OBJECT (rpt_obj_subreport),
+	                      "name", name_,
+	                      "position", &position,
+	                      NULL);
+		}
+	g_free (name_);
+
+	return rpt_obj_subreport;
+}
+
+/**
+ * rpt_obj_subreport_new_from_xml:
+ * @xnode:
+ *
+ * Returns: the newly created #RptObject object.
+ */
+RptObject
+*rpt_obj_subreport_new_from_xml (xmlNode *xnode)
+{
+	gchar *name;
+	gchar *prop;
+	RptObject *rpt_obj_subreport = NULL;
+
+	name = (gchar *)xmlGetProp (xnode, "name");
+	if (name != NULL && strcmp (g_strstrip (name), "") != 0)
+		{
+			RptPoint *position;
+			RptObjSubreportPrivate *priv;
+
+			position = rpt_common_get_position (xnode);
+
+			rpt_obj_subreport = rpt_obj_subreport_new ((const gchar *)name, *position);
+			g_free (position);
+
+			if (rpt_obj_subreport != NULL)
+				{
+					priv = RPT_OBJ_SUBREPORT_GET_PRIVATE (rpt_obj_subreport);
+
+					rpt_object_set_from_xml (RPT_OBJECT (rpt_obj_subreport), xnode);
+
+					g_free (priv->size);
+					priv->size = rpt_common_get_size (xnode);
+
+					prop = (gchar *)xmlGetProp (xnode, "template");
+					g_object_set (rpt_obj_subreport, "template", prop, NULL);
+					if (prop != NULL) xmlFree (prop);
+
+					prop = (gchar *)xmlGetProp (xnode, "parameters");
+					g_object_set (rpt_obj_subreport, "parameters", prop, NULL);
+					if (prop != NULL) xmlFree (prop);
+				}
+		}
+	if (name != NULL) xmlFree (name);
+
+	return rpt_obj_subreport;
+}
+
+/**
+ * rpt_obj_subreport_get_xml:
+ * @rpt_objsubreport:
+ * @xnode:
+ *
+ */
+void
+rpt_obj_subreport_get_xml (RptObject *rpt_objsubreport, xmlNode *xnode)
+{
+	RptObjSubreportPrivate *priv = RPT_OBJ_SUBREPORT_GET_PRIVATE (rpt_objsubreport);
+
+	xmlNodeSetName (xnode, "subreport");
+
+	rpt_common_set_size (xnode, priv->size);
+
+	xmlSetProp (xnode, "template", priv->template);
+	if (priv->parameters != NULL && priv->parameters[0] != '\0')
+		{
+			xmlSetProp (xnode, "parameters", priv->parameters);
+		}
+}
+
+static void
+rpt_obj_subreport_set_property (GObject *object, guint property_id, const GValue *value, GParamSpec *pspec)
+{
+	RptObjSubreport *rpt_obj_subreport = RPT_OBJ_SUBREPORT (object);
+
+	RptObjSubreportPrivate *priv = RPT_OBJ_SUBREPORT_GET_PRIVATE (rpt_obj_subreport);
+
+	switch (property_id)
+		{
+			case PROP_SIZE:
+				g_free (priv->size);
+				priv->size = g_memdup (g_value_get_pointer (value), sizeof (RptSize));
+				break;
+
+			case PROP_TEMPLATE:
+				g_free (priv->template);
+				priv->template = g_strstrip (g_strdup (g_value_get_string (value)));
+				break;
+
+			case PROP_PARAMETERS:
+				g_free (priv->parameters);
+				priv->parameters = g_strstrip (g_strdup (g_value_get_string (value)));
+				break;
+
+			default:
+				G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+				break;
+		}
+}
+
+static void
+rpt_obj_subreport_get_property (GObject *object, guint property_id, GValue *value, GParamSpec *pspec)
+{
+	RptObjSubreport *rpt_obj_subreport = RPT_OBJ_SUBREPORT (object);
+
+	RptObjSubreportPrivate *priv = RPT_OBJ_SUBREPORT_GET_PRIVATE (rpt_obj_subreport);
+
+	switch (property_id)
+		{
+			case PROP_SIZE:
+				g_value_set_pointer (value, g_memdup (priv->size, sizeof (RptSize)));
+				break;
+
+			case PROP_TEMPLATE:
+				g_value_set_string (value, priv->template);
+				break;
+
+			case PROP_PARAMETERS:
+				g_value_set_string (value, priv->parameters);
+				break;
+
+			default:
+				G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+				break;
+		}
+}
+
+static void
+rpt_obj_subreport_finalize (GObject *object)
+{
+	RptObjSubreportPrivate *priv = RPT_OBJ_SUBREPORT_GET_PRIVATE (object);
+
+	g_free (priv->size);
+	g_free (priv->template);
+	g_free (priv->parameters);
+
+	parent_class->finalize (object);
+}
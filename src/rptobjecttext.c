@@ -35,7 +35,10 @@ enum
 	PROP_PADDING_LEFT,
 	PROP_ELLIPSIZE,
 	PROP_LETTER_SPACING,
-	PROP_FILL_WITH
+	PROP_FILL_WITH,
+	PROP_CAN_GROW,
+	PROP_CAN_SHRINK,
+	PROP_FORMAT
 };
 
 static void rpt_obj_text_class_init (RptObjTextClass *klass);
@@ -49,6 +52,7 @@ static void rpt_obj_text_get_property (GObject *object,
                                        guint property_id,
                                        GValue *value,
                                        GParamSpec *pspec);
+static void rpt_obj_text_finalize (GObject *object);
 
 
 #define RPT_OBJ_TEXT_GET_PRIVATE(obj) (G_TYPE_INSTANCE_GET_PRIVATE ((obj), TYPE_RPT_OBJ_TEXT, RptObjTextPrivate))
@@ -70,6 +74,9 @@ struct _RptObjTextPrivate
 		eRptEllipsize ellipsize;
 		guint letter_spacing;
 		gchar *fill_with;
+		gboolean can_grow;
+		gboolean can_shrink;
+		gchar *format;
 	};
 
 G_DEFINE_TYPE (RptObjText, rpt_obj_text, TYPE_RPT_OBJECT)
@@ -84,6 +91,7 @@ rpt_obj_text_class_init (RptObjTextClass *klass)
 
 	object_class->set_property = rpt_obj_text_set_property;
 	object_class->get_property = rpt_obj_text_get_property;
+	object_class->finalize = rpt_obj_text_finalize;
 
 	rptobject_class->get_xml = rpt_obj_text_get_xml;
 
@@ -165,6 +173,24 @@ rpt_obj_text_class_init (RptObjTextClass *klass)
 	                                                      "Fill the box with the specified string.",
 	                                                      "",
 	                                                      G_PARAM_READWRITE | G_PARAM_CONSTRUCT));
+	g_object_class_install_property (object_class, PROP_CAN_GROW,
+	                                 g_param_spec_boolean ("can-grow",
+	                                                       "Can grow",
+	                                                       "Whether the object's height can grow to fit its text.",
+	                                                       FALSE,
+	                                                       G_PARAM_READWRITE | G_PARAM_CONSTRUCT));
+	g_object_class_install_property (object_class, PROP_CAN_SHRINK,
+	                                 g_param_spec_boolean ("can-shrink",
+	                                                       "Can shrink",
+	                                                       "Whether the object's height can shrink to fit its text.",
+	                                                       FALSE,
+	                                                       G_PARAM_READWRITE | G_PARAM_CONSTRUCT));
+	g_object_class_install_property (object_class, PROP_FORMAT,
+	                                 g_param_spec_string ("format",
+	                                                      "Format",
+	                                                      "The mask used to format numbers and dates (ex. #,##0.00 or dd/MM/yyyy).",
+	                                                      "",
+	                                                      G_PARAM_READWRITE | G_PARAM_CONSTRUCT));
 }
 
 static void
@@ -245,6 +271,7 @@ RptObject
 			position = rpt_common_get_position (xnode);
 
 			rpt_obj_text = rpt_obj_text_new ((const gchar *)name, *position);
+			g_free (position);
 
 			if (rpt_obj_text != NULL)
 				{
@@ -254,6 +281,10 @@ RptObject
 
 					priv = RPT_OBJ_TEXT_GET_PRIVATE (rpt_obj_text);
 
+					/* the defaults set by init are replaced */
+					g_free (priv->size);
+					rpt_common_rptfont_free (priv->font);
+
 					priv->size = rpt_common_get_size (xnode);
 					priv->rotation = rpt_common_get_rotation (xnode);
 					priv->border = rpt_common_get_border (xnode);
@@ -271,6 +302,7 @@ RptObject
 
 							color = rpt_common_parse_color (g_strstrip (prop));
 							g_object_set (rpt_obj_text, "background-color", color, NULL);
+							g_free (color);
 
 							xmlFree (prop);
 						}
@@ -317,8 +349,27 @@ RptObject
 							g_object_set (rpt_obj_text, "fill-with", prop, NULL);
 							xmlFree (prop);
 						}
+					prop = (gchar *)xmlGetProp (xnode, "can-grow");
+					if (prop != NULL)
+						{
+							g_object_set (rpt_obj_text, "can-grow", strcasecmp (g_strstrip (prop), "y") == 0, NULL);
+							xmlFree (prop);
+						}
+					prop = (gchar *)xmlGetProp (xnode, "can-shrink");
+					if (prop != NULL)
+						{
+							g_object_set (rpt_obj_text, "can-shrink", strcasecmp (g_strstrip (prop), "y") == 0, NULL);
+							xmlFree (prop);
+						}
+					prop = (gchar *)xmlGetProp (xnode, "format");
+					if (prop != NULL)
+						{
+							g_object_set (rpt_obj_text, "format", prop, NULL);
+							xmlFree (prop);
+						}
 				}
 		}
+	if (name != NULL) xmlFree (name);
 
 	return rpt_obj_text;
 }
@@ -332,6 +383,9 @@ RptObject
 void
 rpt_obj_text_get_xml (RptObject *rpt_objtext, xmlNode *xnode)
 {
+	gchar buf[64];
+	gchar *str;
+
 	RptObjTextPrivate *priv = RPT_OBJ_TEXT_GET_PRIVATE (rpt_objtext);
 
 	xmlNodeSetName (xnode, "text");
@@ -346,38 +400,60 @@ rpt_obj_text_get_xml (RptObject *rpt_objtext, xmlNode *xnode)
 
 	if (priv->background_color != NULL)
 		{
-			xmlSetProp (xnode, "background-color", rpt_common_rptcolor_to_string (priv->background_color));
+			str = rpt_common_rptcolor_to_string (priv->background_color);
+			xmlSetProp (xnode, "background-color", str);
+			g_free (str);
 		}
 
 	if (priv->padding_top != 0.0)
 		{
-			xmlSetProp (xnode, "padding-top", g_strdup_printf ("%f", priv->padding_top));
+			g_snprintf (buf, sizeof (buf), "%f", priv->padding_top);
+			xmlSetProp (xnode, "padding-top", buf);
 		}
 	if (priv->padding_right != 0.0)
 		{
-			xmlSetProp (xnode, "padding-right", g_strdup_printf ("%f", priv->padding_right));
+			g_snprintf (buf, sizeof (buf), "%f", priv->padding_right);
+			xmlSetProp (xnode, "padding-right", buf);
 		}
 	if (priv->padding_bottom != 0.0)
 		{
-			xmlSetProp (xnode, "padding-bottom", g_strdup_printf ("%f", priv->padding_bottom));
+			g_snprintf (buf, sizeof (buf), "%f", priv->padding_bottom);
+			xmlSetProp (xnode, "padding-bottom", buf);
 		}
 	if (priv->padding_left != 0.0)
 		{
-			xmlSetProp (xnode, "padding-left", g_strdup_printf ("%f", priv->padding_left));
+			g_snprintf (buf, sizeof (buf), "%f", priv->padding_left);
+			xmlSetProp (xnode, "padding-left", buf);
 		}
 	if (priv->ellipsize > RPT_ELLIPSIZE_NONE)
 		{
-			xmlSetProp (xnode, "ellipsize", rpt_common_enum_to_strellipsize (priv->ellipsize));
+			str = (gchar *)rpt_common_enum_to_strellipsize (priv->ellipsize);
+			xmlSetProp (xnode, "ellipsize", str);
+			g_free (str);
 		}
 	if (priv->letter_spacing > 0)
 		{
-			xmlSetProp (xnode, "letter-spacing", g_strdup_printf ("%d", priv->letter_spacing));
+			g_snprintf (buf, sizeof (buf), "%u", priv->letter_spacing);
+			xmlSetProp (xnode, "letter-spacing", buf);
 		}
 	if (priv->fill_with != NULL
 	    && g_strcmp0 (priv->fill_with, "") != 0)
 		{
 			xmlSetProp (xnode, "fill-with", priv->fill_with);
 		}
+	if (priv->can_grow)
+		{
+			xmlSetProp (xnode, "can-grow", "y");
+		}
+	if (priv->can_shrink)
+		{
+			xmlSetProp (xnode, "can-shrink", "y");
+		}
+	if (priv->format != NULL
+	    && g_strcmp0 (priv->format, "") != 0)
+		{
+			xmlSetProp (xnode, "format", priv->format);
+		}
 }
 
 static void
@@ -389,30 +465,37 @@ rpt_obj_text_set_property (GObject *object, guint property_id, const GValue *val
 	switch (property_id)
 		{
 			case PROP_SIZE:
+				g_free (priv->size);
 				priv->size = g_memdup (g_value_get_pointer (value), sizeof (RptSize));
 				break;
 
 			case PROP_ROTATION:
+				g_free (priv->rotation);
 				priv->rotation = g_memdup (g_value_get_pointer (value), sizeof (RptRotation));
 				break;
 
 			case PROP_BORDER:
-				priv->border = g_memdup (g_value_get_pointer (value), sizeof (RptBorder));
+				rpt_common_rptborder_free (priv->border);
+				priv->border = rpt_common_rptborder_copy (g_value_get_pointer (value));
 				break;
 
 			case PROP_FONT:
-				priv->font = g_memdup (g_value_get_pointer (value), sizeof (RptFont));
+				rpt_common_rptfont_free (priv->font);
+				priv->font = rpt_common_rptfont_copy (g_value_get_pointer (value));
 				break;
 
 			case PROP_ALIGN:
+				g_free (priv->align);
 				priv->align = g_memdup (g_value_get_pointer (value), sizeof (RptAlign));
 				break;
 
 			case PROP_SOURCE:
+				g_free (priv->source);
 				priv->source = g_strstrip (g_strdup (g_value_get_string (value)));
 				break;
 
 			case PROP_BACKGROUND_COLOR:
+				g_free (priv->background_color);
 				priv->background_color = g_memdup (g_value_get_pointer (value), sizeof (RptColor));
 				break;
 
@@ -441,9 +524,23 @@ rpt_obj_text_set_property (GObject *object, guint property_id, const GValue *val
 				break;
 
 			case PROP_FILL_WITH:
+				g_free (priv->fill_with);
 				priv->fill_with = g_strstrip (g_strdup (g_value_get_string (value)));
 				break;
 
+			case PROP_CAN_GROW:
+				priv->can_grow = g_value_get_boolean (value);
+				break;
+
+			case PROP_CAN_SHRINK:
+				priv->can_shrink = g_value_get_boolean (value);
+				break;
+
+			case PROP_FORMAT:
+				g_free (priv->format);
+				priv->format = g_strdup (g_value_get_string (value));
+				break;
+
 			default:
 				G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
 				break;
@@ -467,11 +564,11 @@ rpt_obj_text_get_property (GObject *object, guint property_id, GValue *value, GP
 				break;
 
 			case PROP_BORDER:
-				g_value_set_pointer (value, g_memdup (priv->border, sizeof (RptBorder)));
+				g_value_set_pointer (value, rpt_common_rptborder_copy (priv->border));
 				break;
 
 			case PROP_FONT:
-				g_value_set_pointer (value, g_memdup (priv->font, sizeof (RptFont)));
+				g_value_set_pointer (value, rpt_common_rptfont_copy (priv->font));
 				break;
 
 			case PROP_ALIGN:
@@ -514,8 +611,38 @@ rpt_obj_text_get_property (GObject *object, guint property_id, GValue *value, GP
 				g_value_set_string (value, priv->fill_with);
 				break;
 
+			case PROP_CAN_GROW:
+				g_value_set_boolean (value, priv->can_grow);
+				break;
+
+			case PROP_CAN_SHRINK:
+				g_value_set_boolean (value, priv->can_shrink);
+				break;
+
+			case PROP_FORMAT:
+				g_value_set_string (value, priv->format);
+				break;
+
 			default:
 				G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
 				break;
 		}
 }
+
+static void
+rpt_obj_text_finalize (GObject *object)
+{
+	RptObjTextPrivate *priv = RPT_OBJ_TEXT_GET_PRIVATE (object);
+
+	g_free (priv->size);
+	g_free (priv->rotation);
+	rpt_common_rptborder_free (priv->border);
+	rpt_common_rptfont_free (priv->font);
+	g_free (priv->align);
+	g_free (priv->source);
+	g_free (priv->background_color);
+	g_free (priv->fill_with);
+	g_free (priv->format);
+
+	G_OBJECT_CLASS (rpt_obj_text_parent_class)->finalize (object);
+}
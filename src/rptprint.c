@@ -16,10 +16,18 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
 #include <locale.h>
+#include <errno.h>
+
+#ifdef G_OS_WIN32
+	#include <io.h>
+#else
+	#include <unistd.h>
+#endif
 
 #include <cairo.h>
 #include <cairo-pdf.h>
@@ -28,9 +36,13 @@
 #include <pango/pangocairo.h>
 #include <pango/pango-attributes.h>
 #include <libxml/xpath.h>
+#include <gmodule.h>
 
 #include "rptprint.h"
 #include "rptcommon.h"
+#include "rptlayoutcache.h"
+#include "rptraster.h"
+#include "rptspatialindex.h"
 
 enum
 {
@@ -40,12 +52,18 @@ enum
 	PROP_OUTPUT_FILENAME,
 	PROP_COPIES,
 	PROP_TRANSLATION,
-	PROP_PATH_RELATIVES_TO
+	PROP_PATH_RELATIVES_TO,
+	PROP_PNG_COMPRESSION,
+	PROP_PNG_FILTER,
+	PROP_RESOLUTION,
+	PROP_STRIP_HEIGHT
 };
 
 static void rpt_print_class_init (RptPrintClass *klass);
 static void rpt_print_init (RptPrint *rpt_print);
 
+static void rpt_print_finalize (GObject *object);
+
 static void rpt_print_set_property (GObject *object,
                                     guint property_id,
                                     const GValue *value,
@@ -60,6 +78,16 @@ static void rpt_print_get_xml_page_attributes (RptPrint *rpt_print,
 
 static void rpt_print_page (RptPrint *rpt_print,
                             xmlNode *xnode);
+static void rpt_print_object (RptPrint *rpt_print,
+                              xmlNode *xnode);
+static void rpt_print_static_band (RptPrint *rpt_print,
+                                   xmlNode *xpage,
+                                   const gchar *static_id);
+static RptSpatialIndex *rpt_print_get_page_index (RptPrint *rpt_print,
+                                                  xmlNode *xpage);
+static gboolean rpt_print_get_object_extents (RptPrint *rpt_print,
+                                              xmlNode *xnode,
+                                              cairo_rectangle_t *extents);
 static void rpt_print_text_xml (RptPrint *rpt_print,
                                 xmlNode *xnode);
 static void rpt_print_line_xml (RptPrint *rpt_print,
@@ -80,6 +108,17 @@ static void rpt_print_border (RptPrint *rpt_print,
                               const RptSize *size,
                               const RptBorder *border,
                               const RptRotation *rotation);
+static void rpt_print_border_line (RptPrint *rpt_print,
+                                   const RptPoint *from_p,
+                                   const RptPoint *to_p,
+                                   const RptStroke *stroke,
+                                   const RptRotation *rotation);
+static gint rpt_print_border_segment_compare (gconstpointer a,
+                                             gconstpointer b);
+static void rpt_print_border_segments_to_path (RptPrint *rpt_print,
+                                               GArray *segments,
+                                               gboolean horizontal);
+static void rpt_print_border_batches_flush (RptPrint *rpt_print);
 
 
 static gchar *rpt_print_new_numbered_filename (const gchar *filename,
@@ -89,23 +128,43 @@ static void rpt_print_rotate (RptPrint *rpt_print,
                               const RptSize *size,
                               gdouble angle);
 
-
-static void rpt_print_gtk_begin_print (GtkPrintOperation *operation, 
-                                       GtkPrintContext *context,
-                                       gpointer user_data);
-static void rpt_print_gtk_request_page_setup (GtkPrintOperation *operation,
-                                              GtkPrintContext *context,
-                                              gint page_nr,
-                                              GtkPageSetup *setup,
-                                              gpointer user_data);
-static void rpt_print_gtk_draw_page (GtkPrintOperation *operation,
-                                     GtkPrintContext *context,
-                                     gint page_nr,
-                                     gpointer user_data);
+static gboolean rpt_print_has_output_sink (RptPrint *rpt_print);
+static gboolean rpt_print_is_raster_output (RptPrint *rpt_print);
+static gboolean rpt_print_page_in_range (RptPrint *rpt_print,
+                                         gint npage);
+static void rpt_print_raster_page (RptPrint *rpt_print,
+                                   xmlNode *xpage,
+                                   gint npage,
+                                   gdouble width,
+                                   gdouble height);
+static cairo_status_t rpt_print_write (void *closure,
+                                      const unsigned char *data,
+                                      unsigned int length);
+static void rpt_print_set_error (RptPrint *rpt_print,
+                                 gint code,
+                                 const gchar *format,
+                                 ...) G_GNUC_PRINTF (3, 4);
+static void rpt_print_surface_finish (RptPrint *rpt_print);
+static cairo_surface_t *rpt_print_create_surface (RptPrint *rpt_print,
+                                                  const gchar *filename,
+                                                  gdouble width,
+                                                  gdouble height);
+
+static gboolean rpt_print_load_pages (RptPrint *rpt_print);
+static void rpt_print_free_pages (RptPrint *rpt_print);
+
+/* the GtkPrintOperation output, that lives in libreptool-gtk */
+typedef void (*RptPrintGtkPrintFunc) (RptPrint *rpt_print, gpointer transient);
+
+static RptPrintGtkPrintFunc rpt_print_get_gtk_print (void);
 
 
 #define RPT_PRINT_GET_PRIVATE(obj) (G_TYPE_INSTANCE_GET_PRIVATE ((obj), TYPE_RPT_PRINT, RptPrintPrivate))
 
+/* rows of a strip by default: 5 MB for an A4 page at 300 dpi, whatever the
+ * page's height; a strip draws only the objects it shows */
+#define RPT_PRINT_STRIP_HEIGHT 512
+
 typedef struct _RptPrintPrivate RptPrintPrivate;
 struct _RptPrintPrivate
 	{
@@ -114,7 +173,27 @@ struct _RptPrintPrivate
 		eRptOutputType output_type;
 		gchar *output_filename;
 
-		GtkPrintSettings *gtk_print_settings;
+		/* where the output goes instead of output_filename: the first that is set */
+		GByteArray *output_bytes;
+		GOutputStream *output_stream;
+		gint output_fd;
+
+		/* 0 if not set */
+		guint copies;
+
+		/* the pages printed, starting from 1; 0 for no limit */
+		guint page_first;
+		guint page_last;
+
+		/* -1 for the libpng's default */
+		gint png_compression;
+		eRptPngFilter png_filter;
+
+		/* raster outputs: dots per inch, and the rows drawn at once (0 for
+		 * the whole page) in strip, that is reused by the next pages */
+		gdouble resolution;
+		guint strip_height;
+		cairo_surface_t *strip;
 
 		RptTranslation *translation;
 
@@ -128,14 +207,47 @@ struct _RptPrintPrivate
 		gdouble margin_left;
 
 		xmlDoc *xdoc;
+		gboolean xdoc_owned;
 
+		xmlXPathObject *xppages;
 		xmlNodeSet *pages;
 
+		/* page's xmlNode -> RptSpatialIndex of its objects */
+		GHashTable *indexes;
+
+		/* RptPrintBorderBatch of the page being drawn */
+		GPtrArray *border_batches;
+
+		/* static-id -> recording surface of the objects with it */
+		GHashTable *static_bands;
+
 		cairo_surface_t *surface;
 		cairo_t *cr;
-		GtkPrintContext *gtk_print_context;
+
+		/* the first error of the print going on */
+		GError *error;
 	};
 
+/* a border side, horizontal or vertical, in points */
+typedef struct
+{
+	/* y of an horizontal side, x of a vertical one */
+	gdouble fixed;
+	gdouble from;
+	gdouble to;
+} RptPrintBorderSegment;
+
+/* the border sides of a page with the same stroke, drawn in one path */
+typedef struct
+{
+	gdouble width;
+	RptColor color;
+	GArray *style;
+
+	GArray *horizontal;
+	GArray *vertical;
+} RptPrintBorderBatch;
+
 G_DEFINE_TYPE (RptPrint, rpt_print, G_TYPE_OBJECT)
 
 static void
@@ -147,6 +259,7 @@ rpt_print_class_init (RptPrintClass *klass)
 
 	object_class->set_property = rpt_print_set_property;
 	object_class->get_property = rpt_print_get_property;
+	object_class->finalize = rpt_print_finalize;
 
 	g_object_class_install_property (object_class, PROP_UNIT_LENGTH,
 	                                 g_param_spec_int ("unit-length",
@@ -160,7 +273,7 @@ rpt_print_class_init (RptPrintClass *klass)
 	                                 g_param_spec_int ("output-type",
 	                                                   "Output Type",
 	                                                   "The output type.",
-	                                                   RPT_OUTPUT_PNG, RPT_OUTPUT_GTK,
+	                                                   RPT_OUTPUT_PNG, RPT_OUTPUT_RAW,
 	                                                   RPT_OUTPUT_PDF,
 	                                                   G_PARAM_READWRITE));
 
@@ -191,6 +304,38 @@ rpt_print_class_init (RptPrintClass *klass)
 	                                                      "Path are relatives to this property's content.",
 	                                                      "",
 	                                                      G_PARAM_READWRITE));
+
+	g_object_class_install_property (object_class, PROP_PNG_COMPRESSION,
+	                                 g_param_spec_int ("png-compression",
+	                                                   "PNG compression",
+	                                                   "The zlib compression level of the png output; -1 for the default.",
+	                                                   -1, 9,
+	                                                   -1,
+	                                                   G_PARAM_READWRITE));
+
+	g_object_class_install_property (object_class, PROP_PNG_FILTER,
+	                                 g_param_spec_int ("png-filter",
+	                                                   "PNG filter",
+	                                                   "The row filter of the png output.",
+	                                                   RPT_PNG_FILTER_DEFAULT, RPT_PNG_FILTER_ALL,
+	                                                   RPT_PNG_FILTER_DEFAULT,
+	                                                   G_PARAM_READWRITE));
+
+	g_object_class_install_property (object_class, PROP_RESOLUTION,
+	                                 g_param_spec_double ("resolution",
+	                                                      "Resolution",
+	                                                      "The dots per inch of the raster outputs.",
+	                                                      1.0, 9600.0,
+	                                                      72.0,
+	                                                      G_PARAM_READWRITE));
+
+	g_object_class_install_property (object_class, PROP_STRIP_HEIGHT,
+	                                 g_param_spec_uint ("strip-height",
+	                                                    "Strip height",
+	                                                    "The rows of pixels the raster outputs draw at once; 0 for the whole page.",
+	                                                    0, G_MAXUINT,
+	                                                    RPT_PRINT_STRIP_HEIGHT,
+	                                                    G_PARAM_READWRITE));
 }
 
 static void
@@ -201,13 +346,56 @@ rpt_print_init (RptPrint *rpt_print)
 	priv->unit = -1;
 	priv->output_type = -1;
 	priv->output_filename = NULL;
-	priv->gtk_print_settings = NULL;
+	priv->output_bytes = NULL;
+	priv->output_stream = NULL;
+	priv->output_fd = -1;
+	priv->copies = 0;
+	priv->png_compression = -1;
+	priv->png_filter = RPT_PNG_FILTER_DEFAULT;
+	priv->resolution = 72.0;
+	priv->strip_height = RPT_PRINT_STRIP_HEIGHT;
+	priv->strip = NULL;
 	priv->path_relatives_to = g_strdup ("");
 	priv->translation = NULL;
 
+	priv->xppages = NULL;
+	priv->pages = NULL;
+	priv->indexes = NULL;
+	priv->border_batches = NULL;
+	priv->static_bands = NULL;
+
 	priv->surface = NULL;
 	priv->cr = NULL;
-	priv->gtk_print_context = NULL;
+	priv->error = NULL;
+}
+
+static void
+rpt_print_finalize (GObject *object)
+{
+	RptPrint *rpt_print = RPT_PRINT (object);
+
+	RptPrintPrivate *priv = RPT_PRINT_GET_PRIVATE (rpt_print);
+
+	g_free (priv->output_filename);
+	if (priv->output_stream != NULL)
+		{
+			g_object_unref (priv->output_stream);
+		}
+	g_free (priv->path_relatives_to);
+	g_free (priv->translation);
+	if (priv->strip != NULL)
+		{
+			cairo_surface_destroy (priv->strip);
+		}
+
+	rpt_print_free_pages (rpt_print);
+
+	if (priv->xdoc_owned)
+		{
+			xmlFreeDoc (priv->xdoc);
+		}
+
+	G_OBJECT_CLASS (rpt_print_parent_class)->finalize (object);
 }
 
 /**
@@ -271,6 +459,14 @@ RptPrint
 	if (xdoc != NULL)
 		{
 			rpt_print = rpt_print_new_from_xml (xdoc);
+			if (rpt_print != NULL)
+				{
+					RPT_PRINT_GET_PRIVATE (rpt_print)->xdoc_owned = TRUE;
+				}
+			else
+				{
+					xmlFreeDoc (xdoc);
+				}
 		}
 
 	return rpt_print;
@@ -305,33 +501,63 @@ rpt_print_set_output_filename (RptPrint *rpt_print, const gchar *output_filename
 
 	RptPrintPrivate *priv = RPT_PRINT_GET_PRIVATE (rpt_print);
 
+	g_free (priv->output_filename);
 	priv->output_filename = g_strdup (output_filename);
 	if (g_strcmp0 (priv->output_filename, "") == 0)
 		{
 			g_warning ("It's not possible to set an empty output filename; default to rptreport.pdf.");
+			g_free (priv->output_filename);
 			priv->output_filename = g_strdup ("rptreport.pdf");
 		}
 }
 
 /**
- * rpt_print_set_gtkprintsettings:
+ * rpt_print_set_output_stream:
  * @rpt_print: an #RptPrint object.
- * @settings: a #GtkPrintSettings object.
+ * @stream: (allow-none): the #GOutputStream to write to; NULL to write
+ * to the output filename again.
  *
+ * The output is written to @stream, that isn't closed. A png or an svg
+ * is one image, so with more than one page to print they can't be
+ * written to @stream: rpt_print_print_full() fails with
+ * %RPT_PRINT_ERROR_NOT_SUPPORTED.
  */
 void
-rpt_print_set_gtkprintsettings (RptPrint *rpt_print, GtkPrintSettings *settings)
+rpt_print_set_output_stream (RptPrint *rpt_print, GOutputStream *stream)
 {
 	g_return_if_fail (IS_RPT_PRINT (rpt_print));
-	g_return_if_fail (GTK_IS_PRINT_SETTINGS (settings));
+	g_return_if_fail (stream == NULL || G_IS_OUTPUT_STREAM (stream));
 
 	RptPrintPrivate *priv = RPT_PRINT_GET_PRIVATE (rpt_print);
 
-	if (GTK_IS_PRINT_SETTINGS (priv->gtk_print_settings))
+	if (stream != NULL)
 		{
-			g_object_unref (priv->gtk_print_settings);
+			g_object_ref (stream);
 		}
-	priv->gtk_print_settings = gtk_print_settings_copy (settings);
+	if (priv->output_stream != NULL)
+		{
+			g_object_unref (priv->output_stream);
+		}
+	priv->output_stream = stream;
+}
+
+/**
+ * rpt_print_set_output_fd:
+ * @rpt_print: an #RptPrint object.
+ * @fd: the file descriptor to write to; -1 to write to the output
+ * filename again.
+ *
+ * Like rpt_print_set_output_stream(), but for a file descriptor, that
+ * isn't closed.
+ */
+void
+rpt_print_set_output_fd (RptPrint *rpt_print, gint fd)
+{
+	g_return_if_fail (IS_RPT_PRINT (rpt_print));
+
+	RptPrintPrivate *priv = RPT_PRINT_GET_PRIVATE (rpt_print);
+
+	priv->output_fd = fd < 0 ? -1 : fd;
 }
 
 /**
@@ -339,7 +565,6 @@ rpt_print_set_gtkprintsettings (RptPrint *rpt_print, GtkPrintSettings *settings)
  * @rpt_print: an #RptPrint object.
  * @copies: number of copies.
  *
- * Deprecated:0.2.2: use rpt_print_set_gtkprintsettings() instead.
  */
 void
 rpt_print_set_copies (RptPrint *rpt_print, guint copies)
@@ -348,11 +573,126 @@ rpt_print_set_copies (RptPrint *rpt_print, guint copies)
 
 	RptPrintPrivate *priv = RPT_PRINT_GET_PRIVATE (rpt_print);
 
-	if (!GTK_IS_PRINT_SETTINGS (priv->gtk_print_settings))
+	priv->copies = copies;
+}
+
+/**
+ * rpt_print_set_page_range:
+ * @rpt_print: an #RptPrint object.
+ * @first: the first page to print, starting from 1; 0 for the first.
+ * @last: the last page to print; 0 for the last.
+ *
+ * rpt_print_print() skips the pages outside of the range; the gtk output
+ * passes it to the print dialog.
+ */
+void
+rpt_print_set_page_range (RptPrint *rpt_print, guint first, guint last)
+{
+	g_return_if_fail (IS_RPT_PRINT (rpt_print));
+	g_return_if_fail (last == 0 || first <= last);
+
+	RptPrintPrivate *priv = RPT_PRINT_GET_PRIVATE (rpt_print);
+
+	priv->page_first = first;
+	priv->page_last = last;
+}
+
+/**
+ * rpt_print_get_page_range:
+ * @rpt_print: an #RptPrint object.
+ * @first: (out) (allow-none): where to put the first page.
+ * @last: (out) (allow-none): where to put the last page; 0 for the last.
+ *
+ * Returns: FALSE if all the pages are printed.
+ */
+gboolean
+rpt_print_get_page_range (RptPrint *rpt_print, guint *first, guint *last)
+{
+	g_return_val_if_fail (IS_RPT_PRINT (rpt_print), FALSE);
+
+	RptPrintPrivate *priv = RPT_PRINT_GET_PRIVATE (rpt_print);
+
+	if (first != NULL)
 		{
-			priv->gtk_print_settings = gtk_print_settings_new ();
+			*first = MAX (priv->page_first, 1);
 		}
-	gtk_print_settings_set_n_copies (priv->gtk_print_settings, copies);
+	if (last != NULL)
+		{
+			*last = priv->page_last;
+		}
+
+	return priv->page_first > 1 || priv->page_last > 0;
+}
+
+/**
+ * rpt_print_set_png_compression:
+ * @rpt_print: an #RptPrint object.
+ * @compression: the zlib level of the png output, from 0 (faster) to 9
+ * (smaller); -1 for the libpng's default.
+ *
+ */
+void
+rpt_print_set_png_compression (RptPrint *rpt_print, gint compression)
+{
+	g_return_if_fail (IS_RPT_PRINT (rpt_print));
+
+	RptPrintPrivate *priv = RPT_PRINT_GET_PRIVATE (rpt_print);
+
+	priv->png_compression = CLAMP (compression, -1, 9);
+}
+
+/**
+ * rpt_print_set_png_filter:
+ * @rpt_print: an #RptPrint object.
+ * @filter: the row filter of the png output; #RPT_PNG_FILTER_NONE with a
+ * low compression is the fastest.
+ *
+ */
+void
+rpt_print_set_png_filter (RptPrint *rpt_print, eRptPngFilter filter)
+{
+	g_return_if_fail (IS_RPT_PRINT (rpt_print));
+
+	RptPrintPrivate *priv = RPT_PRINT_GET_PRIVATE (rpt_print);
+
+	priv->png_filter = filter;
+}
+
+/**
+ * rpt_print_set_resolution:
+ * @rpt_print: an #RptPrint object.
+ * @resolution: the dots per inch of the png, pam and raw outputs; the
+ * default is 72, a pixel for each point.
+ *
+ */
+void
+rpt_print_set_resolution (RptPrint *rpt_print, gdouble resolution)
+{
+	g_return_if_fail (IS_RPT_PRINT (rpt_print));
+	g_return_if_fail (resolution > 0.0);
+
+	RptPrintPrivate *priv = RPT_PRINT_GET_PRIVATE (rpt_print);
+
+	priv->resolution = resolution;
+}
+
+/**
+ * rpt_print_set_strip_height:
+ * @rpt_print: an #RptPrint object.
+ * @rows: the rows of pixels drawn at once; 0 for the whole page.
+ *
+ * The png, pam and raw outputs draw every page in horizontal strips of
+ * @rows rows, given to the encoder one after another, so the memory used
+ * is width * @rows * 4 bytes at any resolution. The default is 512 rows.
+ */
+void
+rpt_print_set_strip_height (RptPrint *rpt_print, guint rows)
+{
+	g_return_if_fail (IS_RPT_PRINT (rpt_print));
+
+	RptPrintPrivate *priv = RPT_PRINT_GET_PRIVATE (rpt_print);
+
+	priv->strip_height = rows;
 }
 
 /**
@@ -380,165 +720,270 @@ rpt_print_set_translation (RptPrint *rpt_print, RptTranslation *translation)
 }
 
 /**
- * rpt_print_print:
+ * rpt_print_get_n_pages:
  * @rpt_print: an #RptPrint object.
- * @transient:
  *
+ * Returns: the number of pages of @rpt_print; 0 if the xml isn't valid.
  */
-void
-rpt_print_print (RptPrint *rpt_print, GtkWindow *transient)
+gint
+rpt_print_get_n_pages (RptPrint *rpt_print)
 {
-	xmlXPathContextPtr xpcontext;
-	xmlXPathObjectPtr xpresult;
-	xmlNodeSetPtr xnodeset;
+	g_return_val_if_fail (IS_RPT_PRINT (rpt_print), 0);
 
-	FILE *fout;
-	gchar *prop;
+	RptPrintPrivate *priv = RPT_PRINT_GET_PRIVATE (rpt_print);
 
-	gdouble width;
-	gdouble height;
+	if (priv->pages == NULL && !rpt_print_load_pages (rpt_print))
+		{
+			return 0;
+		}
 
-	gint npage = 0;
+	return priv->pages->nodeNr;
+}
+
+/**
+ * rpt_print_get_page_size:
+ * @rpt_print: an #RptPrint object.
+ * @page: the page's number, starting from 0.
+ * @width: where to put the page's width, in points.
+ * @height: where to put the page's height, in points.
+ *
+ */
+void
+rpt_print_get_page_size (RptPrint *rpt_print,
+                         gint page,
+                         gdouble *width,
+                         gdouble *height)
+{
+	g_return_if_fail (IS_RPT_PRINT (rpt_print));
+	g_return_if_fail (page >= 0 && page < rpt_print_get_n_pages (rpt_print));
 
 	RptPrintPrivate *priv = RPT_PRINT_GET_PRIVATE (rpt_print);
 
-	xmlNode *cur = xmlDocGetRootElement (priv->xdoc);
-	if (cur == NULL)
+	rpt_print_get_xml_page_attributes (rpt_print, priv->pages->nodeTab[page]);
+
+	if (width != NULL)
 		{
-			/* TODO */
-			g_warning ("Xml isn't a valid reptool print definition.");
-			return;
+			*width = rpt_common_value_to_points (priv->unit, priv->width);
 		}
-	else
+	if (height != NULL)
 		{
-			if (xmlStrcmp (cur->name, (const xmlChar *)"reptool_report") != 0)
-				{
-					/* TODO */
-					g_warning ("Xml isn't a valid reptool print definition.");
-					return;
-				}
+			*height = rpt_common_value_to_points (priv->unit, priv->height);
 		}
+}
 
-	xpcontext = xmlXPathNewContext (priv->xdoc);
+/**
+ * rpt_print_render_page:
+ * @rpt_print: an #RptPrint object.
+ * @page: the page's number, starting from 0.
+ * @cr: the cairo context to draw on.
+ * @width: the width, in @cr's units, the page is scaled to.
+ * @height: the height, in @cr's units, the page is scaled to.
+ *
+ * Draws a page on a cairo context that the caller owns; this is the way
+ * to show the report on a widget or on a print operation.
+ */
+void
+rpt_print_render_page (RptPrint *rpt_print,
+                       gint page,
+                       cairo_t *cr,
+                       gdouble width,
+                       gdouble height)
+{
+	g_return_if_fail (IS_RPT_PRINT (rpt_print));
+	g_return_if_fail (cr != NULL);
+	g_return_if_fail (page >= 0 && page < rpt_print_get_n_pages (rpt_print));
 
-	/* search for node "properties" */
-	xpcontext->node = cur;
-	xpresult = xmlXPathEvalExpression ((const xmlChar *)"child::properties", xpcontext);
-	if (!xmlXPathNodeSetIsEmpty (xpresult->nodesetval))
-		{
-			xnodeset = xpresult->nodesetval;
-			if (xnodeset->nodeNr == 1)
-				{
-					xmlNode *cur_property = xnodeset->nodeTab[0]->children;
-					while (cur_property != NULL)
-						{
-							if (g_strcmp0 (cur_property->name, "unit-length") == 0
-							    && priv->unit == -1)
-								{
-									g_object_set (G_OBJECT (rpt_print), "unit-length", rpt_common_strunit_to_enum ((const gchar *)xmlNodeGetContent (cur_property)), NULL);
-								}
-							else if (g_strcmp0 (cur_property->name, "output-type") == 0
-							         && priv->output_type == -1)
-								{
-									rpt_print_set_output_type (rpt_print, rpt_common_stroutputtype_to_enum ((const gchar *)xmlNodeGetContent (cur_property)));
-								}
-							else if (g_strcmp0 (cur_property->name, "output-filename") == 0
-							         && priv->output_filename == NULL)
-								{
-									rpt_print_set_output_filename (rpt_print, (const gchar *)xmlNodeGetContent (cur_property));
-								}
-							else if (g_strcmp0 (cur_property->name, "copies") == 0
-							         && !GTK_IS_PRINT_SETTINGS (priv->gtk_print_settings))
-								{
-									rpt_print_set_copies (rpt_print, strtol ((const gchar *)xmlNodeGetContent (cur_property), NULL, 10));
-								}
-							else if (g_strcmp0 (cur_property->name, "translation") == 0
-							         && priv->translation == NULL)
-								{
-									rpt_print_set_translation (rpt_print, rpt_common_get_translation (cur_property));
-								}
+	RptPrintPrivate *priv = RPT_PRINT_GET_PRIVATE (rpt_print);
 
-							cur_property = cur_property->next;
-						}
-				}
+	rpt_print_get_xml_page_attributes (rpt_print, priv->pages->nodeTab[page]);
+	if (priv->width == 0 || priv->height == 0)
+		{
+			/* TODO */
+			g_warning ("Page width or height cannot be zero.");
+			return;
 		}
 
-	/* find number of pages */
-	xpcontext->node = cur;
-	xpresult = xmlXPathEvalExpression ((const xmlChar *)"child::page", xpcontext);
-	if (!xmlXPathNodeSetIsEmpty (xpresult->nodesetval))
+	priv->cr = cr;
+	cairo_save (priv->cr);
+
+	cairo_reset_clip (priv->cr);
+	cairo_scale (priv->cr,
+	             width / rpt_common_value_to_points (priv->unit, priv->width),
+	             height / rpt_common_value_to_points (priv->unit, priv->height));
+
+	if (priv->translation != NULL)
 		{
-			xnodeset = xpresult->nodesetval;
-			priv->pages = xnodeset;
+			cairo_translate (priv->cr, priv->translation->x, priv->translation->y);
 		}
-	else
+
+	rpt_print_page (rpt_print, priv->pages->nodeTab[page]);
+
+	cairo_restore (priv->cr);
+	priv->cr = NULL;
+}
+
+/**
+ * rpt_print_render_region:
+ * @rpt_print: an #RptPrint object.
+ * @page: the page's number, starting from 0.
+ * @cr: the cairo context to draw on, with a transformation from the page's
+ * points.
+ * @region: the rectangle of the page to draw, in points.
+ *
+ * Draws, clipped to @region, only the objects of the page that intersect
+ * it; the objects are found with a spatial index built the first time the
+ * page is drawn. This is the way to draw a tile, or the visible part of a
+ * zoomed preview.
+ */
+void
+rpt_print_render_region (RptPrint *rpt_print,
+                         gint page,
+                         cairo_t *cr,
+                         const cairo_rectangle_t *region)
+{
+	g_return_if_fail (IS_RPT_PRINT (rpt_print));
+	g_return_if_fail (cr != NULL);
+	g_return_if_fail (region != NULL);
+	g_return_if_fail (page >= 0 && page < rpt_print_get_n_pages (rpt_print));
+
+	RptPrintPrivate *priv = RPT_PRINT_GET_PRIVATE (rpt_print);
+
+	rpt_print_get_xml_page_attributes (rpt_print, priv->pages->nodeTab[page]);
+	if (priv->width == 0 || priv->height == 0)
 		{
 			/* TODO */
-			g_warning ("No pages found in xml.");
+			g_warning ("Page width or height cannot be zero.");
 			return;
 		}
 
-	if (priv->output_type == RPT_OUTPUT_GTK
-	    || priv->output_type == RPT_OUTPUT_GTK_DEFAULT_PRINTER)
+	priv->cr = cr;
+	cairo_save (priv->cr);
+
+	if (priv->translation != NULL)
 		{
-			GtkPrintOperation *operation;
-			GError *error;
-			GtkPrintSettings *settings;
-			GtkPrintOperationResult res;
+			cairo_translate (priv->cr, priv->translation->x, priv->translation->y);
+		}
 
-			gtk_init (0, NULL);
+	/* rpt_print_page () draws what is inside the clip */
+	cairo_rectangle (priv->cr, region->x, region->y, region->width, region->height);
+	cairo_clip (priv->cr);
 
-			operation = gtk_print_operation_new ();
+	rpt_print_page (rpt_print, priv->pages->nodeTab[page]);
 
-			g_signal_connect (G_OBJECT (operation), "begin-print",
-			                  G_CALLBACK (rpt_print_gtk_begin_print), (gpointer)rpt_print);
-			g_signal_connect (G_OBJECT (operation), "request-page-setup",
-			                  G_CALLBACK (rpt_print_gtk_request_page_setup), (gpointer)rpt_print);
-			g_signal_connect (G_OBJECT (operation), "draw-page",
-			                  G_CALLBACK (rpt_print_gtk_draw_page), (gpointer)rpt_print);
+	cairo_restore (priv->cr);
+	priv->cr = NULL;
+}
 
-			if (GTK_IS_PRINT_SETTINGS (priv->gtk_print_settings))
-				{
-					settings = priv->gtk_print_settings;
-				}
-			else
-				{
-					settings = gtk_print_settings_new ();
-				}
-			if (priv->width > priv->height)
-				{
-					gtk_print_settings_set_orientation (settings, GTK_PAGE_ORIENTATION_LANDSCAPE);
-				}
-			gtk_print_operation_set_print_settings (operation, settings);
+/**
+ * rpt_print_error_quark:
+ *
+ * Returns: the #GQuark of the #RptPrint errors.
+ */
+GQuark
+rpt_print_error_quark (void)
+{
+	return g_quark_from_static_string ("rpt-print-error-quark");
+}
+
+/**
+ * rpt_print_print:
+ * @rpt_print: an #RptPrint object.
+ * @transient: the #GtkWindow the print dialog is transient for; used only
+ * by #RPT_OUTPUT_GTK, that needs libreptool-gtk.
+ *
+ * Like rpt_print_print_full(), with a warning on error.
+ */
+void
+rpt_print_print (RptPrint *rpt_print, gpointer transient)
+{
+	GError *error;
+
+	error = NULL;
+	if (!rpt_print_print_full (rpt_print, transient, &error))
+		{
+			g_warning ("%s", error != NULL && error->message != NULL ? error->message : "Unable to print.");
+			if (error != NULL) g_error_free (error);
+		}
+}
+
+/**
+ * rpt_print_print_full:
+ * @rpt_print: an #RptPrint object.
+ * @transient: the #GtkWindow the print dialog is transient for; used only
+ * by #RPT_OUTPUT_GTK, that needs libreptool-gtk.
+ * @error: return location for a #GError, or NULL.
+ *
+ * Prints @rpt_print; the pages after the first error aren't printed. A
+ * png or svg output to memory, to a stream or to a file descriptor is a
+ * single image, so it can have only one page (see
+ * rpt_print_set_page_range()).
+ *
+ * Returns: TRUE if the whole output was written.
+ */
+gboolean
+rpt_print_print_full (RptPrint *rpt_print, gpointer transient, GError **error)
+{
+	xmlNode *cur;
+
+	gdouble width;
+	gdouble height;
+
+	gint npage = 0;
+
+	/* pages already drawn */
+	gint ndrawn = 0;
+
+	/* pages to draw */
+	gint nprinted;
+
+	g_return_val_if_fail (IS_RPT_PRINT (rpt_print), FALSE);
+
+	RptPrintPrivate *priv = RPT_PRINT_GET_PRIVATE (rpt_print);
+
+	/* properties and pages are read again, the xml could be changed */
+	rpt_print_free_pages (rpt_print);
+	if (!rpt_print_load_pages (rpt_print))
+		{
+			g_set_error (error, RPT_PRINT_ERROR, RPT_PRINT_ERROR_INVALID_XML,
+			             "The xml isn't a valid reptool print definition, or it has no pages.");
+			return FALSE;
+		}
 
-			gtk_print_operation_set_unit (operation, GTK_UNIT_POINTS);
+	g_clear_error (&priv->error);
 
-			error = NULL;
-			res = gtk_print_operation_run (operation,
-			                               priv->output_type == RPT_OUTPUT_GTK ? GTK_PRINT_OPERATION_ACTION_PRINT_DIALOG : GTK_PRINT_OPERATION_ACTION_PRINT,
-			                               transient, &error);
+	if (priv->output_type == RPT_OUTPUT_GTK
+	    || priv->output_type == RPT_OUTPUT_GTK_DEFAULT_PRINTER)
+		{
+			RptPrintGtkPrintFunc gtk_print;
 
-			if (priv->output_type == RPT_OUTPUT_GTK
-			    && res == GTK_PRINT_OPERATION_RESULT_CANCEL)
+			gtk_print = rpt_print_get_gtk_print ();
+			if (gtk_print != NULL)
 				{
-					return;
+					gtk_print (rpt_print, transient);
 				}
-			if (error != NULL && error->message != NULL)
+			else
 				{
-					g_warning ("Error on starting print operation: %s.\n", error->message);
+					rpt_print_set_error (rpt_print, RPT_PRINT_ERROR_NOT_SUPPORTED,
+					                     "The gtk output needs libreptool-gtk.");
 				}
 		}
 	else
 		{
-			if (strcmp (g_strstrip (priv->output_filename), "") == 0)
+			if (!rpt_print_has_output_sink (rpt_print)
+			    && (priv->output_filename == NULL
+			        || strcmp (g_strstrip (priv->output_filename), "") == 0))
 				{
+					g_free (priv->output_filename);
 					switch (priv->output_type)
 						{
 							case RPT_OUTPUT_PNG:
 								priv->output_filename = g_strdup ("reptool.png");
 								break;
-							case RPT_OUTPUT_PDF:
-								priv->output_filename = g_strdup ("reptool.pdf");
+							case RPT_OUTPUT_PAM:
+								priv->output_filename = g_strdup ("reptool.pam");
+								break;
+							case RPT_OUTPUT_RAW:
+								priv->output_filename = g_strdup ("reptool.raw");
 								break;
 							case RPT_OUTPUT_PS:
 								priv->output_filename = g_strdup ("reptool.ps");
@@ -546,21 +991,38 @@ rpt_print_print (RptPrint *rpt_print, GtkWindow *transient)
 							case RPT_OUTPUT_SVG:
 								priv->output_filename = g_strdup ("reptool.svg");
 								break;
+							default:
+								priv->output_filename = g_strdup ("reptool.pdf");
+								break;
 						}
 				}
-			if (priv->output_type != RPT_OUTPUT_PNG && priv->output_type != RPT_OUTPUT_SVG)
+
+			/* a png or an svg is one image, pages back to back in a sink
+			 * wouldn't be a valid file */
+			nprinted = 0;
+			for (npage = 0; npage < priv->pages->nodeNr; npage++)
 				{
-					fout = fopen (priv->output_filename, "w");
-					if (fout == NULL)
+					if (rpt_print_page_in_range (rpt_print, npage))
 						{
-							/* TODO */
-							g_warning ("Unable to write to the output file.");
-							return;
+							nprinted++;
 						}
 				}
+			if (nprinted > 1
+			    && rpt_print_has_output_sink (rpt_print)
+			    && (priv->output_type == RPT_OUTPUT_PNG || priv->output_type == RPT_OUTPUT_SVG))
+				{
+					rpt_print_set_error (rpt_print, RPT_PRINT_ERROR_NOT_SUPPORTED,
+					                     "The «%s» output without a file can have only one page, not %d.",
+					                     rpt_common_enum_to_stroutputtype (priv->output_type), nprinted);
+				}
 
-			for (npage = 0; npage < priv->pages->nodeNr; npage++)
+			for (npage = 0; npage < priv->pages->nodeNr && priv->error == NULL; npage++)
 				{
+					if (!rpt_print_page_in_range (rpt_print, npage))
+						{
+							continue;
+						}
+
 					cur = priv->pages->nodeTab[npage];
 					if (strcmp (cur->name, "page") == 0)
 						{
@@ -570,86 +1032,70 @@ rpt_print_print (RptPrint *rpt_print, GtkWindow *transient)
 									width = rpt_common_value_to_points (priv->unit, priv->width);
 									height = rpt_common_value_to_points (priv->unit, priv->height);
 
-									if (priv->output_type == RPT_OUTPUT_PNG)
-										{
-											priv->surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, (int)width, (int)height);
-										}
-									else if (priv->output_type == RPT_OUTPUT_PDF && npage == 0)
-										{
-											priv->surface = cairo_pdf_surface_create (priv->output_filename, width, height);
-										}
-									else if (priv->output_type == RPT_OUTPUT_PS && npage == 0)
-										{
-											priv->surface = cairo_ps_surface_create (priv->output_filename, width, height);
-										}
-									else if (priv->output_type == RPT_OUTPUT_SVG)
+									if (rpt_print_is_raster_output (rpt_print))
 										{
-											gchar *new_out_filename = rpt_print_new_numbered_filename (priv->output_filename, npage + 1);
-											fout = fopen (new_out_filename, "w");
-											if (fout == NULL)
-												{
-													/* TODO */
-													g_warning ("Unable to write to the output file.");
-													return;
-												}
-											g_free (new_out_filename);
-
-											priv->surface = cairo_svg_surface_create (new_out_filename, width, height);
+											rpt_print_raster_page (rpt_print, cur, npage, width, height);
+											ndrawn++;
 										}
-
-									if (cairo_surface_status (priv->surface) == CAIRO_STATUS_SUCCESS)
+									else
 										{
-											if (priv->output_type == RPT_OUTPUT_PNG || priv->output_type == RPT_OUTPUT_SVG)
+											if ((priv->output_type == RPT_OUTPUT_PDF || priv->output_type == RPT_OUTPUT_PS) && ndrawn == 0)
 												{
-													priv->cr = cairo_create (priv->surface);
+													priv->surface = rpt_print_create_surface (rpt_print, priv->output_filename, width, height);
 												}
-											else if (npage == 0)
+											else if (priv->output_type == RPT_OUTPUT_SVG)
 												{
-													priv->cr = cairo_create (priv->surface);
-												}
+													gchar *new_out_filename = NULL;
 
-											if (priv->output_type != RPT_OUTPUT_PNG && priv->output_type != RPT_OUTPUT_SVG && npage == 0)
-												{
-													cairo_surface_destroy (priv->surface);
+													if (!rpt_print_has_output_sink (rpt_print))
+														{
+															new_out_filename = rpt_print_new_numbered_filename (priv->output_filename, npage + 1);
+														}
+													priv->surface = rpt_print_create_surface (rpt_print, new_out_filename, width, height);
+													g_free (new_out_filename);
 												}
 
-											if (cairo_status (priv->cr) == CAIRO_STATUS_SUCCESS)
+											if (cairo_surface_status (priv->surface) == CAIRO_STATUS_SUCCESS)
 												{
-													rpt_print_page (rpt_print, cur);
-
-													if (priv->output_type == RPT_OUTPUT_PNG)
+													if (priv->output_type == RPT_OUTPUT_SVG)
 														{
-															gchar *new_out_filename = rpt_print_new_numbered_filename (priv->output_filename, npage + 1);
-														
-															cairo_surface_write_to_png (priv->surface,
-															                            new_out_filename);
-															cairo_surface_destroy (priv->surface);
-															cairo_destroy (priv->cr);
-															g_free (new_out_filename);
+															priv->cr = cairo_create (priv->surface);
 														}
-													else
+													else if (ndrawn == 0)
 														{
-															cairo_show_page (priv->cr);
+															priv->cr = cairo_create (priv->surface);
 														}
 
-													if (priv->output_type == RPT_OUTPUT_SVG)
+													if (cairo_status (priv->cr) == CAIRO_STATUS_SUCCESS)
+														{
+															rpt_print_page (rpt_print, cur);
+															ndrawn++;
+
+															cairo_show_page (priv->cr);
+
+															if (priv->output_type == RPT_OUTPUT_SVG)
+																{
+																	cairo_destroy (priv->cr);
+																	priv->cr = NULL;
+																	rpt_print_surface_finish (rpt_print);
+																}
+														}
+													else
 														{
-															cairo_surface_destroy (priv->surface);
-															cairo_destroy (priv->cr);
-															fclose (fout);
+															rpt_print_set_error (rpt_print, RPT_PRINT_ERROR_SURFACE,
+															                     "Unable to draw the «%s» output: %s.",
+															                     rpt_common_enum_to_stroutputtype (priv->output_type),
+															                     cairo_status_to_string (cairo_status (priv->cr)));
 														}
 												}
 											else
 												{
-													/* TODO */
-													g_warning ("Cairo status not sucess: %d", cairo_status (priv->cr));
+													rpt_print_set_error (rpt_print, RPT_PRINT_ERROR_SURFACE,
+													                     "Unable to create the «%s» output: %s.",
+													                     rpt_common_enum_to_stroutputtype (priv->output_type),
+													                     cairo_status_to_string (cairo_surface_status (priv->surface)));
 												}
 										}
-									else
-										{
-											/* TODO */
-											g_warning ("Cairo surface status not sucess.");
-										}
 								}
 							else
 								{
@@ -661,19 +1107,90 @@ rpt_print_print (RptPrint *rpt_print, GtkWindow *transient)
 						{
 							/* TODO */
 						}
-
-					cur = cur->next;
 				}
 
 			if (priv->cr != NULL)
 				{
 					cairo_destroy (priv->cr);
+					priv->cr = NULL;
+				}
+			/* the pdf and the ps are written to the end here */
+			rpt_print_surface_finish (rpt_print);
+			if (priv->strip != NULL)
+				{
+					cairo_surface_destroy (priv->strip);
+					priv->strip = NULL;
 				}
-			if (priv->output_type != RPT_OUTPUT_PNG && priv->output_type != RPT_OUTPUT_SVG)
+
+			if (priv->output_stream != NULL && priv->output_bytes == NULL)
 				{
-					fclose (fout);
+					GError *flush_error = NULL;
+
+					if (!g_output_stream_flush (priv->output_stream, NULL, &flush_error))
+						{
+							rpt_print_set_error (rpt_print, RPT_PRINT_ERROR_WRITE,
+							                     "Unable to write to the output stream: %s.",
+							                     flush_error != NULL && flush_error->message != NULL ? flush_error->message : "no details");
+							g_clear_error (&flush_error);
+						}
 				}
 		}
+
+	rpt_print_free_pages (rpt_print);
+
+	if (priv->error != NULL)
+		{
+			g_propagate_error (error, priv->error);
+			priv->error = NULL;
+			return FALSE;
+		}
+
+	return TRUE;
+}
+
+/**
+ * rpt_print_print_to_bytes:
+ * @rpt_print: an #RptPrint object.
+ *
+ * Prints @rpt_print in memory, without writing to any file.
+ *
+ * Returns: the output document; NULL, with a warning, for the gtk outputs
+ * and on error.
+ */
+GBytes
+*rpt_print_print_to_bytes (RptPrint *rpt_print)
+{
+	GBytes *bytes;
+	GError *error;
+
+	g_return_val_if_fail (IS_RPT_PRINT (rpt_print), NULL);
+
+	RptPrintPrivate *priv = RPT_PRINT_GET_PRIVATE (rpt_print);
+
+	if (priv->output_type == RPT_OUTPUT_GTK
+	    || priv->output_type == RPT_OUTPUT_GTK_DEFAULT_PRINTER)
+		{
+			g_warning ("The gtk output can't be printed in memory.");
+			return NULL;
+		}
+
+	priv->output_bytes = g_byte_array_new ();
+	error = NULL;
+	if (rpt_print_print_full (rpt_print, NULL, &error))
+		{
+			bytes = g_byte_array_free_to_bytes (priv->output_bytes);
+		}
+	else
+		{
+			/* a part of a document isn't returned */
+			g_warning ("%s", error != NULL && error->message != NULL ? error->message : "Unable to print.");
+			if (error != NULL) g_error_free (error);
+			g_byte_array_free (priv->output_bytes, TRUE);
+			bytes = NULL;
+		}
+	priv->output_bytes = NULL;
+
+	return bytes;
 }
 
 static void
@@ -705,9 +1222,26 @@ rpt_print_set_property (GObject *object, guint property_id, const GValue *value,
 				break;
 
 			case PROP_PATH_RELATIVES_TO:
+				g_free (priv->path_relatives_to);
 				priv->path_relatives_to = g_strstrip (g_strdup (g_value_get_string (value)));
 				break;
 
+			case PROP_PNG_COMPRESSION:
+				rpt_print_set_png_compression (rpt_print, g_value_get_int (value));
+				break;
+
+			case PROP_PNG_FILTER:
+				rpt_print_set_png_filter (rpt_print, g_value_get_int (value));
+				break;
+
+			case PROP_RESOLUTION:
+				rpt_print_set_resolution (rpt_print, g_value_get_double (value));
+				break;
+
+			case PROP_STRIP_HEIGHT:
+				rpt_print_set_strip_height (rpt_print, g_value_get_uint (value));
+				break;
+
 			default:
 				G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
 				break;
@@ -735,14 +1269,7 @@ rpt_print_get_property (GObject *object, guint property_id, GValue *value, GPara
 				break;
 
 			case PROP_COPIES:
-				if (priv->gtk_print_settings != NULL)
-					{
-						g_value_set_uint (value, gtk_print_settings_get_n_copies (priv->gtk_print_settings));
-					}
-				else
-					{
-						g_value_set_uint (value, 1);
-					}
+				g_value_set_uint (value, priv->copies == 0 ? 1 : priv->copies);
 				break;
 
 			case PROP_TRANSLATION:
@@ -753,12 +1280,150 @@ rpt_print_get_property (GObject *object, guint property_id, GValue *value, GPara
 				g_value_set_string (value, priv->path_relatives_to);
 				break;
 
+			case PROP_PNG_COMPRESSION:
+				g_value_set_int (value, priv->png_compression);
+				break;
+
+			case PROP_PNG_FILTER:
+				g_value_set_int (value, priv->png_filter);
+				break;
+
+			case PROP_RESOLUTION:
+				g_value_set_double (value, priv->resolution);
+				break;
+
+			case PROP_STRIP_HEIGHT:
+				g_value_set_uint (value, priv->strip_height);
+				break;
+
 			default:
 				G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
 				break;
 		}
 }
 
+static gboolean
+rpt_print_load_pages (RptPrint *rpt_print)
+{
+	xmlXPathContextPtr xpcontext;
+	xmlXPathObjectPtr xpresult;
+	xmlNodeSetPtr xnodeset;
+
+	RptPrintPrivate *priv = RPT_PRINT_GET_PRIVATE (rpt_print);
+
+	xmlNode *cur = xmlDocGetRootElement (priv->xdoc);
+	if (cur == NULL)
+		{
+			/* TODO */
+			g_warning ("Xml isn't a valid reptool print definition.");
+			return FALSE;
+		}
+	else
+		{
+			if (xmlStrcmp (cur->name, (const xmlChar *)"reptool_report") != 0)
+				{
+					/* TODO */
+					g_warning ("Xml isn't a valid reptool print definition.");
+					return FALSE;
+				}
+		}
+
+	xpcontext = xmlXPathNewContext (priv->xdoc);
+
+	/* search for node "properties" */
+	xpcontext->node = cur;
+	xpresult = xmlXPathEvalExpression ((const xmlChar *)"child::properties", xpcontext);
+	if (!xmlXPathNodeSetIsEmpty (xpresult->nodesetval))
+		{
+			xnodeset = xpresult->nodesetval;
+			if (xnodeset->nodeNr == 1)
+				{
+					gchar *content;
+					RptTranslation *translation;
+
+					xmlNode *cur_property = xnodeset->nodeTab[0]->children;
+					while (cur_property != NULL)
+						{
+							content = (gchar *)xmlNodeGetContent (cur_property);
+
+							if (g_strcmp0 (cur_property->name, "unit-length") == 0
+							    && priv->unit == -1)
+								{
+									g_object_set (G_OBJECT (rpt_print), "unit-length", rpt_common_strunit_to_enum (content), NULL);
+								}
+							else if (g_strcmp0 (cur_property->name, "output-type") == 0
+							         && priv->output_type == -1)
+								{
+									rpt_print_set_output_type (rpt_print, rpt_common_stroutputtype_to_enum (content));
+								}
+							else if (g_strcmp0 (cur_property->name, "output-filename") == 0
+							         && priv->output_filename == NULL)
+								{
+									rpt_print_set_output_filename (rpt_print, content);
+								}
+							else if (g_strcmp0 (cur_property->name, "copies") == 0
+							         && priv->copies == 0)
+								{
+									rpt_print_set_copies (rpt_print, strtol (content, NULL, 10));
+								}
+							else if (g_strcmp0 (cur_property->name, "translation") == 0
+							         && priv->translation == NULL)
+								{
+									translation = rpt_common_get_translation (cur_property);
+									rpt_print_set_translation (rpt_print, translation);
+									g_free (translation);
+								}
+
+							xmlFree (content);
+							cur_property = cur_property->next;
+						}
+				}
+		}
+	xmlXPathFreeObject (xpresult);
+
+	/* find number of pages */
+	xpcontext->node = cur;
+	priv->xppages = xmlXPathEvalExpression ((const xmlChar *)"child::page", xpcontext);
+	xmlXPathFreeContext (xpcontext);
+	if (!xmlXPathNodeSetIsEmpty (priv->xppages->nodesetval))
+		{
+			priv->pages = priv->xppages->nodesetval;
+		}
+	else
+		{
+			/* TODO */
+			g_warning ("No pages found in xml.");
+			rpt_print_free_pages (rpt_print);
+			return FALSE;
+		}
+
+	return TRUE;
+}
+
+static void
+rpt_print_free_pages (RptPrint *rpt_print)
+{
+	RptPrintPrivate *priv = RPT_PRINT_GET_PRIVATE (rpt_print);
+
+	if (priv->xppages != NULL)
+		{
+			xmlXPathFreeObject (priv->xppages);
+		}
+	priv->xppages = NULL;
+	priv->pages = NULL;
+
+	if (priv->indexes != NULL)
+		{
+			g_hash_table_destroy (priv->indexes);
+			priv->indexes = NULL;
+		}
+	if (priv->static_bands != NULL)
+		{
+			g_hash_table_destroy (priv->static_bands);
+			priv->static_bands = NULL;
+		}
+}
+
 static void
 rpt_print_get_xml_page_attributes (RptPrint *rpt_print, xmlNode *xml_page)
 {
@@ -807,11 +1472,17 @@ rpt_print_get_xml_page_attributes (RptPrint *rpt_print, xmlNode *xml_page)
 static void
 rpt_print_page (RptPrint *rpt_print, xmlNode *xnode)
 {
-	gchar *prop;
+	GPtrArray *objects;
+	cairo_rectangle_t region;
+	gdouble x1, y1, x2, y2;
+	guint i;
+
+	gchar *static_id;
+	gchar *last_static_id;
 
 	RptPrintPrivate *priv = RPT_PRINT_GET_PRIVATE (rpt_print);
 
-	xmlNode *cur = xnode->children;
+	xmlNode *cur;
 
 	gdouble width = rpt_common_value_to_points (priv->unit, priv->width);
 	gdouble height = rpt_common_value_to_points (priv->unit, priv->height);
@@ -828,330 +1499,400 @@ rpt_print_page (RptPrint *rpt_print, xmlNode *xnode)
 	                 height - margin_top - margin_bottom);
 	cairo_clip (priv->cr);
 
-	while (cur != NULL)
+	/* only the objects inside of the clip, that is the margins, the strip
+	 * or the region */
+	cairo_clip_extents (priv->cr, &x1, &y1, &x2, &y2);
+	region.x = x1;
+	region.y = y1;
+	region.width = x2 - x1;
+	region.height = y2 - y1;
+
+	/* the unrotated borders are drawn together at the end */
+	priv->border_batches = g_ptr_array_new ();
+
+	/* the objects with the same static-id are contiguous, and are drawn
+	 * all together the first time one of them is found */
+	last_static_id = NULL;
+
+	objects = rpt_spatial_index_query (rpt_print_get_page_index (rpt_print, xnode), &region);
+	for (i = 0; i < objects->len; i++)
 		{
-			if (!xmlNodeIsText (cur))
-				{
-					prop = (gchar *)xmlGetProp (cur, "visible");
-					if (prop != NULL
-					    && strcmp (g_strstrip (prop), "y") == 0)
-						{
-							cairo_save (priv->cr);
-							if (g_strcmp0 (cur->name, "text") == 0)
-								{
-									rpt_print_text_xml (rpt_print, cur);
-								}
-							else if (g_strcmp0 (cur->name, "line") == 0)
-								{
-									rpt_print_line_xml (rpt_print, cur);
-								}
-							else if (g_strcmp0 (cur->name, "rect") == 0)
-								{
-									rpt_print_rect_xml (rpt_print, cur);
-								}
-							else if (g_strcmp0 (cur->name, "ellipse") == 0)
-								{
-									rpt_print_ellipse_xml (rpt_print, cur);
-								}
-							else if (g_strcmp0 (cur->name, "image") == 0)
-								{
-									rpt_print_image_xml (rpt_print, cur);
-								}
-							cairo_restore (priv->cr);
-						}
+			cur = (xmlNode *)g_ptr_array_index (objects, i);
 
-					if (prop != NULL)
-						{
-							xmlFree (prop);
-						}
+			static_id = (gchar *)xmlGetProp (cur, (const xmlChar *)"static-id");
+			if (static_id == NULL)
+				{
+					rpt_print_object (rpt_print, cur);
 				}
+			else if (g_strcmp0 (static_id, last_static_id) != 0)
+				{
+					rpt_print_static_band (rpt_print, xnode, static_id);
 
-			cur = cur->next;
-		}
-}
+					g_free (last_static_id);
+					last_static_id = g_strdup (static_id);
+				}
+			if (static_id != NULL)
+				{
+					xmlFree (static_id);
+				}
+		}
+
+	g_free (last_static_id);
+	g_ptr_array_free (objects, TRUE);
+
+	rpt_print_border_batches_flush (rpt_print);
+}
 
 static void
-rpt_print_text_xml (RptPrint *rpt_print, xmlNode *xnode)
+rpt_print_object (RptPrint *rpt_print, xmlNode *xnode)
 {
 	RptPrintPrivate *priv = RPT_PRINT_GET_PRIVATE (rpt_print);
 
-	RptPoint *position;
-	RptSize *size;
-	RptRotation *rotation;
-	RptAlign *align;
-	RptBorder *border;
-	RptFont *font;
-	RptColor *color;
+	cairo_save (priv->cr);
+	if (g_strcmp0 (xnode->name, "text") == 0)
+		{
+			rpt_print_text_xml (rpt_print, xnode);
+		}
+	else if (g_strcmp0 (xnode->name, "line") == 0)
+		{
+			rpt_print_line_xml (rpt_print, xnode);
+		}
+	else if (g_strcmp0 (xnode->name, "rect") == 0)
+		{
+			rpt_print_rect_xml (rpt_print, xnode);
+		}
+	else if (g_strcmp0 (xnode->name, "ellipse") == 0)
+		{
+			rpt_print_ellipse_xml (rpt_print, xnode);
+		}
+	else if (g_strcmp0 (xnode->name, "image") == 0)
+		{
+			rpt_print_image_xml (rpt_print, xnode);
+		}
+	cairo_restore (priv->cr);
+}
 
-	PangoLayout *playout;
-	PangoFontDescription *pfdesc;
-	PangoAttribute *pattr;
-	PangoAttrList *lpattr = NULL;
+/* the objects of a band that is the same on every page, like a page header
+ * without fields and specials, are drawn once on a recording surface,
+ * that is painted on each page; the pdf output writes it once, as a form */
+static void
+rpt_print_static_band (RptPrint *rpt_print, xmlNode *xpage, const gchar *static_id)
+{
+	RptPrintPrivate *priv = RPT_PRINT_GET_PRIVATE (rpt_print);
 
-	GString *text;
+	cairo_surface_t *recording;
+	cairo_t *cr;
+	GPtrArray *border_batches;
+	xmlNode *cur;
 	gchar *prop;
 
-	gdouble padding_top = 0.0;
-	gdouble padding_right = 0.0;
-	gdouble padding_bottom = 0.0;
-	gdouble padding_left = 0.0;
+	if (priv->static_bands == NULL)
+		{
+			priv->static_bands = g_hash_table_new_full (g_str_hash, g_str_equal,
+			                                            g_free, (GDestroyNotify)cairo_surface_destroy);
+		}
 
-	gdouble layout_width;
+	recording = (cairo_surface_t *)g_hash_table_lookup (priv->static_bands, static_id);
+	if (recording == NULL)
+		{
+			recording = cairo_recording_surface_create (CAIRO_CONTENT_COLOR_ALPHA, NULL);
 
-	position = rpt_common_get_position (xnode);
-	size = rpt_common_get_size (xnode);
-	rotation = rpt_common_get_rotation (xnode);
-	align = rpt_common_get_align (xnode);
-	border = rpt_common_get_border (xnode);
-	font = rpt_common_get_font (xnode);
+			cr = priv->cr;
+			border_batches = priv->border_batches;
 
-	if (position == NULL)
-		{
-			g_warning ("Text node position is mandatory.");
-			return;
+			priv->cr = cairo_create (recording);
+			priv->border_batches = g_ptr_array_new ();
+
+			/* all of them, even the ones outside of the clip */
+			for (cur = xpage->children; cur != NULL; cur = cur->next)
+				{
+					if (xmlNodeIsText (cur))
+						{
+							continue;
+						}
+
+					prop = (gchar *)xmlGetProp (cur, (const xmlChar *)"static-id");
+					if (g_strcmp0 (prop, static_id) == 0)
+						{
+							xmlFree (prop);
+							prop = (gchar *)xmlGetProp (cur, (const xmlChar *)"visible");
+							if (prop != NULL
+							    && strcmp (g_strstrip (prop), "y") == 0)
+								{
+									rpt_print_object (rpt_print, cur);
+								}
+						}
+					if (prop != NULL)
+						{
+							xmlFree (prop);
+						}
+				}
+
+			rpt_print_border_batches_flush (rpt_print);
+			cairo_destroy (priv->cr);
+
+			priv->cr = cr;
+			priv->border_batches = border_batches;
+
+			g_hash_table_insert (priv->static_bands, g_strdup (static_id), recording);
 		}
 
-	text = g_string_new ((gchar *)xmlNodeGetContent (xnode));
+	cairo_save (priv->cr);
+	cairo_set_source_surface (priv->cr, recording, 0.0, 0.0);
+	cairo_paint (priv->cr);
+	cairo_restore (priv->cr);
+}
+
+/* the visible objects of the page, indexed the first time the page is drawn */
+static RptSpatialIndex
+*rpt_print_get_page_index (RptPrint *rpt_print, xmlNode *xpage)
+{
+	RptSpatialIndex *index;
+	cairo_rectangle_t extents;
+	xmlNode *cur;
+	gchar *prop;
 
-	/* padding */
-	prop = xmlGetProp (xnode, (const xmlChar *)"padding-top");
-	if (prop != NULL)
+	RptPrintPrivate *priv = RPT_PRINT_GET_PRIVATE (rpt_print);
+
+	if (priv->indexes == NULL)
 		{
-			padding_top = rpt_common_value_to_points (priv->unit, g_strtod (prop, NULL));
-			xmlFree (prop);
+			priv->indexes = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+			                                       NULL, (GDestroyNotify)rpt_spatial_index_free);
 		}
-	prop = xmlGetProp (xnode, (const xmlChar *)"padding-right");
-	if (prop != NULL)
+
+	index = (RptSpatialIndex *)g_hash_table_lookup (priv->indexes, xpage);
+	if (index != NULL)
 		{
-			padding_right = rpt_common_value_to_points (priv->unit, g_strtod (prop, NULL));
-			xmlFree (prop);
+			return index;
 		}
-	prop = xmlGetProp (xnode, (const xmlChar *)"padding-bottom");
-	if (prop != NULL)
+
+	index = rpt_spatial_index_new (rpt_common_value_to_points (priv->unit, priv->width),
+	                               rpt_common_value_to_points (priv->unit, priv->height));
+
+	for (cur = xpage->children; cur != NULL; cur = cur->next)
 		{
-			padding_bottom = rpt_common_value_to_points (priv->unit, g_strtod (prop, NULL));
-			xmlFree (prop);
+			if (xmlNodeIsText (cur)
+			    || (g_strcmp0 (cur->name, "text") != 0
+			        && g_strcmp0 (cur->name, "line") != 0
+			        && g_strcmp0 (cur->name, "rect") != 0
+			        && g_strcmp0 (cur->name, "ellipse") != 0
+			        && g_strcmp0 (cur->name, "image") != 0))
+				{
+					continue;
+				}
+
+			prop = (gchar *)xmlGetProp (cur, "visible");
+			if (prop != NULL
+			    && strcmp (g_strstrip (prop), "y") == 0)
+				{
+					if (rpt_print_get_object_extents (rpt_print, cur, &extents))
+						{
+							rpt_spatial_index_insert (index, cur, &extents);
+						}
+					else
+						{
+							rpt_spatial_index_insert (index, cur, NULL);
+						}
+				}
+			if (prop != NULL)
+				{
+					xmlFree (prop);
+				}
 		}
-	prop = xmlGetProp (xnode, (const xmlChar *)"padding-left");
-	if (prop != NULL)
+
+	g_hash_table_insert (priv->indexes, xpage, index);
+
+	return index;
+}
+
+/* the bounding box of what the object draws, in points, with the strokes,
+ * the borders and the rotation; FALSE when it cannot be known before
+ * drawing, and the object is always drawn */
+static gboolean
+rpt_print_get_object_extents (RptPrint *rpt_print, xmlNode *xnode, cairo_rectangle_t *extents)
+{
+	RptPoint *position;
+	RptSize *size;
+	RptRotation *rotation;
+	RptStroke *stroke;
+	RptBorder *border;
+	gchar *prop;
+
+	cairo_matrix_t matrix;
+	gdouble x[4];
+	gdouble y[4];
+	gdouble pad;
+	gdouble cx;
+	gdouble cy;
+	gint i;
+
+	gboolean ret;
+
+	RptPrintPrivate *priv = RPT_PRINT_GET_PRIVATE (rpt_print);
+
+	position = rpt_common_get_position (xnode);
+	size = rpt_common_get_size (xnode);
+	if (position == NULL || size == NULL)
 		{
-			padding_left = rpt_common_value_to_points (priv->unit, g_strtod (prop, NULL));
-			xmlFree (prop);
+			g_free (position);
+			g_free (size);
+			return FALSE;
 		}
 
-	layout_width = rpt_common_value_to_points (priv->unit, size->width) - padding_left - padding_right;
+	ret = TRUE;
 
-	/* creating pango layout */
-	/*if (priv->output_type == RPTP_OUTPUT_GTK)
+	extents->x = rpt_common_value_to_points (priv->unit, position->x);
+	extents->y = rpt_common_value_to_points (priv->unit, position->y);
+	extents->width = rpt_common_value_to_points (priv->unit, size->width);
+	extents->height = rpt_common_value_to_points (priv->unit, size->height);
+
+	/* the centre of the rotation, as rpt_print_rotate () takes it */
+	if (g_strcmp0 (xnode->name, "line") == 0)
 		{
-			playout = gtk_print_context_create_pango_layout (priv->gtk_print_context);
+			cx = position->x + extents->width / 2;
+			cy = position->y + extents->height / 2;
 		}
 	else
-		{*/
-			playout = pango_cairo_create_layout (priv->cr);
-		/*}*/
-	if (size != NULL)
 		{
-			pango_layout_set_width (playout, layout_width * PANGO_SCALE);
+			cx = position->x + size->width / 2;
+			cy = position->y + size->height / 2;
 		}
 
-	/* creating pango font description */
-	pfdesc = pango_font_description_new ();
+	/* cairo's default line width, and the half point added to the lines */
+	pad = 2.5;
 
-	pango_font_description_set_family (pfdesc, font->name);
-	if (font->bold)
-		{
-			pango_font_description_set_weight (pfdesc, PANGO_WEIGHT_BOLD);
-		}
-	if (font->italic)
-		{
-			pango_font_description_set_style (pfdesc, PANGO_STYLE_ITALIC);
-		}
-	if (font->size > 0.0f)
+	rotation = NULL;
+	if (g_strcmp0 (xnode->name, "ellipse") == 0)
 		{
-			pango_font_description_set_absolute_size (pfdesc, (int)font->size * PANGO_SCALE);
+			/* position is the centre and size the radii; never rotated */
+			extents->x -= extents->width;
+			extents->y -= extents->height;
+			extents->width *= 2;
+			extents->height *= 2;
 		}
 	else
 		{
-			pango_font_description_set_absolute_size (pfdesc, 12 * PANGO_SCALE);
+			rotation = rpt_common_get_rotation (xnode);
 		}
 
-	pango_layout_set_font_description (playout, pfdesc);
-	pango_font_description_free (pfdesc);
-
-	/* setting layout attributes */
-	if (font->underline != PANGO_UNDERLINE_NONE)
+	if (g_strcmp0 (xnode->name, "line") == 0
+	    || g_strcmp0 (xnode->name, "rect") == 0
+	    || g_strcmp0 (xnode->name, "ellipse") == 0)
 		{
-			PangoAttribute *pattr;
-
-			pattr = pango_attr_underline_new (font->underline);
-			pattr->start_index = 0;
-			pattr->end_index = text->len + 1;
-
-			if (lpattr == NULL)
+			stroke = rpt_common_get_stroke (xnode);
+			if (stroke != NULL)
 				{
-					lpattr = pango_attr_list_new ();
+					pad = MAX (pad, stroke->width + 0.5);
+					rpt_common_rptstroke_free (stroke);
 				}
-			pango_attr_list_insert (lpattr, pattr);
 		}
-	if (font->strike)
+	else
 		{
-			PangoAttribute *pattr;
-		
-			pattr = pango_attr_strikethrough_new (TRUE);
-			pattr->start_index = 0;
-			pattr->end_index = text->len + 1;
-
-			if (lpattr == NULL)
+			border = rpt_common_get_border (xnode);
+			if (border != NULL)
 				{
-					lpattr = pango_attr_list_new ();
+					pad = MAX (pad, MAX (MAX (border->top_width, border->bottom_width),
+					                     MAX (border->left_width, border->right_width)) + 0.5);
+					rpt_common_rptborder_free (border);
 				}
-			pango_attr_list_insert (lpattr, pattr);
 		}
 
-	/* letter spacing */
-	prop = xmlGetProp (xnode, (const xmlChar *)"letter-spacing");
-	if (prop != NULL)
+	if (g_strcmp0 (xnode->name, "image") == 0)
 		{
-			guint spacing;
-
-			spacing = strtol (prop, NULL, 10);
-
-			if (spacing > 0)
+			/* the size is the image's one, known only loading it */
+			prop = (gchar *)xmlGetProp (xnode, (const xmlChar *)"adapt");
+			if (prop != NULL && strcmp (g_strstrip (prop), "to-image") == 0)
 				{
-					PangoAttribute *pattr;
-
-					pattr = pango_attr_letter_spacing_new (spacing * PANGO_SCALE);
-					pattr->start_index = 0;
-					pattr->end_index = text->len + 1;
-
-					if (lpattr == NULL)
-						{
-							lpattr = pango_attr_list_new ();
-						}
-					pango_attr_list_insert (lpattr, pattr);
+					ret = FALSE;
+				}
+			if (prop != NULL)
+				{
+					xmlFree (prop);
 				}
-
-			xmlFree (prop);
-		}
-
-	if (lpattr != NULL)
-		{
-			pango_layout_set_attributes (playout, lpattr);
 		}
 
-	if (rotation != NULL)
+	if (extents->width < 0.0)
 		{
-			rpt_print_rotate (rpt_print, position, size, rotation->angle);
+			extents->x += extents->width;
+			extents->width = -extents->width;
 		}
-
-	/* background */
-	prop = xmlGetProp (xnode, (const xmlChar *)"background-color");
-	if (prop != NULL && position != NULL && size != NULL)
+	if (extents->height < 0.0)
 		{
-			color = rpt_common_parse_color (prop);
-
-			cairo_rectangle (priv->cr, rpt_common_value_to_points (priv->unit, position->x),
-			                 rpt_common_value_to_points (priv->unit, position->y),
-			                 rpt_common_value_to_points (priv->unit, size->width),
-			                 rpt_common_value_to_points (priv->unit, size->height));
-			cairo_set_source_rgba (priv->cr, color->r, color->g, color->b, color->a);
-			cairo_fill_preserve (priv->cr);
+			extents->y += extents->height;
+			extents->height = -extents->height;
 		}
-	if (prop != NULL) xmlFree (prop);
 
-	/* drawing border */
-	rpt_print_border (rpt_print, position, size, border, rotation);
+	extents->x -= pad;
+	extents->y -= pad;
+	extents->width += 2 * pad;
+	extents->height += 2 * pad;
 
-	/* setting horizontal alignment */
-	switch (align->h_align)
+	if (rotation != NULL && rotation->angle != 0.0)
 		{
-			case RPT_HALIGN_LEFT:
-				break;
+			cairo_matrix_init_translate (&matrix, cx, cy);
+			cairo_matrix_rotate (&matrix, rotation->angle * G_PI / 180.);
+			cairo_matrix_translate (&matrix, -cx, -cy);
 
-			case RPT_HALIGN_CENTER:
-				pango_layout_set_alignment (playout, PANGO_ALIGN_CENTER);
-				break;
-
-			case RPT_HALIGN_RIGHT:
-				pango_layout_set_alignment (playout, PANGO_ALIGN_RIGHT);
-				break;
+			x[0] = x[3] = extents->x;
+			x[1] = x[2] = extents->x + extents->width;
+			y[0] = y[1] = extents->y;
+			y[2] = y[3] = extents->y + extents->height;
+			for (i = 0; i < 4; i++)
+				{
+					cairo_matrix_transform_point (&matrix, &x[i], &y[i]);
+				}
 
-			case RPT_HALIGN_JUSTIFIED:
-				pango_layout_set_justify (playout, TRUE);
-				break;
+			extents->x = MIN (MIN (x[0], x[1]), MIN (x[2], x[3]));
+			extents->y = MIN (MIN (y[0], y[1]), MIN (y[2], y[3]));
+			extents->width = MAX (MAX (x[0], x[1]), MAX (x[2], x[3])) - extents->x;
+			extents->height = MAX (MAX (y[0], y[1]), MAX (y[2], y[3])) - extents->y;
 		}
 
-	/* TODO */
-	/* setting vertical alignment */
-	switch (align->v_align)
-		{
-	 		case RPT_VALIGN_TOP:
-	 			break;
-
-	 		case RPT_VALIGN_CENTER:
-	 			break;
+	g_free (position);
+	g_free (size);
+	g_free (rotation);
 
-	 		case RPT_VALIGN_BOTTOM:
-	 			break;
-		}
+	return ret;
+}
 
-	/* setting clipping region */
-	if (size != NULL)
-		{
-			cairo_rectangle (priv->cr,
-			                 rpt_common_value_to_points (priv->unit, position->x) + padding_left,
-			                 rpt_common_value_to_points (priv->unit, position->y) + padding_top,
-			                 rpt_common_value_to_points (priv->unit, size->width) - padding_left - padding_right,
-			                 rpt_common_value_to_points (priv->unit, size->height) - padding_top - padding_bottom);
-			cairo_clip (priv->cr);
-		}
+static void
+rpt_print_text_xml (RptPrint *rpt_print, xmlNode *xnode)
+{
+	RptPrintPrivate *priv = RPT_PRINT_GET_PRIVATE (rpt_print);
 
-	/* ellipsize */
-	prop = xmlGetProp (xnode, (const xmlChar *)"ellipsize");
-	if (prop != NULL)
-		{
-			eRptEllipsize ellipsize = rpt_common_strellipsize_to_enum (prop);
-			if (ellipsize > RPT_ELLIPSIZE_NONE)
-				{
-					switch (ellipsize)
-						{
-							case RPT_ELLIPSIZE_START:
-								pango_layout_set_ellipsize (playout, PANGO_ELLIPSIZE_START);
-								break;
+	RptPoint *position;
+	RptSize *size;
+	RptRotation *rotation;
+	RptBorder *border;
+	RptColor *color;
 
-							case RPT_ELLIPSIZE_MIDDLE:
-								pango_layout_set_ellipsize (playout, PANGO_ELLIPSIZE_MIDDLE);
-								break;
+	RptLayoutAttrs *attrs;
+	PangoLayout *playout;
 
-							case RPT_ELLIPSIZE_END:
-								pango_layout_set_ellipsize (playout, PANGO_ELLIPSIZE_END);
-								break;
+	GString *text;
+	gchar *content;
+	gchar *prop;
 
-							default:
-								break;
-						}
-				}
-			xmlFree (prop);
-		}
+	position = rpt_common_get_position (xnode);
+	size = rpt_common_get_size (xnode);
+	rotation = rpt_common_get_rotation (xnode);
+	border = rpt_common_get_border (xnode);
 
-	/* drawing text */
-	if (font != NULL)
+	if (position == NULL)
 		{
-			if (font->color != NULL)
-				{
-					cairo_set_source_rgba (priv->cr, font->color->r, font->color->g, font->color->b, font->color->a);
-				}
-			else
-				{
-					cairo_set_source_rgba (priv->cr, 0.0, 0.0, 0.0, 1.0);
-				}
+			g_warning ("Text node position is mandatory.");
+			g_free (size);
+			g_free (rotation);
+			rpt_common_rptborder_free (border);
+			return;
 		}
 
-	cairo_move_to (priv->cr, rpt_common_value_to_points (priv->unit, position->x) + padding_left,
-	               rpt_common_value_to_points (priv->unit, position->y) + padding_top);
+	content = (gchar *)xmlNodeGetContent (xnode);
+	text = g_string_new (content);
+	if (content != NULL) xmlFree (content);
 
-	pango_layout_set_text (playout, text->str, -1);
+	/* font, size, padding, alignment, ellipsize and letter spacing */
+	attrs = rpt_layout_attrs_new_from_xml (xnode, priv->unit);
 
 	/* fill-with */
 	prop = xmlGetProp (xnode, (const xmlChar *)"fill-with");
@@ -1164,6 +1905,9 @@ rpt_print_text_xml (RptPrint *rpt_print, xmlNode *xnode)
 
 			GString *text_tmp;
 
+			/* the text is changed while filling, so the layout cannot be shared */
+			playout = rpt_layout_cache_new_layout (text->str, attrs);
+
 			lines = pango_layout_get_line_count (playout);
 
 			text_tmp = g_string_new (text->str);
@@ -1173,20 +1917,88 @@ rpt_print_text_xml (RptPrint *rpt_print, xmlNode *xnode)
 			line = pango_layout_get_line (playout, pango_layout_get_line_count (playout) - 1);
 			pango_layout_line_get_pixel_extents (line, NULL, &rect);
 			while (lines == pango_layout_get_line_count (playout)
-			       && rect.width < layout_width)
+			       && rect.width < attrs->width)
 				{
 					g_string_append (text, prop);
 
-					g_string_append (text_tmp, prop);
-					pango_layout_set_text (playout, text_tmp->str, -1);
-					line = pango_layout_get_line (playout, pango_layout_get_line_count (playout) - 1);
-					pango_layout_line_get_pixel_extents (line, NULL, &rect);
-				}
+					g_string_append (text_tmp, prop);
+					pango_layout_set_text (playout, text_tmp->str, -1);
+					line = pango_layout_get_line (playout, pango_layout_get_line_count (playout) - 1);
+					pango_layout_line_get_pixel_extents (line, NULL, &rect);
+				}
+
+			g_string_free (text_tmp, TRUE);
+
+			pango_layout_set_text (playout, text->str, -1);
+		}
+	else
+		{
+			/* the same layout already measured when the report was generated */
+			playout = rpt_layout_cache_get (text->str, attrs);
+		}
+	if (prop != NULL) xmlFree (prop);
+
+	if (rotation != NULL)
+		{
+			rpt_print_rotate (rpt_print, position, size, rotation->angle);
+		}
+
+	/* background */
+	prop = xmlGetProp (xnode, (const xmlChar *)"background-color");
+	if (prop != NULL && position != NULL && size != NULL)
+		{
+			color = rpt_common_parse_color (prop);
+
+			cairo_rectangle (priv->cr, rpt_common_value_to_points (priv->unit, position->x),
+			                 rpt_common_value_to_points (priv->unit, position->y),
+			                 rpt_common_value_to_points (priv->unit, size->width),
+			                 rpt_common_value_to_points (priv->unit, size->height));
+			cairo_set_source_rgba (priv->cr, color->r, color->g, color->b, color->a);
+			cairo_fill_preserve (priv->cr);
+			g_free (color);
+		}
+	if (prop != NULL) xmlFree (prop);
+
+	/* drawing border */
+	rpt_print_border (rpt_print, position, size, border, rotation);
+
+	/* TODO */
+	/* setting vertical alignment */
+	switch (attrs->align->v_align)
+		{
+	 		case RPT_VALIGN_TOP:
+	 			break;
+
+	 		case RPT_VALIGN_CENTER:
+	 			break;
+
+	 		case RPT_VALIGN_BOTTOM:
+	 			break;
+		}
 
-			g_string_free (text_tmp, TRUE);
+	/* setting clipping region */
+	if (size != NULL)
+		{
+			cairo_rectangle (priv->cr,
+			                 rpt_common_value_to_points (priv->unit, position->x) + attrs->padding_left,
+			                 rpt_common_value_to_points (priv->unit, position->y) + attrs->padding_top,
+			                 rpt_common_value_to_points (priv->unit, size->width) - attrs->padding_left - attrs->padding_right,
+			                 rpt_common_value_to_points (priv->unit, size->height) - attrs->padding_top - attrs->padding_bottom);
+			cairo_clip (priv->cr);
+		}
+
+	/* drawing text */
+	if (attrs->font->color != NULL)
+		{
+			cairo_set_source_rgba (priv->cr, attrs->font->color->r, attrs->font->color->g, attrs->font->color->b, attrs->font->color->a);
+		}
+	else
+		{
+			cairo_set_source_rgba (priv->cr, 0.0, 0.0, 0.0, 1.0);
 		}
 
-	pango_layout_set_text (playout, text->str, -1);
+	cairo_move_to (priv->cr, rpt_common_value_to_points (priv->unit, position->x) + attrs->padding_left,
+	               rpt_common_value_to_points (priv->unit, position->y) + attrs->padding_top);
 
 	pango_cairo_show_layout (priv->cr, playout);
 
@@ -1195,12 +2007,13 @@ rpt_print_text_xml (RptPrint *rpt_print, xmlNode *xnode)
 			cairo_reset_clip (priv->cr);
 		}
 
+	g_object_unref (playout);
+	rpt_layout_attrs_free (attrs);
+
 	g_free (position);
 	g_free (size);
 	g_free (rotation);
-	g_free (align);
-	g_free (border);
-	g_free (font);
+	rpt_common_rptborder_free (border);
 	g_string_free (text, TRUE);
 }
 
@@ -1231,7 +2044,7 @@ rpt_print_line_xml (RptPrint *rpt_print, xmlNode *xnode)
 	g_free (to_p);
 	g_free (size);
 	g_free (rotation);
-	g_free (stroke);
+	rpt_common_rptstroke_free (stroke);
 }
 
 static void
@@ -1241,7 +2054,7 @@ rpt_print_rect_xml (RptPrint *rpt_print, xmlNode *xnode)
 	RptSize *size;
 	RptRotation *rotation;
 	RptStroke *stroke;
-	RptColor *fill_color;
+	RptColor *fill_color = NULL;
 	gchar *prop;
 
 	RptPrintPrivate *priv = RPT_PRINT_GET_PRIVATE (rpt_print);
@@ -1254,6 +2067,10 @@ rpt_print_rect_xml (RptPrint *rpt_print, xmlNode *xnode)
 	if (position == NULL || size == NULL)
 		{
 			g_warning ("Rect node position and size are mandatories.");
+			g_free (position);
+			g_free (size);
+			g_free (rotation);
+			rpt_common_rptstroke_free (stroke);
 			return;
 		}
 	if (stroke == NULL)
@@ -1285,7 +2102,7 @@ rpt_print_rect_xml (RptPrint *rpt_print, xmlNode *xnode)
 	                 rpt_common_value_to_points (priv->unit, size->width),
 	                 rpt_common_value_to_points (priv->unit, size->height));
 
-	if (prop != NULL && fill_color != NULL)
+	if (fill_color != NULL)
 		{
 			cairo_set_source_rgba (priv->cr, fill_color->r, fill_color->g, fill_color->b, fill_color->a);
 			cairo_fill_preserve (priv->cr);
@@ -1295,6 +2112,7 @@ rpt_print_rect_xml (RptPrint *rpt_print, xmlNode *xnode)
 		{
 			gdouble *dash = rpt_common_style_to_array (stroke->style);
 			cairo_set_dash (priv->cr, dash, stroke->style->len, 0.0);
+			g_free (dash);
 		}
 
 	cairo_set_source_rgba (priv->cr, stroke->color->r, stroke->color->g, stroke->color->b, stroke->color->a);
@@ -1303,7 +2121,8 @@ rpt_print_rect_xml (RptPrint *rpt_print, xmlNode *xnode)
 	g_free (position);
 	g_free (size);
 	g_free (rotation);
-	g_free (stroke);
+	g_free (fill_color);
+	rpt_common_rptstroke_free (stroke);
 }
 
 static void
@@ -1312,7 +2131,7 @@ rpt_print_ellipse_xml (RptPrint *rpt_print, xmlNode *xnode)
 	RptPoint *position;
 	RptSize *size;
 	RptStroke *stroke;
-	RptColor *fill_color;
+	RptColor *fill_color = NULL;
 	gchar *prop;
 
 	RptPrintPrivate *priv = RPT_PRINT_GET_PRIVATE (rpt_print);
@@ -1327,6 +2146,9 @@ rpt_print_ellipse_xml (RptPrint *rpt_print, xmlNode *xnode)
 	if (position == NULL || size == NULL)
 		{
 			g_warning ("Ellipse node position and size are mandatories.");
+			g_free (position);
+			g_free (size);
+			rpt_common_rptstroke_free (stroke);
 			return;
 		}
 	if (stroke == NULL)
@@ -1342,6 +2164,7 @@ rpt_print_ellipse_xml (RptPrint *rpt_print, xmlNode *xnode)
 	if (prop != NULL)
 		{
 			fill_color = rpt_common_parse_color (prop);
+			xmlFree (prop);
 		}
 
 	cairo_new_path (priv->cr);
@@ -1354,7 +2177,7 @@ rpt_print_ellipse_xml (RptPrint *rpt_print, xmlNode *xnode)
 	cairo_arc (priv->cr, 0., 0., 1., 0., 2. * M_PI);
 	cairo_restore (priv->cr);
 	
-	if (prop != NULL && fill_color != NULL)
+	if (fill_color != NULL)
 		{
 			cairo_set_source_rgba (priv->cr, fill_color->r, fill_color->g, fill_color->b, fill_color->a);
 			cairo_fill_preserve (priv->cr);
@@ -1365,7 +2188,8 @@ rpt_print_ellipse_xml (RptPrint *rpt_print, xmlNode *xnode)
 
 	g_free (position);
 	g_free (size);
-	g_free (stroke);
+	g_free (fill_color);
+	rpt_common_rptstroke_free (stroke);
 }
 
 static void
@@ -1385,14 +2209,16 @@ rpt_print_image_xml (RptPrint *rpt_print, xmlNode *xnode)
 	RptPrintPrivate *priv = RPT_PRINT_GET_PRIVATE (rpt_print);
 
 	gchar *adapt;
-	gchar *filename= xmlGetProp (xnode, (const xmlChar *)"source");
-	if (filename == NULL)
+	gchar *filename;
+	gchar *source = xmlGetProp (xnode, (const xmlChar *)"source");
+	if (source == NULL)
 		{
 			g_warning ("Image node source is mandatory.");
 			return;
 		}
 
-	filename = g_build_filename (priv->path_relatives_to, filename, NULL);
+	filename = g_build_filename (priv->path_relatives_to, source, NULL);
+	xmlFree (source);
 
 	adapt = xmlGetProp (xnode, (const xmlChar *)"adapt");
 	if (adapt == NULL)
@@ -1409,10 +2235,16 @@ rpt_print_image_xml (RptPrint *rpt_print, xmlNode *xnode)
 	rotation = rpt_common_get_rotation (xnode);
 	border = rpt_common_get_border (xnode);
 
-	image = cairo_image_surface_create_from_png (filename);
-	if (cairo_surface_status (image) != CAIRO_STATUS_SUCCESS)
+	image = rpt_layout_cache_get_image (filename);
+	if (image == NULL)
 		{
 			g_warning ("Unable to create the cairo surface from the image «%s».", filename);
+			g_free (position);
+			g_free (size);
+			g_free (rotation);
+			rpt_common_rptborder_free (border);
+			g_free (adapt);
+			g_free (filename);
 			return;
 		}
 
@@ -1458,8 +2290,9 @@ rpt_print_image_xml (RptPrint *rpt_print, xmlNode *xnode)
 	g_free (position);
 	g_free (size);
 	g_free (rotation);
-	g_free (border);
+	rpt_common_rptborder_free (border);
 	g_free (adapt);
+	g_free (filename);
 }
 
 static void
@@ -1500,6 +2333,7 @@ rpt_print_line (RptPrint *rpt_print,
 				{
 					gdouble *dash = rpt_common_style_to_array (stroke->style);
 					cairo_set_dash (priv->cr, dash, stroke->style->len, 0.0);
+					g_free (dash);
 				}
 		}
 	else
@@ -1561,7 +2395,7 @@ rpt_print_border (RptPrint *rpt_print,
 			stroke->width = border->top_width;
 			stroke->color = border->top_color;
 			stroke->style = border->top_style;
-			rpt_print_line (rpt_print, from_p, to_p, stroke, NULL);
+			rpt_print_border_line (rpt_print, from_p, to_p, stroke, rotation);
 		}
 	if (border->right_width != 0.0)
 		{
@@ -1572,7 +2406,7 @@ rpt_print_border (RptPrint *rpt_print,
 			stroke->width = border->right_width;
 			stroke->color = border->right_color;
 			stroke->style = border->right_style;
-			rpt_print_line (rpt_print, from_p, to_p, stroke, NULL);
+			rpt_print_border_line (rpt_print, from_p, to_p, stroke, rotation);
 		}
 	if (border->bottom_width != 0.0)
 		{
@@ -1583,7 +2417,7 @@ rpt_print_border (RptPrint *rpt_print,
 			stroke->width = border->bottom_width;
 			stroke->color = border->bottom_color;
 			stroke->style = border->bottom_style;
-			rpt_print_line (rpt_print, from_p, to_p, stroke, NULL);
+			rpt_print_border_line (rpt_print, from_p, to_p, stroke, rotation);
 		}
 	if (border->left_width != 0.0)
 		{
@@ -1594,7 +2428,7 @@ rpt_print_border (RptPrint *rpt_print,
 			stroke->width = border->left_width;
 			stroke->color = border->left_color;
 			stroke->style = border->left_style;
-			rpt_print_line (rpt_print, from_p, to_p, stroke, NULL);
+			rpt_print_border_line (rpt_print, from_p, to_p, stroke, rotation);
 		}
 
 	g_free (from_p);
@@ -1602,10 +2436,217 @@ rpt_print_border (RptPrint *rpt_print,
 	g_free (stroke);
 }
 
+/* a border side goes to the page's batch of its stroke; the sides of a
+ * rotated object are drawn at once, on the rotated context */
+static void
+rpt_print_border_line (RptPrint *rpt_print,
+                       const RptPoint *from_p,
+                       const RptPoint *to_p,
+                       const RptStroke *stroke,
+                       const RptRotation *rotation)
+{
+	RptPrintPrivate *priv = RPT_PRINT_GET_PRIVATE (rpt_print);
+
+	RptPrintBorderBatch *batch;
+	RptPrintBorderSegment segment;
+	RptColor color;
+	gdouble to_add;
+	guint i;
+	guint j;
+
+	if (priv->border_batches == NULL
+	    || (rotation != NULL && rotation->angle != 0.0)
+	    || (from_p->x != to_p->x && from_p->y != to_p->y))
+		{
+			rpt_print_line (rpt_print, from_p, to_p, stroke, NULL);
+			return;
+		}
+
+	/* the same colour and offset of rpt_print_line () */
+	if (stroke->color != NULL)
+		{
+			color = *stroke->color;
+		}
+	else
+		{
+			color.r = color.g = color.b = 0.0;
+			color.a = 1.0;
+		}
+	to_add = (gint)stroke->width % 2 != 0 ? 0.5 : 0.0;
+
+	batch = NULL;
+	for (i = 0; i < priv->border_batches->len && batch == NULL; i++)
+		{
+			batch = (RptPrintBorderBatch *)g_ptr_array_index (priv->border_batches, i);
+			if (batch->width != stroke->width
+			    || memcmp (&batch->color, &color, sizeof (RptColor)) != 0
+			    || (batch->style == NULL) != (stroke->style == NULL))
+				{
+					batch = NULL;
+				}
+			else if (batch->style != NULL)
+				{
+					if (batch->style->len != stroke->style->len)
+						{
+							batch = NULL;
+						}
+					for (j = 0; batch != NULL && j < batch->style->len; j++)
+						{
+							if (g_array_index (batch->style, gdouble, j) != g_array_index (stroke->style, gdouble, j))
+								{
+									batch = NULL;
+								}
+						}
+				}
+		}
+	if (batch == NULL)
+		{
+			batch = g_new0 (RptPrintBorderBatch, 1);
+			batch->width = stroke->width;
+			batch->color = color;
+			if (stroke->style != NULL)
+				{
+					batch->style = g_array_sized_new (FALSE, FALSE, sizeof (gdouble), stroke->style->len);
+					g_array_append_vals (batch->style, stroke->style->data, stroke->style->len);
+				}
+			batch->horizontal = g_array_new (FALSE, FALSE, sizeof (RptPrintBorderSegment));
+			batch->vertical = g_array_new (FALSE, FALSE, sizeof (RptPrintBorderSegment));
+			g_ptr_array_add (priv->border_batches, batch);
+		}
+
+	if (from_p->y == to_p->y)
+		{
+			segment.fixed = rpt_common_value_to_points (priv->unit, from_p->y) + to_add;
+			segment.from = rpt_common_value_to_points (priv->unit, MIN (from_p->x, to_p->x));
+			segment.to = rpt_common_value_to_points (priv->unit, MAX (from_p->x, to_p->x));
+			g_array_append_val (batch->horizontal, segment);
+		}
+	else
+		{
+			segment.fixed = rpt_common_value_to_points (priv->unit, from_p->x);
+			segment.from = rpt_common_value_to_points (priv->unit, MIN (from_p->y, to_p->y)) + to_add;
+			segment.to = rpt_common_value_to_points (priv->unit, MAX (from_p->y, to_p->y)) + to_add;
+			g_array_append_val (batch->vertical, segment);
+		}
+}
+
+static gint
+rpt_print_border_segment_compare (gconstpointer a, gconstpointer b)
+{
+	const RptPrintBorderSegment *sa = (const RptPrintBorderSegment *)a;
+	const RptPrintBorderSegment *sb = (const RptPrintBorderSegment *)b;
+
+	if (sa->fixed != sb->fixed)
+		{
+			return sa->fixed < sb->fixed ? -1 : 1;
+		}
+	if (sa->from != sb->from)
+		{
+			return sa->from < sb->from ? -1 : 1;
+		}
+	return 0;
+}
+
+/* adds to the path the segments, sorted, with the shared and the adjacent
+ * ones on the same line merged */
+static void
+rpt_print_border_segments_to_path (RptPrint *rpt_print, GArray *segments, gboolean horizontal)
+{
+	RptPrintPrivate *priv = RPT_PRINT_GET_PRIVATE (rpt_print);
+
+	RptPrintBorderSegment *segment;
+	RptPrintBorderSegment merged;
+	guint i;
+
+	if (segments->len == 0)
+		{
+			return;
+		}
+
+	g_array_sort (segments, rpt_print_border_segment_compare);
+
+	merged = g_array_index (segments, RptPrintBorderSegment, 0);
+	for (i = 1; i <= segments->len; i++)
+		{
+			segment = i < segments->len ? &g_array_index (segments, RptPrintBorderSegment, i) : NULL;
+			if (segment != NULL
+			    && segment->fixed == merged.fixed
+			    && segment->from <= merged.to)
+				{
+					merged.to = MAX (merged.to, segment->to);
+					continue;
+				}
+
+			if (horizontal)
+				{
+					cairo_move_to (priv->cr, merged.from, merged.fixed);
+					cairo_line_to (priv->cr, merged.to, merged.fixed);
+				}
+			else
+				{
+					cairo_move_to (priv->cr, merged.fixed, merged.from);
+					cairo_line_to (priv->cr, merged.fixed, merged.to);
+				}
+
+			if (segment != NULL)
+				{
+					merged = *segment;
+				}
+		}
+}
+
+/* draws the page's borders, a stroke for each batch */
+static void
+rpt_print_border_batches_flush (RptPrint *rpt_print)
+{
+	RptPrintPrivate *priv = RPT_PRINT_GET_PRIVATE (rpt_print);
+
+	RptPrintBorderBatch *batch;
+	gdouble *dash;
+	guint i;
+
+	if (priv->border_batches == NULL)
+		{
+			return;
+		}
+
+	for (i = 0; i < priv->border_batches->len; i++)
+		{
+			batch = (RptPrintBorderBatch *)g_ptr_array_index (priv->border_batches, i);
+
+			cairo_new_path (priv->cr);
+			rpt_print_border_segments_to_path (rpt_print, batch->horizontal, TRUE);
+			rpt_print_border_segments_to_path (rpt_print, batch->vertical, FALSE);
+
+			cairo_set_line_width (priv->cr, batch->width);
+			cairo_set_source_rgba (priv->cr, batch->color.r, batch->color.g, batch->color.b, batch->color.a);
+			if (batch->style != NULL)
+				{
+					dash = rpt_common_style_to_array (batch->style);
+					cairo_set_dash (priv->cr, dash, batch->style->len, 0.0);
+					g_free (dash);
+				}
+			cairo_stroke (priv->cr);
+			if (batch->style != NULL)
+				{
+					cairo_set_dash (priv->cr, NULL, 0, 0.0);
+					g_array_free (batch->style, TRUE);
+				}
+
+			g_array_free (batch->horizontal, TRUE);
+			g_array_free (batch->vertical, TRUE);
+			g_free (batch);
+		}
+
+	g_ptr_array_free (priv->border_batches, TRUE);
+	priv->border_batches = NULL;
+}
+
 static gchar
 *rpt_print_new_numbered_filename (const gchar *filename, int number)
 {
 	gchar *new_out_filename = NULL;
+	gchar *basename;
 
 	gchar *filename_ext = g_strrstr (filename, ".");
 	if (filename_ext == NULL)
@@ -1614,91 +2655,349 @@ static gchar
 		}
 	else
 		{
+			basename = g_strndup (filename, strlen (filename) - strlen (filename_ext));
 			new_out_filename = g_strdup_printf ("%s%d%s",
-			                                    g_strndup (filename, strlen (filename) - strlen (filename_ext)),
+			                                    basename,
 			                                    number,
 			                                    filename_ext);
+			g_free (basename);
 		}
 
 	return new_out_filename;
 }
 
+/* TRUE if the output goes to memory, to a stream or to a file descriptor */
+static gboolean
+rpt_print_has_output_sink (RptPrint *rpt_print)
+{
+	RptPrintPrivate *priv = RPT_PRINT_GET_PRIVATE (rpt_print);
+
+	return priv->output_bytes != NULL
+	       || priv->output_stream != NULL
+	       || priv->output_fd >= 0;
+}
+
+static gboolean
+rpt_print_is_raster_output (RptPrint *rpt_print)
+{
+	RptPrintPrivate *priv = RPT_PRINT_GET_PRIVATE (rpt_print);
+
+	return priv->output_type == RPT_OUTPUT_PNG
+	       || priv->output_type == RPT_OUTPUT_PAM
+	       || priv->output_type == RPT_OUTPUT_RAW;
+}
+
+/* npage starts from 0 */
+static gboolean
+rpt_print_page_in_range (RptPrint *rpt_print, gint npage)
+{
+	RptPrintPrivate *priv = RPT_PRINT_GET_PRIVATE (rpt_print);
+
+	return npage + 1 >= (gint)priv->page_first
+	       && (priv->page_last == 0 || npage + 1 <= (gint)priv->page_last);
+}
+
+static cairo_status_t
+rpt_print_write_file (void *closure, const unsigned char *data, unsigned int length)
+{
+	return fwrite (data, 1, length, (FILE *)closure) == length ? CAIRO_STATUS_SUCCESS : CAIRO_STATUS_WRITE_ERROR;
+}
+
+/* draws the page in strips and gives them to the encoder, that writes to
+ * the sink or to the page's numbered file */
 static void
-rpt_print_rotate (RptPrint *rpt_print, const RptPoint *position, const RptSize *size, gdouble angle)
+rpt_print_raster_page (RptPrint *rpt_print, xmlNode *xpage, gint npage, gdouble width, gdouble height)
 {
 	RptPrintPrivate *priv = RPT_PRINT_GET_PRIVATE (rpt_print);
 
-	gdouble tx = position->x + size->width / 2;
-	gdouble ty = position->y + size->height / 2;
+	RptRasterEncoder *encoder;
+	cairo_write_func_t write_func;
+	void *closure;
+	cairo_status_t status;
+	gchar *new_out_filename;
+	FILE *fout;
 
-	cairo_translate (priv->cr, tx, ty);
-	cairo_rotate (priv->cr, angle * G_PI / 180.);
-	cairo_translate (priv->cr, -tx, -ty);
+	gdouble scale;
+	gint width_px;
+	gint height_px;
+	gint strip_rows;
+	gint rows;
+	gint y;
+
+	scale = priv->resolution / 72.0;
+	width_px = (gint)ceil (width * scale);
+	height_px = (gint)ceil (height * scale);
+	strip_rows = priv->strip_height > 0 ? MIN ((gint)priv->strip_height, height_px) : height_px;
+
+	if (priv->strip == NULL
+	    || cairo_image_surface_get_width (priv->strip) != width_px
+	    || cairo_image_surface_get_height (priv->strip) != strip_rows)
+		{
+			if (priv->strip != NULL)
+				{
+					cairo_surface_destroy (priv->strip);
+				}
+			priv->strip = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, width_px, strip_rows);
+		}
+	if (cairo_surface_status (priv->strip) != CAIRO_STATUS_SUCCESS)
+		{
+			rpt_print_set_error (rpt_print, RPT_PRINT_ERROR_SURFACE,
+			                     "Unable to create the page's image: %s.",
+			                     cairo_status_to_string (cairo_surface_status (priv->strip)));
+			cairo_surface_destroy (priv->strip);
+			priv->strip = NULL;
+			return;
+		}
+
+	new_out_filename = NULL;
+	fout = NULL;
+	if (rpt_print_has_output_sink (rpt_print))
+		{
+			write_func = rpt_print_write;
+			closure = rpt_print;
+		}
+	else
+		{
+			new_out_filename = rpt_print_new_numbered_filename (priv->output_filename, npage + 1);
+			fout = fopen (new_out_filename, "wb");
+			if (fout == NULL)
+				{
+					rpt_print_set_error (rpt_print, RPT_PRINT_ERROR_WRITE,
+					                     "Unable to write to the output file «%s»: %s.",
+					                     new_out_filename, g_strerror (errno));
+					g_free (new_out_filename);
+					return;
+				}
+			write_func = rpt_print_write_file;
+			closure = fout;
+		}
+
+	encoder = rpt_raster_encoder_new (priv->output_type, width_px, height_px,
+	                                  priv->png_compression, priv->png_filter,
+	                                  write_func, closure);
+
+	status = CAIRO_STATUS_SUCCESS;
+	for (y = 0; y < height_px && status == CAIRO_STATUS_SUCCESS; y += strip_rows)
+		{
+			rows = MIN (strip_rows, height_px - y);
+
+			priv->cr = cairo_create (priv->strip);
+
+			cairo_set_operator (priv->cr, CAIRO_OPERATOR_CLEAR);
+			cairo_paint (priv->cr);
+			cairo_set_operator (priv->cr, CAIRO_OPERATOR_OVER);
+
+			/* the strip shows the page's rows from y */
+			cairo_translate (priv->cr, 0.0, -y);
+			cairo_scale (priv->cr, scale, scale);
+
+			rpt_print_page (rpt_print, xpage);
+
+			cairo_destroy (priv->cr);
+			priv->cr = NULL;
+
+			status = rpt_raster_encoder_write_rows (encoder, priv->strip, rows);
+		}
+	status = rpt_raster_encoder_finish (encoder);
+
+	if (fout != NULL && fclose (fout) != 0)
+		{
+			status = CAIRO_STATUS_WRITE_ERROR;
+		}
+	if (status != CAIRO_STATUS_SUCCESS)
+		{
+			rpt_print_set_error (rpt_print, RPT_PRINT_ERROR_WRITE,
+			                     "Unable to write the «%s» output: %s.",
+			                     rpt_common_enum_to_stroutputtype (priv->output_type),
+			                     cairo_status_to_string (status));
+		}
+
+	g_free (new_out_filename);
+}
+
+/* the cairo_write_func_t of the output sinks */
+static cairo_status_t
+rpt_print_write (void *closure, const unsigned char *data, unsigned int length)
+{
+	RptPrint *rpt_print = (RptPrint *)closure;
+	RptPrintPrivate *priv = RPT_PRINT_GET_PRIVATE (rpt_print);
+
+	if (priv->output_bytes != NULL)
+		{
+			g_byte_array_append (priv->output_bytes, data, length);
+		}
+	else if (priv->output_stream != NULL)
+		{
+			GError *error = NULL;
+
+			if (!g_output_stream_write_all (priv->output_stream, data, length, NULL, NULL, &error))
+				{
+					rpt_print_set_error (rpt_print, RPT_PRINT_ERROR_WRITE,
+					                     "Unable to write to the output stream: %s.",
+					                     error != NULL && error->message != NULL ? error->message : "no details");
+					g_clear_error (&error);
+					return CAIRO_STATUS_WRITE_ERROR;
+				}
+		}
+	else
+		{
+			gssize written;
+
+			while (length > 0)
+				{
+					written = write (priv->output_fd, data, length);
+					if (written < 0)
+						{
+							if (errno == EINTR)
+								{
+									continue;
+								}
+							rpt_print_set_error (rpt_print, RPT_PRINT_ERROR_WRITE,
+							                     "Unable to write to the output file descriptor: %s.",
+							                     g_strerror (errno));
+							return CAIRO_STATUS_WRITE_ERROR;
+						}
+					data += written;
+					length -= written;
+				}
+		}
+
+	return CAIRO_STATUS_SUCCESS;
 }
 
+/* keeps the first error of the print; the next ones are its consequences */
 static void
-rpt_print_gtk_begin_print (GtkPrintOperation *operation, 
-                           GtkPrintContext *context,
-                           gpointer user_data)
+rpt_print_set_error (RptPrint *rpt_print, gint code, const gchar *format, ...)
 {
-	RptPrint *rpt_print = (RptPrint *)user_data;
+	va_list args;
+
 	RptPrintPrivate *priv = RPT_PRINT_GET_PRIVATE (rpt_print);
 
-	gtk_print_operation_set_n_pages (operation, priv->pages->nodeNr);
+	if (priv->error != NULL)
+		{
+			return;
+		}
+
+	va_start (args, format);
+	priv->error = g_error_new_valist (RPT_PRINT_ERROR, code, format, args);
+	va_end (args);
 }
 
+/* ends the pdf, ps or svg surface, that writes what it still has */
 static void
-rpt_print_gtk_request_page_setup (GtkPrintOperation *operation,
-                                  GtkPrintContext *context,
-                                  gint page_nr,
-                                  GtkPageSetup *setup,
-                                  gpointer user_data)
+rpt_print_surface_finish (RptPrint *rpt_print)
 {
-	GtkPaperSize *paper_size;
+	RptPrintPrivate *priv = RPT_PRINT_GET_PRIVATE (rpt_print);
+
+	if (priv->surface == NULL)
+		{
+			return;
+		}
+
+	cairo_surface_finish (priv->surface);
+	if (cairo_surface_status (priv->surface) != CAIRO_STATUS_SUCCESS)
+		{
+			rpt_print_set_error (rpt_print, RPT_PRINT_ERROR_WRITE,
+			                     "Unable to write the «%s» output: %s.",
+			                     rpt_common_enum_to_stroutputtype (priv->output_type),
+			                     cairo_status_to_string (cairo_surface_status (priv->surface)));
+		}
+	cairo_surface_destroy (priv->surface);
+	priv->surface = NULL;
+}
 
-	RptPrint *rpt_print = (RptPrint *)user_data;
+/* creates the pdf, ps or svg surface on filename or, with a sink, on the sink */
+static cairo_surface_t
+*rpt_print_create_surface (RptPrint *rpt_print, const gchar *filename, gdouble width, gdouble height)
+{
 	RptPrintPrivate *priv = RPT_PRINT_GET_PRIVATE (rpt_print);
 
-	rpt_print_get_xml_page_attributes (rpt_print, priv->pages->nodeTab[page_nr]);
+	gboolean sink = rpt_print_has_output_sink (rpt_print);
 
-	paper_size = gtk_paper_size_new_custom ("reptool",
-	                                        "RepTool",
-	                                        rpt_common_value_to_points (priv->unit, priv->width > priv->height ? priv->height : priv->width),
-	                                        rpt_common_value_to_points (priv->unit, priv->width > priv->height ? priv->width : priv->height),
-	                                        GTK_UNIT_POINTS);
+	switch (priv->output_type)
+		{
+			case RPT_OUTPUT_PS:
+				return sink ? cairo_ps_surface_create_for_stream (rpt_print_write, rpt_print, width, height)
+				            : cairo_ps_surface_create (filename, width, height);
 
-	gtk_page_setup_set_paper_size (setup, paper_size);
+			case RPT_OUTPUT_SVG:
+				return sink ? cairo_svg_surface_create_for_stream (rpt_print_write, rpt_print, width, height)
+				            : cairo_svg_surface_create (filename, width, height);
 
-	gtk_page_setup_set_top_margin (setup, 0.0, GTK_UNIT_POINTS);
-	gtk_page_setup_set_bottom_margin (setup, 0.0, GTK_UNIT_POINTS);
-	gtk_page_setup_set_left_margin (setup, 0.0, GTK_UNIT_POINTS);
-	gtk_page_setup_set_right_margin (setup, 0.0, GTK_UNIT_POINTS);
+			default:
+				return sink ? cairo_pdf_surface_create_for_stream (rpt_print_write, rpt_print, width, height)
+				            : cairo_pdf_surface_create (filename, width, height);
+		}
 }
 
 static void
-rpt_print_gtk_draw_page (GtkPrintOperation *operation,
-                         GtkPrintContext *context,
-                         gint page_nr,
-                         gpointer user_data)
+rpt_print_rotate (RptPrint *rpt_print, const RptPoint *position, const RptSize *size, gdouble angle)
 {
-	RptPrint *rpt_print = (RptPrint *)user_data;
 	RptPrintPrivate *priv = RPT_PRINT_GET_PRIVATE (rpt_print);
 
-	priv->cr = gtk_print_context_get_cairo_context (context);
-	priv->gtk_print_context = context;
+	gdouble tx = position->x + size->width / 2;
+	gdouble ty = position->y + size->height / 2;
 
-	cairo_reset_clip (priv->cr);
-	cairo_scale (priv->cr,
-	             gtk_print_context_get_width (priv->gtk_print_context) / rpt_common_value_to_points (priv->unit, priv->width),
-	             gtk_print_context_get_height (priv->gtk_print_context) / rpt_common_value_to_points (priv->unit, priv->height));
+	cairo_translate (priv->cr, tx, ty);
+	cairo_rotate (priv->cr, angle * G_PI / 180.);
+	cairo_translate (priv->cr, -tx, -ty);
+}
 
-	if (priv->translation != NULL)
+static RptPrintGtkPrintFunc
+rpt_print_get_gtk_print (void)
+{
+	static RptPrintGtkPrintFunc gtk_print = NULL;
+
+	GModule *module;
+	gchar *path;
+
+	if (gtk_print != NULL)
 		{
-			cairo_translate (priv->cr, priv->translation->x, priv->translation->y);
+			return gtk_print;
+		}
+	if (!g_module_supported ())
+		{
+			g_warning ("The gtk output needs libreptool-gtk, but modules aren't supported.");
+			return NULL;
 		}
 
-	if (priv->width != 0 && priv->height != 0)
+	/* the program could be linked to libreptool-gtk already */
+	module = g_module_open (NULL, G_MODULE_BIND_LAZY);
+	if (module != NULL
+	    && g_module_symbol (module, "rpt_print_gtk_print", (gpointer *)&gtk_print))
 		{
-			rpt_print_page (rpt_print, priv->pages->nodeTab[page_nr]);
+			return gtk_print;
 		}
+	if (module != NULL)
+		{
+			g_module_close (module);
+		}
+
+	/* GTK is loaded only by the process that asks for the gtk output; the
+	 * name with the version is the one installed without the development
+	 * files, and it can't be a libreptool-gtk incompatible with this one */
+#if defined (G_OS_WIN32)
+	path = g_build_filename (LIBDIR, "libreptool-gtk-" REPTOOL_GTK_CURRENT ".dll", NULL);
+#elif defined (__APPLE__)
+	path = g_build_filename (LIBDIR, "libreptool-gtk." REPTOOL_GTK_CURRENT ".dylib", NULL);
+#else
+	path = g_build_filename (LIBDIR, "libreptool-gtk.so." REPTOOL_GTK_CURRENT, NULL);
+#endif
+	module = g_module_open (path, G_MODULE_BIND_LAZY | G_MODULE_BIND_LOCAL);
+	g_free (path);
+	if (module == NULL)
+		{
+			g_warning ("Unable to load libreptool-gtk: %s.", g_module_error ());
+			return NULL;
+		}
+	if (!g_module_symbol (module, "rpt_print_gtk_print", (gpointer *)&gtk_print))
+		{
+			g_warning ("Unable to find the gtk output in libreptool-gtk: %s.", g_module_error ());
+			g_module_close (module);
+			gtk_print = NULL;
+			return NULL;
+		}
+	g_module_make_resident (module);
+
+	return gtk_print;
 }
@@ -22,8 +22,9 @@
 
 #include <glib.h>
 #include <glib-object.h>
+#include <gio/gio.h>
 #include <libxml/tree.h>
-#include <gtk/gtk.h>
+#include <cairo.h>
 
 #include "rptcommon.h"
 
@@ -38,6 +39,19 @@ G_BEGIN_DECLS
 #define RPT_PRINT_COMMON_GET_CLASS(obj)       (G_TYPE_INSTANCE_GET_CLASS ((obj), TYPE_RPT_PRINT, RptPrintClass))
 
 
+#define RPT_PRINT_ERROR rpt_print_error_quark ()
+
+typedef enum
+{
+	RPT_PRINT_ERROR_INVALID_XML,
+	RPT_PRINT_ERROR_NOT_SUPPORTED,
+	RPT_PRINT_ERROR_SURFACE,
+	RPT_PRINT_ERROR_WRITE
+} RptPrintError;
+
+GQuark rpt_print_error_quark (void);
+
+
 typedef struct _RptPrint RptPrint;
 typedef struct _RptPrintClass RptPrintClass;
 
@@ -59,12 +73,36 @@ RptPrint *rpt_print_new_from_file (const gchar *filename);
 
 void rpt_print_set_output_type (RptPrint *rpt_print, eRptOutputType output_type);
 void rpt_print_set_output_filename (RptPrint *rpt_print, const gchar *output_filename);
+void rpt_print_set_output_stream (RptPrint *rpt_print, GOutputStream *stream);
+void rpt_print_set_output_fd (RptPrint *rpt_print, gint fd);
 
-void rpt_print_set_gtkprintsettings (RptPrint *rpt_print, GtkPrintSettings *settings);
 void rpt_print_set_copies (RptPrint *rpt_print, guint copies);
+void rpt_print_set_page_range (RptPrint *rpt_print, guint first, guint last);
+gboolean rpt_print_get_page_range (RptPrint *rpt_print, guint *first, guint *last);
+void rpt_print_set_png_compression (RptPrint *rpt_print, gint compression);
+void rpt_print_set_png_filter (RptPrint *rpt_print, eRptPngFilter filter);
+void rpt_print_set_resolution (RptPrint *rpt_print, gdouble resolution);
+void rpt_print_set_strip_height (RptPrint *rpt_print, guint rows);
 void rpt_print_set_translation (RptPrint *rpt_print, RptTranslation *translation);
 
-void rpt_print_print (RptPrint *rpt_print, GtkWindow *transient);
+gint rpt_print_get_n_pages (RptPrint *rpt_print);
+void rpt_print_get_page_size (RptPrint *rpt_print,
+                              gint page,
+                              gdouble *width,
+                              gdouble *height);
+void rpt_print_render_page (RptPrint *rpt_print,
+                            gint page,
+                            cairo_t *cr,
+                            gdouble width,
+                            gdouble height);
+void rpt_print_render_region (RptPrint *rpt_print,
+                              gint page,
+                              cairo_t *cr,
+                              const cairo_rectangle_t *region);
+
+void rpt_print_print (RptPrint *rpt_print, gpointer transient);
+gboolean rpt_print_print_full (RptPrint *rpt_print, gpointer transient, GError **error);
+GBytes *rpt_print_print_to_bytes (RptPrint *rpt_print);
 
 
 G_END_DECLS
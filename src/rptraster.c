@@ -0,0 +1,343 @@
+/*
+ * Copyright (C) 2007-2014 Andrea Zagli <azagli@libero.it>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <string.h>
+#include <setjmp.h>
+
+#include <png.h>
+
+#include "rptraster.h"
+
+struct _RptRasterEncoder
+{
+	eRptOutputType output_type;
+	gint width;
+	gint height;
+
+	cairo_write_func_t write_func;
+	void *closure;
+	cairo_status_t status;
+
+	/* png only */
+	png_structp png;
+	png_infop info;
+
+	/* a row not premultiplied */
+	guint8 *row;
+};
+
+static void rpt_raster_unpremultiply_row (const guint32 *src,
+                                          guint8 *dst,
+                                          gint width);
+
+/* converts a row of premultiplied native ARGB32 to RGBA bytes, as
+ * (c * 255 + a / 2) / a; the float quotient rounds the same for every
+ * value, and a float division, unlike an integer one or a table lookup,
+ * has a vector instruction, so the loop vectorizes at -O3. A transparent
+ * pixel has all its components at 0, so dividing it by 1 instead of 0
+ * needs no branch */
+static void
+rpt_raster_unpremultiply_row (const guint32 *src, guint8 *dst, gint width)
+{
+	guint32 p;
+	guint32 a;
+	gfloat f;
+	gint x;
+
+	for (x = 0; x < width; x++)
+		{
+			p = src[x];
+			a = p >> 24;
+			f = (gfloat)(a + (a == 0));
+			dst[x * 4 + 0] = (guint8)MIN ((guint32)((gfloat)(((p >> 16) & 0xff) * 255) / f + 0.5f), 255);
+			dst[x * 4 + 1] = (guint8)MIN ((guint32)((gfloat)(((p >> 8) & 0xff) * 255) / f + 0.5f), 255);
+			dst[x * 4 + 2] = (guint8)MIN ((guint32)((gfloat)((p & 0xff) * 255) / f + 0.5f), 255);
+			dst[x * 4 + 3] = (guint8)a;
+		}
+}
+
+static void
+rpt_raster_png_write_data (png_structp png, png_bytep data, png_size_t length)
+{
+	RptRasterEncoder *encoder = (RptRasterEncoder *)png_get_io_ptr (png);
+
+	encoder->status = encoder->write_func (encoder->closure, data, length);
+	if (encoder->status != CAIRO_STATUS_SUCCESS)
+		{
+			png_error (png, "write error");
+		}
+}
+
+static void
+rpt_raster_png_flush (png_structp png)
+{
+}
+
+static void
+rpt_raster_png_error (png_structp png, png_const_charp message)
+{
+	RptRasterEncoder *encoder = (RptRasterEncoder *)png_get_error_ptr (png);
+
+	if (encoder->status == CAIRO_STATUS_SUCCESS)
+		{
+			g_warning ("Error on png encoding: %s.", message);
+			encoder->status = CAIRO_STATUS_WRITE_ERROR;
+		}
+
+	longjmp (png_jmpbuf (png), 1);
+}
+
+static void
+rpt_raster_png_warning (png_structp png, png_const_charp message)
+{
+}
+
+static void
+rpt_raster_png_start (RptRasterEncoder *encoder, gint compression, eRptPngFilter filter)
+{
+	encoder->png = png_create_write_struct (PNG_LIBPNG_VER_STRING, encoder,
+	                                        rpt_raster_png_error, rpt_raster_png_warning);
+	if (encoder->png == NULL)
+		{
+			encoder->status = CAIRO_STATUS_NO_MEMORY;
+			return;
+		}
+	encoder->info = png_create_info_struct (encoder->png);
+	if (encoder->info == NULL)
+		{
+			encoder->status = CAIRO_STATUS_NO_MEMORY;
+			return;
+		}
+
+	if (setjmp (png_jmpbuf (encoder->png)))
+		{
+			return;
+		}
+
+	png_set_write_fn (encoder->png, encoder, rpt_raster_png_write_data, rpt_raster_png_flush);
+
+	if (compression >= 0)
+		{
+			png_set_compression_level (encoder->png, MIN (compression, 9));
+		}
+	switch (filter)
+		{
+			case RPT_PNG_FILTER_NONE:
+				png_set_filter (encoder->png, PNG_FILTER_TYPE_BASE, PNG_FILTER_NONE);
+				break;
+
+			case RPT_PNG_FILTER_SUB:
+				png_set_filter (encoder->png, PNG_FILTER_TYPE_BASE, PNG_FILTER_SUB);
+				break;
+
+			case RPT_PNG_FILTER_UP:
+				png_set_filter (encoder->png, PNG_FILTER_TYPE_BASE, PNG_FILTER_UP);
+				break;
+
+			case RPT_PNG_FILTER_AVG:
+				png_set_filter (encoder->png, PNG_FILTER_TYPE_BASE, PNG_FILTER_AVG);
+				break;
+
+			case RPT_PNG_FILTER_PAETH:
+				png_set_filter (encoder->png, PNG_FILTER_TYPE_BASE, PNG_FILTER_PAETH);
+				break;
+
+			case RPT_PNG_FILTER_ALL:
+				png_set_filter (encoder->png, PNG_FILTER_TYPE_BASE, PNG_ALL_FILTERS);
+				break;
+
+			default:
+				break;
+		}
+
+	png_set_IHDR (encoder->png, encoder->info, encoder->width, encoder->height, 8,
+	              PNG_COLOR_TYPE_RGB_ALPHA,
+	              PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+	png_write_info (encoder->png, encoder->info);
+}
+
+/**
+ * rpt_raster_encoder_new:
+ * @output_type: #RPT_OUTPUT_PNG, #RPT_OUTPUT_PAM or #RPT_OUTPUT_RAW.
+ * @width: the image's width, in pixels.
+ * @height: the image's height, in pixels.
+ * @png_compression: the zlib level, from 0 to 9; -1 for the libpng's default.
+ * @png_filter: the png row filter.
+ * @write_func:
+ * @closure:
+ *
+ * Starts an image, whose rows are given with
+ * rpt_raster_encoder_write_rows(), from the top, in any number of strips.
+ *
+ * The png and pam images aren't premultiplied; the raw one is the pixels
+ * as they are in memory, without a header: premultiplied ARGB32 in native
+ * endianness, width * height pixels of 4 bytes.
+ *
+ * Returns: the encoder, to free with rpt_raster_encoder_finish().
+ */
+RptRasterEncoder
+*rpt_raster_encoder_new (eRptOutputType output_type,
+                         gint width,
+                         gint height,
+                         gint png_compression,
+                         eRptPngFilter png_filter,
+                         cairo_write_func_t write_func,
+                         void *closure)
+{
+	RptRasterEncoder *encoder;
+	gchar *header;
+
+
+	encoder = g_new0 (RptRasterEncoder, 1);
+	encoder->output_type = output_type;
+	encoder->width = width;
+	encoder->height = height;
+	encoder->write_func = write_func;
+	encoder->closure = closure;
+	encoder->status = CAIRO_STATUS_SUCCESS;
+	encoder->row = g_malloc (width * 4);
+
+	switch (output_type)
+		{
+			case RPT_OUTPUT_PNG:
+				rpt_raster_png_start (encoder, png_compression, png_filter);
+				break;
+
+			case RPT_OUTPUT_PAM:
+				header = g_strdup_printf ("P7\nWIDTH %d\nHEIGHT %d\nDEPTH 4\nMAXVAL 255\nTUPLTYPE RGB_ALPHA\nENDHDR\n",
+				                          width, height);
+				encoder->status = write_func (closure, (const unsigned char *)header, strlen (header));
+				g_free (header);
+				break;
+
+			case RPT_OUTPUT_RAW:
+				break;
+
+			default:
+				encoder->status = CAIRO_STATUS_INVALID_FORMAT;
+				break;
+		}
+
+	return encoder;
+}
+
+/**
+ * rpt_raster_encoder_write_rows:
+ * @encoder:
+ * @surface: an ARGB32 image surface, as wide as the image.
+ * @rows: the number of rows of @surface to write, from its top.
+ *
+ * Returns: the status; after an error, every call returns it.
+ */
+cairo_status_t
+rpt_raster_encoder_write_rows (RptRasterEncoder *encoder,
+                               cairo_surface_t *surface,
+                               gint rows)
+{
+	guchar *data;
+	gint stride;
+	gint y;
+
+	if (encoder->status != CAIRO_STATUS_SUCCESS)
+		{
+			return encoder->status;
+		}
+
+	if (cairo_surface_get_type (surface) != CAIRO_SURFACE_TYPE_IMAGE
+	    || cairo_image_surface_get_format (surface) != CAIRO_FORMAT_ARGB32
+	    || cairo_image_surface_get_width (surface) != encoder->width
+	    || cairo_image_surface_get_height (surface) < rows)
+		{
+			encoder->status = CAIRO_STATUS_INVALID_FORMAT;
+			return encoder->status;
+		}
+
+	cairo_surface_flush (surface);
+	data = cairo_image_surface_get_data (surface);
+	stride = cairo_image_surface_get_stride (surface);
+
+	switch (encoder->output_type)
+		{
+			case RPT_OUTPUT_PNG:
+				if (setjmp (png_jmpbuf (encoder->png)))
+					{
+						break;
+					}
+				for (y = 0; y < rows; y++)
+					{
+						rpt_raster_unpremultiply_row ((const guint32 *)(data + y * stride), encoder->row, encoder->width);
+						png_write_row (encoder->png, encoder->row);
+					}
+				break;
+
+			case RPT_OUTPUT_PAM:
+				for (y = 0; y < rows && encoder->status == CAIRO_STATUS_SUCCESS; y++)
+					{
+						rpt_raster_unpremultiply_row ((const guint32 *)(data + y * stride), encoder->row, encoder->width);
+						encoder->status = encoder->write_func (encoder->closure, encoder->row, encoder->width * 4);
+					}
+				break;
+
+			default:
+				if (stride == encoder->width * 4)
+					{
+						encoder->status = encoder->write_func (encoder->closure, data, stride * rows);
+					}
+				else
+					{
+						for (y = 0; y < rows && encoder->status == CAIRO_STATUS_SUCCESS; y++)
+							{
+								encoder->status = encoder->write_func (encoder->closure, data + y * stride, encoder->width * 4);
+							}
+					}
+				break;
+		}
+
+	return encoder->status;
+}
+
+/**
+ * rpt_raster_encoder_finish:
+ * @encoder:
+ *
+ * Ends the image and frees @encoder.
+ *
+ * Returns: the status of the whole image.
+ */
+cairo_status_t
+rpt_raster_encoder_finish (RptRasterEncoder *encoder)
+{
+	cairo_status_t status;
+
+	if (encoder->png != NULL)
+		{
+			if (encoder->status == CAIRO_STATUS_SUCCESS
+			    && !setjmp (png_jmpbuf (encoder->png)))
+				{
+					png_write_end (encoder->png, encoder->info);
+				}
+			png_destroy_write_struct (&encoder->png, encoder->info != NULL ? &encoder->info : NULL);
+		}
+
+	status = encoder->status;
+
+	g_free (encoder->row);
+	g_free (encoder);
+
+	return status;
+}
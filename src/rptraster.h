@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2007-2014 Andrea Zagli <azagli@libero.it>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef __RPT_RASTER_H__
+#define __RPT_RASTER_H__
+
+#include <glib.h>
+#include <cairo.h>
+
+#include "rptcommon.h"
+
+G_BEGIN_DECLS
+
+
+typedef struct _RptRasterEncoder RptRasterEncoder;
+
+RptRasterEncoder *rpt_raster_encoder_new (eRptOutputType output_type,
+                                          gint width,
+                                          gint height,
+                                          gint png_compression,
+                                          eRptPngFilter png_filter,
+                                          cairo_write_func_t write_func,
+                                          void *closure);
+
+cairo_status_t rpt_raster_encoder_write_rows (RptRasterEncoder *encoder,
+                                              cairo_surface_t *surface,
+                                              gint rows);
+
+cairo_status_t rpt_raster_encoder_finish (RptRasterEncoder *encoder);
+
+
+G_END_DECLS
+
+#endif /* __RPT_RASTER_H__ */
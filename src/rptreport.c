@@ -36,10 +36,21 @@
 #include "rptobjectrect.h"
 #include "rptobjectellipse.h"
 #include "rptobjectimage.h"
+#include "rptobjectsubreport.h"
+#include "rptlayoutcache.h"
+#include "rptformat.h"
+#include "rptcompiled.h"
+#include "rpttemplatecache.h"
+#include "rptdatasourcegda.h"
+#include "rptdatasourceprefetch.h"
 
 #include "rptmarshal.h"
 
 #include "parser.tab.h"
+#include "lexycal.yy.h"
+
+/* the rows read from the source at a time */
+#define RPT_REPORT_BATCH_ROWS 256
 
 typedef struct
 {
@@ -48,12 +59,27 @@ typedef struct
 	gchar *sql;
 
 	GdaConnection *gda_conn;
-	GdaDataModel *gda_datamodel;
+	/* parsed and prepared once, executed again on every run with the
+	 * values of the parameters; params is NULL if the query has none */
+	GdaStatement *stmt;
+	GdaSet *params;
+
+	RptDataSource *source;
+	/* source is an RptDataSourcePrefetch made by the report */
+	gboolean prefetching;
 
-	GtkTreeModel *treemodel;
-	GHashTable *columns_names;
+	/* field's name -> column + 1, or 0 if the source hasn't it */
+	GHashTable *columns;
 } Database;
 
+typedef struct
+{
+	gchar *name;
+	GType type;
+	/* never NULL: a null value if the parameter has none */
+	GValue *value;
+} Parameter;
+
 typedef struct
 {
 	RptSize *size;
@@ -64,20 +90,27 @@ typedef struct
 {
 	gdouble height;
 	GList *objects;
+	GList *objects_last;
 	gboolean new_page_after;
+	gboolean can_grow;
+	gboolean can_shrink;
 } ReportHeader;
 
 typedef struct
 {
 	gdouble height;
 	GList *objects;
+	GList *objects_last;
 	gboolean new_page_before;
+	gboolean can_grow;
+	gboolean can_shrink;
 } ReportFooter;
 
 typedef struct
 {
 	gdouble height;
 	GList *objects;
+	GList *objects_last;
 	gboolean first_page;
 	gboolean last_page;
 } PageHeader;
@@ -86,15 +119,73 @@ typedef struct
 {
 	gdouble height;
 	GList *objects;
+	GList *objects_last;
 	gboolean first_page;
 	gboolean last_page;
 } PageFooter;
 
+typedef struct
+{
+	gchar *name;
+	RptReportSection section;
+	/* the object is also in another report, see rpt_report_copy() */
+	gboolean shared;
+} ObjectIndex;
+
+/* a subreport during a run: the detail's definition and the rows already
+ * read for every set of parameters' values */
+typedef struct
+{
+	RptReport *report;
+
+	/* the parameters' names and the sources of their values */
+	gchar **names;
+	gchar **sources;
+
+	GdaConnection *gda_conn;
+	GdaStatement *stmt;
+	GdaSet *params;
+
+	/* the parameters' values, joined -> RptDataSource */
+	GHashTable *results;
+	RptDataBatch *batch;
+
+	/* added to the x of the detail's objects */
+	gdouble dx;
+} Subreport;
+
+typedef struct
+{
+	xmlNode *xnode;
+	gdouble y;
+	gdouble height;
+	Subreport *subreport;
+	gchar *source;
+	gchar *field;
+	RptFormat *format;
+	RptLayoutAttrs *attrs;
+	gboolean can_grow;
+	gboolean can_shrink;
+	gdouble static_delta;
+	gchar *static_id;
+} EmitObject;
+
+typedef struct
+{
+	gdouble height;
+	gboolean can_grow;
+	gboolean can_shrink;
+	GPtrArray *objects;
+} EmitBand;
+
 typedef struct
 {
 	gdouble height;
 	GList *objects;
+	GList *objects_last;
 	gboolean new_page_after;
+	gboolean can_grow;
+	gboolean can_shrink;
 } Body;
 
 enum
@@ -109,6 +200,9 @@ enum
 static void rpt_report_class_init (RptReportClass *klass);
 static void rpt_report_init (RptReport *rpt_report);
 
+static void rpt_report_dispose (GObject *object);
+static void rpt_report_finalize (GObject *object);
+
 static void rpt_report_set_property (GObject *object,
                                      guint property_id,
                                      const GValue *value,
@@ -118,14 +212,51 @@ static void rpt_report_get_property (GObject *object,
                                      GValue *value,
                                      GParamSpec *pspec);
 
+static xmlDoc *rpt_report_read_file (const gchar *filename,
+                                      gboolean allow_compiled,
+                                      GError **error);
+static gboolean rpt_report_xml_check_once (xmlNode *xnode,
+                                           xmlNode **found,
+                                           GError **error);
+static void rpt_report_xml_parse_properties (RptReport *rpt_report,
+                                             xmlNode *xnode);
+static void rpt_report_xml_parse_database (RptReport *rpt_report,
+                                           xmlNode *xnode);
+static gboolean rpt_report_xml_parse_parameters (RptReport *rpt_report,
+                                                 xmlNode *xnode,
+                                                 GError **error);
+static gboolean rpt_report_xml_parse_page (RptReport *rpt_report,
+                                           xmlNode *xnode,
+                                           GError **error);
+static gboolean rpt_report_xml_parse_report (RptReport *rpt_report,
+                                             xmlNode *xnode,
+                                             GError **error);
 static void rpt_report_xml_parse_section (RptReport *rpt_report, xmlNode *xnode, RptReportSection section);
-
-static RptObject *rpt_report_get_object_from_name_in_list (GList *list, const gchar *name);
+static void rpt_report_xml_parse_section_grow_shrink (xmlNode *xnode, gboolean *can_grow, gboolean *can_shrink);
+
+static void rpt_report_object_index_free (ObjectIndex *index);
+static void rpt_report_on_object_name_changed (GObject *object,
+                                               GParamSpec *pspec,
+                                               gpointer user_data);
+static void rpt_report_section_unindex_objects (RptReport *rpt_report, GList *objects);
+static gboolean rpt_report_section_get_object_list (RptReport *rpt_report,
+                                                    RptReportSection section,
+                                                    GList ***objects,
+                                                    GList ***objects_last);
 
 static RptReportSection rpt_report_object_get_section (RptReport *rpt_report, RptObject *rpt_object);
-static gboolean rpt_report_object_is_in_section (RptReport *rpt_report, RptObject *rpt_object, RptReportSection section);
+static RptObject *rpt_report_object_new_from_xml (xmlNode *xnode);
+static RptObject *rpt_report_object_unshare (RptReport *rpt_report, RptObject *rpt_object);
 
 static void rpt_report_section_create (RptReport *rpt_report, RptReportSection section);
+static void rpt_report_section_free_objects (RptReport *rpt_report, GList *objects);
+static void rpt_report_database_free (Database *db);
+static gboolean rpt_report_database_execute (RptReport *rpt_report, GError **error);
+static gboolean rpt_report_bind_parameters (RptReport *rpt_report, GdaSet *params, GError **error);
+
+static Parameter *rpt_report_parameter_find (RptReport *rpt_report, const gchar *name);
+static Parameter *rpt_report_parameter_add (RptReport *rpt_report, const gchar *name, GType type);
+static void rpt_report_parameter_free (Parameter *param);
 static xmlNode *rpt_report_section_get_xml (RptReport *rpt_report, RptReportSection section);
 
 static xmlNode *rpt_report_rptprint_get_properties_node (xmlDoc *xdoc);
@@ -136,12 +267,79 @@ static void rpt_report_rptprint_section (RptReport *rpt_report,
                                          xmlNode *xpage,
                                          gdouble *cur_y,
                                          RptReportSection section);
+static xmlNode *rpt_report_rptprint_section_build (RptReport *rpt_report,
+                                                  gdouble cur_y,
+                                                  RptReportSection section,
+                                                  gdouble *height);
+static void rpt_report_rptprint_section_place (xmlNode *xpage,
+                                               xmlNode *xband);
+static void rpt_report_rptprint_band_move (xmlNode *xband,
+                                           gdouble from_y,
+                                           gdouble to_y);
+static void rpt_report_rptprint_band_set_page (xmlNode *xband, guint page);
+static gboolean rpt_report_objects_use_page (GList *objects);
+static gdouble rpt_report_rptprint_text_fit (RptReport *rpt_report,
+                                             EmitObject *emit,
+                                             xmlNode *xnode);
+static EmitBand *rpt_report_rptprint_section_get_template (RptReport *rpt_report,
+                                                          RptReportSection section);
+static void rpt_report_rptprint_templates_free (RptReport *rpt_report);
+static void rpt_report_rptprint_run_end (RptReport *rpt_report);
+static void rpt_report_emit_object_free (EmitObject *emit);
+static gboolean rpt_report_section_get_grow_shrink (RptReport *rpt_report,
+                                                    RptReportSection section,
+                                                    gboolean *can_grow,
+                                                    gboolean *can_shrink);
 
 static void rpt_report_rptprint_parse_text_source (RptReport *rpt_report,
                                                    RptObject *rptobj,
                                                    xmlNode *xnode);
+static void rpt_report_rptprint_eval_source (RptReport *rpt_report,
+                                             const gchar *source,
+                                             const RptFormat *format,
+                                             xmlNode *xnode);
+static void rpt_report_rptprint_format_field (RptReport *rpt_report,
+                                              EmitObject *emit,
+                                              xmlNode *xnode);
+static void rpt_report_rptprint_set_content (xmlNode *xnode, const gchar *content);
+static void rpt_report_rptprint_set_text (xmlNode *xnode, const gchar *text, gsize len);
+static gunichar rpt_report_entity_char (const gchar *name, gsize len);
+static void rpt_report_append_value (GString *buf, const GValue *gval, gboolean escape);
+static void rpt_report_append_escaped (GString *buf, const gchar *str);
+static void rpt_report_append_escaped_len (GString *buf, const gchar *str, gsize len);
+static gboolean rpt_report_decode_entities (const gchar *content, GString *buf);
+static gchar *rpt_report_eval_string (RptReport *rpt_report, const gchar *source);
+static gchar *rpt_report_parse (RptReport *rpt_report, const gchar *source);
+
+static Subreport *rpt_report_subreport_new (RptReport *rpt_report,
+                                            RptObject *rptobj,
+                                            gdouble x);
+static void rpt_report_subreport_free (Subreport *sub);
+static gdouble rpt_report_rptprint_subreport (RptReport *rpt_report,
+                                              Subreport *sub,
+                                              gdouble y,
+                                              gdouble max_height,
+                                              xmlNode *xband);
+static gint rpt_report_get_field_column (RptReport *rpt_report,
+                                         const gchar *field_name);
+static const GValue *rpt_report_get_field_value (RptReport *rpt_report,
+                                                 const gchar *field_name);
+static gboolean rpt_report_append_field (RptReport *rpt_report,
+                                         GString *buf,
+                                         const gchar *field_name,
+                                         gboolean escape);
 
 static void rpt_report_change_specials (RptReport *rpt_report, xmlDoc *xdoc);
+static gboolean rpt_report_uses_pages (RptReport *rpt_report);
+static void rpt_report_rptprint_drop_pages (RptReport *rpt_report, xmlDoc *xdoc);
+
+static GStringChunk *rpt_report_scratch_get (void);
+static GString *rpt_report_value_buffer_get (void);
+static void rpt_report_value_buffer_free (gpointer data);
+
+static gchar *rpt_report_str_replace_take (gchar *string,
+                                           const gchar *origin,
+                                           gchar *replace);
 
 
 #define RPT_REPORT_GET_PRIVATE(obj) (G_TYPE_INSTANCE_GET_PRIVATE ((obj), TYPE_RPT_REPORT, RptReportPrivate))
@@ -157,11 +355,22 @@ struct _RptReportPrivate
 		eRptOutputType output_type;
 		gchar *output_filename;
 
+		/* the directory of the definition's file, for the subreports */
+		gchar *base_dir;
+
 		guint copies;
 
 		RptTranslation *translation;
 
+		/* the pages generated, starting from 1; 0 for no limit */
+		guint page_first;
+		guint page_last;
+
 		Database *db;
+		/* the Parameters bound to the query, in declaration order */
+		GPtrArray *parameters;
+		/* the batches fetched in a thread while laying out; 0 for none */
+		guint prefetch;
 
 		Page *page;
 		ReportHeader *report_header;
@@ -170,13 +379,45 @@ struct _RptReportPrivate
 		PageFooter *page_footer;
 		Body *body;
 
+		/* name -> RptObject, the keys are owned by objects_index */
+		GHashTable *objects_by_name;
+		/* RptObject -> ObjectIndex */
+		GHashTable *objects_index;
+
+		/* sections compiled for the current rpt_report_get_xml_rptprint () */
+		EmitBand *emit_bands[RPTREPORT_SECTION_BODY + 1];
+
+		/* the time the current rpt_report_get_xml_rptprint () started at,
+		 * and the @Date and @Time specials already formatted with it */
+		GDateTime *run_time;
+		GHashTable *specials;
+
 		guint cur_page;
-		gint cur_row;
-		GtkTreeIter *cur_iter;
+		/* while a body band is built, @Page is left in its texts and
+		 * written when the band is placed, maybe on the next page */
+		gboolean defer_page;
+
+		/* the row whose fields are read */
+		RptDataBatch *cur_batch;
+		guint cur_batch_row;
 	};
 
 G_DEFINE_TYPE (RptReport, rpt_report, G_TYPE_OBJECT)
 
+/* strings made by the lexer and the parser while evaluating sources;
+ * every thread has its own arena, so a thread that releases it doesn't
+ * touch the strings of a run going on in another thread */
+static GPrivate scratch = G_PRIVATE_INIT ((GDestroyNotify)g_string_chunk_free);
+
+/* where a value is written before it becomes a node's content; reused for
+ * every value, so a value costs no allocation */
+static GPrivate value_buffer = G_PRIVATE_INIT (rpt_report_value_buffer_free);
+
+/* how many sources the thread is parsing: a field-request handler can
+ * evaluate a source while another one is parsed, and the arena must be
+ * kept until the outer one ends */
+static GPrivate parse_depth;
+
 static void
 rpt_report_class_init (RptReportClass *klass)
 {
@@ -186,6 +427,8 @@ rpt_report_class_init (RptReportClass *klass)
 
 	object_class->set_property = rpt_report_set_property;
 	object_class->get_property = rpt_report_get_property;
+	object_class->dispose = rpt_report_dispose;
+	object_class->finalize = rpt_report_finalize;
 
 	g_object_class_install_property (object_class, PROP_UNIT_LENGTH,
 	                                 g_param_spec_int ("unit-length",
@@ -218,8 +461,9 @@ rpt_report_class_init (RptReportClass *klass)
 	 * @field_name: the name of the field requested.
 	 * @data_model: a #GdaDataModel; or NULL if there's no database source.
 	 * @row: the current @data_model's row; -1 if @data_model is NULL.
-	 * @treemodel: a #GtkTreeModel; or NULL if there's no #GtkTreeModel source.
-	 * @iter: a #GtkTreeIter; or NULL if @treemodel is NULL.
+	 * @treemodel: the rows' source set by libreptool-gtk (a #GtkTreeModel);
+	 * or NULL if there's no such source.
+	 * @iter: the current row of @treemodel (a #GtkTreeIter); or NULL if @treemodel is NULL.
 	 *
 	 * The signal is emitted each time there's into text's attribute source
 	 * a field that doesn't exists.
@@ -247,10 +491,13 @@ rpt_report_init (RptReport *rpt_report)
 
 	priv->output_type = RPT_OUTPUT_PDF;
 	priv->output_filename = g_strdup ("rptreport.pdf");
+	priv->base_dir = NULL;
 	priv->copies = 1;
 	priv->translation = NULL;
 
 	priv->db = NULL;
+	priv->parameters = g_ptr_array_new_with_free_func ((GDestroyNotify)rpt_report_parameter_free);
+	priv->prefetch = 0;
 
 	priv->page = (Page *)g_malloc0 (sizeof (Page));
 
@@ -267,8 +514,63 @@ rpt_report_init (RptReport *rpt_report)
 	priv->body->objects = NULL;
 	priv->body->new_page_after = FALSE;
 
-	priv->cur_row = -1;
-	priv->cur_iter = NULL;
+	priv->objects_by_name = g_hash_table_new (g_str_hash, g_str_equal);
+	priv->objects_index = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+	                                             NULL, (GDestroyNotify)rpt_report_object_index_free);
+
+	priv->cur_batch = NULL;
+}
+
+static void
+rpt_report_dispose (GObject *object)
+{
+	RptReport *rpt_report = RPT_REPORT (object);
+
+	RptReportPrivate *priv = RPT_REPORT_GET_PRIVATE (rpt_report);
+
+	rpt_report_rptprint_templates_free (rpt_report);
+
+	rpt_report_section_remove (rpt_report, RPTREPORT_SECTION_REPORT_HEADER);
+	rpt_report_section_remove (rpt_report, RPTREPORT_SECTION_REPORT_FOOTER);
+	rpt_report_section_remove (rpt_report, RPTREPORT_SECTION_PAGE_HEADER);
+	rpt_report_section_remove (rpt_report, RPTREPORT_SECTION_PAGE_FOOTER);
+	if (priv->body != NULL)
+		{
+			rpt_report_section_free_objects (rpt_report, priv->body->objects);
+			priv->body->objects = NULL;
+			priv->body->objects_last = NULL;
+		}
+
+	rpt_report_database_free (priv->db);
+	priv->db = NULL;
+
+	G_OBJECT_CLASS (rpt_report_parent_class)->dispose (object);
+}
+
+static void
+rpt_report_finalize (GObject *object)
+{
+	RptReport *rpt_report = RPT_REPORT (object);
+
+	RptReportPrivate *priv = RPT_REPORT_GET_PRIVATE (rpt_report);
+
+	g_free (priv->name);
+	g_free (priv->description);
+	g_free (priv->output_filename);
+	g_free (priv->base_dir);
+	g_free (priv->translation);
+
+	g_free (priv->page->size);
+	g_free (priv->page->margin);
+	g_free (priv->page);
+	g_free (priv->body);
+
+	g_hash_table_destroy (priv->objects_by_name);
+	g_hash_table_destroy (priv->objects_index);
+
+	g_ptr_array_free (priv->parameters, TRUE);
+
+	G_OBJECT_CLASS (rpt_report_parent_class)->finalize (object);
 }
 
 /**
@@ -288,509 +590,380 @@ RptReport
 	return rpt_report;
 }
 
+/**
+ * rpt_report_error_quark:
+ *
+ * Returns: the #GQuark of the #RptReport errors.
+ */
+GQuark
+rpt_report_error_quark (void)
+{
+	return g_quark_from_static_string ("rpt-report-error-quark");
+}
+
 /**
  * rpt_report_new_from_file:
  * @filename: the path of the xml file to load.
  *
- * Returns: the newly created #RptReport object.
+ * Returns: the newly created #RptReport object; NULL, after a warning, if
+ * the file isn't a valid report definition.
  */
 RptReport
 *rpt_report_new_from_file (const gchar *filename)
 {
-	RptReport *rpt_report = NULL;
+	RptReport *rpt_report;
+	GError *error;
 
-	xmlDoc *xdoc = xmlParseFile (filename);
-	if (xdoc != NULL)
+	error = NULL;
+	rpt_report = rpt_report_new_from_file_full (filename, &error);
+	if (rpt_report == NULL)
 		{
-			rpt_report = rpt_report_new_from_xml (xdoc);
+			g_warning ("%s", error != NULL && error->message != NULL ? error->message : "Unable to load the report definition.");
+			if (error != NULL) g_error_free (error);
 		}
 
 	return rpt_report;
 }
 
 /**
- * rpt_report_new_from_xml:
- * @xdoc: an #xmlDoc.
+ * rpt_report_new_from_file_full:
+ * @filename: the path of the xml file to load.
+ * @error: return location for a #GError, or NULL.
  *
- * Returns: the newly created #RptReport object.
+ * @filename can also be a template compiled with rpt_report_compile_file():
+ * it's recognized from its content, not from the extension.
+ *
+ * Returns: the newly created #RptReport object; NULL, with @error set, if
+ * the file cannot be parsed or isn't a valid report definition.
  */
 RptReport
-*rpt_report_new_from_xml (xmlDoc *xdoc)
+*rpt_report_new_from_file_full (const gchar *filename, GError **error)
 {
-	RptReport *rpt_report = NULL;
+	RptReport *rpt_report;
+	xmlDoc *xdoc;
+
+	g_return_val_if_fail (filename != NULL, NULL);
 
-	xmlNode *cur = xmlDocGetRootElement (xdoc);
-	if (cur != NULL)
+	xdoc = rpt_report_read_file (filename, TRUE, error);
+	if (xdoc == NULL)
 		{
-			if (g_strcmp0 (cur->name, "reptool") == 0)
-				{
-					xmlXPathContextPtr xpcontext;
-					xmlXPathObjectPtr xpresult;
-					xmlNodeSetPtr xnodeset;
-					RptReportPrivate *priv;
+			return NULL;
+		}
 
-					rpt_report = rpt_report_new ();
+	rpt_report = rpt_report_new_from_xml_full (xdoc, error);
+	xmlFreeDoc (xdoc);
 
-					priv = RPT_REPORT_GET_PRIVATE (rpt_report);
+	if (rpt_report != NULL)
+		{
+			/* the subreports' paths are relative to the file */
+			RPT_REPORT_GET_PRIVATE (rpt_report)->base_dir = g_path_get_dirname (filename);
+		}
 
-					/* search for node "properties" */
-					xmlNode *xnodeprop = rpt_report_rptprint_get_properties_node (xdoc);
-					if (xnodeprop != NULL)
-						{
-							xmlNode *cur_property = xnodeprop->children;
-							while (cur_property != NULL)
-								{
-									if (g_strcmp0 (cur_property->name, "name") == 0)
-										{
-											g_object_set (G_OBJECT (rpt_report), "name", (const gchar *)xmlNodeGetContent (cur_property), NULL);
-										}
-									else if (g_strcmp0 (cur_property->name, "description") == 0)
-										{
-											g_object_set (G_OBJECT (rpt_report), "description", (const gchar *)xmlNodeGetContent (cur_property), NULL);
-										}
-									else if (g_strcmp0 (cur_property->name, "unit-length") == 0)
-										{
-											g_object_set (G_OBJECT (rpt_report), "unit-length", rpt_common_strunit_to_enum ((const gchar *)xmlNodeGetContent (cur_property)), NULL);
-										}
-									else if (g_strcmp0 (cur_property->name, "output-type") == 0)
-										{
-											rpt_report_set_output_type (rpt_report, rpt_common_stroutputtype_to_enum ((const gchar *)xmlNodeGetContent (cur_property)));
-										}
-									else if (g_strcmp0 (cur_property->name, "output-filename") == 0)
-										{
-											rpt_report_set_output_filename (rpt_report, (const gchar *)xmlNodeGetContent (cur_property));
-										}
-									else if (g_strcmp0 (cur_property->name, "copies") == 0)
-										{
-											rpt_report_set_copies (rpt_report, strtol ((const gchar *)xmlNodeGetContent (cur_property), NULL, 10));
-										}
-									else if (g_strcmp0 (cur_property->name, "translation") == 0)
-										{
-											rpt_report_set_translation (rpt_report, rpt_common_get_translation (cur_property));
-										}
+	return rpt_report;
+}
 
-									cur_property = cur_property->next;
-								}
-						}
+/**
+ * rpt_report_new_from_xml:
+ * @xdoc: an #xmlDoc.
+ *
+ * Returns: the newly created #RptReport object; NULL, after a warning, if
+ * @xdoc isn't a valid report definition.
+ */
+RptReport
+*rpt_report_new_from_xml (xmlDoc *xdoc)
+{
+	RptReport *rpt_report;
+	GError *error;
 
-					/* search for node "database" */
-					xpcontext = xmlXPathNewContext (xdoc);
-					xpcontext->node = cur;
-					xpresult = xmlXPathEvalExpression ((const xmlChar *)"child::database", xpcontext);
-					if (!xmlXPathNodeSetIsEmpty (xpresult->nodesetval))
-						{
-							xnodeset = xpresult->nodesetval;
-							if (xnodeset->nodeNr == 1)
-								{
-									gchar *provider_id;
-									gchar *connection_string;
-									gchar *sql;
+	error = NULL;
+	rpt_report = rpt_report_new_from_xml_full (xdoc, &error);
+	if (rpt_report == NULL)
+		{
+			g_warning ("%s", error != NULL && error->message != NULL ? error->message : "Unable to load the report definition.");
+			if (error != NULL) g_error_free (error);
+		}
 
-									xmlNode *cur_database = xnodeset->nodeTab[0]->children;
-									while (cur_database != NULL)
-										{
-											if (g_strcmp0 (cur_database->name, "provider") == 0)
-												{
-													provider_id = g_strstrip ((gchar *)xmlNodeGetContent (cur_database));
-												}
-											else if (g_strcmp0 (cur_database->name, "connection-string") == 0)
-												{
-													connection_string = g_strstrip ((gchar *)xmlNodeGetContent (cur_database));
-												}
-											else if (g_strcmp0 (cur_database->name, "sql") == 0)
-												{
-													sql = g_strstrip ((gchar *)xmlNodeGetContent (cur_database));
-												}
-											
-											cur_database = cur_database->next;
-										}
+	return rpt_report;
+}
 
-									if (g_strcmp0 (provider_id, "") == 0 ||
-										g_strcmp0 (connection_string, "") == 0 ||
-										g_strcmp0 (sql, "") == 0)
-										{
-											/* TO DO */
-										}
-									else
-										{
-											rpt_report_set_database (rpt_report, provider_id, connection_string, sql);
-										}
+/**
+ * rpt_report_new_from_xml_full:
+ * @xdoc: an #xmlDoc.
+ * @error: return location for a #GError, or NULL.
+ *
+ * Loads the report definition with a single walk of the tree; nothing
+ * aborts the process, every problem is returned in @error.
+ *
+ * Returns: the newly created #RptReport object; NULL, with @error set, if
+ * @xdoc isn't a valid report definition.
+ */
+RptReport
+*rpt_report_new_from_xml_full (xmlDoc *xdoc, GError **error)
+{
+	RptReport *rpt_report;
 
-									g_free (provider_id);
-									g_free (connection_string);
-									g_free (sql);
-								}
-						}
+	xmlNode *cur;
+	xmlNode *xproperties;
+	xmlNode *xdatabase;
+	xmlNode *xparameters;
+	xmlNode *xpage;
+	xmlNode *xreport;
+	gboolean ok;
 
-					/* search for node "page" */
-					xpcontext->node = cur;
-					xpresult = xmlXPathEvalExpression ((const xmlChar *)"child::page", xpcontext);
-					if (!xmlXPathNodeSetIsEmpty (xpresult->nodesetval))
-						{
-							xnodeset = xpresult->nodesetval;
-							if (xnodeset->nodeNr == 1)
-								{
-									gchar *prop;
-									gdouble margin_top = 0.0;
-									gdouble margin_right = 0.0;
-									gdouble margin_bottom = 0.0;
-									gdouble margin_left = 0.0;
-									RptSize *size;
-
-									size = rpt_common_get_size (xnodeset->nodeTab[0]);
-									rpt_report_set_page_size (rpt_report, *size);
-
-									prop = xmlGetProp (xnodeset->nodeTab[0], "margin-top");
-									if (prop != NULL)
-										{
-											margin_top = g_strtod (prop, NULL);
-											xmlFree (prop);
-										}
-									prop = xmlGetProp (xnodeset->nodeTab[0], "margin-right");
-									if (prop != NULL)
-										{
-											margin_right = g_strtod (prop, NULL);
-											xmlFree (prop);
-										}
-									prop = xmlGetProp (xnodeset->nodeTab[0], "margin-bottom");
-									if (prop != NULL)
-										{
-											margin_bottom = g_strtod (prop, NULL);
-											xmlFree (prop);
-										}
-									prop = xmlGetProp (xnodeset->nodeTab[0], "margin-left");
-									if (prop != NULL)
-										{
-											margin_left = g_strtod (prop, NULL);
-											xmlFree (prop);
-										}
-									rpt_report_set_page_margins (rpt_report, margin_top, margin_right, margin_bottom, margin_left);
-								}
-							else
-								{
-									/* TO DO */
-									/* return */
-									g_error ("Node «page» is missing");
-								}
-						}
-					else
-						{
-							/* TO DO */
-							/* return */
-							g_error ("Node «page» is missing");
-						}
+	g_return_val_if_fail (xdoc != NULL, NULL);
 
-					/* search for node "report" */
-					xpcontext->node = cur;
-					xpresult = xmlXPathEvalExpression ((const xmlChar *)"child::report", xpcontext);
-					if (!xmlXPathNodeSetIsEmpty (xpresult->nodesetval))
-						{
-							xnodeset = xpresult->nodesetval;
-							if (xnodeset->nodeNr == 1)
-								{
-									/* search for node "report-header" */
-									xpcontext->node = xnodeset->nodeTab[0];
-									xpresult = xmlXPathEvalExpression ((const xmlChar *)"child::report-header", xpcontext);
-									if (!xmlXPathNodeSetIsEmpty (xpresult->nodesetval) && xpresult->nodesetval->nodeNr == 1)
-										{
-											rpt_report_section_create (rpt_report, RPTREPORT_SECTION_REPORT_HEADER);
-											rpt_report_xml_parse_section (rpt_report, xpresult->nodesetval->nodeTab[0], RPTREPORT_SECTION_REPORT_HEADER);
-										}
+	cur = xmlDocGetRootElement (xdoc);
+	if (cur == NULL || g_strcmp0 (cur->name, "reptool") != 0)
+		{
+			g_set_error (error, RPT_REPORT_ERROR, RPT_REPORT_ERROR_INVALID_ROOT,
+			             "The file is not a valid reptool report definition file.");
+			return NULL;
+		}
 
-									/* search for node "report-footer" */
-									xpcontext->node = xnodeset->nodeTab[0];
-									xpresult = xmlXPathEvalExpression ((const xmlChar *)"child::report-footer", xpcontext);
-									if (!xmlXPathNodeSetIsEmpty (xpresult->nodesetval) && xpresult->nodesetval->nodeNr == 1)
-										{
-											rpt_report_section_create (rpt_report, RPTREPORT_SECTION_REPORT_FOOTER);
-											rpt_report_xml_parse_section (rpt_report, xpresult->nodesetval->nodeTab[0], RPTREPORT_SECTION_REPORT_FOOTER);
-										}
+	rpt_report = rpt_report_new ();
 
-									/* search for node "page-header" */
-									xpcontext->node = xnodeset->nodeTab[0];
-									xpresult = xmlXPathEvalExpression ((const xmlChar *)"child::page-header", xpcontext);
-									if (!xmlXPathNodeSetIsEmpty (xpresult->nodesetval) && xpresult->nodesetval->nodeNr == 1)
-										{
-											rpt_report_section_create (rpt_report, RPTREPORT_SECTION_PAGE_HEADER);
-											rpt_report_xml_parse_section (rpt_report, xpresult->nodesetval->nodeTab[0], RPTREPORT_SECTION_PAGE_HEADER);
-										}
+	xproperties = NULL;
+	xdatabase = NULL;
+	xparameters = NULL;
+	xpage = NULL;
+	xreport = NULL;
 
-									/* search for node "page-footer" */
-									xpcontext->node = xnodeset->nodeTab[0];
-									xpresult = xmlXPathEvalExpression ((const xmlChar *)"child::page-footer", xpcontext);
-									if (!xmlXPathNodeSetIsEmpty (xpresult->nodesetval) && xpresult->nodesetval->nodeNr == 1)
-										{
-											rpt_report_section_create (rpt_report, RPTREPORT_SECTION_PAGE_FOOTER);
-											rpt_report_xml_parse_section (rpt_report, xpresult->nodesetval->nodeTab[0], RPTREPORT_SECTION_PAGE_FOOTER);
-										}
+	ok = TRUE;
+	for (cur = cur->children; cur != NULL && ok; cur = cur->next)
+		{
+			if (cur->type != XML_ELEMENT_NODE)
+				{
+					continue;
+				}
 
-									/* search for node "body" */
-									xpcontext->node = xnodeset->nodeTab[0];
-									xpresult = xmlXPathEvalExpression ((const xmlChar *)"child::body", xpcontext);
-									if (!xmlXPathNodeSetIsEmpty (xpresult->nodesetval) && xpresult->nodesetval->nodeNr == 1)
-										{
-											rpt_report_xml_parse_section (rpt_report, xpresult->nodesetval->nodeTab[0], RPTREPORT_SECTION_BODY);
-										}
-									else
-										{
-											/* TO DO */
-											/* return */
-											g_error ("Node «body» is missing");
-										}
-								}
-							else
-								{
-									/* TO DO */
-									/* return */
-									g_error ("Only one node «report» is allowed");
-								}
+			if (g_strcmp0 (cur->name, "properties") == 0)
+				{
+					ok = rpt_report_xml_check_once (cur, &xproperties, error);
+					if (ok)
+						{
+							rpt_report_xml_parse_properties (rpt_report, cur);
 						}
-					else
+				}
+			else if (g_strcmp0 (cur->name, "database") == 0)
+				{
+					ok = rpt_report_xml_check_once (cur, &xdatabase, error);
+					if (ok)
 						{
-							/* TO DO */
-							/* return */
-							g_error ("Node «report» is missing");
+							rpt_report_xml_parse_database (rpt_report, cur);
 						}
 				}
-			else
+			else if (g_strcmp0 (cur->name, "parameters") == 0)
 				{
-					/* TO DO */
-					g_warning ("The file is not a valid reptool report definition file.");
+					ok = rpt_report_xml_check_once (cur, &xparameters, error)
+					     && rpt_report_xml_parse_parameters (rpt_report, cur, error);
+				}
+			else if (g_strcmp0 (cur->name, "page") == 0)
+				{
+					ok = rpt_report_xml_check_once (cur, &xpage, error)
+					     && rpt_report_xml_parse_page (rpt_report, cur, error);
+				}
+			else if (g_strcmp0 (cur->name, "report") == 0)
+				{
+					ok = rpt_report_xml_check_once (cur, &xreport, error)
+					     && rpt_report_xml_parse_report (rpt_report, cur, error);
 				}
 		}
 
+	if (ok && xpage == NULL)
+		{
+			g_set_error (error, RPT_REPORT_ERROR, RPT_REPORT_ERROR_MISSING_NODE,
+			             "Node «page» is missing.");
+			ok = FALSE;
+		}
+	if (ok && xreport == NULL)
+		{
+			g_set_error (error, RPT_REPORT_ERROR, RPT_REPORT_ERROR_MISSING_NODE,
+			             "Node «report» is missing.");
+			ok = FALSE;
+		}
+
+	if (!ok)
+		{
+			g_object_unref (rpt_report);
+			rpt_report = NULL;
+		}
+
 	return rpt_report;
 }
 
 /**
- * rpt_report_new_from_gtktreeview:
- * @view:
- * @title:
+ * rpt_report_copy:
+ * @rpt_report: an #RptReport object.
+ *
+ * Creates a new #RptReport with the properties, the page, the database
+ * and the sections of @rpt_report, without parsing anything again. The
+ * objects aren't copied until they're needed: the two reports share them,
+ * and the first time rpt_report_get_object_from_name() or
+ * rpt_report_section_get_objects() hand out a shared object, the report
+ * replaces it with a copy of its own, so that changing it doesn't change
+ * the other report. The reports themselves are independent, and objects
+ * can be added to or removed from each one.
  *
  * Returns: the newly created #RptReport object.
  */
 RptReport
-*rpt_report_new_from_gtktreeview (GtkTreeView *view,
-                                  const gchar *title)
+*rpt_report_copy (RptReport *rpt_report)
 {
-	RptReport *ret;
-
-	GtkStyle *style;
-	PangoFontDescription *pango_font;
-
-	GList *columns;
-	GHashTable *columns_names;
-
-	GList *lst_cells;
-
-	RptSize *page_size;
-	RptMargin *page_margin;
-
-	RptPoint *point;
-	RptSize *size;
-	RptFont *font;
-	RptAlign *align;
-	RptObject *obj;
+	RptReport *copy;
+	RptReportSection section;
+	GList **objects;
+	GList **objects_last;
+	GList *cur;
+	ObjectIndex *index;
+	Parameter *param;
+	guint i;
 
-	guint x;
-	GtkTreeViewColumn *col;
-	gfloat col_width;
-	const gchar *col_title;
-	gchar *field_name;
+	g_return_val_if_fail (IS_RPT_REPORT (rpt_report), NULL);
 
-	guint idx;
-	gint col_idx;
-	gpointer ptr_col_idx;
+	RptReportPrivate *priv = RPT_REPORT_GET_PRIVATE (rpt_report);
 
-	gint iheight;
-	gdouble height;
+	copy = rpt_report_new ();
 
-	g_return_val_if_fail (GTK_IS_TREE_VIEW (view), NULL);
+	RptReportPrivate *priv_copy = RPT_REPORT_GET_PRIVATE (copy);
 
-	style = gtk_widget_get_style (GTK_WIDGET (view));
-	pango_font = pango_font_description_copy (style->font_desc);
-	if (pango_font == NULL)
+	g_free (priv_copy->name);
+	priv_copy->name = g_strdup (priv->name);
+	g_free (priv_copy->description);
+	priv_copy->description = g_strdup (priv->description);
+	priv_copy->unit = priv->unit;
+	priv_copy->output_type = priv->output_type;
+	g_free (priv_copy->output_filename);
+	priv_copy->output_filename = g_strdup (priv->output_filename);
+	priv_copy->base_dir = g_strdup (priv->base_dir);
+	priv_copy->copies = priv->copies;
+	if (priv->translation != NULL)
 		{
-			g_warning ("No font from GtkTreeView. Default to Arial 10.");
-
-			pango_font = pango_font_description_new ();
-			pango_font_description_set_family (pango_font, "Arial");
-			pango_font_description_set_absolute_size (pango_font, 10 * PANGO_SCALE);
+			priv_copy->translation = rpt_common_rpttranslation_new_with_values (priv->translation->x, priv->translation->y);
 		}
-
-	ret = rpt_report_new ();
-
-	columns = gtk_tree_view_get_columns (view);
-	if (columns == NULL) return NULL;
-
-	/* find the height to use as defaul height from gtkcellrenderer */
-	lst_cells = gtk_cell_layout_get_cells (GTK_CELL_LAYOUT (columns->data));
-	gtk_cell_renderer_get_size ((GtkCellRenderer *)lst_cells->data, GTK_WIDGET (view),
-	                            NULL, NULL, NULL, NULL, &iheight);
-	height = rpt_common_points_to_value (RPT_UNIT_MILLIMETRE, (iheight * 72.0) / 96.0);
-
-	g_object_set (G_OBJECT (ret), "unit-length", RPT_UNIT_MILLIMETRE, NULL);
-
-	page_size = rpt_common_rptsize_new_with_values (297, 210);
-	rpt_report_set_page_size (ret, *page_size);
-
-	page_margin = rpt_common_rptmargin_new_with_values (10, 10, 10, 10);
-	rpt_report_set_page_margins_struct (ret, *page_margin);
-
-	rpt_report_set_section_height (ret, RPTREPORT_SECTION_PAGE_HEADER, (height * 3) + 2);
-	rpt_report_set_page_header_first_last_page (ret, TRUE, TRUE);
-
-	rpt_report_set_section_height (ret, RPTREPORT_SECTION_BODY, height);
-
-	if (title != NULL)
+	priv_copy->page_first = priv->page_first;
+	priv_copy->page_last = priv->page_last;
+	priv_copy->prefetch = priv->prefetch;
+
+	/* only the definition: the connections and the models belong to a run */
+	if (priv->db != NULL
+	    && priv->db->provider_id != NULL
+	    && priv->db->connection_string != NULL
+	    && priv->db->sql != NULL)
 		{
-			point = rpt_common_rptpoint_new_with_values (0, 0);
-			obj = rpt_obj_text_new ("title", *point);
-
-			size = rpt_common_rptsize_new_with_values (page_size->width - page_margin->left - page_margin->right, height);
-			font = rpt_common_rptfont_from_pango_description (pango_font);
-			font->size += 2;
-			font->bold = TRUE;
-
-			g_object_set (obj,
-			              "source", title,
-			              "size", size,
-			              "font", font,
-			              NULL);
+			rpt_report_set_database (copy, priv->db->provider_id, priv->db->connection_string, priv->db->sql);
+		}
+	for (i = 0; i < priv->parameters->len; i++)
+		{
+			param = (Parameter *)g_ptr_array_index (priv->parameters, i);
+			rpt_report_parameter_add (copy, param->name, param->type);
+			rpt_report_set_parameter (copy, param->name, param->value);
+		}
 
-			g_free (point);
-			g_free (size);
+	*priv_copy->page->size = *priv->page->size;
+	*priv_copy->page->margin = *priv->page->margin;
 
-			rpt_report_add_object_to_section (ret, obj, RPTREPORT_SECTION_PAGE_HEADER);
+	if (priv->report_header != NULL)
+		{
+			rpt_report_section_create (copy, RPTREPORT_SECTION_REPORT_HEADER);
+			*priv_copy->report_header = *priv->report_header;
 		}
+	if (priv->report_footer != NULL)
+		{
+			rpt_report_section_create (copy, RPTREPORT_SECTION_REPORT_FOOTER);
+			*priv_copy->report_footer = *priv->report_footer;
+		}
+	if (priv->page_header != NULL)
+		{
+			rpt_report_section_create (copy, RPTREPORT_SECTION_PAGE_HEADER);
+			*priv_copy->page_header = *priv->page_header;
+		}
+	if (priv->page_footer != NULL)
+		{
+			rpt_report_section_create (copy, RPTREPORT_SECTION_PAGE_FOOTER);
+			*priv_copy->page_footer = *priv->page_footer;
+		}
+	*priv_copy->body = *priv->body;
 
-	columns_names = g_hash_table_new (g_str_hash, g_str_equal);
-
-	x = 0;
-	idx = 0;
-	while (columns != NULL)
+	for (section = RPTREPORT_SECTION_REPORT_HEADER; section <= RPTREPORT_SECTION_BODY; section++)
 		{
-			col = (GtkTreeViewColumn *)columns->data;
+			if (!rpt_report_section_get_object_list (copy, section, &objects, &objects_last))
+				{
+					continue;
+				}
 
-			if (gtk_tree_view_column_get_visible (col))
+			/* the lists were copied with the sections, they are rebuilt */
+			cur = *objects;
+			*objects = NULL;
+			*objects_last = NULL;
+			for (; cur != NULL; cur = cur->next)
 				{
-					col_title = g_strdup_printf ("\"%s\"", gtk_tree_view_column_get_title (col));
-					col_width = rpt_common_points_to_value (RPT_UNIT_MILLIMETRE, (gtk_tree_view_column_get_width (col) * 72.0) / 96.0);
+					rpt_report_add_object_to_section (copy, RPT_OBJECT (g_object_ref (cur->data)), section);
 
-					point = rpt_common_rptpoint_new_with_values (x, height * 2);
-					if (columns->next == NULL && x < page_size->width)
+					index = (ObjectIndex *)g_hash_table_lookup (priv_copy->objects_index, cur->data);
+					if (index != NULL)
 						{
-							/* the last column is always large until the end of the page */
-							size = rpt_common_rptsize_new_with_values ((page_size->width - page_margin->left - page_margin->right) - x, height);
+							index->shared = TRUE;
 						}
-					else
+					index = (ObjectIndex *)g_hash_table_lookup (priv->objects_index, cur->data);
+					if (index != NULL)
 						{
-							size = rpt_common_rptsize_new_with_values (col_width, height);
+							index->shared = TRUE;
 						}
-					font = rpt_common_rptfont_from_pango_description (pango_font);
-					font->bold = TRUE;
+				}
+		}
 
-					obj = rpt_obj_text_new (g_strdup_printf ("title_%d", idx), *point);
+	return copy;
+}
 
-					g_object_set (obj,
-					              "source", col_title,
-					              "size", size,
-					              "font", font,
-					              NULL);
+/**
+ * rpt_report_compile_file:
+ * @filename: the path of the xml file to compile.
+ * @output_filename: the path of the compiled template to write.
+ * @error: return location for a #GError, or NULL.
+ *
+ * Checks that @filename is a valid report definition and writes it as a
+ * compiled template, that rpt_report_new_from_file_full() (and so the
+ * template cache) loads by mapping it, without parsing any xml: the tree
+ * is rebuilt from the file's strings' table, so the text isn't scanned,
+ * and entities and whitespace aren't decoded again. The objects are then
+ * built from the tree as from an xml file.
+ *
+ * A compiled template is tied to the version of the library that wrote
+ * it (the package version, e.g. 0.5.0), and to the byte order of the
+ * machine: the others refuse it with #RPT_REPORT_ERROR_VERSION_MISMATCH,
+ * and it must be compiled again.
+ *
+ * Returns: TRUE on success.
+ */
+gboolean
+rpt_report_compile_file (const gchar *filename,
+                         const gchar *output_filename,
+                         GError **error)
+{
+	RptReport *rpt_report;
+	xmlDoc *xdoc;
+	gboolean ret;
 
-					rpt_report_add_object_to_section (ret, obj, RPTREPORT_SECTION_PAGE_HEADER);
+	g_return_val_if_fail (filename != NULL, FALSE);
+	g_return_val_if_fail (output_filename != NULL, FALSE);
 
-					g_free (point);
+	xdoc = rpt_report_read_file (filename, FALSE, error);
+	if (xdoc == NULL)
+		{
+			return FALSE;
+		}
 
-					point = rpt_common_rptpoint_new_with_values (x, 0);
-					font = rpt_common_rptfont_from_pango_description (pango_font);
-
-					field_name = g_strdup_printf ("field_%d", idx);
-					obj = rpt_obj_text_new (field_name, *point);
-
-					g_object_set (obj,
-					              "source", g_strdup_printf ("[%s]", field_name),
-					              "size", size,
-					              "font", font,
-					              "ellipsize", RPT_ELLIPSIZE_END,
-					              NULL);
-
-					rpt_report_add_object_to_section (ret, obj, RPTREPORT_SECTION_BODY);
-
-					g_free (point);
-					g_free (size);
-
-					/* it's not possible to read column attribute that represents the source from liststore */
-					col_idx = idx;
-					ptr_col_idx = g_object_get_data (G_OBJECT (col), "rpt_text_col_idx");
-					if (ptr_col_idx != NULL)
-						{
-							col_idx = strtol ((gchar *)ptr_col_idx, NULL, 10);
-						}
-
-					g_hash_table_insert (columns_names, field_name, g_strdup_printf ("%d", col_idx));
-
-					x += col_width;
-				}
-
-			idx++;
-
-			columns = g_list_next (columns);
+	/* only valid definitions are compiled */
+	rpt_report = rpt_report_new_from_xml_full (xdoc, error);
+	if (rpt_report == NULL)
+		{
+			xmlFreeDoc (xdoc);
+			return FALSE;
 		}
+	g_object_unref (rpt_report);
 
-	point = rpt_common_rptpoint_new_with_values (0, (height * 3) + 1);
-	obj = rpt_obj_line_new ("line1", *point);
-
-	size = rpt_common_rptsize_new_with_values (page_size->width - page_margin->left - page_margin->right, 0);
-
-	g_object_set (obj,
-	              "size", size,
-	              NULL);
-
-	g_free (point);
-	g_free (size);
-
-	rpt_report_add_object_to_section (ret, obj, RPTREPORT_SECTION_PAGE_HEADER);
-
-	rpt_report_set_section_height (ret, RPTREPORT_SECTION_PAGE_FOOTER, height + 2);
-
-	point = rpt_common_rptpoint_new_with_values (0, 0);
-	obj = rpt_obj_line_new ("line2", *point);
-
-	size = rpt_common_rptsize_new_with_values (page_size->width - page_margin->left - page_margin->right, 0);
-
-	g_object_set (obj,
-	              "size", size,
-	              NULL);
-
-	g_free (point);
-	g_free (size);
-
-	rpt_report_add_object_to_section (ret, obj, RPTREPORT_SECTION_PAGE_FOOTER);
-	rpt_report_set_page_footer_first_last_page (ret, TRUE, TRUE);
-
-	point = rpt_common_rptpoint_new_with_values (0, 2);
-	obj = rpt_obj_text_new ("pages", *point);
-
-	size = rpt_common_rptsize_new_with_values (page_size->width - page_margin->left - page_margin->right, height);
-	align = rpt_common_rptalign_new ();
-	align->h_align = RPT_HALIGN_RIGHT;
-	font = rpt_common_rptfont_from_pango_description (pango_font);
-	font->size -= 1;
-
-	g_object_set (obj,
-	              "source", "\"Page \" & @Page & \" of \" & @Pages",
-	              "size", size,
-	              "font", font,
-	              "align", align,
-	              NULL);
-
-	g_free (point);
-	g_free (size);
-
-	rpt_report_add_object_to_section (ret, obj, RPTREPORT_SECTION_PAGE_FOOTER);
-
-	rpt_report_set_database_as_gtktreemodel (ret, gtk_tree_view_get_model (view), columns_names);
+	ret = rpt_compiled_write (xdoc, output_filename, error);
+	xmlFreeDoc (xdoc);
 
 	return ret;
 }
@@ -848,6 +1021,28 @@ rpt_report_set_copies (RptReport *rpt_report, guint copies)
 	priv->copies = copies;
 }
 
+/**
+ * rpt_report_set_page_range:
+ * @rpt_report:
+ * @first: the first page to generate, starting from 1; 0 for the first.
+ * @last: the last page to generate; 0 for the last.
+ *
+ * rpt_report_get_xml_rptprint() will return only the pages from @first
+ * to @last, and will stop the layout after @last, unless the report uses
+ * @Pages, that needs all the pages to be counted.
+ */
+void
+rpt_report_set_page_range (RptReport *rpt_report, guint first, guint last)
+{
+	g_return_if_fail (IS_RPT_REPORT (rpt_report));
+	g_return_if_fail (last == 0 || first <= last);
+
+	RptReportPrivate *priv = RPT_REPORT_GET_PRIVATE (rpt_report);
+
+	priv->page_first = first;
+	priv->page_last = last;
+}
+
 /**
  * rpt_report_set_translation:
  * @rpt_report:
@@ -880,16 +1075,16 @@ rpt_report_set_translation (RptReport *rpt_report, RptTranslation *translation)
 const gchar
 *rpt_report_database_get_provider (RptReport *rpt_report)
 {
-	gchar *ret = NULL;
+	const gchar *ret = NULL;
 
 	RptReportPrivate *priv = RPT_REPORT_GET_PRIVATE (rpt_report);
 
 	if (priv->db != NULL)
 		{
-			ret = g_strdup (priv->db->provider_id);
+			ret = priv->db->provider_id;
 		}
 
-	return (const gchar *)ret;
+	return ret;
 }
 
 /**
@@ -900,16 +1095,16 @@ const gchar
 const gchar
 *rpt_report_database_get_connection_string (RptReport *rpt_report)
 {
-	gchar *ret = NULL;
+	const gchar *ret = NULL;
 
 	RptReportPrivate *priv = RPT_REPORT_GET_PRIVATE (rpt_report);
 
 	if (priv->db != NULL)
 		{
-			ret = g_strdup (priv->db->connection_string);
+			ret = priv->db->connection_string;
 		}
 
-	return (const gchar *)ret;
+	return ret;
 }
 
 /**
@@ -920,16 +1115,16 @@ const gchar
 const gchar
 *rpt_report_database_get_sql (RptReport *rpt_report)
 {
-	gchar *ret = NULL;
+	const gchar *ret = NULL;
 
 	RptReportPrivate *priv = RPT_REPORT_GET_PRIVATE (rpt_report);
 
 	if (priv->db != NULL)
 		{
-			ret = g_strdup (priv->db->sql);
+			ret = priv->db->sql;
 		}
 
-	return (const gchar *)ret;
+	return ret;
 }
 
 /**
@@ -937,7 +1132,8 @@ const gchar
  * @rpt_report: an #RptReport object.
  * @provider_id: a libgda's provider_id.
  * @connection_string: a libgda's connection string.
- * @sql: a valid SQL statement.
+ * @sql: a valid SQL statement; its parameters are bound to the values
+ * given with rpt_report_set_parameter().
  *
  */
 void
@@ -948,19 +1144,18 @@ rpt_report_set_database (RptReport *rpt_report,
 {
 	RptReportPrivate *priv = RPT_REPORT_GET_PRIVATE (rpt_report);
 
-	if (priv->db != NULL)
-		{
-			g_free (priv->db);
-		}
+	rpt_report_database_free (priv->db);
 	priv->db = (Database *)g_new0 (Database, 1);
 
 	priv->db->provider_id = g_strstrip (g_strdup (provider_id));
 	priv->db->connection_string = g_strstrip (g_strdup (connection_string));
 	priv->db->sql = g_strstrip (g_strdup (sql));
 	priv->db->gda_conn = NULL;
-	priv->db->gda_datamodel = NULL;
-	priv->db->treemodel = NULL;
-	priv->db->columns_names = NULL;
+	priv->db->stmt = NULL;
+	priv->db->params = NULL;
+	priv->db->source = NULL;
+	priv->db->prefetching = FALSE;
+	priv->db->columns = NULL;
 }
 
 /**
@@ -972,71 +1167,126 @@ rpt_report_set_database (RptReport *rpt_report,
 void
 rpt_report_set_database_from_datamodel (RptReport *rpt_report, GdaDataModel *data_model)
 {
+	RptDataSource *source;
+
 	g_return_if_fail (IS_RPT_REPORT (rpt_report));
 	g_return_if_fail (GDA_IS_DATA_MODEL (data_model));
 
+	source = rpt_data_source_gda_new (data_model);
+	rpt_report_set_data_source (rpt_report, source);
+	g_object_unref (source);
+}
+
+/**
+ * rpt_report_set_data_source:
+ * @rpt_report: an #RptReport object.
+ * @source: an #RptDataSource; NULL to remove the rows, with the database.
+ *
+ * Sets the source of the rows, read in batches; the report keeps a
+ * reference to @source and rewinds it at the start of every run.
+ */
+void
+rpt_report_set_data_source (RptReport *rpt_report, RptDataSource *source)
+{
+	g_return_if_fail (IS_RPT_REPORT (rpt_report));
+	g_return_if_fail (source == NULL || IS_RPT_DATA_SOURCE (source));
+
 	RptReportPrivate *priv = RPT_REPORT_GET_PRIVATE (rpt_report);
 
-	if (priv->db != NULL)
-		{
-			if (priv->db->columns_names != NULL)
-				{
-					g_hash_table_destroy (priv->db->columns_names);
-				}
+	rpt_report_database_free (priv->db);
+	priv->db = NULL;
 
-			g_free (priv->db);
+	if (source == NULL)
+		{
+			return;
 		}
+
+	g_object_ref (source);
+
 	priv->db = (Database *)g_new0 (Database, 1);
 
 	priv->db->provider_id = NULL;
 	priv->db->connection_string = NULL;
 	priv->db->sql = NULL;
 	priv->db->gda_conn = NULL;
-	priv->db->gda_datamodel = data_model;
-	priv->db->treemodel = NULL;
-	priv->db->columns_names = NULL;
+	priv->db->stmt = NULL;
+	priv->db->params = NULL;
+	priv->db->source = source;
+	priv->db->prefetching = FALSE;
+	priv->db->columns = NULL;
 }
 
 /**
- * rpt_report_set_database_as_gtktreemodel:
+ * rpt_report_set_prefetch:
  * @rpt_report: an #RptReport object.
- * @model: a #GtkTreeModel (for now only #GtkListStore is supported).
- * @columns_names:
+ * @n_batches: the most batches of rows fetched in advance; 0 to read the
+ * rows only when they are laid out.
  *
+ * Reads the rows in a thread of their own while the report lays out the
+ * rows already read (see rpt_data_source_prefetch_new()); the
+ * source must be readable out of the main thread, so not a #GtkTreeModel,
+ * and the RptReport::field-request handlers get no model and row, since
+ * the model is read by the other thread meanwhile.
  */
 void
-rpt_report_set_database_as_gtktreemodel (RptReport *rpt_report,
-                                         GtkTreeModel *model,
-                                         GHashTable *columns_names)
+rpt_report_set_prefetch (RptReport *rpt_report, guint n_batches)
 {
 	g_return_if_fail (IS_RPT_REPORT (rpt_report));
-	g_return_if_fail (GTK_IS_TREE_MODEL (model));
-	g_return_if_fail (columns_names != NULL);
 
 	RptReportPrivate *priv = RPT_REPORT_GET_PRIVATE (rpt_report);
 
-	if (priv->db != NULL)
-		{
-			if (priv->db->gda_datamodel != NULL)
-				{
-					g_object_unref (priv->db->gda_datamodel);
-				}
-			if (priv->db->gda_conn != NULL)
-				{
-					gda_connection_close_no_warning (priv->db->gda_conn);
-				}
+	priv->prefetch = n_batches;
+}
+
+/**
+ * rpt_report_set_parameter:
+ * @rpt_report: an #RptReport object.
+ * @name: the parameter's name.
+ * @value: the parameter's value; NULL for a null value.
+ *
+ * Sets the value bound to the parameter @name of the query, written in the
+ * SQL as ##@name::type; a parameter not declared in the definition is
+ * declared with the type of @value. The query is parsed and prepared only
+ * the first time, every run executes it again with the current values.
+ */
+void
+rpt_report_set_parameter (RptReport *rpt_report, const gchar *name, const GValue *value)
+{
+	Parameter *param;
+
+	g_return_if_fail (IS_RPT_REPORT (rpt_report));
+	g_return_if_fail (name != NULL);
 
-			g_free (priv->db);
+	param = rpt_report_parameter_find (rpt_report, name);
+	if (param == NULL)
+		{
+			param = rpt_report_parameter_add (rpt_report, name,
+			                                  value == NULL || gda_value_is_null (value) ? G_TYPE_STRING : G_VALUE_TYPE (value));
 		}
-	priv->db = (Database *)g_new0 (Database, 1);
 
-	priv->db->provider_id = NULL;
-	priv->db->connection_string = NULL;
-	priv->db->sql = NULL;
-	priv->db->gda_conn = NULL;
-	priv->db->gda_datamodel = NULL;
-	priv->db->treemodel = model;
-	priv->db->columns_names = g_hash_table_ref (columns_names);
+	gda_value_free (param->value);
+	param->value = value == NULL ? gda_value_new_null () : gda_value_copy (value);
+}
+
+/**
+ * rpt_report_get_parameter:
+ * @rpt_report: an #RptReport object.
+ * @name: the parameter's name.
+ *
+ * Returns: the value of the parameter @name, a null value if it hasn't
+ * one; NULL if the parameter isn't declared.
+ */
+const GValue
+*rpt_report_get_parameter (RptReport *rpt_report, const gchar *name)
+{
+	Parameter *param;
+
+	g_return_val_if_fail (IS_RPT_REPORT (rpt_report), NULL);
+	g_return_val_if_fail (name != NULL, NULL);
+
+	param = rpt_report_parameter_find (rpt_report, name);
+
+	return param != NULL ? param->value : NULL;
 }
 
 /**
@@ -1252,46 +1502,22 @@ GList
 *rpt_report_section_get_objects (RptReport *rpt_report,
                                  RptReportSection section)
 {
-	GList *objects = NULL;
-
-	RptReportPrivate *priv = RPT_REPORT_GET_PRIVATE (rpt_report);
+	GList **objects;
+	GList **objects_last;
+	GList *cur;
 
-	switch (section)
+	if (!rpt_report_section_get_object_list (rpt_report, section, &objects, &objects_last))
 		{
-			case RPTREPORT_SECTION_REPORT_HEADER:
-				if (priv->report_header != NULL)
-					{
-						objects = g_list_copy (priv->report_header->objects);
-					}
-				break;
-
-			case RPTREPORT_SECTION_REPORT_FOOTER:
-				if (priv->report_footer != NULL)
-					{
-						objects = g_list_copy (priv->report_footer->objects);
-					}
-				break;
-
-			case RPTREPORT_SECTION_PAGE_HEADER:
-				if (priv->page_header != NULL)
-					{
-						objects = g_list_copy (priv->page_header->objects);
-					}
-				break;
-
-			case RPTREPORT_SECTION_PAGE_FOOTER:
-				if (priv->page_footer != NULL)
-					{
-						objects = g_list_copy (priv->page_footer->objects);
-					}
-				break;
+			return NULL;
+		}
 
-			case RPTREPORT_SECTION_BODY:
-				objects = g_list_copy (priv->body->objects);
-				break;
+	/* the caller can change the objects, so they can't be shared */
+	for (cur = *objects; cur != NULL; cur = cur->next)
+		{
+			cur->data = rpt_report_object_unshare (rpt_report, RPT_OBJECT (cur->data));
 		}
 
-	return objects;
+	return g_list_copy (*objects);
 }
 
 /**
@@ -1310,6 +1536,7 @@ rpt_report_section_remove (RptReport *rpt_report, RptReportSection section)
 			case RPTREPORT_SECTION_REPORT_HEADER:
 				if (priv->report_header != NULL)
 					{
+						rpt_report_section_free_objects (rpt_report, priv->report_header->objects);
 						g_free (priv->report_header);
 						priv->report_header = NULL;
 					}
@@ -1318,6 +1545,7 @@ rpt_report_section_remove (RptReport *rpt_report, RptReportSection section)
 			case RPTREPORT_SECTION_REPORT_FOOTER:
 				if (priv->report_footer != NULL)
 					{
+						rpt_report_section_free_objects (rpt_report, priv->report_footer->objects);
 						g_free (priv->report_footer);
 						priv->report_footer = NULL;
 					}
@@ -1326,6 +1554,7 @@ rpt_report_section_remove (RptReport *rpt_report, RptReportSection section)
 			case RPTREPORT_SECTION_PAGE_HEADER:
 				if (priv->page_header != NULL)
 					{
+						rpt_report_section_free_objects (rpt_report, priv->page_header->objects);
 						g_free (priv->page_header);
 						priv->page_header = NULL;
 					}
@@ -1334,6 +1563,7 @@ rpt_report_section_remove (RptReport *rpt_report, RptReportSection section)
 			case RPTREPORT_SECTION_PAGE_FOOTER:
 				if (priv->page_footer != NULL)
 					{
+						rpt_report_section_free_objects (rpt_report, priv->page_footer->objects);
 						g_free (priv->page_footer);
 						priv->page_footer = NULL;
 					}
@@ -1523,6 +1753,88 @@ rpt_report_body_set_new_page_after (RptReport *rpt_report, gboolean new_page_aft
 	priv->body->new_page_after = new_page_after;
 }
 
+/**
+ * rpt_report_get_section_can_grow:
+ * @rpt_report: an #RptReport object.
+ * @section:
+ *
+ * Returns: TRUE if @section's height can grow to show the whole text of its
+ * can-grow text objects.
+ */
+gboolean
+rpt_report_get_section_can_grow (RptReport *rpt_report, RptReportSection section)
+{
+	gboolean can_grow = FALSE;
+
+	rpt_report_section_get_grow_shrink (rpt_report, section, &can_grow, NULL);
+
+	return can_grow;
+}
+
+/**
+ * rpt_report_get_section_can_shrink:
+ * @rpt_report: an #RptReport object.
+ * @section:
+ *
+ * Returns: TRUE if @section's height can shrink when its can-shrink text
+ * objects need less space than designed.
+ */
+gboolean
+rpt_report_get_section_can_shrink (RptReport *rpt_report, RptReportSection section)
+{
+	gboolean can_shrink = FALSE;
+
+	rpt_report_section_get_grow_shrink (rpt_report, section, NULL, &can_shrink);
+
+	return can_shrink;
+}
+
+/**
+ * rpt_report_set_section_can_grow_shrink:
+ * @rpt_report: an #RptReport object.
+ * @section:
+ * @can_grow:
+ * @can_shrink:
+ *
+ * Page header and page footer always keep their height.
+ */
+void
+rpt_report_set_section_can_grow_shrink (RptReport *rpt_report,
+                                        RptReportSection section,
+                                        gboolean can_grow,
+                                        gboolean can_shrink)
+{
+	RptReportPrivate *priv = RPT_REPORT_GET_PRIVATE (rpt_report);
+
+	switch (section)
+		{
+			case RPTREPORT_SECTION_REPORT_HEADER:
+				if (priv->report_header != NULL)
+					{
+						priv->report_header->can_grow = can_grow;
+						priv->report_header->can_shrink = can_shrink;
+					}
+				break;
+
+			case RPTREPORT_SECTION_REPORT_FOOTER:
+				if (priv->report_footer != NULL)
+					{
+						priv->report_footer->can_grow = can_grow;
+						priv->report_footer->can_shrink = can_shrink;
+					}
+				break;
+
+			case RPTREPORT_SECTION_BODY:
+				priv->body->can_grow = can_grow;
+				priv->body->can_shrink = can_shrink;
+				break;
+
+			default:
+				g_warning ("Section «%d» cannot grow or shrink.", section);
+				break;
+		}
+}
+
 /**
  * rpt_report_get_xml:
  * @rpt_report: an #RptReport object.
@@ -1535,6 +1847,10 @@ xmlDoc
 	xmlNode *xroot;
 	xmlNode *xreport;
 	xmlNode *xnode;
+	gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+	Parameter *param;
+	gchar *str;
+	guint i;
 
 	RptReportPrivate *priv = RPT_REPORT_GET_PRIVATE (rpt_report);
 
@@ -1567,7 +1883,8 @@ xmlDoc
 	xmlAddChild (xnodeprop, xnode);
 
 	xnode = xmlNewNode (NULL, "copies");
-	xmlNodeSetContent (xnode, g_strdup_printf ("%d", priv->copies));
+	g_snprintf (buf, sizeof (buf), "%d", priv->copies);
+	xmlNodeSetContent (xnode, buf);
 	xmlAddChild (xnodeprop, xnode);
 
 	if (priv->translation != NULL)
@@ -1593,23 +1910,45 @@ xmlDoc
 			xmlAddChild (xnodedb, xnode);
 		};
 
+	if (priv->parameters->len > 0)
+		{
+			xmlNode *xnodeparams = xmlNewNode (NULL, "parameters");
+			xmlAddChild (xroot, xnodeparams);
+
+			for (i = 0; i < priv->parameters->len; i++)
+				{
+					param = (Parameter *)g_ptr_array_index (priv->parameters, i);
+
+					xnode = xmlNewNode (NULL, "parameter");
+					xmlSetProp (xnode, "name", param->name);
+					xmlSetProp (xnode, "type", gda_g_type_to_string (param->type));
+					if (!gda_value_is_null (param->value))
+						{
+							str = gda_value_stringify (param->value);
+							xmlSetProp (xnode, "default", str);
+							g_free (str);
+						}
+					xmlAddChild (xnodeparams, xnode);
+				}
+		}
+
 	xnode = xmlNewNode (NULL, "page");
 	rpt_common_set_size (xnode, priv->page->size);
 	if (priv->page->margin->top != 0.0)
 		{
-			xmlSetProp (xnode, "margin-top", g_strdup_printf ("%f", priv->page->margin->top));
+			xmlSetProp (xnode, "margin-top", g_ascii_formatd (buf, sizeof (buf), "%f", priv->page->margin->top));
 		}
 	if (priv->page->margin->right != 0.0)
 		{
-			xmlSetProp (xnode, "margin-right", g_strdup_printf ("%f", priv->page->margin->right));
+			xmlSetProp (xnode, "margin-right", g_ascii_formatd (buf, sizeof (buf), "%f", priv->page->margin->right));
 		}
 	if (priv->page->margin->bottom != 0.0)
 		{
-			xmlSetProp (xnode, "margin-bottom", g_strdup_printf ("%f", priv->page->margin->bottom));
+			xmlSetProp (xnode, "margin-bottom", g_ascii_formatd (buf, sizeof (buf), "%f", priv->page->margin->bottom));
 		}
 	if (priv->page->margin->left != 0.0)
 		{
-			xmlSetProp (xnode, "margin-left", g_strdup_printf ("%f", priv->page->margin->left));
+			xmlSetProp (xnode, "margin-left", g_ascii_formatd (buf, sizeof (buf), "%f", priv->page->margin->left));
 		}
 	xmlAddChild (xroot, xnode);
 
@@ -1655,6 +1994,36 @@ xmlDoc
 *rpt_report_get_xml_rptprint (RptReport *rpt_report)
 {
 	GError *error;
+	xmlDoc *xdoc;
+
+	error = NULL;
+	xdoc = rpt_report_get_xml_rptprint_full (rpt_report, &error);
+	if (xdoc == NULL)
+		{
+			g_warning ("Unable to generate the report: %s.",
+			           error != NULL && error->message != NULL ? error->message : "no details");
+			if (error != NULL) g_error_free (error);
+		}
+
+	return xdoc;
+}
+
+/**
+ * rpt_report_get_xml_rptprint_full:
+ * @rpt_report: an #RptReport object.
+ * @error: return location for a #GError, or NULL.
+ *
+ * Like rpt_report_get_xml_rptprint(), but the connection, the query, the
+ * binding of the parameters (#RPT_REPORT_ERROR_INVALID_PARAMETER) and the
+ * reading of the rows return their errors in @error.
+ *
+ * Returns: an #xmlDoc, that represents the generated report; NULL, with
+ * @error set, on error.
+ */
+xmlDoc
+*rpt_report_get_xml_rptprint_full (RptReport *rpt_report, GError **error)
+{
+	GError *read_error;
 
 	xmlDoc *xdoc;
 	xmlNode *xroot;
@@ -1662,6 +2031,13 @@ xmlDoc
 
 	gdouble cur_y = 0.0;
 
+	/* the layout stops when this page is complete; 0 to do all */
+	guint stop_page;
+	gboolean stopped;
+
+	/* the body shows @Page */
+	gboolean defer_page;
+
 	RptReportPrivate *priv = RPT_REPORT_GET_PRIVATE (rpt_report);
 
 	xdoc = rpt_report_rptprint_new ();
@@ -1669,6 +2045,20 @@ xmlDoc
 
 	priv->cur_page = 0;
 
+	stop_page = 0;
+	if (priv->page_last > 0 && !rpt_report_uses_pages (rpt_report))
+		{
+			stop_page = priv->page_last;
+		}
+	stopped = FALSE;
+
+	/* objects could be changed since the last run */
+	rpt_report_rptprint_templates_free (rpt_report);
+
+	/* every @Date and @Time of the same run shows the same instant */
+	priv->run_time = g_date_time_new_now_local ();
+	priv->specials = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+
 	/* properties */
 	rpt_report_rptprint_set_name (xdoc, priv->name);
 	rpt_report_rptprint_set_description (xdoc, priv->description);
@@ -1684,225 +2074,215 @@ xmlDoc
 	if (priv->db != NULL)
 		{
 			gint row;
-
-			if (priv->db->treemodel != NULL)
+			xmlNode *xband;
+			gdouble body_height;
+
+			/* the rows being laid out and the one before; when a batch is
+			 * over, the next rows go in the other one, so the previous row,
+			 * for the page footer, is still there */
+			RptDataBatch *batches[2];
+			RptDataBatch *batch;
+			guint batch_row;
+			RptDataBatch *batch_prec;
+			guint batch_row_prec;
+			RptDataSource *source;
+			/* where the band was built */
+			gdouble band_y;
+
+			/* the query is executed again on every run, with the current
+			 * values of the parameters, so the rows are never stale */
+			if (priv->db->sql != NULL)
 				{
-					GtkTreeIter *iter_prec;
-					GtkTreeIter iter;
-
-					if (!gtk_tree_model_get_iter_first (priv->db->treemodel, &iter))
+					if (!rpt_report_database_execute (rpt_report, error))
 						{
-							g_warning ("GtkTreeModel is empty.");
+							xmlFreeDoc (xdoc);
+							rpt_report_rptprint_run_end (rpt_report);
 							return NULL;
 						}
+				}
+
+			if (priv->db->prefetching && priv->prefetch == 0)
+				{
+					source = g_object_ref (rpt_data_source_prefetch_get_source (RPT_DATA_SOURCE_PREFETCH (priv->db->source)));
+					g_object_unref (priv->db->source);
+					priv->db->source = source;
+					priv->db->prefetching = FALSE;
+				}
+			else if (!priv->db->prefetching && priv->prefetch > 0)
+				{
+					source = rpt_data_source_prefetch_new (priv->db->source, priv->prefetch);
+					g_object_unref (priv->db->source);
+					priv->db->source = source;
+					priv->db->prefetching = TRUE;
+				}
+
+			if (!rpt_data_source_rewind (priv->db->source, error))
+				{
+					g_prefix_error (error, "Unable to read the rows: ");
+					xmlFreeDoc (xdoc);
+					rpt_report_rptprint_run_end (rpt_report);
+					return NULL;
+				}
+
+			defer_page = rpt_report_objects_use_page (priv->body->objects);
+			band_y = 0.0;
+
+			batches[0] = rpt_data_batch_new ();
+			batches[1] = rpt_data_batch_new ();
+			batch = batches[1];
+			batch_row = 0;
+			batch_prec = NULL;
+			batch_row_prec = 0;
 
-					row = 0;
-					do
+			for (row = 0; ; row++)
+				{
+					if (batch_row >= rpt_data_batch_get_n_rows (batch))
 						{
-							priv->cur_iter = &iter;
-							if (row == 0 ||
-							    priv->body->new_page_after ||
-							    (priv->page_footer != NULL && (cur_y + priv->body->height > priv->page->size->height - priv->page->margin->bottom - priv->page_footer->height)) ||
-							    cur_y > (priv->page->size->height - priv->page->margin->bottom))
+							batch = batch == batches[0] ? batches[1] : batches[0];
+							read_error = NULL;
+							if (rpt_data_source_next_batch (priv->db->source, batch, RPT_REPORT_BATCH_ROWS, &read_error) == 0)
 								{
-									if (priv->cur_page > 0 && priv->page_footer != NULL)
+									if (read_error != NULL)
 										{
-											if ((priv->cur_page == 1 && priv->page_footer->first_page) ||
-											    priv->cur_page > 1)
-												{
-													cur_y = priv->page->size->height - priv->page->margin->bottom - priv->page_footer->height;
-													priv->cur_iter = iter_prec;
-													rpt_report_rptprint_section (rpt_report, xpage, &cur_y, RPTREPORT_SECTION_PAGE_FOOTER);
-													priv->cur_iter = &iter;
-												}
+											/* a report without some rows isn't returned */
+											g_propagate_prefixed_error (error, read_error, "Unable to read the rows: ");
+											rpt_data_batch_free (batches[0]);
+											rpt_data_batch_free (batches[1]);
+											xmlFreeDoc (xdoc);
+											rpt_report_rptprint_run_end (rpt_report);
+											return NULL;
 										}
+									break;
+								}
+							batch_row = 0;
+						}
 
-									cur_y = priv->page->margin->top;
-									xpage = rpt_report_rptprint_new_page (rpt_report, xdoc);
+					priv->cur_batch = batch;
+					priv->cur_batch_row = batch_row;
+					/* a body that can grow or shrink must be built to know its height */
+					xband = NULL;
+					body_height = priv->body->height;
+					if (row > 0 && (priv->body->can_grow || priv->body->can_shrink))
+						{
+							priv->defer_page = defer_page;
+							xband = rpt_report_rptprint_section_build (rpt_report, cur_y, RPTREPORT_SECTION_BODY, &body_height);
+							priv->defer_page = FALSE;
+							band_y = cur_y;
+						}
 
-									if (priv->page_header != NULL)
+					if (row == 0 ||
+					    priv->body->new_page_after ||
+					    (cur_y + body_height > priv->page->size->height - priv->page->margin->bottom - (priv->page_footer != NULL ? priv->page_footer->height : 0.0)))
+						{
+							if (priv->cur_page > 0 && priv->page_footer != NULL)
+								{
+									if ((priv->cur_page == 1 && priv->page_footer->first_page) ||
+									    priv->cur_page > 1)
 										{
-											if ((priv->cur_page == 1 && priv->page_header->first_page) ||
-											    priv->cur_page > 1)
-												{
-													rpt_report_rptprint_section (rpt_report, xpage, &cur_y, RPTREPORT_SECTION_PAGE_HEADER);
-												}
+											cur_y = priv->page->size->height - priv->page->margin->bottom - priv->page_footer->height;
+											priv->cur_batch = batch_prec;
+											priv->cur_batch_row = batch_row_prec;
+											rpt_report_rptprint_section (rpt_report, xpage, &cur_y, RPTREPORT_SECTION_PAGE_FOOTER);
+											priv->cur_batch = batch;
+											priv->cur_batch_row = batch_row;
 										}
-									if (priv->cur_page == 1 && priv->report_header != NULL)
+								}
+
+							if (stop_page > 0 && priv->cur_page >= stop_page)
+								{
+									/* the last page asked is complete */
+									if (xband != NULL)
 										{
-											rpt_report_rptprint_section (rpt_report, xpage, &cur_y, RPTREPORT_SECTION_REPORT_HEADER);
-											if (priv->report_header->new_page_after)
-												{
-													cur_y = 0.0;
-													xpage = rpt_report_rptprint_new_page (rpt_report, xdoc);
-												}
+											xmlFreeNode (xband);
 										}
+									stopped = TRUE;
+									break;
 								}
 
-							rpt_report_rptprint_section (rpt_report, xpage, &cur_y, RPTREPORT_SECTION_BODY);
-
-							iter_prec = g_memdup (&iter, sizeof (GtkTreeIter));
-							row++;
-						} while (gtk_tree_model_iter_next (priv->db->treemodel, &iter));
+							cur_y = priv->page->margin->top;
+							xpage = rpt_report_rptprint_new_page (rpt_report, xdoc);
 
-					priv->cur_iter = iter_prec;
-					if (priv->cur_page > 0 && priv->report_footer != NULL)
-						{
-							if ((cur_y + priv->report_footer->height > priv->page->size->height - priv->page->margin->bottom - (priv->page_footer != NULL ? priv->page_footer->height : 0.0)) ||
-							    priv->report_footer->new_page_before)
+							if (priv->page_header != NULL)
 								{
-									if (priv->page_header != NULL)
+									if ((priv->cur_page == 1 && priv->page_header->first_page) ||
+									    priv->cur_page > 1)
 										{
 											rpt_report_rptprint_section (rpt_report, xpage, &cur_y, RPTREPORT_SECTION_PAGE_HEADER);
 										}
-
-									cur_y = priv->page->margin->top;
-									xpage = rpt_report_rptprint_new_page (rpt_report, xdoc);
-
-									if (priv->cur_page > 0 && priv->page_footer != NULL)
+								}
+							if (priv->cur_page == 1 && priv->report_header != NULL)
+								{
+									rpt_report_rptprint_section (rpt_report, xpage, &cur_y, RPTREPORT_SECTION_REPORT_HEADER);
+									if (priv->report_header->new_page_after)
 										{
-											cur_y = priv->page->size->height - priv->page->margin->bottom - priv->page_footer->height;
-											rpt_report_rptprint_section (rpt_report, xpage, &cur_y, RPTREPORT_SECTION_PAGE_FOOTER);
+											cur_y = 0.0;
+											xpage = rpt_report_rptprint_new_page (rpt_report, xdoc);
 										}
 								}
-
-							rpt_report_rptprint_section (rpt_report, xpage, &cur_y, RPTREPORT_SECTION_REPORT_FOOTER);
+							if (xband != NULL)
+								{
+									/* moved to the new page without evaluating the row
+									 * again, so no field is asked twice */
+									rpt_report_rptprint_band_move (xband, band_y, cur_y);
+								}
 						}
 
-					if (priv->cur_page > 0 && priv->page_footer != NULL && priv->page_footer->last_page)
+					if (xband == NULL)
 						{
-							cur_y = priv->page->size->height - priv->page->margin->bottom - priv->page_footer->height;
-							rpt_report_rptprint_section (rpt_report, xpage, &cur_y, RPTREPORT_SECTION_PAGE_FOOTER);
+							priv->defer_page = defer_page;
+							xband = rpt_report_rptprint_section_build (rpt_report, cur_y, RPTREPORT_SECTION_BODY, &body_height);
+							priv->defer_page = FALSE;
 						}
-				}
-			else
-				{
-					gint rows;
-
-					/* database connection */
-					gda_init ();
-					if (priv->db->gda_datamodel == NULL)
+					if (defer_page)
 						{
-							error = NULL;
-							priv->db->gda_conn = gda_connection_open_from_string (priv->db->provider_id,
-							                                                      priv->db->connection_string,
-							                                                      NULL,
-							                                                      GDA_CONNECTION_OPTIONS_NONE,
-							                                                      &error);
-							if (priv->db->gda_conn == NULL || error != NULL)
-								{
-									/* TO DO */
-									g_warning ("Unable to establish the connection: %s.",
-									           error != NULL && error->message != NULL ? error->message : "no details");
-									return NULL;
-								}
-							else
-								{
-									GdaSqlParser *parser = gda_sql_parser_new ();
-									error = NULL;
-									GdaStatement *stmt = gda_sql_parser_parse_string (parser, priv->db->sql, NULL, &error);
-
-									error = NULL;
-									priv->db->gda_datamodel = gda_connection_statement_execute_select (priv->db->gda_conn, stmt, NULL, &error);
-									if (priv->db->gda_datamodel == NULL || error != NULL)
-										{
-											/* TO DO */
-											g_warning ("Unable to create the datamodel: %s",
-											           error != NULL && error->message != NULL ? error->message : "no details");
-											return NULL;
-										}
-								}
+							rpt_report_rptprint_band_set_page (xband, priv->cur_page);
 						}
+					rpt_report_rptprint_section_place (xpage, xband);
+					cur_y += body_height;
 
-					rows = gda_data_model_get_n_rows (priv->db->gda_datamodel);
-					for (row = 0; row < rows; row++)
+					batch_prec = batch;
+					batch_row_prec = batch_row;
+					batch_row++;
+				}
+
+			/* the footers show the last row */
+			priv->cur_batch = batch_prec;
+			priv->cur_batch_row = batch_row_prec;
+			if (!stopped && priv->cur_page > 0 && priv->report_footer != NULL)
+				{
+					if ((cur_y + priv->report_footer->height > priv->page->size->height - priv->page->margin->bottom - (priv->page_footer != NULL ? priv->page_footer->height : 0.0)) ||
+					    priv->report_footer->new_page_before)
 						{
-							priv->cur_row = row;
-							if (row == 0 ||
-							    priv->body->new_page_after ||
-							    (priv->page_footer != NULL && (cur_y + priv->body->height > priv->page->size->height - priv->page->margin->bottom - priv->page_footer->height)) ||
-							    cur_y > (priv->page->size->height - priv->page->margin->bottom))
+							if (priv->page_header != NULL)
 								{
-									if (priv->cur_page > 0 && priv->page_footer != NULL)
-										{
-											if ((priv->cur_page == 1 && priv->page_footer->first_page) ||
-											    priv->cur_page > 1)
-												{
-													cur_y = priv->page->size->height - priv->page->margin->bottom - priv->page_footer->height;
-													priv->cur_row = row - 1;
-													rpt_report_rptprint_section (rpt_report, xpage, &cur_y, RPTREPORT_SECTION_PAGE_FOOTER);
-													priv->cur_row = row;
-												}
-										}
-
-									cur_y = priv->page->margin->top;
-									xpage = rpt_report_rptprint_new_page (rpt_report, xdoc);
-
-									if (priv->page_header != NULL)
-										{
-											if ((priv->cur_page == 1 && priv->page_header->first_page) ||
-											    priv->cur_page > 1)
-												{
-													rpt_report_rptprint_section (rpt_report, xpage, &cur_y, RPTREPORT_SECTION_PAGE_HEADER);
-												}
-										}
-									if (priv->cur_page == 1 && priv->report_header != NULL)
-										{
-											rpt_report_rptprint_section (rpt_report, xpage, &cur_y, RPTREPORT_SECTION_REPORT_HEADER);
-											if (priv->report_header->new_page_after)
-												{
-													cur_y = 0.0;
-													xpage = rpt_report_rptprint_new_page (rpt_report, xdoc);
-												}
-										}
+									rpt_report_rptprint_section (rpt_report, xpage, &cur_y, RPTREPORT_SECTION_PAGE_HEADER);
 								}
 
-							rpt_report_rptprint_section (rpt_report, xpage, &cur_y, RPTREPORT_SECTION_BODY);
-						}
+							cur_y = priv->page->margin->top;
+							xpage = rpt_report_rptprint_new_page (rpt_report, xdoc);
 
-					if (priv->cur_page > 0 && priv->report_footer != NULL)
-						{
-							if ((cur_y + priv->report_footer->height > priv->page->size->height - priv->page->margin->bottom - (priv->page_footer != NULL ? priv->page_footer->height : 0.0)) ||
-							    priv->report_footer->new_page_before)
+							if (priv->cur_page > 0 && priv->page_footer != NULL)
 								{
-									if (priv->page_header != NULL)
-										{
-											priv->cur_row = row - 1;
-											rpt_report_rptprint_section (rpt_report, xpage, &cur_y, RPTREPORT_SECTION_PAGE_HEADER);
-											priv->cur_row = row;
-										}
-
-									cur_y = priv->page->margin->top;
-									xpage = rpt_report_rptprint_new_page (rpt_report, xdoc);
-
-									if (priv->cur_page > 0 && priv->page_footer != NULL)
-										{
-											cur_y = priv->page->size->height - priv->page->margin->bottom - priv->page_footer->height;
-											priv->cur_row = row - 1;
-											rpt_report_rptprint_section (rpt_report, xpage, &cur_y, RPTREPORT_SECTION_PAGE_FOOTER);
-											priv->cur_row = row;
-										}
+									cur_y = priv->page->size->height - priv->page->margin->bottom - priv->page_footer->height;
+									rpt_report_rptprint_section (rpt_report, xpage, &cur_y, RPTREPORT_SECTION_PAGE_FOOTER);
 								}
-
-							priv->cur_row = row - 1;
-							rpt_report_rptprint_section (rpt_report, xpage, &cur_y, RPTREPORT_SECTION_REPORT_FOOTER);
-							priv->cur_row = row;
 						}
 
-					if (priv->cur_page > 0 && priv->page_footer != NULL && priv->page_footer->last_page)
-						{
-							cur_y = priv->page->size->height - priv->page->margin->bottom - priv->page_footer->height;
-							priv->cur_row = row - 1;
-							rpt_report_rptprint_section (rpt_report, xpage, &cur_y, RPTREPORT_SECTION_PAGE_FOOTER);
-							priv->cur_row = row;
-						}
+					rpt_report_rptprint_section (rpt_report, xpage, &cur_y, RPTREPORT_SECTION_REPORT_FOOTER);
+				}
+
+			if (!stopped && priv->cur_page > 0 && priv->page_footer != NULL && priv->page_footer->last_page)
+				{
+					cur_y = priv->page->size->height - priv->page->margin->bottom - priv->page_footer->height;
+					rpt_report_rptprint_section (rpt_report, xpage, &cur_y, RPTREPORT_SECTION_PAGE_FOOTER);
 				}
 
+			priv->cur_batch = NULL;
+			rpt_data_batch_free (batches[0]);
+			rpt_data_batch_free (batches[1]);
+
 			/* change @Pages */
 			rpt_report_change_specials (rpt_report, xdoc);
-
-			priv->cur_row = -1;
-			priv->cur_iter = NULL;
 		}
 	else
 		{
@@ -1931,6 +2311,10 @@ xmlDoc
 				}
 		}
 
+	rpt_report_rptprint_drop_pages (rpt_report, xdoc);
+
+	rpt_report_rptprint_run_end (rpt_report);
+
 	return xdoc;
 }
 
@@ -2063,6 +2447,7 @@ rpt_report_rptprint_set_copies (xmlDoc *xdoc, guint copies)
 	xmlNode *xnodeprop;
 	xmlNode *xnode;
 	xmlNode *xroot;
+	gchar buf[16];
 
 	xnodeprop = rpt_report_rptprint_get_properties_node (xdoc);
 	if (xnodeprop == NULL)
@@ -2075,7 +2460,8 @@ rpt_report_rptprint_set_copies (xmlDoc *xdoc, guint copies)
 	/* TODO
 	 * replace eventually already present node */
 	xnode = xmlNewNode (NULL, "copies");
-	xmlNodeSetContent (xnode, g_strdup_printf ("%d", copies));
+	g_snprintf (buf, sizeof (buf), "%u", copies);
+	xmlNodeSetContent (xnode, buf);
 	xmlAddChild (xnodeprop, xnode);
 }
 
@@ -2141,6 +2527,11 @@ rpt_report_rptprint_page_add_object (xmlNode *xnodepage, RptObject *rpt_object)
 				{
 					xmlRemoveProp (attr);
 				}
+			attr = xmlHasProp (xnodeobj, "format");
+			if (attr != NULL)
+				{
+					xmlRemoveProp (attr);
+				}
 		}
 	else if (IS_RPT_OBJ_IMAGE (rpt_object))
 		{
@@ -2165,57 +2556,51 @@ rpt_report_add_object_to_section (RptReport *rpt_report, RptObject *rpt_object,
 {
 	gboolean ret = FALSE;
 	gchar *objname;
+	GList **objects;
+	GList **objects_last;
+	ObjectIndex *index;
 
 	RptReportPrivate *priv = RPT_REPORT_GET_PRIVATE (rpt_report);
 
 	g_object_get (rpt_object, "name", &objname, NULL);
-	if (rpt_report_get_object_from_name (rpt_report, objname) == NULL)
+	if (g_hash_table_lookup (priv->objects_by_name, objname) == NULL)
 		{
-			switch (section)
+			rpt_report_section_create (rpt_report, section);
+			if (rpt_report_section_get_object_list (rpt_report, section, &objects, &objects_last))
 				{
-					case RPTREPORT_SECTION_REPORT_HEADER:
-						if (priv->report_header == NULL)
-							{
-								rpt_report_section_create (rpt_report, RPTREPORT_SECTION_REPORT_HEADER);
-							}
-						priv->report_header->objects = g_list_append (priv->report_header->objects, rpt_object);;
-						break;
+					/* appending after the last element keeps adding n objects linear */
+					*objects_last = g_list_append (*objects_last, rpt_object);
+					if (*objects == NULL)
+						{
+							*objects = *objects_last;
+						}
+					else
+						{
+							*objects_last = (*objects_last)->next;
+						}
 
-					case RPTREPORT_SECTION_REPORT_FOOTER:
-						if (priv->report_footer == NULL)
-							{
-								rpt_report_section_create (rpt_report, RPTREPORT_SECTION_REPORT_FOOTER);
-							}
-						priv->report_footer->objects = g_list_append (priv->report_footer->objects, rpt_object);;
-						break;
+					index = g_new0 (ObjectIndex, 1);
+					index->name = objname;
+					index->section = section;
 
-					case RPTREPORT_SECTION_PAGE_HEADER:
-						if (priv->page_header == NULL)
-							{
-								rpt_report_section_create (rpt_report, RPTREPORT_SECTION_PAGE_HEADER);
-							}
-						priv->page_header->objects = g_list_append (priv->page_header->objects, rpt_object);;
-						break;
+					g_hash_table_insert (priv->objects_index, rpt_object, index);
+					g_hash_table_insert (priv->objects_by_name, index->name, rpt_object);
 
-					case RPTREPORT_SECTION_PAGE_FOOTER:
-						if (priv->page_footer == NULL)
-							{
-								rpt_report_section_create (rpt_report, RPTREPORT_SECTION_PAGE_FOOTER);
-							}
-						priv->page_footer->objects = g_list_append (priv->page_footer->objects, rpt_object);;
-						break;
+					g_signal_connect (rpt_object, "notify::name",
+					                  G_CALLBACK (rpt_report_on_object_name_changed), rpt_report);
 
-					case RPTREPORT_SECTION_BODY:
-						priv->body->objects = g_list_append (priv->body->objects, rpt_object);;
-						break;
+					ret = TRUE;
+				}
+			else
+				{
+					g_free (objname);
 				}
-
-			ret = TRUE;
 		}
 	else
 		{
 			/* TO DO */
 			g_warning ("An object with name «%s» already exists.", objname);
+			g_free (objname);
 		}
 
 	return ret;
@@ -2231,31 +2616,32 @@ rpt_report_add_object_to_section (RptReport *rpt_report, RptObject *rpt_object,
 void
 rpt_report_remove_object (RptReport *rpt_report, RptObject *rpt_object)
 {
+	GList **objects;
+	GList **objects_last;
+	GList *link;
+
 	RptReportPrivate *priv = RPT_REPORT_GET_PRIVATE (rpt_report);
 
 	RptReportSection section = rpt_report_object_get_section (rpt_report, rpt_object);
 
-	switch (section)
+	if (rpt_report_section_get_object_list (rpt_report, section, &objects, &objects_last))
 		{
-			case RPTREPORT_SECTION_REPORT_HEADER:
-				priv->report_header->objects = g_list_remove (priv->report_header->objects, rpt_object);;
-				break;
-
-			case RPTREPORT_SECTION_REPORT_FOOTER:
-				priv->report_footer->objects = g_list_remove (priv->report_footer->objects, rpt_object);;
-				break;
-
-			case RPTREPORT_SECTION_PAGE_HEADER:
-				priv->page_header->objects = g_list_remove (priv->page_header->objects, rpt_object);;
-				break;
+			link = g_list_find (*objects, rpt_object);
+			if (link != NULL)
+				{
+					if (link == *objects_last)
+						{
+							*objects_last = link->prev;
+						}
+					*objects = g_list_delete_link (*objects, link);
+				}
 
-			case RPTREPORT_SECTION_PAGE_FOOTER:
-				priv->page_footer->objects = g_list_remove (priv->page_footer->objects, rpt_object);;
-				break;
+			if (link != NULL)
+				{
+					GList tmp = { rpt_object, NULL, NULL };
 
-			case RPTREPORT_SECTION_BODY:
-				priv->body->objects = g_list_remove (priv->body->objects, rpt_object);;
-				break;
+					rpt_report_section_unindex_objects (rpt_report, &tmp);
+				}
 		}
 }
 
@@ -2264,32 +2650,25 @@ rpt_report_remove_object (RptReport *rpt_report, RptObject *rpt_object)
  * @rpt_report: an #RptReport object.
  * @name: the #RptObject's name.
  *
+ * If the object is shared with another report (see rpt_report_copy()), it's
+ * first replaced with a copy of its own.
+ *
  * Returns: the #RptObject object represented by the name @name.
  */
 RptObject
 *rpt_report_get_object_from_name (RptReport *rpt_report, const gchar *name)
 {
-	RptObject *obj = NULL;
+	RptObject *rpt_object;
 
 	RptReportPrivate *priv = RPT_REPORT_GET_PRIVATE (rpt_report);
 
-	if (priv->report_header != NULL && (obj = rpt_report_get_object_from_name_in_list (priv->report_header->objects, name)) != NULL)
-		{
-		}
-	else if (priv->report_footer != NULL && (obj = rpt_report_get_object_from_name_in_list (priv->report_footer->objects, name)) != NULL)
-		{
-		}
-	else if (priv->page_header != NULL && (obj = rpt_report_get_object_from_name_in_list (priv->page_header->objects, name)) != NULL)
-		{
-		}
-	else if (priv->page_footer != NULL && (obj = rpt_report_get_object_from_name_in_list (priv->page_footer->objects, name)) != NULL)
-		{
-		}
-	else if (priv->body != NULL && (obj = rpt_report_get_object_from_name_in_list (priv->body->objects, name)) != NULL)
+	rpt_object = (RptObject *)g_hash_table_lookup (priv->objects_by_name, name);
+	if (rpt_object != NULL)
 		{
+			rpt_object = rpt_report_object_unshare (rpt_report, rpt_object);
 		}
 
-	return obj;
+	return rpt_object;
 }
 
 void
@@ -2376,225 +2755,612 @@ rpt_report_get_property (GObject *object, guint property_id, GValue *value, GPar
 		}
 }
 
+static void
+rpt_report_object_index_free (ObjectIndex *index)
+{
+	g_free (index->name);
+	g_free (index);
+}
+
 /**
- * rpt_report_get_object_from_name_in_list:
- * @list:
- * @name:
+ * rpt_report_on_object_name_changed:
+ * @object:
+ * @pspec:
+ * @user_data: the #RptReport that contains @object.
  *
+ * Keeps the name index in sync when an object is renamed.
  */
-static RptObject
-*rpt_report_get_object_from_name_in_list (GList *list, const gchar *name)
+static void
+rpt_report_on_object_name_changed (GObject *object, GParamSpec *pspec, gpointer user_data)
 {
+	ObjectIndex *index;
 	gchar *objname;
-	RptObject *obj = NULL;
+	RptObject *other;
+
+	RptReportPrivate *priv = RPT_REPORT_GET_PRIVATE (user_data);
 
-	if (list != NULL)
+	index = (ObjectIndex *)g_hash_table_lookup (priv->objects_index, object);
+	if (index == NULL)
 		{
-			list = g_list_first (list);
-			while (list != NULL)
-				{
-					g_object_get ((RptObject *)list->data, "name", &objname, NULL);
-					if (g_strcmp0 (name, objname) == 0)
-						{
-							obj = (RptObject *)list->data;
-							break;
-						}
-				
-					list = g_list_next (list);
-				}
+			return;
 		}
 
-	return obj;
+	g_object_get (object, "name", &objname, NULL);
+	if (g_strcmp0 (objname, index->name) == 0)
+		{
+			g_free (objname);
+			return;
+		}
+
+	other = (RptObject *)g_hash_table_lookup (priv->objects_by_name, objname);
+	if (other != NULL)
+		{
+			/* TO DO */
+			g_warning ("An object with name «%s» already exists.", objname);
+		}
+
+	if (g_hash_table_lookup (priv->objects_by_name, index->name) == (gpointer)object)
+		{
+			g_hash_table_remove (priv->objects_by_name, index->name);
+		}
+	g_free (index->name);
+	index->name = objname;
+	if (other == NULL)
+		{
+			g_hash_table_insert (priv->objects_by_name, index->name, object);
+		}
 }
 
 /**
- * rpt_report_object_get_section:
- * @rpt_report: an #RptReport object.
- * @rpt_object: an #RptObject object.
+ * rpt_report_object_new_from_xml:
+ * @xnode: an object's node of a section.
  *
- * Returns: the #RptReportSection in which @rpt_object is contained.
+ * Returns: the #RptObject described by @xnode; NULL if @xnode isn't an
+ * object (text, comments and unknown elements).
  */
-static RptReportSection
-rpt_report_object_get_section (RptReport *rpt_report, RptObject *rpt_object)
+static RptObject
+*rpt_report_object_new_from_xml (xmlNode *xnode)
 {
-	RptReportSection section = -1;
+	RptObject *rptobj = NULL;
 
-	RptReportPrivate *priv = RPT_REPORT_GET_PRIVATE (rpt_report);
-
-	if (rpt_report_object_is_in_section (rpt_report, rpt_object, RPTREPORT_SECTION_REPORT_HEADER))
+	if (xnode->type != XML_ELEMENT_NODE)
+		{
+			/* nothing, text and comments aren't objects */
+		}
+	else if (g_strcmp0 (xnode->name, "text") == 0)
 		{
-			section = RPTREPORT_SECTION_REPORT_HEADER;
+			rptobj = rpt_obj_text_new_from_xml (xnode);
 		}
-	else if (rpt_report_object_is_in_section (rpt_report, rpt_object, RPTREPORT_SECTION_REPORT_FOOTER))
+	else if (g_strcmp0 (xnode->name, "line") == 0)
 		{
-			section = RPTREPORT_SECTION_REPORT_FOOTER;
+			rptobj = rpt_obj_line_new_from_xml (xnode);
 		}
-	else if (rpt_report_object_is_in_section (rpt_report, rpt_object, RPTREPORT_SECTION_PAGE_HEADER))
+	else if (g_strcmp0 (xnode->name, "rect") == 0)
 		{
-			section = RPTREPORT_SECTION_PAGE_HEADER;
+			rptobj = rpt_obj_rect_new_from_xml (xnode);
 		}
-	else if (rpt_report_object_is_in_section (rpt_report, rpt_object, RPTREPORT_SECTION_PAGE_FOOTER))
+	else if (g_strcmp0 (xnode->name, "ellipse") == 0)
 		{
-			section = RPTREPORT_SECTION_PAGE_FOOTER;
+			rptobj = rpt_obj_ellipse_new_from_xml (xnode);
 		}
-	else if (rpt_report_object_is_in_section (rpt_report, rpt_object, RPTREPORT_SECTION_BODY))
+	else if (g_strcmp0 (xnode->name, "image") == 0)
 		{
-			section = RPTREPORT_SECTION_BODY;
+			rptobj = rpt_obj_image_new_from_xml (xnode);
+		}
+	else if (g_strcmp0 (xnode->name, "subreport") == 0)
+		{
+			rptobj = rpt_obj_subreport_new_from_xml (xnode);
 		}
 
-	return section;
+	return rptobj;
 }
 
 /**
- * rpt_report_section_create:
+ * rpt_report_object_unshare:
  * @rpt_report:
- * @section:
+ * @rpt_object: an object of @rpt_report.
+ *
+ * If @rpt_object is shared with another report, replaces it in
+ * @rpt_report, in the same place, with a copy made from its xml.
  *
+ * Returns: the object that @rpt_report owns alone: @rpt_object itself if
+ * it isn't shared, or its copy.
  */
-static void
-rpt_report_section_create (RptReport *rpt_report, RptReportSection section)
+static RptObject
+*rpt_report_object_unshare (RptReport *rpt_report, RptObject *rpt_object)
 {
+	ObjectIndex *index;
+	RptObject *copy;
+	GList **objects;
+	GList **objects_last;
+	GList *link;
+	xmlNode *xnode;
+
 	RptReportPrivate *priv = RPT_REPORT_GET_PRIVATE (rpt_report);
 
-	switch (section)
+	index = (ObjectIndex *)g_hash_table_lookup (priv->objects_index, rpt_object);
+	if (index == NULL || !index->shared)
 		{
-			case RPTREPORT_SECTION_REPORT_HEADER:
-				if (priv->report_header == NULL)
-					{
-						priv->report_header = (ReportHeader *)g_malloc0 (sizeof (ReportHeader));
-						priv->report_header->objects = NULL;
-					}
-				break;
+			return rpt_object;
+		}
 
-			case RPTREPORT_SECTION_REPORT_FOOTER:
-				if (priv->report_footer == NULL)
-					{
-						priv->report_footer = (ReportFooter *)g_malloc0 (sizeof (ReportFooter));
-						priv->report_footer->objects = NULL;
-					}
-				break;
+	xnode = xmlNewNode (NULL, "object");
+	rpt_object_get_xml (rpt_object, xnode);
+	copy = rpt_report_object_new_from_xml (xnode);
+	xmlFreeNode (xnode);
 
-			case RPTREPORT_SECTION_PAGE_HEADER:
-				if (priv->page_header == NULL)
-					{
-						priv->page_header = (PageHeader *)g_malloc0 (sizeof (PageHeader));
-						priv->page_header->objects = NULL;
-					}
-				break;
+	if (copy == NULL
+	    || !rpt_report_section_get_object_list (rpt_report, index->section, &objects, &objects_last)
+	    || (link = g_list_find (*objects, rpt_object)) == NULL)
+		{
+			g_warning ("Unable to copy the shared object «%s».", index->name);
+			if (copy != NULL)
+				{
+					g_object_unref (copy);
+				}
+			return rpt_object;
+		}
 
-			case RPTREPORT_SECTION_PAGE_FOOTER:
-				if (priv->page_footer == NULL)
-					{
-						priv->page_footer = (PageFooter *)g_malloc0 (sizeof (PageFooter));
-						priv->page_footer->objects = NULL;
-					}
-				break;
+	link->data = copy;
 
-			case RPTREPORT_SECTION_BODY:
-				/*g_warning ("Body cannot be created.");*/
-				break;
+	/* the index moves to the copy, with its name */
+	g_hash_table_steal (priv->objects_index, rpt_object);
+	index->shared = FALSE;
+	g_hash_table_insert (priv->objects_index, copy, index);
+	if (g_hash_table_lookup (priv->objects_by_name, index->name) == (gpointer)rpt_object)
+		{
+			g_hash_table_insert (priv->objects_by_name, index->name, copy);
 		}
+
+	g_signal_handlers_disconnect_by_func (rpt_object,
+	                                      rpt_report_on_object_name_changed,
+	                                      rpt_report);
+	g_signal_connect (copy, "notify::name",
+	                  G_CALLBACK (rpt_report_on_object_name_changed), rpt_report);
+	g_object_unref (rpt_object);
+
+	return copy;
 }
 
-/** 
- * rpt_report_object_is_in_section:
- * @rpt_report: an #RptReport object.
- * @rpt_object: an #RptObject object.
- * @section:
+/**
+ * rpt_report_section_unindex_objects:
+ * @rpt_report:
+ * @objects: a #GList of #RptObject.
  *
- * Returns: TRUE if rpt_object is contained into 
+ * Removes @objects from the name index; the list itself is not changed.
  */
-static gboolean
-rpt_report_object_is_in_section (RptReport *rpt_report, RptObject *rpt_object, RptReportSection section)
+static void
+rpt_report_section_unindex_objects (RptReport *rpt_report, GList *objects)
 {
-	gboolean ret = FALSE;
-	GList *list = NULL;
+	ObjectIndex *index;
 
 	RptReportPrivate *priv = RPT_REPORT_GET_PRIVATE (rpt_report);
 
-	switch (section)
+	for (; objects != NULL; objects = objects->next)
 		{
-			case RPTREPORT_SECTION_REPORT_HEADER:
-				if (priv->report_header != NULL)
-					{
-						list = priv->report_header->objects;
-					}
-				break;
-
-			case RPTREPORT_SECTION_REPORT_FOOTER:
-				if (priv->report_footer != NULL)
-					{
-						list = priv->report_footer->objects;
-					}
-				break;
-
-			case RPTREPORT_SECTION_PAGE_HEADER:
-				if (priv->page_header != NULL)
-					{
-						list = priv->page_header->objects;
-					}
-				break;
-
-			case RPTREPORT_SECTION_PAGE_FOOTER:
-				if (priv->page_footer != NULL)
-					{
-						list = priv->page_footer->objects;
-					}
-				break;
-
-			case RPTREPORT_SECTION_BODY:
-				list = priv->body->objects;
-				break;
+			index = (ObjectIndex *)g_hash_table_lookup (priv->objects_index, objects->data);
+			if (index == NULL)
+				{
+					continue;
+				}
 
-			default:
-				return FALSE;
-		}
+			g_signal_handlers_disconnect_by_func (objects->data,
+			                                      rpt_report_on_object_name_changed,
+			                                      rpt_report);
 
-	if (list != NULL)
-		{
-			list = g_list_first (list);
-			while (list != NULL)
+			if (g_hash_table_lookup (priv->objects_by_name, index->name) == objects->data)
 				{
-					if ((RptObject *)list->data == rpt_object)
-						{
-							ret = TRUE;
-							break;
-						}
-
-					list = g_list_next (list);
+					g_hash_table_remove (priv->objects_by_name, index->name);
 				}
+			g_hash_table_remove (priv->objects_index, objects->data);
 		}
-
-	return ret;
 }
 
 /**
- * rpt_report_section_get_xml:
- * @rpt_report: an #RptReport object.
- * @section:
+ * rpt_report_section_free_objects:
+ * @rpt_report:
+ * @objects: a section's objects.
  *
+ * Unindexes and unrefs @objects, and frees the list.
  */
-static xmlNode
-*rpt_report_section_get_xml (RptReport *rpt_report , RptReportSection section)
+static void
+rpt_report_section_free_objects (RptReport *rpt_report, GList *objects)
 {
-	xmlNode *xnode = NULL;
-	xmlNode *xnodechild;
-	gdouble height;
-	GList *objects;
-	RptObject *rptobj;
+	rpt_report_section_unindex_objects (rpt_report, objects);
+	g_list_free_full (objects, g_object_unref);
+}
 
-	RptReportPrivate *priv = RPT_REPORT_GET_PRIVATE (rpt_report);
+static void
+rpt_report_database_free (Database *db)
+{
+	if (db == NULL)
+		{
+			return;
+		}
 
-	switch (section)
+	g_free (db->provider_id);
+	g_free (db->connection_string);
+	g_free (db->sql);
+
+	if (db->source != NULL)
 		{
-			case RPTREPORT_SECTION_REPORT_HEADER:
-				xnode = xmlNewNode (NULL, "report-header");
-				height = priv->report_header->height;
+			g_object_unref (db->source);
+		}
+	if (db->params != NULL)
+		{
+			g_object_unref (db->params);
+		}
+	if (db->stmt != NULL)
+		{
+			g_object_unref (db->stmt);
+		}
+	if (db->gda_conn != NULL)
+		{
+			gda_connection_close_no_warning (db->gda_conn);
+			g_object_unref (db->gda_conn);
+		}
+	if (db->columns != NULL)
+		{
+			g_hash_table_destroy (db->columns);
+		}
+
+	g_free (db);
+}
+
+/* opens the connection, and parses and prepares the query, the first time;
+ * then executes the query with the current values of the parameters */
+static gboolean
+rpt_report_database_execute (RptReport *rpt_report, GError **error)
+{
+	GdaSqlParser *parser;
+	GdaDataModel *data_model;
+
+	RptReportPrivate *priv = RPT_REPORT_GET_PRIVATE (rpt_report);
+
+	/* a connection closed by the server is opened again, and the query
+	 * prepared again on it */
+	if (priv->db->gda_conn != NULL && !gda_connection_is_opened (priv->db->gda_conn))
+		{
+			if (priv->db->params != NULL)
+				{
+					g_object_unref (priv->db->params);
+					priv->db->params = NULL;
+				}
+			if (priv->db->stmt != NULL)
+				{
+					g_object_unref (priv->db->stmt);
+					priv->db->stmt = NULL;
+				}
+			g_object_unref (priv->db->gda_conn);
+			priv->db->gda_conn = NULL;
+		}
+
+	if (priv->db->gda_conn == NULL)
+		{
+			gda_init ();
+			priv->db->gda_conn = gda_connection_open_from_string (priv->db->provider_id,
+			                                                      priv->db->connection_string,
+			                                                      NULL,
+			                                                      GDA_CONNECTION_OPTIONS_NONE,
+			                                                      error);
+			if (priv->db->gda_conn == NULL)
+				{
+					g_prefix_error (error, "Unable to establish the connection: ");
+					return FALSE;
+				}
+		}
+
+	if (priv->db->stmt == NULL)
+		{
+			parser = gda_connection_create_parser (priv->db->gda_conn);
+			if (parser == NULL)
+				{
+					parser = gda_sql_parser_new ();
+				}
+			priv->db->stmt = gda_sql_parser_parse_string (parser, priv->db->sql, NULL, error);
+			g_object_unref (parser);
+			if (priv->db->stmt == NULL)
+				{
+					return FALSE;
+				}
+			if (!gda_statement_get_parameters (priv->db->stmt, &priv->db->params, error))
+				{
+					g_object_unref (priv->db->stmt);
+					priv->db->stmt = NULL;
+					return FALSE;
+				}
+
+			/* a provider that can't prepare it only executes it */
+			gda_connection_statement_prepare (priv->db->gda_conn, priv->db->stmt, NULL);
+		}
+
+	if (priv->db->params != NULL
+	    && !rpt_report_bind_parameters (rpt_report, priv->db->params, error))
+		{
+			return FALSE;
+		}
+
+	data_model = gda_connection_statement_execute_select (priv->db->gda_conn, priv->db->stmt, priv->db->params, error);
+	if (data_model == NULL)
+		{
+			return FALSE;
+		}
+
+	/* the source of the last run, maybe inside a prefetch, is replaced */
+	if (priv->db->source != NULL)
+		{
+			g_object_unref (priv->db->source);
+		}
+	priv->db->source = rpt_data_source_gda_new (data_model);
+	priv->db->prefetching = FALSE;
+	g_object_unref (data_model);
+
+	return TRUE;
+}
+
+/* binds every parameter of the query to the report's parameter with the
+ * same name; nothing is ever written into the SQL */
+static gboolean
+rpt_report_bind_parameters (RptReport *rpt_report, GdaSet *params, GError **error)
+{
+	GSList *holders;
+	GdaHolder *holder;
+	Parameter *param;
+	gchar *str;
+	gboolean ok;
+
+	ok = TRUE;
+	for (holders = params->holders; holders != NULL && ok; holders = holders->next)
+		{
+			holder = GDA_HOLDER (holders->data);
+			param = rpt_report_parameter_find (rpt_report, gda_holder_get_id (holder));
+			if (param == NULL)
+				{
+					g_set_error (error, RPT_REPORT_ERROR, RPT_REPORT_ERROR_INVALID_PARAMETER,
+					             "The parameter «%s» of the query isn't declared.",
+					             gda_holder_get_id (holder));
+					ok = FALSE;
+				}
+			else if (gda_value_is_null (param->value)
+			         || G_VALUE_TYPE (param->value) == gda_holder_get_g_type (holder))
+				{
+					ok = gda_holder_set_value (holder, param->value, error);
+				}
+			else
+				{
+					/* the holder converts it to its own type */
+					str = gda_value_stringify (param->value);
+					ok = gda_holder_set_value_str (holder, NULL, str, error);
+					g_free (str);
+				}
+		}
+
+	return ok;
+}
+
+static Parameter
+*rpt_report_parameter_find (RptReport *rpt_report, const gchar *name)
+{
+	Parameter *param;
+	guint i;
+
+	RptReportPrivate *priv = RPT_REPORT_GET_PRIVATE (rpt_report);
+
+	for (i = 0; i < priv->parameters->len; i++)
+		{
+			param = (Parameter *)g_ptr_array_index (priv->parameters, i);
+			if (g_strcmp0 (param->name, name) == 0)
+				{
+					return param;
+				}
+		}
+
+	return NULL;
+}
+
+/* declares a parameter, with a null value */
+static Parameter
+*rpt_report_parameter_add (RptReport *rpt_report, const gchar *name, GType type)
+{
+	Parameter *param;
+
+	RptReportPrivate *priv = RPT_REPORT_GET_PRIVATE (rpt_report);
+
+	param = g_new0 (Parameter, 1);
+	param->name = g_strdup (name);
+	param->type = type;
+	param->value = gda_value_new_null ();
+	g_ptr_array_add (priv->parameters, param);
+
+	return param;
+}
+
+static void
+rpt_report_parameter_free (Parameter *param)
+{
+	g_free (param->name);
+	gda_value_free (param->value);
+	g_free (param);
+}
+
+/**
+ * rpt_report_section_get_object_list:
+ * @rpt_report:
+ * @section:
+ * @objects: where to return the address of @section's objects list.
+ * @objects_last: where to return the address of the list's last element.
+ *
+ * Returns: FALSE if @section doesn't exist.
+ */
+static gboolean
+rpt_report_section_get_object_list (RptReport *rpt_report,
+                                    RptReportSection section,
+                                    GList ***objects,
+                                    GList ***objects_last)
+{
+	RptReportPrivate *priv = RPT_REPORT_GET_PRIVATE (rpt_report);
+
+	switch (section)
+		{
+			case RPTREPORT_SECTION_REPORT_HEADER:
+				if (priv->report_header == NULL)
+					{
+						return FALSE;
+					}
+				*objects = &priv->report_header->objects;
+				*objects_last = &priv->report_header->objects_last;
+				break;
+
+			case RPTREPORT_SECTION_REPORT_FOOTER:
+				if (priv->report_footer == NULL)
+					{
+						return FALSE;
+					}
+				*objects = &priv->report_footer->objects;
+				*objects_last = &priv->report_footer->objects_last;
+				break;
+
+			case RPTREPORT_SECTION_PAGE_HEADER:
+				if (priv->page_header == NULL)
+					{
+						return FALSE;
+					}
+				*objects = &priv->page_header->objects;
+				*objects_last = &priv->page_header->objects_last;
+				break;
+
+			case RPTREPORT_SECTION_PAGE_FOOTER:
+				if (priv->page_footer == NULL)
+					{
+						return FALSE;
+					}
+				*objects = &priv->page_footer->objects;
+				*objects_last = &priv->page_footer->objects_last;
+				break;
+
+			case RPTREPORT_SECTION_BODY:
+				*objects = &priv->body->objects;
+				*objects_last = &priv->body->objects_last;
+				break;
+
+			default:
+				return FALSE;
+		}
+
+	return TRUE;
+}
+
+/**
+ * rpt_report_object_get_section:
+ * @rpt_report: an #RptReport object.
+ * @rpt_object: an #RptObject object.
+ *
+ * Returns: the #RptReportSection in which @rpt_object is contained.
+ */
+static RptReportSection
+rpt_report_object_get_section (RptReport *rpt_report, RptObject *rpt_object)
+{
+	RptReportSection section = -1;
+	ObjectIndex *index;
+
+	RptReportPrivate *priv = RPT_REPORT_GET_PRIVATE (rpt_report);
+
+	index = (ObjectIndex *)g_hash_table_lookup (priv->objects_index, rpt_object);
+	if (index != NULL)
+		{
+			section = index->section;
+		}
+
+	return section;
+}
+
+/**
+ * rpt_report_section_create:
+ * @rpt_report:
+ * @section:
+ *
+ */
+static void
+rpt_report_section_create (RptReport *rpt_report, RptReportSection section)
+{
+	RptReportPrivate *priv = RPT_REPORT_GET_PRIVATE (rpt_report);
+
+	switch (section)
+		{
+			case RPTREPORT_SECTION_REPORT_HEADER:
+				if (priv->report_header == NULL)
+					{
+						priv->report_header = (ReportHeader *)g_malloc0 (sizeof (ReportHeader));
+						priv->report_header->objects = NULL;
+					}
+				break;
+
+			case RPTREPORT_SECTION_REPORT_FOOTER:
+				if (priv->report_footer == NULL)
+					{
+						priv->report_footer = (ReportFooter *)g_malloc0 (sizeof (ReportFooter));
+						priv->report_footer->objects = NULL;
+					}
+				break;
+
+			case RPTREPORT_SECTION_PAGE_HEADER:
+				if (priv->page_header == NULL)
+					{
+						priv->page_header = (PageHeader *)g_malloc0 (sizeof (PageHeader));
+						priv->page_header->objects = NULL;
+					}
+				break;
+
+			case RPTREPORT_SECTION_PAGE_FOOTER:
+				if (priv->page_footer == NULL)
+					{
+						priv->page_footer = (PageFooter *)g_malloc0 (sizeof (PageFooter));
+						priv->page_footer->objects = NULL;
+					}
+				break;
+
+			case RPTREPORT_SECTION_BODY:
+				/*g_warning ("Body cannot be created.");*/
+				break;
+		}
+}
+
+/**
+ * rpt_report_section_get_xml:
+ * @rpt_report: an #RptReport object.
+ * @section:
+ *
+ */
+static xmlNode
+*rpt_report_section_get_xml (RptReport *rpt_report , RptReportSection section)
+{
+	xmlNode *xnode = NULL;
+	xmlNode *xnodechild;
+	gdouble height;
+	GList *objects;
+	RptObject *rptobj;
+	gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+
+	RptReportPrivate *priv = RPT_REPORT_GET_PRIVATE (rpt_report);
+
+	switch (section)
+		{
+			case RPTREPORT_SECTION_REPORT_HEADER:
+				xnode = xmlNewNode (NULL, "report-header");
+				height = priv->report_header->height;
 				objects = priv->report_header->objects;
 				if (priv->report_header->new_page_after)
 					{
 						xmlSetProp (xnode, "new-page-after", "y");
 					}
+				if (priv->report_header->can_grow)
+					{
+						xmlSetProp (xnode, "can-grow", "y");
+					}
+				if (priv->report_header->can_shrink)
+					{
+						xmlSetProp (xnode, "can-shrink", "y");
+					}
 				break;
 
 			case RPTREPORT_SECTION_REPORT_FOOTER:
@@ -2605,6 +3371,14 @@ static xmlNode
 					{
 						xmlSetProp (xnode, "new-page-before", "y");
 					}
+				if (priv->report_footer->can_grow)
+					{
+						xmlSetProp (xnode, "can-grow", "y");
+					}
+				if (priv->report_footer->can_shrink)
+					{
+						xmlSetProp (xnode, "can-shrink", "y");
+					}
 				break;
 
 			case RPTREPORT_SECTION_PAGE_HEADER:
@@ -2643,9 +3417,17 @@ static xmlNode
 					{
 						xmlSetProp (xnode, "new-page-after", "y");
 					}
+				if (priv->body->can_grow)
+					{
+						xmlSetProp (xnode, "can-grow", "y");
+					}
+				if (priv->body->can_shrink)
+					{
+						xmlSetProp (xnode, "can-shrink", "y");
+					}
 				break;
 		}
-	xmlSetProp (xnode, "height", g_strdup_printf ("%f", height));
+	xmlSetProp (xnode, "height", g_ascii_formatd (buf, sizeof (buf), "%f", height));
 
 	objects = g_list_first (objects);
 	while (objects != NULL)
@@ -2662,48 +3444,391 @@ static xmlNode
 	return xnode;
 }
 
-static void
-rpt_report_xml_parse_section (RptReport *rpt_report, xmlNode *xnode, RptReportSection section)
+/* maps @filename and builds its tree, from xml or, if @allow_compiled,
+ * from a compiled template */
+static xmlDoc
+*rpt_report_read_file (const gchar *filename, gboolean allow_compiled, GError **error)
 {
-	RptObject *rptobj;
-	GList *objects = NULL;
-	gdouble height;
-	gchar *prop;
-	gchar *objname;
-	xmlNode *cur;
-
-	RptReportPrivate *priv = RPT_REPORT_GET_PRIVATE (rpt_report);
+	GMappedFile *mapped;
+	GError *mapped_error;
+	const gchar *data;
+	gsize length;
+	xmlDoc *xdoc;
+	xmlErrorPtr xerror;
 
-	prop = (gchar *)xmlGetProp (xnode, "height");
-	if (prop != NULL)
+	mapped_error = NULL;
+	mapped = g_mapped_file_new (filename, FALSE, &mapped_error);
+	if (mapped == NULL)
 		{
-			height = g_strtod (g_strstrip (g_strdup (prop)), NULL);
+			g_set_error (error, RPT_REPORT_ERROR, RPT_REPORT_ERROR_INVALID_XML,
+			             "Unable to open «%s»: %s", filename, mapped_error->message);
+			g_error_free (mapped_error);
+			return NULL;
 		}
 
-	cur = xnode->children;
-	while (cur != NULL)
+	/* an empty file isn't mapped, and the contents are NULL */
+	data = g_mapped_file_get_contents (mapped);
+	length = g_mapped_file_get_length (mapped);
+
+	if (rpt_compiled_is_compiled (data, length))
 		{
-			if (g_strcmp0 (cur->name, "text") == 0)
-				{
-					rptobj = rpt_obj_text_new_from_xml (cur);
-				}
-			else if (g_strcmp0 (cur->name, "line") == 0)
+			if (allow_compiled)
 				{
-					rptobj = rpt_obj_line_new_from_xml (cur);
+					xdoc = rpt_compiled_read (data, length, error);
+					if (xdoc == NULL)
+						{
+							g_prefix_error (error, "Unable to load «%s»: ", filename);
+						}
 				}
-			else if (g_strcmp0 (cur->name, "rect") == 0)
+			else
 				{
-					rptobj = rpt_obj_rect_new_from_xml (cur);
+					xdoc = NULL;
+					g_set_error (error, RPT_REPORT_ERROR, RPT_REPORT_ERROR_INVALID_XML,
+					             "«%s» is already compiled.", filename);
 				}
-			else if (g_strcmp0 (cur->name, "ellipse") == 0)
+		}
+	else
+		{
+			xdoc = data != NULL ? xmlReadMemory (data, length, filename, NULL, 0) : NULL;
+			if (xdoc == NULL)
+				{
+					xerror = xmlGetLastError ();
+					g_set_error (error, RPT_REPORT_ERROR, RPT_REPORT_ERROR_INVALID_XML,
+					             "Unable to parse «%s»: %s", filename,
+					             data != NULL && xerror != NULL && xerror->message != NULL ? g_strstrip (xerror->message) : "the file is empty");
+				}
+		}
+
+	g_mapped_file_unref (mapped);
+
+	return xdoc;
+}
+
+/* FALSE, with error set, if a node with the same name was already found */
+static gboolean
+rpt_report_xml_check_once (xmlNode *xnode, xmlNode **found, GError **error)
+{
+	if (*found != NULL)
+		{
+			g_set_error (error, RPT_REPORT_ERROR, RPT_REPORT_ERROR_DUPLICATE_NODE,
+			             "Only one node «%s» is allowed (line %ld).",
+			             (const gchar *)xnode->name, xmlGetLineNo (xnode));
+			return FALSE;
+		}
+
+	*found = xnode;
+
+	return TRUE;
+}
+
+static void
+rpt_report_xml_parse_properties (RptReport *rpt_report, xmlNode *xnode)
+{
+	gchar *content;
+	RptTranslation *translation;
+	xmlNode *cur;
+
+	for (cur = xnode->children; cur != NULL; cur = cur->next)
+		{
+			if (cur->type != XML_ELEMENT_NODE)
+				{
+					continue;
+				}
+
+			content = (gchar *)xmlNodeGetContent (cur);
+
+			if (g_strcmp0 (cur->name, "name") == 0)
+				{
+					g_object_set (G_OBJECT (rpt_report), "name", content, NULL);
+				}
+			else if (g_strcmp0 (cur->name, "description") == 0)
+				{
+					g_object_set (G_OBJECT (rpt_report), "description", content, NULL);
+				}
+			else if (g_strcmp0 (cur->name, "unit-length") == 0)
+				{
+					g_object_set (G_OBJECT (rpt_report), "unit-length", rpt_common_strunit_to_enum (content), NULL);
+				}
+			else if (g_strcmp0 (cur->name, "output-type") == 0)
+				{
+					rpt_report_set_output_type (rpt_report, rpt_common_stroutputtype_to_enum (content));
+				}
+			else if (g_strcmp0 (cur->name, "output-filename") == 0)
+				{
+					rpt_report_set_output_filename (rpt_report, content);
+				}
+			else if (g_strcmp0 (cur->name, "copies") == 0)
+				{
+					rpt_report_set_copies (rpt_report, strtol (content, NULL, 10));
+				}
+			else if (g_strcmp0 (cur->name, "translation") == 0)
+				{
+					translation = rpt_common_get_translation (cur);
+					rpt_report_set_translation (rpt_report, translation);
+					g_free (translation);
+				}
+
+			xmlFree (content);
+		}
+}
+
+static void
+rpt_report_xml_parse_database (RptReport *rpt_report, xmlNode *xnode)
+{
+	gchar *provider_id;
+	gchar *connection_string;
+	gchar *sql;
+	xmlNode *cur;
+
+	provider_id = NULL;
+	connection_string = NULL;
+	sql = NULL;
+
+	for (cur = xnode->children; cur != NULL; cur = cur->next)
+		{
+			if (cur->type != XML_ELEMENT_NODE)
+				{
+					continue;
+				}
+
+			if (g_strcmp0 (cur->name, "provider") == 0)
+				{
+					g_free (provider_id);
+					provider_id = g_strstrip ((gchar *)xmlNodeGetContent (cur));
+				}
+			else if (g_strcmp0 (cur->name, "connection-string") == 0)
+				{
+					g_free (connection_string);
+					connection_string = g_strstrip ((gchar *)xmlNodeGetContent (cur));
+				}
+			else if (g_strcmp0 (cur->name, "sql") == 0)
+				{
+					g_free (sql);
+					sql = g_strstrip ((gchar *)xmlNodeGetContent (cur));
+				}
+		}
+
+	if (provider_id == NULL || g_strcmp0 (provider_id, "") == 0
+	    || connection_string == NULL || g_strcmp0 (connection_string, "") == 0
+	    || sql == NULL || g_strcmp0 (sql, "") == 0)
+		{
+			/* TO DO */
+		}
+	else
+		{
+			rpt_report_set_database (rpt_report, provider_id, connection_string, sql);
+		}
+
+	g_free (provider_id);
+	g_free (connection_string);
+	g_free (sql);
+}
+
+static gboolean
+rpt_report_xml_parse_parameters (RptReport *rpt_report, xmlNode *xnode, GError **error)
+{
+	Parameter *param;
+	gchar *name;
+	gchar *type_name;
+	gchar *default_value;
+	GType type;
+	gboolean ok;
+	xmlNode *cur;
+
+	ok = TRUE;
+	for (cur = xnode->children; cur != NULL && ok; cur = cur->next)
+		{
+			if (cur->type != XML_ELEMENT_NODE
+			    || g_strcmp0 (cur->name, "parameter") != 0)
+				{
+					continue;
+				}
+
+			name = (gchar *)xmlGetProp (cur, "name");
+			type_name = (gchar *)xmlGetProp (cur, "type");
+			default_value = (gchar *)xmlGetProp (cur, "default");
+
+			type = type_name == NULL ? G_TYPE_STRING : gda_g_type_from_string (g_strstrip (type_name));
+			if (name == NULL || g_strcmp0 (g_strstrip (name), "") == 0)
+				{
+					g_set_error (error, RPT_REPORT_ERROR, RPT_REPORT_ERROR_INVALID_VALUE,
+					             "Node «parameter» must have a name (line %ld).",
+					             xmlGetLineNo (cur));
+					ok = FALSE;
+				}
+			else if (type == G_TYPE_INVALID)
+				{
+					g_set_error (error, RPT_REPORT_ERROR, RPT_REPORT_ERROR_INVALID_VALUE,
+					             "The type «%s» of the parameter «%s» is unknown (line %ld).",
+					             type_name, name, xmlGetLineNo (cur));
+					ok = FALSE;
+				}
+			else if (rpt_report_parameter_find (rpt_report, name) != NULL)
+				{
+					g_set_error (error, RPT_REPORT_ERROR, RPT_REPORT_ERROR_DUPLICATE_NODE,
+					             "The parameter «%s» is declared twice (line %ld).",
+					             name, xmlGetLineNo (cur));
+					ok = FALSE;
+				}
+			else
+				{
+					param = rpt_report_parameter_add (rpt_report, name, type);
+					if (default_value != NULL)
+						{
+							gda_value_free (param->value);
+							param->value = gda_value_new_from_string (default_value, type);
+							if (param->value == NULL)
+								{
+									param->value = gda_value_new_null ();
+									g_set_error (error, RPT_REPORT_ERROR, RPT_REPORT_ERROR_INVALID_VALUE,
+									             "The default «%s» of the parameter «%s» isn't a valid %s (line %ld).",
+									             default_value, name, gda_g_type_to_string (type), xmlGetLineNo (cur));
+									ok = FALSE;
+								}
+						}
+				}
+
+			xmlFree (name);
+			xmlFree (type_name);
+			xmlFree (default_value);
+		}
+
+	return ok;
+}
+
+static gboolean
+rpt_report_xml_parse_page (RptReport *rpt_report, xmlNode *xnode, GError **error)
+{
+	gchar *prop;
+	gdouble margin_top = 0.0;
+	gdouble margin_right = 0.0;
+	gdouble margin_bottom = 0.0;
+	gdouble margin_left = 0.0;
+	RptSize *size;
+
+	size = rpt_common_get_size (xnode);
+	if (size == NULL)
+		{
+			g_set_error (error, RPT_REPORT_ERROR, RPT_REPORT_ERROR_INVALID_VALUE,
+			             "Node «page» must have width and height (line %ld).",
+			             xmlGetLineNo (xnode));
+			return FALSE;
+		}
+	rpt_report_set_page_size (rpt_report, *size);
+	g_free (size);
+
+	prop = xmlGetProp (xnode, "margin-top");
+	if (prop != NULL)
+		{
+			margin_top = g_strtod (prop, NULL);
+			xmlFree (prop);
+		}
+	prop = xmlGetProp (xnode, "margin-right");
+	if (prop != NULL)
+		{
+			margin_right = g_strtod (prop, NULL);
+			xmlFree (prop);
+		}
+	prop = xmlGetProp (xnode, "margin-bottom");
+	if (prop != NULL)
+		{
+			margin_bottom = g_strtod (prop, NULL);
+			xmlFree (prop);
+		}
+	prop = xmlGetProp (xnode, "margin-left");
+	if (prop != NULL)
+		{
+			margin_left = g_strtod (prop, NULL);
+			xmlFree (prop);
+		}
+	rpt_report_set_page_margins (rpt_report, margin_top, margin_right, margin_bottom, margin_left);
+
+	return TRUE;
+}
+
+static gboolean
+rpt_report_xml_parse_report (RptReport *rpt_report, xmlNode *xnode, GError **error)
+{
+	xmlNode *cur;
+	xmlNode *xsections[5] = { NULL, NULL, NULL, NULL, NULL };
+	RptReportSection section;
+
+	for (cur = xnode->children; cur != NULL; cur = cur->next)
+		{
+			if (cur->type != XML_ELEMENT_NODE)
+				{
+					continue;
+				}
+
+			if (g_strcmp0 (cur->name, "report-header") == 0)
+				{
+					section = RPTREPORT_SECTION_REPORT_HEADER;
+				}
+			else if (g_strcmp0 (cur->name, "report-footer") == 0)
+				{
+					section = RPTREPORT_SECTION_REPORT_FOOTER;
+				}
+			else if (g_strcmp0 (cur->name, "page-header") == 0)
+				{
+					section = RPTREPORT_SECTION_PAGE_HEADER;
+				}
+			else if (g_strcmp0 (cur->name, "page-footer") == 0)
 				{
-					rptobj = rpt_obj_ellipse_new_from_xml (cur);
+					section = RPTREPORT_SECTION_PAGE_FOOTER;
 				}
-			else if (g_strcmp0 (cur->name, "image") == 0)
+			else if (g_strcmp0 (cur->name, "body") == 0)
 				{
-					rptobj = rpt_obj_image_new_from_xml (cur);
+					section = RPTREPORT_SECTION_BODY;
 				}
+			else
+				{
+					continue;
+				}
+
+			if (!rpt_report_xml_check_once (cur, &xsections[section], error))
+				{
+					return FALSE;
+				}
+
+			rpt_report_section_create (rpt_report, section);
+			rpt_report_xml_parse_section (rpt_report, cur, section);
+		}
+
+	if (xsections[RPTREPORT_SECTION_BODY] == NULL)
+		{
+			g_set_error (error, RPT_REPORT_ERROR, RPT_REPORT_ERROR_MISSING_NODE,
+			             "Node «body» is missing (line %ld).",
+			             xmlGetLineNo (xnode));
+			return FALSE;
+		}
+
+	return TRUE;
+}
+
+static void
+rpt_report_xml_parse_section (RptReport *rpt_report, xmlNode *xnode, RptReportSection section)
+{
+	RptObject *rptobj;
+	GList *objects = NULL;
+	gdouble height;
+	gchar *prop;
+	gchar *objname;
+	xmlNode *cur;
+
+	RptReportPrivate *priv = RPT_REPORT_GET_PRIVATE (rpt_report);
+
+	height = 0.0;
+	prop = (gchar *)xmlGetProp (xnode, "height");
+	if (prop != NULL)
+		{
+			height = g_strtod (g_strstrip (prop), NULL);
+			xmlFree (prop);
+		}
 
+	cur = xnode->children;
+	while (cur != NULL)
+		{
+			rptobj = rpt_report_object_new_from_xml (cur);
 			if (rptobj != NULL)
 				{
 					rpt_report_add_object_to_section (rpt_report, rptobj, section);
@@ -2726,6 +3851,7 @@ rpt_report_xml_parse_section (RptReport *rpt_report, xmlNode *xnode, RptReportSe
 							}
 						xmlFree (prop);
 					}
+				rpt_report_xml_parse_section_grow_shrink (xnode, &priv->report_header->can_grow, &priv->report_header->can_shrink);
 				break;
 
 			case RPTREPORT_SECTION_REPORT_FOOTER:
@@ -2740,6 +3866,7 @@ rpt_report_xml_parse_section (RptReport *rpt_report, xmlNode *xnode, RptReportSe
 							}
 						xmlFree (prop);
 					}
+				rpt_report_xml_parse_section_grow_shrink (xnode, &priv->report_footer->can_grow, &priv->report_footer->can_shrink);
 				break;
 
 			case RPTREPORT_SECTION_PAGE_HEADER:
@@ -2784,6 +3911,7 @@ rpt_report_xml_parse_section (RptReport *rpt_report, xmlNode *xnode, RptReportSe
 							{
 								priv->page_footer->last_page = TRUE;
 							}
+						xmlFree (prop);
 					}
 				break;
 
@@ -2799,8 +3927,78 @@ rpt_report_xml_parse_section (RptReport *rpt_report, xmlNode *xnode, RptReportSe
 							}
 						xmlFree (prop);
 					}
+				rpt_report_xml_parse_section_grow_shrink (xnode, &priv->body->can_grow, &priv->body->can_shrink);
+				break;
+		}
+}
+
+static void
+rpt_report_xml_parse_section_grow_shrink (xmlNode *xnode, gboolean *can_grow, gboolean *can_shrink)
+{
+	gchar *prop;
+
+	prop = xmlGetProp (xnode, "can-grow");
+	if (prop != NULL)
+		{
+			*can_grow = (strcasecmp (g_strstrip (prop), "y") == 0);
+			xmlFree (prop);
+		}
+	prop = xmlGetProp (xnode, "can-shrink");
+	if (prop != NULL)
+		{
+			*can_shrink = (strcasecmp (g_strstrip (prop), "y") == 0);
+			xmlFree (prop);
+		}
+}
+
+static gboolean
+rpt_report_section_get_grow_shrink (RptReport *rpt_report,
+                                    RptReportSection section,
+                                    gboolean *can_grow,
+                                    gboolean *can_shrink)
+{
+	gboolean grow = FALSE;
+	gboolean shrink = FALSE;
+
+	RptReportPrivate *priv = RPT_REPORT_GET_PRIVATE (rpt_report);
+
+	switch (section)
+		{
+			case RPTREPORT_SECTION_REPORT_HEADER:
+				if (priv->report_header != NULL)
+					{
+						grow = priv->report_header->can_grow;
+						shrink = priv->report_header->can_shrink;
+					}
 				break;
+
+			case RPTREPORT_SECTION_REPORT_FOOTER:
+				if (priv->report_footer != NULL)
+					{
+						grow = priv->report_footer->can_grow;
+						shrink = priv->report_footer->can_shrink;
+					}
+				break;
+
+			case RPTREPORT_SECTION_BODY:
+				grow = priv->body->can_grow;
+				shrink = priv->body->can_shrink;
+				break;
+
+			default:
+				break;
+		}
+
+	if (can_grow != NULL)
+		{
+			*can_grow = grow;
+		}
+	if (can_shrink != NULL)
+		{
+			*can_shrink = shrink;
 		}
+
+	return grow || shrink;
 }
 
 static xmlNode
@@ -2808,23 +4006,19 @@ static xmlNode
 {
 	xmlNode *xnode;
 
-	xmlXPathContextPtr xpcontext;
-	xmlXPathObjectPtr xpresult;
-	xmlNodeSetPtr xnodeset;
-
-	xnode = NULL;
-
-	xpcontext = xmlXPathNewContext (xdoc);
+	xnode = xmlDocGetRootElement (xdoc);
+	if (xnode == NULL)
+		{
+			return NULL;
+		}
 
 	/* search for node "properties" */
-	xpcontext->node = xmlDocGetRootElement (xdoc);
-	xpresult = xmlXPathEvalExpression ((const xmlChar *)"child::properties", xpcontext);
-	if (!xmlXPathNodeSetIsEmpty (xpresult->nodesetval))
+	for (xnode = xnode->children; xnode != NULL; xnode = xnode->next)
 		{
-			xnodeset = xpresult->nodesetval;
-			if (xnodeset->nodeNr > 0)
+			if (xnode->type == XML_ELEMENT_NODE
+			    && g_strcmp0 (xnode->name, "properties") == 0)
 				{
-					xnode = xnodeset->nodeTab[0];
+					break;
 				}
 		}
 
@@ -2838,6 +4032,9 @@ static xmlNode
 
 	RptReportPrivate *priv = RPT_REPORT_GET_PRIVATE (rpt_report);
 
+	/* nothing evaluated on the previous page is still referenced */
+	rpt_report_scratch_clear ();
+
 	xnode = rpt_report_rptprint_page_new (xdoc, priv->page->size, priv->page->margin);
 
 	priv->cur_page++;
@@ -2851,40 +4048,210 @@ rpt_report_rptprint_section (RptReport *rpt_report,
                              gdouble *cur_y,
                              RptReportSection section)
 {
-	GList *objects;
-	xmlAttrPtr attr;
+	xmlNode *xband;
+	gdouble height;
+
+	xband = rpt_report_rptprint_section_build (rpt_report, *cur_y, section, &height);
+	rpt_report_rptprint_section_place (xpage, xband);
+
+	*cur_y += height;
+}
+
+/**
+ * rpt_report_rptprint_section_build:
+ * @rpt_report:
+ * @cur_y: where the section will be placed on the page.
+ * @section:
+ * @height: where to return the section's height, after its can-grow and
+ * can-shrink text objects were fitted to their text.
+ *
+ * Returns: an #xmlNode, not linked to any document, that contains the
+ * section's objects ready to be moved to the page with
+ * rpt_report_rptprint_section_place().
+ */
+static xmlNode
+*rpt_report_rptprint_section_build (RptReport *rpt_report,
+                                    gdouble cur_y,
+                                    RptReportSection section,
+                                    gdouble *height)
+{
+	EmitBand *band;
+	EmitObject *emit;
+	xmlNode *xband;
 	xmlNode *xnode;
-	gchar *prop;
+	guint i;
 
-	RptObject *rptobj;
+	gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+	gchar y_buf[G_ASCII_DTOSTR_BUF_SIZE];
+	gchar *static_id;
+
+	gboolean any_measured;
+	gdouble delta;
+	gdouble max_delta;
+	gdouble bottom;
+	gdouble max_bottom;
+	gdouble max_height;
 
 	RptReportPrivate *priv = RPT_REPORT_GET_PRIVATE (rpt_report);
 
-	switch (section)
-		{
+	band = rpt_report_rptprint_section_get_template (rpt_report, section);
+
+	*height = band->height;
+
+	any_measured = FALSE;
+	max_delta = -G_MAXDOUBLE;
+	max_bottom = 0.0;
+
+	g_ascii_formatd (y_buf, sizeof (y_buf), "%f", cur_y);
+
+	xband = xmlNewNode (NULL, "band");
+	for (i = 0; i < band->objects->len; i++)
+		{
+			emit = (EmitObject *)g_ptr_array_index (band->objects, i);
+
+			if (emit->subreport != NULL)
+				{
+					/* the detail's rows take the place of the object; the band
+					 * is never split, so the detail must fit in the room a page
+					 * has for the body */
+					max_height = priv->page->size->height - priv->page->margin->top - priv->page->margin->bottom
+					             - (priv->page_header != NULL ? priv->page_header->height : 0.0)
+					             - (priv->page_footer != NULL ? priv->page_footer->height : 0.0)
+					             - emit->y;
+					delta = rpt_report_rptprint_subreport (rpt_report, emit->subreport, emit->y + cur_y, max_height, xband) - emit->height;
+
+					any_measured = TRUE;
+					max_delta = MAX (max_delta, delta);
+					max_bottom = MAX (max_bottom, emit->y + emit->height + delta);
+					continue;
+				}
+
+			/* only the position and the evaluated text change from row to row */
+			xnode = xmlCopyNode (emit->xnode, 1);
+
+			g_ascii_formatd (buf, sizeof (buf), "%f", emit->y + cur_y);
+			xmlSetProp (xnode, "y", buf);
+
+			if (emit->field != NULL)
+				{
+					rpt_report_rptprint_format_field (rpt_report, emit, xnode);
+				}
+			else if (emit->source != NULL)
+				{
+					rpt_report_rptprint_eval_source (rpt_report, emit->source, emit->format, xnode);
+				}
+
+			if (emit->static_id != NULL)
+				{
+					/* the same id only where the band is in the same place */
+					static_id = g_strdup_printf ("%s@%s", emit->static_id, y_buf);
+					xmlSetProp (xnode, "static-id", static_id);
+					g_free (static_id);
+				}
+
+			bottom = emit->y + emit->height;
+			if (emit->attrs != NULL)
+				{
+					delta = emit->source != NULL ? rpt_report_rptprint_text_fit (rpt_report, emit, xnode) : emit->static_delta;
+
+					any_measured = TRUE;
+					max_delta = MAX (max_delta, delta);
+					bottom += delta;
+				}
+			max_bottom = MAX (max_bottom, bottom);
+
+			xmlAddChild (xband, xnode);
+		}
+
+	if (any_measured)
+		{
+			if (max_delta > 0.0 && band->can_grow)
+				{
+					*height += max_delta;
+				}
+			else if (max_delta < 0.0 && band->can_shrink)
+				{
+					/* never cut the objects that were not fitted */
+					*height = MAX (*height + max_delta, max_bottom);
+				}
+		}
+
+	return xband;
+}
+
+/**
+ * rpt_report_rptprint_section_get_template:
+ * @rpt_report:
+ * @section:
+ *
+ * Compiles @section, the first time it is requested during a run, into an
+ * #EmitBand: every object is serialized once with its static attributes,
+ * the page's left margin already added to x and its name removed; texts
+ * without fields or specials are evaluated once too, and format masks are
+ * compiled once.
+ *
+ * Returns: the #EmitBand of @section.
+ */
+static EmitBand
+*rpt_report_rptprint_section_get_template (RptReport *rpt_report,
+                                          RptReportSection section)
+{
+	GList *objects;
+	xmlAttrPtr attr;
+	xmlNode *xnode;
+	gchar *prop;
+	gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+
+	RptObject *rptobj;
+	EmitBand *band;
+	EmitObject *emit;
+	guint static_run;
+
+	RptReportPrivate *priv = RPT_REPORT_GET_PRIVATE (rpt_report);
+
+	if (priv->emit_bands[section] != NULL)
+		{
+			return priv->emit_bands[section];
+		}
+
+	band = g_new0 (EmitBand, 1);
+	band->objects = g_ptr_array_new_with_free_func ((GDestroyNotify)rpt_report_emit_object_free);
+
+	switch (section)
+		{
 			case RPTREPORT_SECTION_REPORT_HEADER:
 				objects = g_list_first (priv->report_header->objects);
+				band->height = priv->report_header->height;
 				break;
 
 			case RPTREPORT_SECTION_REPORT_FOOTER:
 				objects = g_list_first (priv->report_footer->objects);
+				band->height = priv->report_footer->height;
 				break;
 
 			case RPTREPORT_SECTION_PAGE_HEADER:
 				objects = g_list_first (priv->page_header->objects);
+				band->height = priv->page_header->height;
 				break;
 
 			case RPTREPORT_SECTION_PAGE_FOOTER:
 				objects = g_list_first (priv->page_footer->objects);
+				band->height = priv->page_footer->height;
 				break;
 
 			case RPTREPORT_SECTION_BODY:
 				objects = g_list_first (priv->body->objects);
+				band->height = priv->body->height;
 				break;
 		}
 
+	rpt_report_section_get_grow_shrink (rpt_report, section, &band->can_grow, &band->can_shrink);
+
+	static_run = 0;
 	while (objects != NULL)
 		{
+			emit = g_new0 (EmitObject, 1);
+
 			xnode = xmlNewNode (NULL, "node");
 
 			rptobj = (RptObject *)objects->data;
@@ -2898,227 +4265,1407 @@ rpt_report_rptprint_section (RptReport *rpt_report,
 			if (priv->page->margin->left != 0.0)
 				{
 					prop = (gchar *)xmlGetProp (xnode, "x");
-					if (prop == NULL)
-						{
-							prop = g_strdup ("0.0");
-						}
-					xmlSetProp (xnode, "x", g_strdup_printf ("%f", g_strtod (prop, NULL) + priv->page->margin->left));
-					xmlFree (prop);
+					g_ascii_formatd (buf, sizeof (buf), "%f",
+					                 (prop != NULL ? g_strtod (prop, NULL) : 0.0) + priv->page->margin->left);
+					xmlSetProp (xnode, "x", buf);
+					if (prop != NULL) xmlFree (prop);
 				}
 
 			prop = (gchar *)xmlGetProp (xnode, "y");
-			if (prop == NULL)
+			if (prop != NULL)
 				{
-					prop = g_strdup ("0.0");
+					emit->y = g_strtod (prop, NULL);
+					xmlFree (prop);
+				}
+
+			prop = (gchar *)xmlGetProp (xnode, "height");
+			if (prop != NULL)
+				{
+					emit->height = g_strtod (prop, NULL);
+					xmlFree (prop);
 				}
-			xmlSetProp (xnode, "y", g_strdup_printf ("%f", g_strtod (prop, NULL) + *cur_y));
-			xmlFree (prop);
 
 			if (IS_RPT_OBJ_TEXT (rptobj))
 				{
-					rpt_report_rptprint_parse_text_source (rpt_report, rptobj, xnode);
+					attr = xmlHasProp (xnode, "can-grow");
+					if (attr != NULL)
+						{
+							emit->can_grow = TRUE;
+							xmlRemoveProp (attr);
+						}
+					attr = xmlHasProp (xnode, "can-shrink");
+					if (attr != NULL)
+						{
+							emit->can_shrink = TRUE;
+							xmlRemoveProp (attr);
+						}
+					if ((emit->can_grow || emit->can_shrink)
+					    && xmlHasProp (xnode, "width") != NULL)
+						{
+							emit->attrs = rpt_layout_attrs_new_from_xml (xnode, priv->unit);
+						}
+
+					prop = (gchar *)xmlGetProp (xnode, "format");
+					if (prop != NULL)
+						{
+							emit->format = rpt_format_new (prop);
+							xmlFree (prop);
+							xmlRemoveProp (xmlHasProp (xnode, "format"));
+						}
+
+					prop = (gchar *)xmlGetProp (xnode, "source");
 					attr = xmlHasProp (xnode, "source");
 					if (attr != NULL)
 						{
 							xmlRemoveProp (attr);
 						}
+
+					if (prop != NULL
+					    && (strchr (prop, '[') != NULL || strchr (prop, '@') != NULL))
+						{
+							/* fields and specials must be evaluated for each row */
+							emit->source = g_strdup (prop);
+
+							/* a lone field is written (and formatted) from its
+							 * typed value, without the parser */
+							gchar *source = g_strstrip (g_strdup (prop));
+							gsize len = strlen (source);
+
+							if (len > 2
+							    && source[0] == '['
+							    && source[len - 1] == ']'
+							    && strpbrk (source + 1, "[]") == source + len - 1)
+								{
+									emit->field = g_strndup (source + 1, len - 2);
+								}
+							g_free (source);
+						}
+					else
+						{
+							rpt_report_rptprint_eval_source (rpt_report, prop != NULL ? prop : "", emit->format, xnode);
+							if (emit->attrs != NULL)
+								{
+									emit->static_delta = rpt_report_rptprint_text_fit (rpt_report, emit, xnode);
+								}
+						}
+					if (prop != NULL) xmlFree (prop);
 				}
 			else if (IS_RPT_OBJ_IMAGE (rptobj))
 				{
 					/* TO DO */
 					/* rpt_report_rptprint_parse_image_source (rpt_report, rptobj, xnode); */
 				}
+			else if (IS_RPT_OBJ_SUBREPORT (rptobj))
+				{
+					prop = (gchar *)xmlGetProp (xnode, "x");
+					emit->subreport = rpt_report_subreport_new (rpt_report, rptobj,
+					                                            prop != NULL ? g_strtod (prop, NULL) : 0.0);
+					if (prop != NULL) xmlFree (prop);
+
+					if (emit->subreport == NULL)
+						{
+							/* nothing to lay out */
+							emit->xnode = xnode;
+							rpt_report_emit_object_free (emit);
+							objects = g_list_next (objects);
+							continue;
+						}
+				}
+
+			/* the page header and footer objects without fields and specials
+			 * are the same on every page, so rptprint draws them once; the
+			 * objects between two evaluated ones get their own id, to keep the
+			 * drawing order */
+			if (section == RPTREPORT_SECTION_PAGE_HEADER
+			    || section == RPTREPORT_SECTION_PAGE_FOOTER)
+				{
+					if (emit->source == NULL)
+						{
+							emit->static_id = g_strdup_printf ("%s-%u",
+							                                   section == RPTREPORT_SECTION_PAGE_HEADER ? "page-header" : "page-footer",
+							                                   static_run);
+						}
+					else
+						{
+							static_run++;
+						}
+				}
 
-			xmlAddChild (xpage, xnode);
+			emit->xnode = xnode;
+			g_ptr_array_add (band->objects, emit);
 
 			objects = g_list_next (objects);
 		}
 
-	switch (section)
+	priv->emit_bands[section] = band;
+
+	return band;
+}
+
+static void
+rpt_report_rptprint_templates_free (RptReport *rpt_report)
+{
+	guint i;
+
+	RptReportPrivate *priv = RPT_REPORT_GET_PRIVATE (rpt_report);
+
+	for (i = 0; i <= RPTREPORT_SECTION_BODY; i++)
 		{
-			case RPTREPORT_SECTION_REPORT_HEADER:
-				*cur_y += priv->report_header->height;
-				break;
+			if (priv->emit_bands[i] != NULL)
+				{
+					g_ptr_array_free (priv->emit_bands[i]->objects, TRUE);
+					g_free (priv->emit_bands[i]);
+					priv->emit_bands[i] = NULL;
+				}
+		}
+}
 
-			case RPTREPORT_SECTION_REPORT_FOOTER:
-				*cur_y += priv->report_footer->height;
-				break;
+/**
+ * rpt_report_rptprint_run_end:
+ * @rpt_report:
+ *
+ * Releases, in one step, everything rpt_report_get_xml_rptprint () kept
+ * only for the current run.
+ */
+static void
+rpt_report_rptprint_run_end (RptReport *rpt_report)
+{
+	RptReportPrivate *priv = RPT_REPORT_GET_PRIVATE (rpt_report);
+
+	rpt_report_rptprint_templates_free (rpt_report);
+
+	if (priv->specials != NULL)
+		{
+			g_hash_table_destroy (priv->specials);
+			priv->specials = NULL;
+		}
+	if (priv->run_time != NULL)
+		{
+			g_date_time_unref (priv->run_time);
+			priv->run_time = NULL;
+		}
+
+	rpt_report_scratch_clear ();
+
+	priv->cur_batch = NULL;
+}
+
+static void
+rpt_report_emit_object_free (EmitObject *emit)
+{
+	xmlFreeNode (emit->xnode);
+	rpt_report_subreport_free (emit->subreport);
+	g_free (emit->source);
+	g_free (emit->field);
+	g_free (emit->static_id);
+	rpt_format_free (emit->format);
+	rpt_layout_attrs_free (emit->attrs);
+	g_free (emit);
+}
+
+/**
+ * rpt_report_subreport_new:
+ * @rpt_report:
+ * @rptobj: an #RptObjSubreport.
+ * @x: where the subreport is on the page.
+ *
+ * Loads the detail's definition and prepares its query, on the connection
+ * of @rpt_report if it is to the detail's database, for the current run.
+ *
+ * Returns: the #Subreport; NULL, after a warning, if it cannot be used.
+ */
+static Subreport
+*rpt_report_subreport_new (RptReport *rpt_report, RptObject *rptobj, gdouble x)
+{
+	Subreport *sub;
+	gchar *template;
+	gchar *parameters;
+	gchar *filename;
+	gchar **strv;
+	gchar *eq;
+	GError *error;
+	GdaSqlParser *parser;
+	guint n;
+	guint i;
+
+	RptReportPrivate *priv = RPT_REPORT_GET_PRIVATE (rpt_report);
+	RptReportPrivate *sub_priv;
+
+	g_object_get (rptobj,
+	              "template", &template,
+	              "parameters", &parameters,
+	              NULL);
+	if (template == NULL || template[0] == '\0')
+		{
+			g_warning ("A subreport has no template.");
+			g_free (template);
+			g_free (parameters);
+			return NULL;
+		}
+
+	if (priv->base_dir != NULL && !g_path_is_absolute (template))
+		{
+			filename = g_build_filename (priv->base_dir, template, NULL);
+		}
+	else
+		{
+			filename = g_strdup (template);
+		}
+	g_free (template);
+
+	sub = g_new0 (Subreport, 1);
+
+	error = NULL;
+	sub->report = rpt_template_cache_get (filename, &error);
+	if (sub->report == NULL)
+		{
+			g_warning ("Unable to load the subreport «%s»: %s.", filename,
+			           error != NULL && error->message != NULL ? error->message : "no details");
+			if (error != NULL) g_error_free (error);
+			g_free (filename);
+			g_free (parameters);
+			rpt_report_subreport_free (sub);
+			return NULL;
+		}
+
+	sub_priv = RPT_REPORT_GET_PRIVATE (sub->report);
+	if (sub_priv->db == NULL || sub_priv->db->sql == NULL)
+		{
+			g_warning ("The subreport «%s» has no query.", filename);
+			g_free (filename);
+			g_free (parameters);
+			rpt_report_subreport_free (sub);
+			return NULL;
+		}
+
+	/* the detail is evaluated as a part of the master's run */
+	sub_priv->run_time = g_date_time_ref (priv->run_time);
+	sub_priv->specials = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+
+	/* name=source;name=source */
+	strv = g_strsplit (parameters != NULL ? parameters : "", ";", -1);
+	n = g_strv_length (strv);
+	sub->names = g_new0 (gchar *, n + 1);
+	sub->sources = g_new0 (gchar *, n + 1);
+	for (i = 0, n = 0; strv[i] != NULL; i++)
+		{
+			eq = strchr (strv[i], '=');
+			if (eq == NULL)
+				{
+					if (g_strstrip (strv[i])[0] != '\0')
+						{
+							g_warning ("Parameter «%s» of the subreport «%s» without a value.", strv[i], filename);
+						}
+					continue;
+				}
+			*eq = '\0';
+			sub->names[n] = g_strstrip (g_strdup (strv[i]));
+			sub->sources[n] = g_strstrip (g_strdup (eq + 1));
+			n++;
+		}
+	g_strfreev (strv);
+	g_free (parameters);
+
+	/* the master's connection, if it is to the same database */
+	if (priv->db != NULL && priv->db->gda_conn != NULL
+	    && g_strcmp0 (priv->db->provider_id, sub_priv->db->provider_id) == 0
+	    && g_strcmp0 (priv->db->connection_string, sub_priv->db->connection_string) == 0)
+		{
+			sub->gda_conn = g_object_ref (priv->db->gda_conn);
+		}
+	else
+		{
+			gda_init ();
+			error = NULL;
+			sub->gda_conn = gda_connection_open_from_string (sub_priv->db->provider_id,
+			                                                 sub_priv->db->connection_string,
+			                                                 NULL,
+			                                                 GDA_CONNECTION_OPTIONS_NONE,
+			                                                 &error);
+			if (sub->gda_conn == NULL)
+				{
+					g_warning ("Unable to establish the connection of the subreport «%s»: %s.", filename,
+					           error != NULL && error->message != NULL ? error->message : "no details");
+					if (error != NULL) g_error_free (error);
+					g_free (filename);
+					rpt_report_subreport_free (sub);
+					return NULL;
+				}
+		}
+
+	/* the query is parsed once, only the parameters change */
+	parser = gda_connection_create_parser (sub->gda_conn);
+	if (parser == NULL)
+		{
+			parser = gda_sql_parser_new ();
+		}
+	error = NULL;
+	sub->stmt = gda_sql_parser_parse_string (parser, sub_priv->db->sql, NULL, &error);
+	g_object_unref (parser);
+	if (sub->stmt == NULL
+	    || !gda_statement_get_parameters (sub->stmt, &sub->params, &error))
+		{
+			g_warning ("Unable to parse the query of the subreport «%s»: %s.", filename,
+			           error != NULL && error->message != NULL ? error->message : "no details");
+			if (error != NULL) g_error_free (error);
+			g_free (filename);
+			rpt_report_subreport_free (sub);
+			return NULL;
+		}
+	g_free (filename);
+
+	sub->results = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_object_unref);
+	sub->batch = rpt_data_batch_new ();
+	sub->dx = x - sub_priv->page->margin->left;
+
+	return sub;
+}
+
+static void
+rpt_report_subreport_free (Subreport *sub)
+{
+	if (sub == NULL)
+		{
+			return;
+		}
+
+	if (sub->report != NULL)
+		{
+			rpt_report_rptprint_run_end (sub->report);
+			g_object_unref (sub->report);
+		}
+	g_strfreev (sub->names);
+	g_strfreev (sub->sources);
+	if (sub->results != NULL)
+		{
+			g_hash_table_destroy (sub->results);
+		}
+	rpt_data_batch_free (sub->batch);
+	if (sub->params != NULL)
+		{
+			g_object_unref (sub->params);
+		}
+	if (sub->stmt != NULL)
+		{
+			g_object_unref (sub->stmt);
+		}
+	if (sub->gda_conn != NULL)
+		{
+			g_object_unref (sub->gda_conn);
+		}
+	g_free (sub);
+}
+
+/**
+ * rpt_report_rptprint_subreport:
+ * @rpt_report:
+ * @sub:
+ * @y: where the detail starts on the page.
+ * @max_height: the most room the detail can take.
+ * @xband: the band where the detail's objects are added.
+ *
+ * Lays out the detail's body once for every row of its query, with the
+ * parameters' values of the current row; the query runs only the first
+ * time those values are met during the run. A detail isn't split across
+ * pages: the rows beyond @max_height are left out, with a warning.
+ *
+ * Returns: the height of the detail.
+ */
+static gdouble
+rpt_report_rptprint_subreport (RptReport *rpt_report,
+                               Subreport *sub,
+                               gdouble y,
+                               gdouble max_height,
+                               xmlNode *xband)
+{
+	RptDataSource *source;
+	GdaDataModel *data_model;
+	GdaHolder *holder;
+	GString *key;
+	gchar **values;
+	GError *error;
+	xmlNode *xdetail;
+	xmlNode *cur;
+	gchar *prop;
+	gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+	gdouble height;
+	gdouble row_height;
+	guint n_rows;
+	guint n_laid;
+	gboolean full;
+	guint row;
+	guint i;
+
+	RptReportPrivate *priv = RPT_REPORT_GET_PRIVATE (rpt_report);
+	RptReportPrivate *sub_priv = RPT_REPORT_GET_PRIVATE (sub->report);
+
+	values = g_new0 (gchar *, g_strv_length (sub->names) + 1);
+	key = g_string_new (NULL);
+	for (i = 0; sub->names[i] != NULL; i++)
+		{
+			values[i] = rpt_report_eval_string (rpt_report, sub->sources[i]);
+			if (i > 0)
+				{
+					g_string_append_c (key, '\x1f');
+				}
+			g_string_append (key, values[i]);
+		}
+
+	source = (RptDataSource *)g_hash_table_lookup (sub->results, key->str);
+	if (source == NULL)
+		{
+			error = NULL;
+			for (i = 0; sub->names[i] != NULL; i++)
+				{
+					holder = sub->params != NULL ? gda_set_get_holder (sub->params, sub->names[i]) : NULL;
+					if (holder == NULL)
+						{
+							g_warning ("The query of the subreport hasn't the parameter «%s».", sub->names[i]);
+						}
+					else if (!gda_holder_set_value_str (holder, NULL, values[i], &error))
+						{
+							/* the holder would keep the value of another row */
+							g_warning ("The value «%s» of the parameter «%s» of the subreport is invalid: %s.",
+							           values[i], sub->names[i],
+							           error != NULL && error->message != NULL ? error->message : "no details");
+							if (error != NULL) g_error_free (error);
+							g_string_free (key, TRUE);
+							g_strfreev (values);
+							return 0.0;
+						}
+				}
+
+			error = NULL;
+			data_model = gda_connection_statement_execute_select (sub->gda_conn, sub->stmt, sub->params, &error);
+			if (data_model == NULL)
+				{
+					g_warning ("Unable to read the rows of the subreport: %s.",
+					           error != NULL && error->message != NULL ? error->message : "no details");
+					if (error != NULL) g_error_free (error);
+					g_string_free (key, TRUE);
+					g_strfreev (values);
+					return 0.0;
+				}
+
+			source = rpt_data_source_gda_new (data_model);
+			g_object_unref (data_model);
+			g_hash_table_insert (sub->results, g_string_free (key, FALSE), source);
+		}
+	else
+		{
+			g_string_free (key, TRUE);
+		}
+	g_strfreev (values);
+
+	/* the detail reads the rows, without owning them */
+	sub_priv->db->source = source;
+	sub_priv->cur_page = priv->cur_page;
+	sub_priv->defer_page = priv->defer_page;
+
+	height = 0.0;
+	n_laid = 0;
+	full = FALSE;
+	error = NULL;
+	if (rpt_data_source_rewind (source, &error))
+		{
+			while (!full
+			       && (n_rows = rpt_data_source_next_batch (source, sub->batch, RPT_REPORT_BATCH_ROWS, &error)) > 0)
+				{
+					for (row = 0; row < n_rows; row++)
+						{
+							sub_priv->cur_batch = sub->batch;
+							sub_priv->cur_batch_row = row;
+
+							xdetail = rpt_report_rptprint_section_build (sub->report, y + height, RPTREPORT_SECTION_BODY, &row_height);
+							if (height + row_height > max_height)
+								{
+									/* it would run off the bottom of the page */
+									g_warning ("The detail of a subreport is taller than a page: only its first %u rows are laid out.",
+									           n_laid);
+									xmlFreeNode (xdetail);
+									full = TRUE;
+									break;
+								}
+
+							while ((cur = xdetail->children) != NULL)
+								{
+									xmlUnlinkNode (cur);
+									if (sub->dx != 0.0)
+										{
+											prop = (gchar *)xmlGetProp (cur, "x");
+											g_ascii_formatd (buf, sizeof (buf), "%f",
+											                 (prop != NULL ? g_strtod (prop, NULL) : 0.0) + sub->dx);
+											xmlSetProp (cur, "x", buf);
+											if (prop != NULL) xmlFree (prop);
+										}
+									xmlAddChild (xband, cur);
+								}
+							xmlFreeNode (xdetail);
+
+							height += row_height;
+							n_laid++;
+						}
+				}
+		}
+	if (error != NULL)
+		{
+			g_warning ("Unable to read the rows of the subreport: %s.",
+			           error->message != NULL ? error->message : "no details");
+			g_error_free (error);
+		}
+
+	sub_priv->cur_batch = NULL;
+	sub_priv->db->source = NULL;
+
+	return height;
+}
+
+/**
+ * rpt_report_rptprint_section_place:
+ * @xpage:
+ * @xband: an #xmlNode returned by rpt_report_rptprint_section_build().
+ *
+ * Moves the objects of @xband to @xpage and frees @xband.
+ */
+static void
+rpt_report_rptprint_section_place (xmlNode *xpage, xmlNode *xband)
+{
+	xmlNode *cur;
+	xmlNode *next;
+
+	cur = xband->children;
+	while (cur != NULL)
+		{
+			next = cur->next;
+
+			xmlUnlinkNode (cur);
+			xmlAddChild (xpage, cur);
+
+			cur = next;
+		}
+
+	xmlFreeNode (xband);
+}
+
+/**
+ * rpt_report_rptprint_band_move:
+ * @xband: an #xmlNode returned by rpt_report_rptprint_section_build().
+ * @from_y: where @xband was built.
+ * @to_y: where @xband goes.
+ *
+ * Moves the objects of @xband, without evaluating them again.
+ */
+static void
+rpt_report_rptprint_band_move (xmlNode *xband, gdouble from_y, gdouble to_y)
+{
+	xmlNode *cur;
+	gchar *prop;
+	gchar *at;
+	gchar *static_id;
+	gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+	gchar y_buf[G_ASCII_DTOSTR_BUF_SIZE];
+
+	g_ascii_formatd (y_buf, sizeof (y_buf), "%f", to_y);
+
+	for (cur = xband->children; cur != NULL; cur = cur->next)
+		{
+			if (cur->type != XML_ELEMENT_NODE)
+				{
+					continue;
+				}
+
+			prop = (gchar *)xmlGetProp (cur, "y");
+			if (prop != NULL)
+				{
+					g_ascii_formatd (buf, sizeof (buf), "%f", g_strtod (prop, NULL) + to_y - from_y);
+					xmlSetProp (cur, "y", buf);
+					xmlFree (prop);
+				}
+
+			/* the static id has the band's place */
+			prop = (gchar *)xmlGetProp (cur, "static-id");
+			if (prop != NULL)
+				{
+					at = strrchr (prop, '@');
+					if (at != NULL)
+						{
+							*at = '\0';
+							static_id = g_strdup_printf ("%s@%s", prop, y_buf);
+							xmlSetProp (cur, "static-id", static_id);
+							g_free (static_id);
+						}
+					xmlFree (prop);
+				}
+		}
+}
+
+/**
+ * rpt_report_rptprint_band_set_page:
+ * @xband: an #xmlNode built while @Page was deferred.
+ * @page: the page where @xband goes.
+ *
+ * Writes @page where the texts of @xband show @Page.
+ */
+static void
+rpt_report_rptprint_band_set_page (xmlNode *xband, guint page)
+{
+	xmlNode *cur;
+	gchar *content;
+	const gchar *from;
+	const gchar *marker;
+	GString *text;
+	gchar num[16];
+
+	g_snprintf (num, sizeof (num), "%u", page);
+
+	for (cur = xband->children; cur != NULL; cur = cur->next)
+		{
+			if (cur->type != XML_ELEMENT_NODE
+			    || xmlStrcmp (cur->name, (const xmlChar *)"text") != 0)
+				{
+					continue;
+				}
+
+			content = (gchar *)xmlNodeGetContent (cur);
+			if (content == NULL || strstr (content, "@Page") == NULL)
+				{
+					if (content != NULL) xmlFree (content);
+					continue;
+				}
+
+			text = g_string_new (NULL);
+			from = content;
+			while ((marker = strstr (from, "@Page")) != NULL)
+				{
+					g_string_append_len (text, from, marker - from);
+					if (marker[5] == 's')
+						{
+							/* @Pages is written at the end of the run */
+							g_string_append_len (text, marker, 6);
+							from = marker + 6;
+						}
+					else
+						{
+							g_string_append (text, num);
+							from = marker + 5;
+						}
+				}
+			g_string_append (text, from);
+
+			rpt_report_rptprint_set_text (cur, text->str, text->len);
+
+			g_string_free (text, TRUE);
+			xmlFree (content);
+		}
+}
+
+/**
+ * rpt_report_rptprint_text_fit:
+ * @rpt_report:
+ * @emit: the compiled text object.
+ * @xnode: a copy of @emit's node with its content already set.
+ *
+ * Changes the node's height to fit the text. The text is measured with the
+ * layout cache, so the same #PangoLayout will be used to draw it.
+ *
+ * Returns: how much the node's height changed.
+ */
+static gdouble
+rpt_report_rptprint_text_fit (RptReport *rpt_report, EmitObject *emit, xmlNode *xnode)
+{
+	gchar *content;
+	gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+
+	gdouble height;
+	gdouble delta = 0.0;
+
+	RptReportPrivate *priv = RPT_REPORT_GET_PRIVATE (rpt_report);
+
+	content = (gchar *)xmlNodeGetContent (xnode);
+
+	height = rpt_common_points_to_value (priv->unit,
+	                                     rpt_layout_cache_get_text_height (content != NULL ? content : "", emit->attrs));
+
+	if ((emit->can_grow && height > emit->height)
+	    || (emit->can_shrink && height < emit->height))
+		{
+			delta = height - emit->height;
+
+			g_ascii_formatd (buf, sizeof (buf), "%f", height);
+			xmlSetProp (xnode, "height", buf);
+		}
+
+	if (content != NULL) xmlFree (content);
+
+	return delta;
+}
+
+static void
+rpt_report_rptprint_parse_text_source (RptReport *rpt_report,
+                                       RptObject *rptobj,
+                                       xmlNode *xnode)
+{
+	gchar *source;
+	gchar *mask;
+	RptFormat *format;
+
+	g_object_get (G_OBJECT (rptobj),
+	              "source", &source,
+	              "format", &mask,
+	              NULL);
+
+	format = rpt_format_new (mask);
+
+	rpt_report_rptprint_eval_source (rpt_report, source, format, xnode);
+
+	rpt_format_free (format);
+	g_free (mask);
+	g_free (source);
+}
+
+static void
+rpt_report_rptprint_eval_source (RptReport *rpt_report,
+                                 const gchar *source,
+                                 const RptFormat *format,
+                                 xmlNode *xnode)
+{
+	gchar *ret;
+	gchar *formatted;
+
+	ret = rpt_report_parse (rpt_report, source);
+
+	if (ret != NULL && format != NULL)
+		{
+			formatted = rpt_format_string (format, ret);
+			g_free (ret);
+			ret = formatted;
+		}
+
+	rpt_report_rptprint_set_content (xnode, ret);
+	g_free (ret);
+
+	/* during a run the arena is released page by page */
+	if ((rpt_report == NULL
+	     || RPT_REPORT_GET_PRIVATE (rpt_report)->run_time == NULL)
+	    && g_private_get (&parse_depth) == NULL)
+		{
+			rpt_report_scratch_clear ();
+		}
+}
+
+/* evaluates @source on the current row as the text of an object would
+ * show it; returns a newly allocated string */
+static gchar
+*rpt_report_eval_string (RptReport *rpt_report, const gchar *source)
+{
+	gchar *ret;
+	GString *buf;
+
+	ret = rpt_report_parse (rpt_report, source);
+	if (ret == NULL)
+		{
+			return g_strdup ("");
+		}
+
+	buf = g_string_new (NULL);
+	if (!rpt_report_decode_entities (ret, buf))
+		{
+			g_string_free (buf, TRUE);
+			return ret;
+		}
+	g_free (ret);
+
+	return g_string_free (buf, FALSE);
+}
+
+/* evaluates @source with a scanner of its own, so sources are parsed
+ * concurrently and from inside a field-request handler; returns a newly
+ * allocated string, or NULL */
+static gchar
+*rpt_report_parse (RptReport *rpt_report, const gchar *source)
+{
+	gchar *ret = NULL;
+	gint depth;
+	yyscan_t scanner;
+	YY_BUFFER_STATE buffer;
+
+	if (yylex_init (&scanner) != 0)
+		{
+			g_warning ("Unable to create the scanner for «%s».", source);
+			return NULL;
+		}
+
+	depth = GPOINTER_TO_INT (g_private_get (&parse_depth));
+	g_private_set (&parse_depth, GINT_TO_POINTER (depth + 1));
+
+	buffer = yy_scan_string (source, scanner);
+	yyparse (scanner, rpt_report, &ret);
+	yy_delete_buffer (buffer, scanner);
+	yylex_destroy (scanner);
+
+	g_private_set (&parse_depth, GINT_TO_POINTER (depth));
+
+	return ret;
+}
+
+/**
+ * rpt_report_rptprint_format_field:
+ * @rpt_report:
+ * @emit: a compiled text object whose source is only a field.
+ * @xnode:
+ *
+ * Writes the field's value straight from its type, formatted with @emit's
+ * mask if it has one; the value is the node's text as it is, so it's never
+ * escaped.
+ */
+static void
+rpt_report_rptprint_format_field (RptReport *rpt_report,
+                                  EmitObject *emit,
+                                  xmlNode *xnode)
+{
+	const GValue *gval;
+	GString *buf;
+	gchar *ret;
+	gchar *str;
+
+	if (emit->format == NULL)
+		{
+			buf = rpt_report_value_buffer_get ();
+			if (rpt_report_append_field (rpt_report, buf, emit->field, FALSE))
+				{
+					rpt_report_rptprint_set_text (xnode, buf->str, buf->len);
+					return;
+				}
+		}
+
+	gval = rpt_report_get_field_value (rpt_report, emit->field);
+	if (gval != NULL)
+		{
+			ret = rpt_format_value (emit->format, gval);
+		}
+	else
+		{
+			/* only the program knows the value */
+			str = rpt_report_ask_field (rpt_report, emit->field);
+			if (emit->format != NULL)
+				{
+					ret = rpt_format_string (emit->format, str);
+					g_free (str);
+				}
+			else
+				{
+					ret = str;
+				}
+		}
+
+	rpt_report_rptprint_set_text (xnode, ret, strlen (ret));
+	g_free (ret);
+}
+
+/* sets the content of an evaluated source, where the fields' values are
+ * escaped and the newlines are written "&#10;": the entities are read in
+ * one scan, so the text is set as it is */
+static void
+rpt_report_rptprint_set_content (xmlNode *xnode, const gchar *content)
+{
+	GString *buf;
+
+	if (content == NULL)
+		{
+			rpt_report_rptprint_set_text (xnode, "", 0);
+			return;
+		}
+
+	buf = rpt_report_value_buffer_get ();
+	if (!rpt_report_decode_entities (content, buf))
+		{
+			/* an entity only libxml knows */
+			xmlNodeSetContent (xnode, content);
+			return;
+		}
+
+	rpt_report_rptprint_set_text (xnode, buf->str, buf->len);
+}
+
+/* appends @content to @buf with its entities read; FALSE if there's an
+ * entity that isn't predefined or a character reference */
+static gboolean
+rpt_report_decode_entities (const gchar *content, GString *buf)
+{
+	const gchar *p;
+	const gchar *amp;
+	const gchar *end;
+	gunichar c;
+
+	p = content;
+	while ((amp = strchr (p, '&')) != NULL)
+		{
+			g_string_append_len (buf, p, amp - p);
+
+			end = strchr (amp + 1, ';');
+			c = end != NULL ? rpt_report_entity_char (amp + 1, end - amp - 1) : 0;
+			if (c == 0)
+				{
+					return FALSE;
+				}
+			g_string_append_unichar (buf, c);
+
+			p = end + 1;
+		}
+	g_string_append (buf, p);
+
+	return TRUE;
+}
+
+/* sets @text as the content of @xnode without reading entities in it */
+static void
+rpt_report_rptprint_set_text (xmlNode *xnode, const gchar *text, gsize len)
+{
+	if (xnode->children != NULL)
+		{
+			xmlNodeSetContent (xnode, NULL);
+		}
+	if (len > 0)
+		{
+			xmlNodeAddContentLen (xnode, text, len);
+		}
+}
+
+/* returns the character of the entity @name (without '&' and ';'), a
+ * predefined one or a character reference; 0 for any other entity */
+static gunichar
+rpt_report_entity_char (const gchar *name, gsize len)
+{
+	gchar num[16];
+	gchar *end;
+	guint64 c;
+
+	switch (len)
+		{
+			case 2:
+				if (strncmp (name, "lt", 2) == 0) return '<';
+				if (strncmp (name, "gt", 2) == 0) return '>';
+				break;
+
+			case 3:
+				if (strncmp (name, "amp", 3) == 0) return '&';
+				break;
+
+			case 4:
+				if (strncmp (name, "quot", 4) == 0) return '"';
+				if (strncmp (name, "apos", 4) == 0) return '\'';
+				break;
+		}
+
+	if (len < 2 || len >= sizeof (num) || name[0] != '#')
+		{
+			return 0;
+		}
+
+	memcpy (num, name + 1, len - 1);
+	num[len - 1] = '\0';
+	if (num[0] == 'x')
+		{
+			if (!g_ascii_isxdigit (num[1])) return 0;
+			c = g_ascii_strtoull (num + 1, &end, 16);
+		}
+	else
+		{
+			if (!g_ascii_isdigit (num[0])) return 0;
+			c = g_ascii_strtoull (num, &end, 10);
+		}
+	if (*end != '\0' || c == 0 || c > 0x10ffff || !g_unichar_validate ((gunichar)c))
+		{
+			return 0;
+		}
+
+	return (gunichar)c;
+}
+
+static void
+rpt_report_change_specials (RptReport *rpt_report, xmlDoc *xdoc)
+{
+	xmlXPathContextPtr xpcontext;
+	xmlXPathObjectPtr xpresult;
+	xmlNodeSetPtr xnodeset;
+	RptReportPrivate *priv = RPT_REPORT_GET_PRIVATE (rpt_report);
+
+	xpcontext = xmlXPathNewContext (xdoc);
+
+	xpcontext->node = xmlDocGetRootElement (xdoc);
+	xpresult = xmlXPathEvalExpression ((const xmlChar *)"//text[contains(node(), \"@Pages\")]", xpcontext);
+	if (xpresult != NULL && !xmlXPathNodeSetIsEmpty (xpresult->nodesetval))
+		{
+			gint i;
+			xmlNode *cur;
+			gchar *pages;
+			gchar *content;
+			gchar *cont;
+			gchar **strv;
+
+			xnodeset = xpresult->nodesetval;
+
+			pages = g_strdup_printf ("%d", priv->cur_page);
+			for (i = 0; i < xnodeset->nodeNr; i++)
+				{
+					cur = xnodeset->nodeTab[i];
+					content = (gchar *)xmlNodeGetContent (cur);
+					strv = g_strsplit (content, "@Pages", -1);
+					cont = g_strjoinv (pages, strv);
+					xmlNodeSetContent (cur, cont);
+					g_free (cont);
+					g_strfreev (strv);
+					xmlFree (content);
+				}
+			g_free (pages);
+		}
+
+	if (xpresult != NULL)
+		{
+			xmlXPathFreeObject (xpresult);
+		}
+	xmlXPathFreeContext (xpcontext);
+}
+
+/* TRUE if a text of @objects shows @Page, or a detail could */
+static gboolean
+rpt_report_objects_use_page (GList *objects)
+{
+	gchar *source;
+	const gchar *page;
+	gboolean ret;
+
+	ret = FALSE;
+	for (; objects != NULL && !ret; objects = objects->next)
+		{
+			if (IS_RPT_OBJ_SUBREPORT (objects->data))
+				{
+					ret = TRUE;
+				}
+			else if (IS_RPT_OBJ_TEXT (objects->data))
+				{
+					g_object_get (objects->data, "source", &source, NULL);
+					page = source != NULL ? strstr (source, "@Page") : NULL;
+					while (page != NULL && page[5] == 's')
+						{
+							page = strstr (page + 5, "@Page");
+						}
+					ret = (page != NULL);
+					g_free (source);
+				}
+		}
+
+	return ret;
+}
+
+static gboolean
+rpt_report_objects_use_pages (GList *objects)
+{
+	gchar *source;
+	gboolean ret;
+
+	ret = FALSE;
+	for (; objects != NULL && !ret; objects = objects->next)
+		{
+			if (IS_RPT_OBJ_TEXT (objects->data))
+				{
+					g_object_get (objects->data, "source", &source, NULL);
+					ret = (source != NULL && strstr (source, "@Pages") != NULL);
+					g_free (source);
+				}
+		}
+
+	return ret;
+}
+
+/* TRUE if a text shows the number of pages, that is known only at the end */
+static gboolean
+rpt_report_uses_pages (RptReport *rpt_report)
+{
+	RptReportPrivate *priv = RPT_REPORT_GET_PRIVATE (rpt_report);
+
+	return (priv->report_header != NULL && rpt_report_objects_use_pages (priv->report_header->objects))
+	       || (priv->report_footer != NULL && rpt_report_objects_use_pages (priv->report_footer->objects))
+	       || (priv->page_header != NULL && rpt_report_objects_use_pages (priv->page_header->objects))
+	       || (priv->page_footer != NULL && rpt_report_objects_use_pages (priv->page_footer->objects))
+	       || rpt_report_objects_use_pages (priv->body->objects);
+}
+
+/* removes the pages outside of the page range */
+static void
+rpt_report_rptprint_drop_pages (RptReport *rpt_report, xmlDoc *xdoc)
+{
+	xmlNode *cur;
+	xmlNode *next;
+	guint npage;
+
+	RptReportPrivate *priv = RPT_REPORT_GET_PRIVATE (rpt_report);
 
-			case RPTREPORT_SECTION_PAGE_HEADER:
-				*cur_y += priv->page_header->height;
-				break;
+	if (priv->page_first <= 1 && priv->page_last == 0)
+		{
+			return;
+		}
 
-			case RPTREPORT_SECTION_PAGE_FOOTER:
-				*cur_y += priv->page_footer->height;
-				break;
+	npage = 0;
+	for (cur = xmlDocGetRootElement (xdoc)->children; cur != NULL; cur = next)
+		{
+			next = cur->next;
+			if (cur->type != XML_ELEMENT_NODE
+			    || xmlStrcmp (cur->name, (const xmlChar *)"page") != 0)
+				{
+					continue;
+				}
 
-			case RPTREPORT_SECTION_BODY:
-				*cur_y += priv->body->height;
-				break;
+			npage++;
+			if (npage < priv->page_first
+			    || (priv->page_last > 0 && npage > priv->page_last))
+				{
+					xmlUnlinkNode (cur);
+					xmlFreeNode (cur);
+				}
 		}
 }
 
-static void
-rpt_report_rptprint_parse_text_source (RptReport *rpt_report,
-                                       RptObject *rptobj,
-                                       xmlNode *xnode)
+/**
+ * rpt_report_get_field_column:
+ * @rpt_report:
+ * @field_name:
+ *
+ * Returns: the column of the current batch that holds @field_name; -1 if
+ * the source doesn't have the field, or there isn't a current row.
+ */
+static gint
+rpt_report_get_field_column (RptReport *rpt_report,
+                             const gchar *field_name)
 {
-	gchar *source;
-	gchar *ret;
+	gpointer col;
 
 	RptReportPrivate *priv = RPT_REPORT_GET_PRIVATE (rpt_report);
 
-	g_object_get (G_OBJECT (rptobj), "source", &source, NULL);
-
-	yy_scan_string (source);
-	yyparse (rpt_report, &ret);
-
-	if (g_strstr_len (ret, -1, "&#10;") != NULL)
+	if (priv->db == NULL
+	    || priv->db->source == NULL
+	    || priv->cur_batch == NULL)
 		{
-			ret = g_strjoinv ("\n", g_strsplit (ret, "&#10;", -1));
+			return -1;
 		}
 
-	if (ret == NULL)
+	/* the columns are looked for once, not for every row */
+	if (priv->db->columns == NULL)
 		{
-			xmlNodeSetContent (xnode, "");
+			priv->db->columns = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
 		}
-	else
+	if (!g_hash_table_lookup_extended (priv->db->columns, field_name, NULL, &col))
 		{
-			xmlNodeSetContent (xnode, ret);
+			col = GINT_TO_POINTER (rpt_data_source_get_column_index (priv->db->source, field_name) + 1);
+			g_hash_table_insert (priv->db->columns, g_strdup (field_name), col);
 		}
+
+	return GPOINTER_TO_INT (col) - 1;
 }
 
-static void
-rpt_report_change_specials (RptReport *rpt_report, xmlDoc *xdoc)
+/**
+ * rpt_report_get_field_value:
+ * @rpt_report:
+ * @field_name:
+ *
+ * Returns: the current row's value of @field_name, with its type, owned by
+ * the current batch; NULL if the source doesn't have the field.
+ */
+static const GValue
+*rpt_report_get_field_value (RptReport *rpt_report,
+                             const gchar *field_name)
 {
-	xmlXPathContextPtr xpcontext;
-	xmlXPathObjectPtr xpresult;
-	xmlNodeSetPtr xnodeset;
-	RptReportPrivate *priv = RPT_REPORT_GET_PRIVATE (rpt_report);
+	gint col;
 
-	xpcontext = xmlXPathNewContext (xdoc);
+	RptReportPrivate *priv = RPT_REPORT_GET_PRIVATE (rpt_report);
 
-	xpcontext->node = xmlDocGetRootElement (xdoc);
-	xpresult = xmlXPathEvalExpression ((const xmlChar *)"//text[contains(node(), \"@Pages\")]", xpcontext);
-	if (!xmlXPathNodeSetIsEmpty (xpresult->nodesetval))
+	col = rpt_report_get_field_column (rpt_report, field_name);
+	if (col < 0)
 		{
-			gint i;
-			xmlNode *cur;
-			gchar *ref;
-			gchar *cont;
+			return NULL;
+		}
 
-			xnodeset = xpresult->nodesetval;
+	return rpt_data_batch_get_value (priv->cur_batch, priv->cur_batch_row, col);
+}
 
-			for (i = 0; i < xnodeset->nodeNr; i++)
+/**
+ * rpt_report_append_field:
+ * @rpt_report:
+ * @buf:
+ * @field_name:
+ * @escape: whether to escape '&'.
+ *
+ * Appends the current row's value of @field_name to @buf as a string; a
+ * value the source set as a slice of its own buffer (e.g. a CSV cell) is
+ * copied from there, without a string of its own.
+ *
+ * Returns: FALSE if the source doesn't have the field.
+ */
+static gboolean
+rpt_report_append_field (RptReport *rpt_report,
+                         GString *buf,
+                         const gchar *field_name,
+                         gboolean escape)
+{
+	gint col;
+	const gchar *str;
+	gsize len;
+
+	RptReportPrivate *priv = RPT_REPORT_GET_PRIVATE (rpt_report);
+
+	col = rpt_report_get_field_column (rpt_report, field_name);
+	if (col < 0)
+		{
+			return FALSE;
+		}
+
+	if (rpt_data_batch_get_slice (priv->cur_batch, priv->cur_batch_row, col, &str, &len))
+		{
+			if (escape)
 				{
-					cur = xnodeset->nodeTab[i];
-					cont = g_strdup (xmlNodeGetContent (cur));
-					while ((ref = strstr (cont, "@Pages")) != NULL)
-						{
-							cont = g_strconcat ("",
-							                    g_strndup (cont, strlen (cont) - strlen (ref)),
-							                    g_strdup_printf ("%d", priv->cur_page),
-							                    g_strndup (ref + 6, strlen (ref - 6)),
-							                    NULL);
-						}
-					xmlNodeSetContent (cur, cont);
-					g_free (cont);
+					rpt_report_append_escaped_len (buf, str, len);
+				}
+			else
+				{
+					g_string_append_len (buf, str, len);
 				}
 		}
+	else
+		{
+			rpt_report_append_value (buf, rpt_data_batch_get_value (priv->cur_batch, priv->cur_batch_row, col), escape);
+		}
+
+	return TRUE;
 }
 
+/**
+ * rpt_report_get_field:
+ * @rpt_report:
+ * @field_name:
+ *
+ * Returns: the current row's value of @field_name as a string, with '&'
+ * escaped, in the scratch arena; it must not be freed.
+ */
 gchar
 *rpt_report_get_field (RptReport *rpt_report,
                        const gchar *field_name)
 {
-	GError *error;
-
-	gint col;
-	GValue *gval;
+	GString *buf;
+	gchar *str;
 
-	gchar *ret = NULL;
-
-	RptReportPrivate *priv = RPT_REPORT_GET_PRIVATE (rpt_report);
+	buf = rpt_report_value_buffer_get ();
 
-	if (priv->db != NULL)
+	if (!rpt_report_append_field (rpt_report, buf, field_name, TRUE))
 		{
-			if (priv->db->treemodel != NULL
-			    && priv->db->columns_names != NULL)
-				{
-					gchar *str_col;
+			/* the handler can evaluate sources, that fill the same buffer,
+			 * so it's taken again, empty, after the handler returns */
+			str = rpt_report_ask_field (rpt_report, field_name);
+			buf = rpt_report_value_buffer_get ();
+			rpt_report_append_escaped (buf, str);
+			g_free (str);
+		}
 
-					str_col = (gchar *)g_hash_table_lookup (priv->db->columns_names, field_name);
-					if (str_col != NULL)
-						{
-							str_col = g_strstrip (g_strdup (str_col));
-							if (g_strcmp0 (str_col, "") != 0)
-								{
-									gval = g_new0 (GValue, 1);
+	return rpt_report_scratch_strndup (buf->str, buf->len);
+}
 
-									col = strtol (str_col, NULL, 10);
-									gtk_tree_model_get_value (priv->db->treemodel, priv->cur_iter,
-									                          col, gval);
+/* appends @gval to @buf as a string, escaping '&' if @escape; the strings
+ * and the integers are written without allocating */
+static void
+rpt_report_append_value (GString *buf, const GValue *gval, gboolean escape)
+{
+	GType type;
+	gchar num[32];
+	gchar *str;
 
-									ret = (gchar *)gda_value_stringify (gval);
+	if (gda_value_is_null (gval))
+		{
+			return;
+		}
 
-									g_value_unset (gval);
-									g_free (str_col);
-								}
-						}
+	type = G_VALUE_TYPE (gval);
+	if (type == G_TYPE_STRING)
+		{
+			if (escape)
+				{
+					rpt_report_append_escaped (buf, g_value_get_string (gval));
 				}
-			else if (priv->db->gda_datamodel != NULL)
+			else
 				{
-					col = gda_data_model_get_column_index (priv->db->gda_datamodel, field_name);
-
-					if (col > -1)
-						{
-							error = NULL;
-							gval = (GValue *)gda_data_model_get_value_at (priv->db->gda_datamodel, col, priv->cur_row, &error);
-							if (error != NULL)
-								{
-									g_warning ("Error on retrieving field «%s» value: %s.",
-									           field_name,
-									           error->message != NULL ? error->message : "no details");
-								}
-							else
-								{
-									if (gda_value_is_null (gval))
-										{
-											ret = g_strdup ("");
-										}
-									else
-										{
-											ret = (gchar *)gda_value_stringify (gval);
-											if (ret == NULL)
-												{
-													ret = g_strdup ("");
-												}
-										}
-								}
-						}
+					g_string_append (buf, g_value_get_string (gval));
 				}
 		}
-
-	if (ret == NULL)
+	else if (type == G_TYPE_INT)
 		{
-			ret = rpt_report_ask_field (rpt_report, field_name);
+			g_snprintf (num, sizeof (num), "%d", g_value_get_int (gval));
+			g_string_append (buf, num);
 		}
-	if (ret == NULL)
+	else if (type == G_TYPE_UINT)
 		{
-			ret = g_strdup ("{ERROR}");
+			g_snprintf (num, sizeof (num), "%u", g_value_get_uint (gval));
+			g_string_append (buf, num);
+		}
+	else if (type == G_TYPE_INT64)
+		{
+			g_snprintf (num, sizeof (num), "%" G_GINT64_FORMAT, g_value_get_int64 (gval));
+			g_string_append (buf, num);
+		}
+	else if (type == G_TYPE_UINT64)
+		{
+			g_snprintf (num, sizeof (num), "%" G_GUINT64_FORMAT, g_value_get_uint64 (gval));
+			g_string_append (buf, num);
+		}
+	else if (type == G_TYPE_LONG)
+		{
+			g_snprintf (num, sizeof (num), "%ld", g_value_get_long (gval));
+			g_string_append (buf, num);
+		}
+	else if (type == G_TYPE_ULONG)
+		{
+			g_snprintf (num, sizeof (num), "%lu", g_value_get_ulong (gval));
+			g_string_append (buf, num);
 		}
 	else
 		{
-			gchar **strv;
-
-			strv = g_strsplit (ret, "&", -1);
-			g_free (ret);
+			str = gda_value_stringify (gval);
+			if (escape)
+				{
+					rpt_report_append_escaped (buf, str);
+				}
+			else if (str != NULL)
+				{
+					g_string_append (buf, str);
+				}
+			g_free (str);
+		}
+}
 
-			ret = g_strjoinv ("&amp;", strv);
-			g_strfreev (strv);
+/* appends @str to @buf with '&' written "&amp;" */
+static void
+rpt_report_append_escaped (GString *buf, const gchar *str)
+{
+	if (str == NULL)
+		{
+			return;
 		}
 
-	return ret;
+	rpt_report_append_escaped_len (buf, str, strlen (str));
+}
+
+/* as rpt_report_append_escaped(), for the @len bytes of @str, that needn't
+ * be nul terminated */
+static void
+rpt_report_append_escaped_len (GString *buf, const gchar *str, gsize len)
+{
+	const gchar *amp;
+
+	while ((amp = memchr (str, '&', len)) != NULL)
+		{
+			g_string_append_len (buf, str, amp - str);
+			g_string_append_len (buf, "&amp;", 5);
+			len -= amp + 1 - str;
+			str = amp + 1;
+		}
+	g_string_append_len (buf, str, len);
 }
 
 gchar
@@ -3133,20 +5680,19 @@ gchar
 
 	if (priv->db != NULL)
 		{
-			if (priv->db->gda_datamodel != NULL)
-				{
-					g_signal_emit (rpt_report, klass->field_request_signal_id,
-					               0, field,
-					               priv->db->gda_datamodel, priv->cur_row,
-					               NULL, NULL,
-					               &ret);
-				}
-			else if (priv->db->treemodel != NULL)
+			if (priv->db->source != NULL && priv->cur_batch != NULL)
 				{
+					GdaDataModel *data_model;
+					gint model_row;
+					GObject *tree_model;
+					gpointer iter;
+
+					rpt_data_source_get_row_origin (priv->db->source, priv->cur_batch, priv->cur_batch_row,
+					                                &data_model, &model_row, &tree_model, &iter);
 					g_signal_emit (rpt_report, klass->field_request_signal_id,
 					               0, field,
-					               NULL, -1,
-					               priv->db->treemodel, priv->cur_iter,
+					               data_model, model_row,
+					               tree_model, iter,
 					               &ret);
 				}
 		}
@@ -3155,11 +5701,8 @@ gchar
 			g_signal_emit (rpt_report, klass->field_request_signal_id,
 			               0, field, NULL, -1, NULL, NULL, &ret);
 		}
-	if (ret != NULL)
-		{
-			ret = g_strdup (ret);
-		}
-	else
+	/* the string returned by the signal is already a copy */
+	if (ret == NULL)
 		{
 			ret = g_strdup ("{ERROR}");
 		}
@@ -3181,6 +5724,7 @@ static gchar
                          const gchar *replace)
 {
 	gchar *ret;
+	gchar *prefix;
 	gchar *p;
 
 	p = g_strstr_len (string, -1, origin);
@@ -3190,9 +5734,34 @@ static gchar
 			return g_strdup (string);
 		}
 
-	ret = g_strndup (string, p - string);
+	prefix = g_strndup (string, p - string);
+
+	ret = g_strdup_printf ("%s%s%s", prefix, replace, p + strlen (origin));
+
+	g_free (prefix);
+
+	return ret;
+}
+
+/**
+ * rpt_report_str_replace_take:
+ * @string:
+ * @origin:
+ * @replace:
+ *
+ * Like rpt_report_str_replace(), but @string and @replace are freed.
+ */
+static gchar
+*rpt_report_str_replace_take (gchar *string,
+                              const gchar *origin,
+                              gchar *replace)
+{
+	gchar *ret;
+
+	ret = rpt_report_str_replace (string, origin, replace);
 
-	ret = g_strdup_printf ("%s%s%s", ret, replace, p + strlen (origin));
+	g_free (string);
+	g_free (replace);
 
 	return ret;
 }
@@ -3217,22 +5786,21 @@ gchar
 {
 	gchar *ret;
 
-	ret = g_strdup ("");
-
-	g_return_val_if_fail (datetime != NULL, ret);
-
-	ret = rpt_report_str_replace (format, "%Y",
-	                              g_strdup_printf ("%04u", datetime->tm_year + 1900));
-	ret = rpt_report_str_replace (ret, "%m",
-	                              g_strdup_printf ("%02u", datetime->tm_mon + 1));
-	ret = rpt_report_str_replace (ret, "%d",
-	                              g_strdup_printf ("%02u", datetime->tm_mday));
-	ret = rpt_report_str_replace (ret, "%H",
-	                              g_strdup_printf ("%02u", datetime->tm_hour));
-	ret = rpt_report_str_replace (ret, "%M",
-	                              g_strdup_printf ("%02u", datetime->tm_min));
-	ret = rpt_report_str_replace (ret, "%S",
-	                              g_strdup_printf ("%02u", datetime->tm_sec));
+	g_return_val_if_fail (datetime != NULL, g_strdup (""));
+
+	ret = g_strdup (format);
+	ret = rpt_report_str_replace_take (ret, "%Y",
+	                                   g_strdup_printf ("%04u", datetime->tm_year + 1900));
+	ret = rpt_report_str_replace_take (ret, "%m",
+	                                   g_strdup_printf ("%02u", datetime->tm_mon + 1));
+	ret = rpt_report_str_replace_take (ret, "%d",
+	                                   g_strdup_printf ("%02u", datetime->tm_mday));
+	ret = rpt_report_str_replace_take (ret, "%H",
+	                                   g_strdup_printf ("%02u", datetime->tm_hour));
+	ret = rpt_report_str_replace_take (ret, "%M",
+	                                   g_strdup_printf ("%02u", datetime->tm_min));
+	ret = rpt_report_str_replace_take (ret, "%S",
+	                                   g_strdup_printf ("%02u", datetime->tm_sec));
 
 	return ret;
 }
@@ -3243,27 +5811,37 @@ gchar
 	gchar *ret;
 	gchar *real_special;
 
-	if (special == NULL) return "";
+	if (special == NULL) return g_strdup ("");
 
 	RptReportPrivate *priv = RPT_REPORT_GET_PRIVATE (rpt_report);
 
-	ret = g_strdup ("");
+	ret = NULL;
 	real_special = g_strstrip (g_strdup (special));
 
 	if (g_strcmp0 (real_special, "@Page") == 0)
 		{
-			ret = g_strdup_printf ("%d", priv->cur_page);
+			ret = priv->defer_page ? g_strdup ("@Page") : g_strdup_printf ("%d", priv->cur_page);
 		}
 	else if (g_strcmp0 (real_special, "@Pages") == 0)
 		{
 			ret = g_strdup ("@Pages");
 		}
-	else if (strncmp (real_special, "@Date", 5) == 0)
+	else if (strncmp (real_special, "@Date", 5) == 0
+	         || strncmp (real_special, "@Time", 5) == 0)
 		{
 			gchar *format;
 			GDateTime *now;
+			const gchar *cached;
+
+			/* during a run the same token always gives the same string */
+			cached = priv->specials != NULL ? (const gchar *)g_hash_table_lookup (priv->specials, real_special) : NULL;
+			if (cached != NULL)
+				{
+					g_free (real_special);
+					return g_strdup (cached);
+				}
 
-			now = g_date_time_new_now_local ();
+			now = priv->run_time != NULL ? g_date_time_ref (priv->run_time) : g_date_time_new_now_local ();
 
 			if (strlen (real_special) > 5
 			    && real_special[5] == '{'
@@ -3271,30 +5849,11 @@ gchar
 				{
 					format = g_strndup (real_special + 6, strlen (real_special + 6) - 1);
 				}
-			else
+			else if (real_special[1] == 'D')
 				{
 					/* TODO get from locale */
 					format = g_strdup ("%Y-%m-%d");
 				}
-
-			ret = g_date_time_format (now, format);
-
-			g_free (format);
-			g_date_time_unref (now);
-		}
-	else if (strncmp (real_special, "@Time", 5) == 0)
-		{
-			gchar *format;
-			GDateTime *now;
-
-			now = g_date_time_new_now_local ();
-
-			if (strlen (real_special) > 5
-			    && real_special[5] == '{'
-			    && real_special[strlen (real_special) - 1] == '}')
-				{
-					format = g_strndup (real_special + 6, strlen (real_special + 6) - 1);
-				}
 			else
 				{
 					/* TODO get from locale */
@@ -3302,9 +5861,125 @@ gchar
 				}
 
 			ret = g_date_time_format (now, format);
+			if (ret == NULL)
+				{
+					ret = g_strdup ("");
+				}
+
+			if (priv->specials != NULL)
+				{
+					g_hash_table_insert (priv->specials, g_strdup (real_special), g_strdup (ret));
+				}
+
 			g_free (format);
 			g_date_time_unref (now);
 		}
 
+	g_free (real_special);
+
+	if (ret == NULL)
+		{
+			ret = g_strdup ("");
+		}
+
+	return ret;
+}
+
+/**
+ * rpt_report_scratch_strdup:
+ * @str:
+ *
+ * Returns: a copy of @str in the scratch arena; it must not be freed.
+ */
+gchar
+*rpt_report_scratch_strdup (const gchar *str)
+{
+	return g_string_chunk_insert (rpt_report_scratch_get (), str != NULL ? str : "");
+}
+
+/**
+ * rpt_report_scratch_strndup:
+ * @str:
+ * @n: the number of bytes of @str to copy.
+ *
+ * Returns: a copy of the first @n bytes of @str in the scratch arena; it
+ * must not be freed.
+ */
+gchar
+*rpt_report_scratch_strndup (const gchar *str, gsize n)
+{
+	return g_string_chunk_insert_len (rpt_report_scratch_get (), str, n);
+}
+
+/**
+ * rpt_report_scratch_take:
+ * @str: a newly allocated string.
+ *
+ * Moves @str into the scratch arena.
+ *
+ * Returns: the copy of @str; it must not be freed.
+ */
+gchar
+*rpt_report_scratch_take (gchar *str)
+{
+	gchar *ret;
+
+	ret = rpt_report_scratch_strdup (str);
+	g_free (str);
+
 	return ret;
 }
+
+/**
+ * rpt_report_scratch_clear:
+ *
+ * Releases all the strings of the scratch arena at once.
+ */
+void
+rpt_report_scratch_clear (void)
+{
+	GStringChunk *chunk;
+
+	chunk = (GStringChunk *)g_private_get (&scratch);
+	if (chunk != NULL)
+		{
+			g_string_chunk_clear (chunk);
+		}
+}
+
+static GString
+*rpt_report_value_buffer_get (void)
+{
+	GString *buf;
+
+	buf = (GString *)g_private_get (&value_buffer);
+	if (buf == NULL)
+		{
+			buf = g_string_sized_new (256);
+			g_private_set (&value_buffer, buf);
+		}
+	g_string_truncate (buf, 0);
+
+	return buf;
+}
+
+static void
+rpt_report_value_buffer_free (gpointer data)
+{
+	g_string_free ((GString *)data, TRUE);
+}
+
+static GStringChunk
+*rpt_report_scratch_get (void)
+{
+	GStringChunk *chunk;
+
+	chunk = (GStringChunk *)g_private_get (&scratch);
+	if (chunk == NULL)
+		{
+			chunk = g_string_chunk_new (4096);
+			g_private_set (&scratch, chunk);
+		}
+
+	return chunk;
+}
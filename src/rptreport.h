@@ -22,11 +22,11 @@
 
 #include <glib.h>
 #include <glib-object.h>
-#include <gtk/gtk.h>
 #include <libgda/libgda.h>
 #include <libxml/tree.h>
 
 #include "rptobject.h"
+#include "rptdatasource.h"
 
 G_BEGIN_DECLS
 
@@ -66,19 +66,41 @@ typedef enum
 	RPTREPORT_SECTION_BODY
 } RptReportSection;
 
+#define RPT_REPORT_ERROR rpt_report_error_quark ()
+
+typedef enum
+{
+	RPT_REPORT_ERROR_INVALID_XML,
+	RPT_REPORT_ERROR_INVALID_ROOT,
+	RPT_REPORT_ERROR_MISSING_NODE,
+	RPT_REPORT_ERROR_DUPLICATE_NODE,
+	RPT_REPORT_ERROR_INVALID_VALUE,
+	RPT_REPORT_ERROR_INVALID_COMPILED,
+	RPT_REPORT_ERROR_VERSION_MISMATCH,
+	RPT_REPORT_ERROR_INVALID_PARAMETER
+} RptReportError;
+
+GQuark rpt_report_error_quark (void);
+
 RptReport *rpt_report_new (void);
 
 RptReport *rpt_report_new_from_xml (xmlDoc *xdoc);
 RptReport *rpt_report_new_from_file (const gchar *filename);
+RptReport *rpt_report_new_from_xml_full (xmlDoc *xdoc, GError **error);
+RptReport *rpt_report_new_from_file_full (const gchar *filename, GError **error);
+
+RptReport *rpt_report_copy (RptReport *rpt_report);
 
-RptReport *rpt_report_new_from_gtktreeview (GtkTreeView *view,
-                                            const gchar *title);
+gboolean rpt_report_compile_file (const gchar *filename,
+                                  const gchar *output_filename,
+                                  GError **error);
 
 void rpt_report_set_output_type (RptReport *rpt_report, eRptOutputType output_type);
 void rpt_report_set_output_filename (RptReport *rpt_report, const gchar *output_filename);
 
 void rpt_report_set_copies (RptReport *rpt_report, guint copies);
 void rpt_report_set_translation (RptReport *rpt_report, RptTranslation *translation);
+void rpt_report_set_page_range (RptReport *rpt_report, guint first, guint last);
 
 const gchar *rpt_report_database_get_provider (RptReport *rpt_report);
 const gchar *rpt_report_database_get_connection_string (RptReport *rpt_report);
@@ -89,10 +111,11 @@ void rpt_report_set_database (RptReport *rpt_report,
                               const gchar *sql);
 
 void rpt_report_set_database_from_datamodel (RptReport *rpt_report, GdaDataModel *data_model);
+void rpt_report_set_data_source (RptReport *rpt_report, RptDataSource *source);
+void rpt_report_set_prefetch (RptReport *rpt_report, guint n_batches);
 
-void rpt_report_set_database_as_gtktreemodel (RptReport *rpt_report,
-                                              GtkTreeModel *model,
-                                              GHashTable *columns_names);
+void rpt_report_set_parameter (RptReport *rpt_report, const gchar *name, const GValue *value);
+const GValue *rpt_report_get_parameter (RptReport *rpt_report, const gchar *name);
 
 RptSize *rpt_report_get_page_size (RptReport *rpt_report);
 void rpt_report_set_page_size (RptReport *rpt_report,
@@ -144,6 +167,15 @@ void rpt_report_set_page_footer_first_last_page (RptReport *rpt_report,
 gboolean rpt_report_body_get_new_page_after (RptReport *rpt_report);
 void rpt_report_body_set_new_page_after (RptReport *rpt_report, gboolean new_page_after);
 
+gboolean rpt_report_get_section_can_grow (RptReport *rpt_report,
+                                          RptReportSection section);
+gboolean rpt_report_get_section_can_shrink (RptReport *rpt_report,
+                                            RptReportSection section);
+void rpt_report_set_section_can_grow_shrink (RptReport *rpt_report,
+                                             RptReportSection section,
+                                             gboolean can_grow,
+                                             gboolean can_shrink);
+
 gboolean rpt_report_add_object_to_section (RptReport *rpt_report,
                                            RptObject *rpt_object,
                                            RptReportSection section);
@@ -161,6 +193,7 @@ void rpt_report_set_description (RptReport *rpt_report,
 xmlDoc *rpt_report_get_xml (RptReport *rpt_report);
 
 xmlDoc *rpt_report_get_xml_rptprint (RptReport *rpt_report);
+xmlDoc *rpt_report_get_xml_rptprint_full (RptReport *rpt_report, GError **error);
 
 xmlDoc *rpt_report_rptprint_new (void);
 
@@ -21,6 +21,7 @@
 #define __RPT_REPORT_PRIV_H__
 
 #include <glib.h>
+#include <glib-object.h>
 
 #include "rptreport.h"
 
@@ -34,6 +35,11 @@ gchar *rpt_report_ask_field (RptReport *rpt_report,
 gchar *rpt_report_get_special (RptReport *rpt_report,
                                const gchar *special);
 
+gchar *rpt_report_scratch_strdup (const gchar *str);
+gchar *rpt_report_scratch_strndup (const gchar *str, gsize n);
+gchar *rpt_report_scratch_take (gchar *str);
+void rpt_report_scratch_clear (void);
+
 
 G_END_DECLS
 
@@ -0,0 +1,285 @@
+/*
+ * Copyright (C) 2007-2014 Andrea Zagli <azagli@libero.it>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <math.h>
+
+#include "rptspatialindex.h"
+
+/* side of the grid's cells, in points */
+#define RPT_SPATIAL_INDEX_CELL_SIZE 32.0
+
+/* the grid never has more cells than this for each side */
+#define RPT_SPATIAL_INDEX_MAX_CELLS 256
+
+typedef struct
+{
+	gpointer data;
+	cairo_rectangle_t extents;
+
+	/* the last query that found it */
+	guint mark;
+} RptSpatialIndexItem;
+
+/* a uniform grid over the page: every cell has the indexes, in insertion
+ * order, of the items whose extents touch it; the items outside of the
+ * page are in the border cells */
+struct _RptSpatialIndex
+{
+	gdouble cell_width;
+	gdouble cell_height;
+	gint columns;
+	gint rows;
+
+	GArray *items;
+	GArray **cells;
+
+	/* items without extents, returned by every query */
+	GArray *unbounded;
+
+	guint mark;
+};
+
+static gint rpt_spatial_index_column (RptSpatialIndex *index,
+                                      gdouble x);
+static gint rpt_spatial_index_row (RptSpatialIndex *index,
+                                   gdouble y);
+static gboolean rpt_spatial_index_intersects (const cairo_rectangle_t *a,
+                                              const cairo_rectangle_t *b);
+static gint rpt_spatial_index_compare_uint (gconstpointer a,
+                                            gconstpointer b);
+
+/**
+ * rpt_spatial_index_new:
+ * @width: the page's width, in points.
+ * @height: the page's height, in points.
+ *
+ * Returns: an empty index, to free with rpt_spatial_index_free().
+ */
+RptSpatialIndex
+*rpt_spatial_index_new (gdouble width, gdouble height)
+{
+	RptSpatialIndex *index;
+
+	index = g_new0 (RptSpatialIndex, 1);
+
+	index->columns = CLAMP ((gint)ceil (width / RPT_SPATIAL_INDEX_CELL_SIZE), 1, RPT_SPATIAL_INDEX_MAX_CELLS);
+	index->rows = CLAMP ((gint)ceil (height / RPT_SPATIAL_INDEX_CELL_SIZE), 1, RPT_SPATIAL_INDEX_MAX_CELLS);
+	index->cell_width = width > 0.0 ? width / index->columns : RPT_SPATIAL_INDEX_CELL_SIZE;
+	index->cell_height = height > 0.0 ? height / index->rows : RPT_SPATIAL_INDEX_CELL_SIZE;
+
+	index->items = g_array_new (FALSE, FALSE, sizeof (RptSpatialIndexItem));
+	index->cells = g_new0 (GArray *, index->columns * index->rows);
+	index->unbounded = g_array_new (FALSE, FALSE, sizeof (guint));
+
+	return index;
+}
+
+void
+rpt_spatial_index_free (RptSpatialIndex *index)
+{
+	gint i;
+
+	if (index == NULL)
+		{
+			return;
+		}
+
+	for (i = 0; i < index->columns * index->rows; i++)
+		{
+			if (index->cells[i] != NULL)
+				{
+					g_array_free (index->cells[i], TRUE);
+				}
+		}
+	g_free (index->cells);
+	g_array_free (index->items, TRUE);
+	g_array_free (index->unbounded, TRUE);
+	g_free (index);
+}
+
+/**
+ * rpt_spatial_index_insert:
+ * @index:
+ * @data: the item.
+ * @extents: the item's bounding box, in points; NULL if it isn't known,
+ * and the item is returned by every query.
+ *
+ * The items must be inserted in drawing order, the order of the queries.
+ */
+void
+rpt_spatial_index_insert (RptSpatialIndex *index,
+                          gpointer data,
+                          const cairo_rectangle_t *extents)
+{
+	RptSpatialIndexItem item;
+	GArray *cell;
+	guint n;
+	gint c1, c2, r1, r2;
+	gint c, r;
+
+	n = index->items->len;
+
+	item.data = data;
+	item.mark = 0;
+	if (extents == NULL)
+		{
+			item.extents.x = item.extents.y = 0.0;
+			item.extents.width = item.extents.height = -1.0;
+			g_array_append_val (index->items, item);
+			g_array_append_val (index->unbounded, n);
+			return;
+		}
+
+	item.extents = *extents;
+	g_array_append_val (index->items, item);
+
+	c1 = rpt_spatial_index_column (index, extents->x);
+	c2 = rpt_spatial_index_column (index, extents->x + extents->width);
+	r1 = rpt_spatial_index_row (index, extents->y);
+	r2 = rpt_spatial_index_row (index, extents->y + extents->height);
+	for (r = r1; r <= r2; r++)
+		{
+			for (c = c1; c <= c2; c++)
+				{
+					cell = index->cells[r * index->columns + c];
+					if (cell == NULL)
+						{
+							cell = g_array_new (FALSE, FALSE, sizeof (guint));
+							index->cells[r * index->columns + c] = cell;
+						}
+					g_array_append_val (cell, n);
+				}
+		}
+}
+
+/**
+ * rpt_spatial_index_query:
+ * @index:
+ * @region: the region, in points; NULL for all the items.
+ *
+ * Returns: the items whose extents intersect @region, and the ones
+ * without extents, in insertion order; to free with g_ptr_array_free().
+ */
+GPtrArray
+*rpt_spatial_index_query (RptSpatialIndex *index,
+                          const cairo_rectangle_t *region)
+{
+	GPtrArray *ret;
+	GArray *found;
+	GArray *cell;
+	RptSpatialIndexItem *item;
+	guint n;
+	guint i;
+	gint c1, c2, r1, r2;
+	gint c, r;
+
+	ret = g_ptr_array_sized_new (index->items->len);
+
+	if (region == NULL)
+		{
+			for (i = 0; i < index->items->len; i++)
+				{
+					g_ptr_array_add (ret, g_array_index (index->items, RptSpatialIndexItem, i).data);
+				}
+			return ret;
+		}
+
+	/* a new mark, to take every item once even if it is in more cells */
+	index->mark++;
+	if (index->mark == 0)
+		{
+			for (i = 0; i < index->items->len; i++)
+				{
+					g_array_index (index->items, RptSpatialIndexItem, i).mark = 0;
+				}
+			index->mark = 1;
+		}
+
+	found = g_array_new (FALSE, FALSE, sizeof (guint));
+	g_array_append_vals (found, index->unbounded->data, index->unbounded->len);
+
+	c1 = rpt_spatial_index_column (index, region->x);
+	c2 = rpt_spatial_index_column (index, region->x + region->width);
+	r1 = rpt_spatial_index_row (index, region->y);
+	r2 = rpt_spatial_index_row (index, region->y + region->height);
+	for (r = r1; r <= r2; r++)
+		{
+			for (c = c1; c <= c2; c++)
+				{
+					cell = index->cells[r * index->columns + c];
+					if (cell == NULL)
+						{
+							continue;
+						}
+					for (i = 0; i < cell->len; i++)
+						{
+							n = g_array_index (cell, guint, i);
+							item = &g_array_index (index->items, RptSpatialIndexItem, n);
+							if (item->mark != index->mark)
+								{
+									item->mark = index->mark;
+									if (rpt_spatial_index_intersects (&item->extents, region))
+										{
+											g_array_append_val (found, n);
+										}
+								}
+						}
+				}
+		}
+
+	/* back to the drawing order */
+	g_array_sort (found, rpt_spatial_index_compare_uint);
+	for (i = 0; i < found->len; i++)
+		{
+			g_ptr_array_add (ret, g_array_index (index->items, RptSpatialIndexItem, g_array_index (found, guint, i)).data);
+		}
+	g_array_free (found, TRUE);
+
+	return ret;
+}
+
+static gint
+rpt_spatial_index_column (RptSpatialIndex *index, gdouble x)
+{
+	return (gint)CLAMP (floor (x / index->cell_width), 0, index->columns - 1);
+}
+
+static gint
+rpt_spatial_index_row (RptSpatialIndex *index, gdouble y)
+{
+	return (gint)CLAMP (floor (y / index->cell_height), 0, index->rows - 1);
+}
+
+/* the edges count: a line has no width or height */
+static gboolean
+rpt_spatial_index_intersects (const cairo_rectangle_t *a, const cairo_rectangle_t *b)
+{
+	return a->x <= b->x + b->width
+	       && b->x <= a->x + a->width
+	       && a->y <= b->y + b->height
+	       && b->y <= a->y + a->height;
+}
+
+static gint
+rpt_spatial_index_compare_uint (gconstpointer a, gconstpointer b)
+{
+	guint ua = *(const guint *)a;
+	guint ub = *(const guint *)b;
+
+	return ua < ub ? -1 : (ua > ub ? 1 : 0);
+}
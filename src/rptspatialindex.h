@@ -0,0 +1,43 @@
+/*
+ * Copyright (C) 2007-2014 Andrea Zagli <azagli@libero.it>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef __RPT_SPATIAL_INDEX_H__
+#define __RPT_SPATIAL_INDEX_H__
+
+#include <glib.h>
+#include <cairo.h>
+
+G_BEGIN_DECLS
+
+
+typedef struct _RptSpatialIndex RptSpatialIndex;
+
+RptSpatialIndex *rpt_spatial_index_new (gdouble width, gdouble height);
+void rpt_spatial_index_free (RptSpatialIndex *index);
+
+void rpt_spatial_index_insert (RptSpatialIndex *index,
+                               gpointer data,
+                               const cairo_rectangle_t *extents);
+
+GPtrArray *rpt_spatial_index_query (RptSpatialIndex *index,
+                                    const cairo_rectangle_t *region);
+
+
+G_END_DECLS
+
+#endif /* __RPT_SPATIAL_INDEX_H__ */
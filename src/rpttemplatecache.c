@@ -0,0 +1,312 @@
+/*
+ * Copyright (C) 2007-2014 Andrea Zagli <azagli@libero.it>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <glib/gstdio.h>
+
+#include "rpttemplatecache.h"
+
+/* default memory limit of the cache */
+#define RPT_TEMPLATE_CACHE_DEFAULT_MAX_SIZE (64 * 1024 * 1024)
+
+/* a loaded template takes about this many times the size of its file */
+#define RPT_TEMPLATE_CACHE_SIZE_FACTOR 8
+
+typedef struct
+{
+	gchar *path;
+	time_t mtime;
+	goffset file_size;
+
+	/* the estimated memory taken */
+	gsize size;
+
+	/* never given out: every caller gets a copy */
+	RptReport *report;
+
+	/* in lru */
+	GList *link;
+} RptTemplateCacheEntry;
+
+static void rpt_template_cache_entry_free (RptTemplateCacheEntry *entry);
+static void rpt_template_cache_remove (RptTemplateCacheEntry *entry);
+static void rpt_template_cache_evict (void);
+static gchar *rpt_template_cache_canonical_path (const gchar *filename);
+
+/* path -> RptTemplateCacheEntry; everything is protected by the lock */
+static GHashTable *entries = NULL;
+
+/* the entries, the most recently used first */
+static GQueue lru = G_QUEUE_INIT;
+
+static gsize total_size = 0;
+static gsize max_size = RPT_TEMPLATE_CACHE_DEFAULT_MAX_SIZE;
+
+G_LOCK_DEFINE_STATIC (cache);
+
+/**
+ * rpt_template_cache_get:
+ * @filename: the path of the report definition.
+ * @error: return location for a #GError, or NULL.
+ *
+ * Loads the report definition the first time, and every time the file's
+ * modification time or size change; the other times returns a copy of the
+ * one already loaded, made with rpt_report_copy(): the objects are shared
+ * with the cache until the copy hands them out, and then copied, so they
+ * can be changed without changing the cached definition.
+ *
+ * The cache is shared by all the threads, is keyed by the file's canonical
+ * path and drops the least recently used definitions when their memory
+ * goes over the limit set with rpt_template_cache_set_max_size().
+ *
+ * Returns: a new #RptReport, to unref when done; NULL, with @error set, if
+ * the file cannot be loaded.
+ */
+RptReport
+*rpt_template_cache_get (const gchar *filename, GError **error)
+{
+	RptTemplateCacheEntry *entry;
+	RptReport *template;
+	RptReport *ret;
+	GStatBuf st;
+	gchar *path;
+	gint errsv;
+
+	g_return_val_if_fail (filename != NULL, NULL);
+
+	path = rpt_template_cache_canonical_path (filename);
+	if (g_stat (path, &st) != 0)
+		{
+			errsv = errno;
+			g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (errsv),
+			             "Unable to read «%s»: %s", filename, g_strerror (errsv));
+			g_free (path);
+			return NULL;
+		}
+
+	template = NULL;
+
+	G_LOCK (cache);
+	if (entries != NULL)
+		{
+			entry = (RptTemplateCacheEntry *)g_hash_table_lookup (entries, path);
+			if (entry != NULL
+			    && entry->mtime == st.st_mtime
+			    && entry->file_size == st.st_size)
+				{
+					g_queue_unlink (&lru, entry->link);
+					g_queue_push_head_link (&lru, entry->link);
+					template = g_object_ref (entry->report);
+				}
+		}
+	G_UNLOCK (cache);
+
+	if (template == NULL)
+		{
+			/* loaded without the lock; two threads could load the same file,
+			 * and the last one stays in the cache */
+			template = rpt_report_new_from_file_full (path, error);
+			if (template == NULL)
+				{
+					g_free (path);
+					return NULL;
+				}
+
+			entry = g_new0 (RptTemplateCacheEntry, 1);
+			entry->path = g_strdup (path);
+			entry->mtime = st.st_mtime;
+			entry->file_size = st.st_size;
+			entry->size = sizeof (RptTemplateCacheEntry) + strlen (path) + st.st_size * RPT_TEMPLATE_CACHE_SIZE_FACTOR;
+			entry->report = g_object_ref (template);
+
+			G_LOCK (cache);
+			if (entries == NULL)
+				{
+					entries = g_hash_table_new_full (g_str_hash, g_str_equal,
+					                                 NULL, (GDestroyNotify)rpt_template_cache_entry_free);
+				}
+			if (g_hash_table_lookup (entries, path) != NULL)
+				{
+					rpt_template_cache_remove ((RptTemplateCacheEntry *)g_hash_table_lookup (entries, path));
+				}
+			if (entry->size <= max_size)
+				{
+					g_queue_push_head (&lru, entry);
+					entry->link = lru.head;
+					g_hash_table_insert (entries, entry->path, entry);
+					total_size += entry->size;
+
+					rpt_template_cache_evict ();
+				}
+			else
+				{
+					rpt_template_cache_entry_free (entry);
+				}
+			G_UNLOCK (cache);
+		}
+
+	/* copied outside of the lock: the template is never changed */
+	ret = rpt_report_copy (template);
+	g_object_unref (template);
+
+	g_free (path);
+
+	return ret;
+}
+
+/**
+ * rpt_template_cache_invalidate:
+ * @filename: the path of a report definition.
+ *
+ * Drops the definition loaded from @filename, if any; the next
+ * rpt_template_cache_get() loads the file again.
+ */
+void
+rpt_template_cache_invalidate (const gchar *filename)
+{
+	RptTemplateCacheEntry *entry;
+	gchar *path;
+
+	g_return_if_fail (filename != NULL);
+
+	path = rpt_template_cache_canonical_path (filename);
+
+	G_LOCK (cache);
+	if (entries != NULL)
+		{
+			entry = (RptTemplateCacheEntry *)g_hash_table_lookup (entries, path);
+			if (entry != NULL)
+				{
+					rpt_template_cache_remove (entry);
+				}
+		}
+	G_UNLOCK (cache);
+
+	g_free (path);
+}
+
+/**
+ * rpt_template_cache_clear:
+ *
+ * Drops all the loaded definitions; the reports already returned aren't
+ * touched.
+ */
+void
+rpt_template_cache_clear (void)
+{
+	G_LOCK (cache);
+	while (!g_queue_is_empty (&lru))
+		{
+			rpt_template_cache_remove ((RptTemplateCacheEntry *)g_queue_peek_tail (&lru));
+		}
+	G_UNLOCK (cache);
+}
+
+/**
+ * rpt_template_cache_set_max_size:
+ * @limit: the memory limit, in bytes; the default is 64 MiB.
+ *
+ * The memory taken by a definition is estimated from its file's size.
+ */
+void
+rpt_template_cache_set_max_size (gsize limit)
+{
+	G_LOCK (cache);
+	max_size = limit;
+	rpt_template_cache_evict ();
+	G_UNLOCK (cache);
+}
+
+/**
+ * rpt_template_cache_get_size:
+ *
+ * Returns: the estimated memory taken by the cache, in bytes.
+ */
+gsize
+rpt_template_cache_get_size (void)
+{
+	gsize ret;
+
+	G_LOCK (cache);
+	ret = total_size;
+	G_UNLOCK (cache);
+
+	return ret;
+}
+
+static void
+rpt_template_cache_entry_free (RptTemplateCacheEntry *entry)
+{
+	g_object_unref (entry->report);
+	g_free (entry->path);
+	g_free (entry);
+}
+
+/* with the lock held */
+static void
+rpt_template_cache_remove (RptTemplateCacheEntry *entry)
+{
+	g_queue_delete_link (&lru, entry->link);
+	total_size -= entry->size;
+
+	/* frees entry */
+	g_hash_table_remove (entries, entry->path);
+}
+
+/* with the lock held */
+static void
+rpt_template_cache_evict (void)
+{
+	while (total_size > max_size && !g_queue_is_empty (&lru))
+		{
+			rpt_template_cache_remove ((RptTemplateCacheEntry *)g_queue_peek_tail (&lru));
+		}
+}
+
+static gchar
+*rpt_template_cache_canonical_path (const gchar *filename)
+{
+	gchar *ret;
+	gchar *cwd;
+
+#ifndef G_OS_WIN32
+	char *resolved;
+
+	resolved = realpath (filename, NULL);
+	if (resolved != NULL)
+		{
+			ret = g_strdup (resolved);
+			free (resolved);
+			return ret;
+		}
+#endif
+
+	if (g_path_is_absolute (filename))
+		{
+			return g_strdup (filename);
+		}
+
+	cwd = g_get_current_dir ();
+	ret = g_build_filename (cwd, filename, NULL);
+	g_free (cwd);
+
+	return ret;
+}
@@ -0,0 +1,40 @@
+/*
+ * Copyright (C) 2007-2014 Andrea Zagli <azagli@libero.it>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef __RPT_TEMPLATE_CACHE_H__
+#define __RPT_TEMPLATE_CACHE_H__
+
+#include <glib.h>
+
+#include "rptreport.h"
+
+G_BEGIN_DECLS
+
+
+RptReport *rpt_template_cache_get (const gchar *filename, GError **error);
+
+void rpt_template_cache_invalidate (const gchar *filename);
+void rpt_template_cache_clear (void);
+
+void rpt_template_cache_set_max_size (gsize limit);
+gsize rpt_template_cache_get_size (void);
+
+
+G_END_DECLS
+
+#endif /* __RPT_TEMPLATE_CACHE_H__ */
@@ -0,0 +1,246 @@
+/*
+ * Copyright (C) 2014 Andrea Zagli <azagli@libero.it>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor Boston, MA 02110-1301,  USA
+ */
+
+#include <malloc.h>
+
+#include <glib/gstdio.h>
+
+#include <libgda/libgda.h>
+
+#include <rptreport.h>
+#include <rptprint.h>
+#include <rptobjecttext.h>
+
+/* runs done before measuring, so caches and allocator pools are warm */
+#define WARMUP_RUNS 20
+#define RUNS 300
+
+/* how many bytes the heap in use may grow while the measured runs are
+ * done: the caches are warm, so a leak of a few bytes a run goes over it */
+#define MAX_GROWTH_BYTES 4096
+
+/* the objects not finalized yet */
+static gint live_objects = 0;
+
+/* the bytes malloc() handed out and that aren't freed yet; -1 if the C
+ * library doesn't tell */
+static gssize
+get_heap_in_use (void)
+{
+#if defined (__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+	return (gssize)mallinfo2 ().uordblks;
+#elif defined (__GLIBC__)
+	return (gssize)mallinfo ().uordblks;
+#else
+	return -1;
+#endif
+}
+
+static void
+on_finalized (gpointer data, GObject *object)
+{
+	live_objects--;
+}
+
+/* counts @object among the live ones until it's finalized */
+static gpointer
+track (gpointer object)
+{
+	live_objects++;
+	g_object_weak_ref (G_OBJECT (object), on_finalized, NULL);
+
+	return object;
+}
+
+static GdaDataModel
+*create_data_model (void)
+{
+	GdaDataModel *model;
+	GList *values;
+	GValue *gval;
+	gint row;
+
+	model = gda_data_model_array_new_with_g_types (3,
+	                                               G_TYPE_INT,
+	                                               G_TYPE_STRING,
+	                                               G_TYPE_DOUBLE);
+	gda_data_model_set_column_name (model, 0, "id");
+	gda_data_model_set_column_name (model, 1, "name");
+	gda_data_model_set_column_name (model, 2, "amount");
+
+	for (row = 0; row < 120; row++)
+		{
+			values = NULL;
+
+			gval = gda_value_new (G_TYPE_INT);
+			g_value_set_int (gval, row);
+			values = g_list_append (values, gval);
+
+			gval = gda_value_new (G_TYPE_STRING);
+			g_value_take_string (gval, g_strdup_printf ("Name & surname %d", row));
+			values = g_list_append (values, gval);
+
+			gval = gda_value_new (G_TYPE_DOUBLE);
+			g_value_set_double (gval, row * 1234.5);
+			values = g_list_append (values, gval);
+
+			gda_data_model_append_values (model, values, NULL);
+
+			g_list_free_full (values, (GDestroyNotify)gda_value_free);
+		}
+
+	return model;
+}
+
+static void
+add_text (RptReport *rptr,
+          RptReportSection section,
+          const gchar *name,
+          gdouble x,
+          gdouble y,
+          const gchar *source,
+          const gchar *format)
+{
+	RptObject *obj;
+	RptPoint point;
+	RptSize size;
+
+	point.x = x;
+	point.y = y;
+	size.width = 60;
+	size.height = 6;
+
+	obj = track (rpt_obj_text_new (name, point));
+	g_object_set (obj,
+	              "source", source,
+	              "size", &size,
+	              "format", format,
+	              NULL);
+	rpt_report_add_object_to_section (rptr, obj, section);
+}
+
+static RptReport
+*create_report (GdaDataModel *model)
+{
+	RptReport *rptr;
+	RptSize size;
+
+	rptr = track (rpt_report_new ());
+	g_object_set (G_OBJECT (rptr), "unit-length", RPT_UNIT_MILLIMETRE, NULL);
+
+	size.width = 210;
+	size.height = 297;
+	rpt_report_set_page_size (rptr, size);
+	rpt_report_set_page_margins (rptr, 10, 10, 10, 10);
+
+	rpt_report_set_database_from_datamodel (rptr, model);
+
+	rpt_report_set_section_height (rptr, RPTREPORT_SECTION_PAGE_HEADER, 10);
+	add_text (rptr, RPTREPORT_SECTION_PAGE_HEADER, "date", 0, 0, "@Date{%d/%m/%Y} & \" \" & @Time", "");
+
+	rpt_report_set_section_height (rptr, RPTREPORT_SECTION_PAGE_FOOTER, 10);
+	add_text (rptr, RPTREPORT_SECTION_PAGE_FOOTER, "page", 0, 0, "\"Page \" & @Page & \" of \" & @Pages", "");
+
+	rpt_report_set_section_height (rptr, RPTREPORT_SECTION_BODY, 6);
+	add_text (rptr, RPTREPORT_SECTION_BODY, "id", 0, 0, "[id]", "");
+	add_text (rptr, RPTREPORT_SECTION_BODY, "name", 20, 0, "[name]", "");
+	add_text (rptr, RPTREPORT_SECTION_BODY, "amount", 80, 0, "[amount]", "#,##0.00");
+	add_text (rptr, RPTREPORT_SECTION_BODY, "double", 140, 0, "[amount] * 2", "0.0");
+
+	return rptr;
+}
+
+static void
+run (GdaDataModel *model)
+{
+	RptReport *rptr;
+	RptPrint *rptp;
+	xmlDoc *xdoc;
+
+	rptr = create_report (model);
+
+	xdoc = rpt_report_get_xml_rptprint (rptr);
+	g_assert (xdoc != NULL);
+
+	rptp = rpt_print_new_from_xml (xdoc);
+	g_assert (rptp != NULL);
+	track (rptp);
+
+	rpt_print_set_output_type (rptp, RPT_OUTPUT_PDF);
+	rpt_print_set_output_filename (rptp, "leakcheck.pdf");
+	rpt_print_print (rptp, NULL);
+
+	g_object_unref (rptp);
+	xmlFreeDoc (xdoc);
+	g_object_unref (rptr);
+
+	/* the report, its objects and the print */
+	if (live_objects != 0)
+		{
+			g_error ("%d objects of a run weren't finalized.", live_objects);
+		}
+}
+
+int
+main (int argc, char **argv)
+{
+	GdaDataModel *model;
+	gssize heap_start;
+	gssize heap_end;
+	gint i;
+
+	/* every block is a malloc() of its own, so the heap tells them all */
+	g_setenv ("G_SLICE", "always-malloc", TRUE);
+
+	gda_init ();
+
+	if (get_heap_in_use () < 0)
+		{
+			g_message ("The heap in use isn't known with this C library, skipping.");
+			return 77;
+		}
+
+	model = create_data_model ();
+
+	for (i = 0; i < WARMUP_RUNS; i++)
+		{
+			run (model);
+		}
+	heap_start = get_heap_in_use ();
+
+	for (i = 0; i < RUNS; i++)
+		{
+			run (model);
+		}
+	heap_end = get_heap_in_use ();
+
+	g_object_unref (model);
+	g_unlink ("leakcheck.pdf");
+
+	g_message ("Heap in use: %" G_GSSIZE_FORMAT " bytes after %d runs, %" G_GSSIZE_FORMAT " bytes after %d more.",
+	           heap_start, WARMUP_RUNS, heap_end, RUNS);
+
+	if (heap_end - heap_start > MAX_GROWTH_BYTES)
+		{
+			g_warning ("The heap in use grew by %" G_GSSIZE_FORMAT " bytes, %" G_GSSIZE_FORMAT " a run.",
+			           heap_end - heap_start, (heap_end - heap_start) / RUNS);
+			return 1;
+		}
+
+	return 0;
+}
@@ -18,6 +18,7 @@
 
 #include <rptreport.h>
 #include <rptprint.h>
+#include <rptgtk.h>
 
 gchar
 *field_request (RptReport *rpt_report,
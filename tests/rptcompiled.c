@@ -0,0 +1,204 @@
+/*
+ * Copyright (C) 2014 Andrea Zagli <azagli@libero.it>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor Boston, MA 02110-1301,  USA
+ */
+
+#include <string.h>
+
+#include <glib/gstdio.h>
+
+#include <libgda/libgda.h>
+
+#include <rptreport.h>
+#include <rptcompiled.h>
+
+/* where the fields are in the header of a compiled template */
+#define OFFSET_VERSION 4
+#define OFFSET_LIBRARY_VERSION 8
+#define OFFSET_N_NODES 32
+#define OFFSET_STRINGS_SIZE 36
+#define OFFSET_N_STRINGS 28
+#define HEADER_SIZE 40
+
+static const gchar *report_xml =
+	"<?xml version=\"1.0\" ?>\n"
+	"<reptool>\n"
+	"	<page width=\"595\" height=\"842\" />\n"
+	"	<report>\n"
+	"		<page-header height=\"20\">\n"
+	"			<text name=\"title\" x=\"10\" y=\"0\" width=\"200\" height=\"20\" source=\"&quot;Title &amp; more&quot;\" />\n"
+	"		</page-header>\n"
+	"		<body height=\"20\">\n"
+	"			<text name=\"id\" x=\"10\" y=\"0\" width=\"50\" height=\"20\" source=\"[id]\" format=\"#,##0\" />\n"
+	"			<rect name=\"box\" x=\"70\" y=\"0\" width=\"50\" height=\"20\" fill-color=\"#FFFF00\" />\n"
+	"		</body>\n"
+	"	</report>\n"
+	"</reptool>\n";
+
+static gchar *tmp_dir;
+
+static gchar
+*write_file (const gchar *name, const gchar *data, gsize length)
+{
+	gchar *filename;
+	GError *error;
+
+	filename = g_build_filename (tmp_dir, name, NULL);
+
+	error = NULL;
+	if (!g_file_set_contents (filename, data, length, &error))
+		{
+			g_error ("Unable to write «%s»: %s", filename, error->message);
+		}
+
+	return filename;
+}
+
+static guint32
+get_word (const gchar *data, gsize offset)
+{
+	guint32 word;
+
+	memcpy (&word, data + offset, 4);
+
+	return word;
+}
+
+static void
+set_word (gchar *data, gsize offset, guint32 word)
+{
+	memcpy (data + offset, &word, 4);
+}
+
+/* loads @length bytes of @data and checks that they're refused with @code */
+static void
+check_refused (const gchar *what, const gchar *data, gsize length, gint code)
+{
+	gchar *filename;
+	RptReport *rptr;
+	GError *error;
+
+	filename = write_file ("broken.rptc", data, length);
+
+	error = NULL;
+	rptr = rpt_report_new_from_file_full (filename, &error);
+	if (rptr != NULL || !g_error_matches (error, RPT_REPORT_ERROR, code))
+		{
+			g_error ("A compiled template %s was loaded, or refused with another error: %s.",
+			         what, error != NULL ? error->message : "no error");
+		}
+	g_error_free (error);
+
+	g_unlink (filename);
+	g_free (filename);
+}
+
+int
+main (int argc, char **argv)
+{
+	GError *error;
+	gchar *xml_filename;
+	gchar *compiled_filename;
+	gchar *compiled;
+	gchar *broken;
+	gsize length;
+	gsize strings;
+	RptReport *rptr;
+	xmlDoc *xdoc;
+
+	gda_init ();
+
+	error = NULL;
+	tmp_dir = g_dir_make_tmp ("rptcompiledXXXXXX", &error);
+	g_assert (tmp_dir != NULL);
+
+	xml_filename = write_file ("report.rpt", report_xml, strlen (report_xml));
+	compiled_filename = g_build_filename (tmp_dir, "report.rptc", NULL);
+
+	/* a valid definition is compiled, and loaded as the xml */
+	g_assert (rpt_report_compile_file (xml_filename, compiled_filename, &error));
+	g_assert_no_error (error);
+
+	rptr = rpt_report_new_from_file_full (compiled_filename, &error);
+	g_assert_no_error (error);
+	g_assert (rptr != NULL);
+	g_assert (rpt_report_get_object_from_name (rptr, "title") != NULL);
+	g_assert (rpt_report_get_object_from_name (rptr, "id") != NULL);
+	g_assert (rpt_report_get_object_from_name (rptr, "box") != NULL);
+	xdoc = rpt_report_get_xml (rptr);
+	g_assert (xdoc != NULL);
+	xmlFreeDoc (xdoc);
+	g_object_unref (rptr);
+
+	/* a compiled template isn't compiled again */
+	g_assert (!rpt_report_compile_file (compiled_filename, compiled_filename, &error));
+	g_assert_error (error, RPT_REPORT_ERROR, RPT_REPORT_ERROR_INVALID_XML);
+	g_clear_error (&error);
+
+	g_assert (g_file_get_contents (compiled_filename, &compiled, &length, &error));
+	g_assert (length > HEADER_SIZE);
+	g_assert_cmpuint (get_word (compiled, OFFSET_VERSION), ==, RPT_COMPILED_VERSION);
+	strings = HEADER_SIZE + get_word (compiled, OFFSET_N_STRINGS) * 4;
+
+	/* truncated */
+	check_refused ("without its last word", compiled, length - 4, RPT_REPORT_ERROR_INVALID_COMPILED);
+	check_refused ("cut in half", compiled, length / 2, RPT_REPORT_ERROR_INVALID_COMPILED);
+	check_refused ("with only the header", compiled, HEADER_SIZE, RPT_REPORT_ERROR_INVALID_COMPILED);
+	/* shorter than the header it isn't recognized, and it's read as xml */
+	check_refused ("shorter than the header", compiled, HEADER_SIZE / 2, RPT_REPORT_ERROR_INVALID_XML);
+
+	/* corrupted */
+	broken = g_memdup (compiled, length);
+	set_word (broken, OFFSET_N_NODES, get_word (compiled, OFFSET_N_NODES) + 1);
+	check_refused ("with a wrong number of nodes", broken, length, RPT_REPORT_ERROR_INVALID_COMPILED);
+
+	memcpy (broken, compiled, length);
+	set_word (broken, HEADER_SIZE, 0x00FFFFFF);
+	check_refused ("with a string outside the table", broken, length, RPT_REPORT_ERROR_INVALID_COMPILED);
+
+	memcpy (broken, compiled, length);
+	broken[strings + get_word (compiled, OFFSET_STRINGS_SIZE) - 1] = 'x';
+	check_refused ("with an unterminated string", broken, length, RPT_REPORT_ERROR_INVALID_COMPILED);
+
+	memcpy (broken, compiled, length);
+	set_word (broken, strings + get_word (compiled, OFFSET_STRINGS_SIZE), 0xFFFFFFFE);
+	check_refused ("with a node's name outside the table", broken, length, RPT_REPORT_ERROR_INVALID_COMPILED);
+
+	/* another version */
+	memcpy (broken, compiled, length);
+	set_word (broken, OFFSET_VERSION, RPT_COMPILED_VERSION + 1);
+	check_refused ("with another layout", broken, length, RPT_REPORT_ERROR_VERSION_MISMATCH);
+
+	memcpy (broken, compiled, length);
+	set_word (broken, OFFSET_VERSION, GUINT32_SWAP_LE_BE (RPT_COMPILED_VERSION));
+	check_refused ("with another byte order", broken, length, RPT_REPORT_ERROR_VERSION_MISMATCH);
+
+	memcpy (broken, compiled, length);
+	memcpy (broken + OFFSET_LIBRARY_VERSION, "0.0.0-other\0\0\0\0", 16);
+	check_refused ("by another library", broken, length, RPT_REPORT_ERROR_VERSION_MISMATCH);
+
+	g_free (broken);
+	g_free (compiled);
+
+	g_unlink (compiled_filename);
+	g_unlink (xml_filename);
+	g_rmdir (tmp_dir);
+	g_free (compiled_filename);
+	g_free (xml_filename);
+	g_free (tmp_dir);
+
+	return 0;
+}
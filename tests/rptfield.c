@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2014 Andrea Zagli <azagli@libero.it>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor Boston, MA 02110-1301,  USA
+ */
+
+#include <string.h>
+
+#include <libgda/libgda.h>
+
+#include <rptreport.h>
+
+/* the field is asked inside an expression, and the handler evaluates the
+ * sources of another report meanwhile */
+static const gchar *outer_xml =
+	"<?xml version=\"1.0\" ?>\n"
+	"<reptool>\n"
+	"	<page width=\"595\" height=\"842\" />\n"
+	"	<report>\n"
+	"		<body height=\"20\">\n"
+	"			<text name=\"asked\" x=\"10\" y=\"0\" width=\"200\" height=\"20\" source=\"&quot;&lt;&quot; &amp; [asked] &amp; &quot;&gt;&quot;\" />\n"
+	"		</body>\n"
+	"	</report>\n"
+	"</reptool>\n";
+
+static const gchar *inner_xml =
+	"<?xml version=\"1.0\" ?>\n"
+	"<reptool>\n"
+	"	<page width=\"595\" height=\"842\" />\n"
+	"	<report>\n"
+	"		<body height=\"20\">\n"
+	"			<text name=\"inner\" x=\"10\" y=\"0\" width=\"200\" height=\"20\" source=\"&quot;left over &quot; &amp; &quot;by the handler&quot;\" />\n"
+	"		</body>\n"
+	"	</report>\n"
+	"</reptool>\n";
+
+static RptReport
+*new_report (const gchar *xml)
+{
+	RptReport *rptr;
+	xmlDoc *xdoc;
+
+	xdoc = xmlReadMemory (xml, strlen (xml), NULL, NULL, 0);
+	g_assert (xdoc != NULL);
+	rptr = rpt_report_new_from_xml (xdoc);
+	g_assert (rptr != NULL);
+	xmlFreeDoc (xdoc);
+
+	return rptr;
+}
+
+/* returns the text of the first text object under @xnode */
+static gchar
+*get_text (xmlNode *xnode)
+{
+	gchar *ret;
+
+	for (; xnode != NULL; xnode = xnode->next)
+		{
+			if (xnode->type != XML_ELEMENT_NODE)
+				{
+					continue;
+				}
+			if (g_strcmp0 ((const gchar *)xnode->name, "text") == 0)
+				{
+					return (gchar *)xmlNodeGetContent (xnode);
+				}
+			ret = get_text (xnode->children);
+			if (ret != NULL)
+				{
+					return ret;
+				}
+		}
+
+	return NULL;
+}
+
+static gchar
+*on_field_request (RptReport *rpt_report,
+                   gchar *field_name,
+                   GdaDataModel *data_model,
+                   gint row,
+                   gpointer tree_model,
+                   gpointer iter,
+                   gpointer user_data)
+{
+	RptReport *inner;
+	xmlDoc *xdoc;
+
+	g_assert_cmpstr (field_name, ==, "asked");
+
+	inner = new_report (inner_xml);
+	xdoc = rpt_report_get_xml_rptprint (inner);
+	g_assert (xdoc != NULL);
+	xmlFreeDoc (xdoc);
+	g_object_unref (inner);
+
+	return g_strdup ("a & b");
+}
+
+int
+main (int argc, char **argv)
+{
+	RptReport *rptr;
+	xmlDoc *xdoc;
+	gchar *text;
+
+	gda_init ();
+
+	rptr = new_report (outer_xml);
+	g_signal_connect (rptr, "field-request", G_CALLBACK (on_field_request), NULL);
+
+	xdoc = rpt_report_get_xml_rptprint (rptr);
+	g_assert (xdoc != NULL);
+
+	text = get_text (xmlDocGetRootElement (xdoc));
+	g_assert_cmpstr (text, ==, "<a & b>");
+
+	xmlFree (text);
+	xmlFreeDoc (xdoc);
+	g_object_unref (rptr);
+
+	return 0;
+}
@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2014 Andrea Zagli <azagli@libero.it>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor Boston, MA 02110-1301,  USA
+ */
+
+#include <locale.h>
+
+#include <libgda/libgda.h>
+
+#include <rptformat.h>
+
+static void
+check_number (const gchar *mask, gdouble number, const gchar *expected)
+{
+	RptFormat *format;
+	gchar *ret;
+
+	format = rpt_format_new (mask);
+	g_assert (format != NULL);
+
+	ret = rpt_format_double (format, number);
+	g_assert_cmpstr (ret, ==, expected);
+
+	g_free (ret);
+	rpt_format_free (format);
+}
+
+static void
+check_string (const gchar *mask, const gchar *str, const gchar *expected)
+{
+	RptFormat *format;
+	gchar *ret;
+
+	format = rpt_format_new (mask);
+	g_assert (format != NULL);
+
+	ret = rpt_format_string (format, str);
+	g_assert_cmpstr (ret, ==, expected);
+
+	g_free (ret);
+	rpt_format_free (format);
+}
+
+static void
+check_date (const gchar *mask, GDateYear year, GDateMonth month, GDateDay day, const gchar *expected)
+{
+	RptFormat *format;
+	GValue value = G_VALUE_INIT;
+	GDate *date;
+	gchar *ret;
+
+	date = g_date_new_dmy (day, month, year);
+	g_value_init (&value, G_TYPE_DATE);
+	g_value_take_boxed (&value, date);
+
+	format = rpt_format_new (mask);
+	g_assert (format != NULL);
+
+	ret = rpt_format_value (format, &value);
+	g_assert_cmpstr (ret, ==, expected);
+
+	g_free (ret);
+	rpt_format_free (format);
+	g_value_unset (&value);
+}
+
+int
+main (int argc, char **argv)
+{
+	gda_init ();
+
+	setlocale (LC_ALL, "C");
+
+	g_assert (rpt_format_new (NULL) == NULL);
+	g_assert (rpt_format_new ("") == NULL);
+
+	/* numbers */
+	check_number ("#,##0.00", 1234.5, "1,234.50");
+	check_number ("€ #,##0.00", -1234567.891, "-€ 1,234,567.89");
+	check_number ("0.0%", 0.125, "12.5%");
+	check_number ("#.##", 0.5, ".5");
+	check_number ("0.00", -0.001, "0.00");
+	check_number ("000", 7, "007");
+	check_number ("'#'0", 7, "#7");
+	check_number ("0 'days'", 3, "3 days");
+	check_number ("0.0' h'", 1.5, "1.5 h");
+	check_number ("#,##0 ms", 1500, "1,500 ms");
+	check_string ("#,##0.00", " 1234.5 ", "1,234.50");
+	check_string ("#,##0.00", "abc", "abc");
+
+	/* dates, also with a literal 0 */
+	check_string ("dd/MM/yyyy", "2014-03-05", "05/03/2014");
+	check_string ("dd/MM/yyyy 00:00", "2014-03-05", "05/03/2014 00:00");
+	check_string ("yyyy-MM-dd HH:mm:ss", "2014-03-05 07:08:09", "2014-03-05 07:08:09");
+	check_string ("d/M/yy h:mm", "2014-03-05 13:04:00", "5/3/14 1:04");
+	check_string ("HH'h'mm", "07:08:00", "07h08");
+	check_string ("'Day' d '''0'", "2014-03-05", "Day 5 '0");
+	check_string ("dd/MM/yyyy", "not a date", "not a date");
+	check_date ("dd MMM yyyy", 2014, G_DATE_MARCH, 5, "05 Mar 2014");
+	check_date ("d MMMM yyyy", 2014, G_DATE_MARCH, 5, "5 March 2014");
+
+	/* the separators come from the locale the mask is compiled in */
+	if (setlocale (LC_NUMERIC, "de_DE.UTF-8") != NULL)
+		{
+			check_number ("#,##0.00", 1234.5, "1.234,50");
+			check_string ("#,##0.00", "1234.5", "1.234,50");
+			setlocale (LC_NUMERIC, "C");
+		}
+	else
+		{
+			g_message ("The de_DE.UTF-8 locale isn't available, its checks are skipped.");
+		}
+
+	return 0;
+}
@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2014 Andrea Zagli <azagli@libero.it>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor Boston, MA 02110-1301,  USA
+ */
+
+#include <string.h>
+
+#include <libgda/libgda.h>
+
+#include <rptreport.h>
+
+#define PAGE_HEIGHT 300.0
+#define MARGIN_BOTTOM 50.0
+
+/* a body that grows with its text and no page footer: the bands must stop
+ * at the bottom margin */
+static const gchar *report_xml =
+	"<?xml version=\"1.0\" ?>\n"
+	"<reptool>\n"
+	"	<page width=\"595\" height=\"300\" margin-top=\"20\" margin-bottom=\"50\" />\n"
+	"	<report>\n"
+	"		<body height=\"20\" can-grow=\"y\">\n"
+	"			<text name=\"name\" x=\"10\" y=\"0\" width=\"100\" height=\"20\" can-grow=\"y\" source=\"[name]\" />\n"
+	"		</body>\n"
+	"	</report>\n"
+	"</reptool>\n";
+
+static GdaDataModel
+*create_data_model (void)
+{
+	GdaDataModel *model;
+	GString *str;
+	GValue *gval;
+	GList *values;
+	gint row;
+	gint i;
+
+	model = gda_data_model_array_new_with_g_types (1, G_TYPE_STRING);
+	gda_data_model_set_column_name (model, 0, "name");
+
+	for (row = 0; row < 40; row++)
+		{
+			str = g_string_new ("Row");
+			if (row % 5 == 4)
+				{
+					/* many lines, that make the band grow */
+					for (i = 0; i < 6; i++)
+						{
+							g_string_append_printf (str, "\nline %d of row %d", i, row);
+						}
+				}
+
+			gval = gda_value_new (G_TYPE_STRING);
+			g_value_take_string (gval, g_string_free (str, FALSE));
+			values = g_list_append (NULL, gval);
+
+			gda_data_model_append_values (model, values, NULL);
+
+			g_list_free_full (values, (GDestroyNotify)gda_value_free);
+		}
+
+	return model;
+}
+
+static gdouble
+get_prop_double (xmlNode *xnode, const gchar *name)
+{
+	gchar *prop;
+	gdouble ret;
+
+	prop = (gchar *)xmlGetProp (xnode, (const xmlChar *)name);
+	g_assert (prop != NULL);
+	ret = g_ascii_strtod (prop, NULL);
+	xmlFree (prop);
+
+	return ret;
+}
+
+int
+main (int argc, char **argv)
+{
+	GdaDataModel *model;
+	RptReport *rptr;
+	xmlDoc *xdoc;
+	xmlNode *xpage;
+	xmlNode *cur;
+	gint pages;
+	gint texts;
+	gdouble bottom;
+	gdouble max_bottom;
+
+	gda_init ();
+
+	xdoc = xmlReadMemory (report_xml, strlen (report_xml), NULL, NULL, 0);
+	g_assert (xdoc != NULL);
+	rptr = rpt_report_new_from_xml (xdoc);
+	g_assert (rptr != NULL);
+	xmlFreeDoc (xdoc);
+
+	model = create_data_model ();
+	rpt_report_set_database_from_datamodel (rptr, model);
+
+	xdoc = rpt_report_get_xml_rptprint (rptr);
+	g_assert (xdoc != NULL);
+
+	pages = 0;
+	texts = 0;
+	max_bottom = 0.0;
+	for (xpage = xmlDocGetRootElement (xdoc)->children; xpage != NULL; xpage = xpage->next)
+		{
+			if (xpage->type != XML_ELEMENT_NODE
+			    || g_strcmp0 ((const gchar *)xpage->name, "page") != 0)
+				{
+					continue;
+				}
+			pages++;
+
+			for (cur = xpage->children; cur != NULL; cur = cur->next)
+				{
+					if (cur->type != XML_ELEMENT_NODE
+					    || g_strcmp0 ((const gchar *)cur->name, "text") != 0)
+						{
+							continue;
+						}
+					texts++;
+
+					bottom = get_prop_double (cur, "y") + get_prop_double (cur, "height");
+					max_bottom = MAX (max_bottom, bottom);
+				}
+		}
+
+	g_assert_cmpint (texts, ==, 40);
+	g_assert_cmpint (pages, >, 1);
+	g_assert_cmpfloat (max_bottom, <=, PAGE_HEIGHT - MARGIN_BOTTOM + 0.001);
+
+	xmlFreeDoc (xdoc);
+	g_object_unref (model);
+	g_object_unref (rptr);
+
+	return 0;
+}
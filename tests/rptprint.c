@@ -25,7 +25,7 @@ static gchar *output_file_name = NULL;
 static GOptionEntry entries[] =
 {
 	{ "rptr-file-name", 'r', 0, G_OPTION_ARG_STRING, &rptr_file_name, "RptPrint definition file name", "RPTR_FILE_NAME" },
-	{ "output-type", 'o', 0, G_OPTION_ARG_STRING, &output_type, "Output type (png | pdf | ps | svg | gtk | gtk-default)", "OUTPUT-TYPE" },
+	{ "output-type", 'o', 0, G_OPTION_ARG_STRING, &output_type, "Output type (png | pdf | ps | svg | pam | raw | gtk | gtk-default)", "OUTPUT-TYPE" },
 	{ "output-file-name", 'f', 0, G_OPTION_ARG_FILENAME, &output_file_name, "Output file name", "FILE-NAME" },
 	{ NULL }
 };
@@ -57,7 +57,9 @@ main (int argc, char **argv)
 			if (g_strcmp0 (output_type, "png") == 0
 			    || g_strcmp0 (output_type, "pdf") == 0
 			    || g_strcmp0 (output_type, "ps") == 0
-			    || g_strcmp0 (output_type, "svg") == 0)
+			    || g_strcmp0 (output_type, "svg") == 0
+			    || g_strcmp0 (output_type, "pam") == 0
+			    || g_strcmp0 (output_type, "raw") == 0)
 				{
 					rpt_print_set_output_filename (rptp, output_file_name == NULL ? g_strdup_printf ("test.%s", output_type) : output_file_name);
 				}
@@ -18,6 +18,7 @@
 
 #include <rptreport.h>
 #include <rptprint.h>
+#include <rptgtk.h>
 
 static gchar *rpt_file_name = NULL;
 static gchar *xml_rpt_file_name = NULL;
@@ -34,7 +35,7 @@ static GOptionEntry entries[] =
 	{ "xml-report-file-name", 'x', 0, G_OPTION_ARG_FILENAME, &xml_rpt_file_name, "RptReport xml output file name", "FILE-NAME" },
 	{ "xml-print-file-name", 'p', 0, G_OPTION_ARG_FILENAME, &xml_rptr_file_name, "RptPrint xml output file name", "FILE-NAME" },
 	{ "path-relatives-to", 't', 0, G_OPTION_ARG_FILENAME, &path_relatives_to, "Path relatives to", "FILE-NAME" },
-	{ "output-type", 'o', 0, G_OPTION_ARG_STRING, &output_type, "Output type (png | pdf | ps | svg | gtk | gtk-default)", "OUTPUT-TYPE" },
+	{ "output-type", 'o', 0, G_OPTION_ARG_STRING, &output_type, "Output type (png | pdf | ps | svg | pam | raw | gtk | gtk-default)", "OUTPUT-TYPE" },
 	{ "output-file-name", 'f', 0, G_OPTION_ARG_FILENAME, &output_file_name, "Output file name", "FILE-NAME" },
 	{ "printer-name", 0, 0, G_OPTION_ARG_STRING, &printer_name, "Printer name", "PRINTER-NAME" },
 	{ "copies", 0, 0, G_OPTION_ARG_INT, &copies, "Number of copies", "N_COPIES" },
@@ -125,7 +126,9 @@ main (int argc, char **argv)
 					if (g_strcmp0 (output_type, "png") == 0
 					    || g_strcmp0 (output_type, "pdf") == 0
 					    || g_strcmp0 (output_type, "ps") == 0
-					    || g_strcmp0 (output_type, "svg") == 0)
+					    || g_strcmp0 (output_type, "svg") == 0
+					    || g_strcmp0 (output_type, "pam") == 0
+					    || g_strcmp0 (output_type, "raw") == 0)
 						{
 							rpt_print_set_output_filename (rptp, output_file_name == NULL ? g_strdup_printf ("test.%s", output_type) : output_file_name);
 						}
@@ -0,0 +1,658 @@
+/*
+ * Copyright (C) 2014 Andrea Zagli <azagli@libero.it>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor Boston, MA 02110-1301,  USA
+ */
+
+/*
+ * Render jobs shared by the reptool tools.
+ *
+ * Templates are cached by path and loaded again when the file changes.
+ * Every template keeps the RptReport instances that aren't running, so
+ * the same template can be generated by more threads at once. Every
+ * instance keeps its database connection, with the template's query
+ * prepared on it.
+ */
+
+#include <string.h>
+
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+#include <pango/pangocairo.h>
+#include <libgda/libgda.h>
+
+#include <rptreport.h>
+#include <rptprint.h>
+#include <rptdatasourcecsv.h>
+#include <rpttemplatecache.h>
+#include <rptobjecttext.h>
+#include <rptobjectline.h>
+#include <rptobjectrect.h>
+#include <rptobjectellipse.h>
+#include <rptobjectimage.h>
+
+#include "reptool-job.h"
+
+typedef struct
+{
+	RptReport *report;
+	/* the job replaced the template's rows */
+	gboolean replaced;
+	/* the values the job's parameters had before the job */
+	GHashTable *saved;
+
+	/* the parameters of the job that's running the instance */
+	GHashTable *params;
+} Instance;
+
+typedef struct
+{
+	gint ref_count;
+
+	gchar *filename;
+	gchar *dirname;
+	gint64 mtime;
+	goffset size;
+
+	gchar *provider_id;
+	gchar *connection_string;
+	gchar *sql;
+
+	/* Instance not running */
+	GMutex lock;
+	GSList *idle;
+} Template;
+
+static void template_unref (Template *tpl);
+static void instance_free (Instance *inst);
+
+/* file name -> Template */
+static GHashTable *templates = NULL;
+G_LOCK_DEFINE_STATIC (templates);
+
+/**
+ * reptool_job_init:
+ *
+ * Does once the work that every job would do the first time: libgda,
+ * types and fontconfig.
+ */
+void
+reptool_job_init (void)
+{
+	PangoFontFamily **families;
+	gint n_families;
+
+	gda_init ();
+
+	/* the types are registered before the workers start */
+	g_type_ensure (TYPE_RPT_REPORT);
+	g_type_ensure (TYPE_RPT_PRINT);
+	g_type_ensure (TYPE_RPT_OBJ_TEXT);
+	g_type_ensure (TYPE_RPT_OBJ_LINE);
+	g_type_ensure (TYPE_RPT_OBJ_RECT);
+	g_type_ensure (TYPE_RPT_OBJ_ELLIPSE);
+	g_type_ensure (TYPE_RPT_OBJ_IMAGE);
+
+	/* fontconfig reads its configuration and the fonts' list once */
+	pango_font_map_list_families (pango_cairo_font_map_get_default (), &families, &n_families);
+	g_free (families);
+
+	templates = g_hash_table_new_full (g_str_hash, g_str_equal,
+	                                   g_free, (GDestroyNotify)template_unref);
+}
+
+/**
+ * reptool_job_shutdown:
+ *
+ */
+void
+reptool_job_shutdown (void)
+{
+	G_LOCK (templates);
+	g_hash_table_destroy (templates);
+	templates = NULL;
+	G_UNLOCK (templates);
+}
+
+/**
+ * reptool_job_new:
+ *
+ * Returns: a new job, with pdf output.
+ */
+ReptoolJob
+*reptool_job_new (void)
+{
+	ReptoolJob *job;
+
+	job = g_new0 (ReptoolJob, 1);
+	job->output_type = RPT_OUTPUT_PDF;
+	job->params = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+
+	return job;
+}
+
+/**
+ * reptool_job_free:
+ * @job:
+ *
+ */
+void
+reptool_job_free (ReptoolJob *job)
+{
+	g_free (job->template);
+	g_free (job->output);
+	g_free (job->provider_id);
+	g_free (job->connection_string);
+	g_free (job->sql);
+	g_free (job->csv);
+	g_hash_table_destroy (job->params);
+	g_free (job);
+}
+
+static gboolean
+job_parse_pages (ReptoolJob *job, const gchar *value)
+{
+	guint64 first;
+	guint64 last;
+	gchar *end;
+
+	first = 0;
+	last = 0;
+
+	end = (gchar *)value;
+	if (*value != '-')
+		{
+			first = g_ascii_strtoull (value, &end, 10);
+			if (end == value || first == 0)
+				{
+					return FALSE;
+				}
+		}
+	if (*end == '\0')
+		{
+			/* a single page */
+			last = first;
+		}
+	else if (*end == '-')
+		{
+			value = end + 1;
+			if (*value != '\0')
+				{
+					last = g_ascii_strtoull (value, &end, 10);
+					if (end == value || *end != '\0' || last == 0 || last < first)
+						{
+							return FALSE;
+						}
+				}
+		}
+	else
+		{
+			return FALSE;
+		}
+
+	job->page_first = first;
+	job->page_last = last;
+
+	return TRUE;
+}
+
+/**
+ * reptool_job_set:
+ * @job:
+ * @key: template, output-type, output, pages, provider, connection-string,
+ * sql, csv or param.NAME; pages is "N", "FIRST-LAST", "FIRST-" or "-LAST".
+ * @value:
+ * @error:
+ *
+ * Returns: FALSE if @key is unknown.
+ */
+gboolean
+reptool_job_set (ReptoolJob *job, const gchar *key, const gchar *value, GError **error)
+{
+	if (g_strcmp0 (key, "template") == 0)
+		{
+			g_free (job->template);
+			job->template = g_strdup (value);
+		}
+	else if (g_strcmp0 (key, "output-type") == 0)
+		{
+			job->output_type = rpt_common_stroutputtype_to_enum (value);
+		}
+	else if (g_strcmp0 (key, "output") == 0)
+		{
+			g_free (job->output);
+			job->output = g_strdup (value);
+		}
+	else if (g_strcmp0 (key, "pages") == 0)
+		{
+			if (!job_parse_pages (job, value))
+				{
+					g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+					             "invalid pages' range «%s»", value);
+					return FALSE;
+				}
+		}
+	else if (g_strcmp0 (key, "provider") == 0)
+		{
+			g_free (job->provider_id);
+			job->provider_id = g_strdup (value);
+		}
+	else if (g_strcmp0 (key, "connection-string") == 0)
+		{
+			g_free (job->connection_string);
+			job->connection_string = g_strdup (value);
+		}
+	else if (g_strcmp0 (key, "sql") == 0)
+		{
+			g_free (job->sql);
+			job->sql = g_strdup (value);
+		}
+	else if (g_strcmp0 (key, "csv") == 0)
+		{
+			g_free (job->csv);
+			job->csv = g_strdup (value);
+		}
+	else if (g_str_has_prefix (key, "param.") && key[6] != '\0')
+		{
+			g_hash_table_replace (job->params, g_strdup (key + 6), g_strdup (value));
+		}
+	else
+		{
+			g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+			             "unknown job's key «%s»", key);
+			return FALSE;
+		}
+
+	return TRUE;
+}
+
+static gchar
+*field_request (RptReport *rpt_report,
+                gchar *field_name,
+                GdaDataModel *data_model,
+                gint row,
+                gpointer treemodel,
+                gpointer iter,
+                gpointer user_data)
+{
+	Instance *inst = (Instance *)user_data;
+	const gchar *value;
+
+	if (inst->params == NULL)
+		{
+			return NULL;
+		}
+
+	value = (const gchar *)g_hash_table_lookup (inst->params, field_name);
+
+	return value != NULL ? g_strdup (value) : NULL;
+}
+
+static Instance
+*instance_new (Template *tpl, GError **error)
+{
+	Instance *inst;
+
+	inst = g_new0 (Instance, 1);
+	inst->report = rpt_template_cache_get (tpl->filename, error);
+	if (inst->report == NULL)
+		{
+			g_free (inst);
+			return NULL;
+		}
+	inst->saved = g_hash_table_new_full (g_str_hash, g_str_equal,
+	                                     g_free, (GDestroyNotify)gda_value_free);
+
+	g_signal_connect (inst->report, "field-request", G_CALLBACK (field_request), inst);
+
+	return inst;
+}
+
+static void
+instance_free (Instance *inst)
+{
+	g_object_unref (inst->report);
+	g_hash_table_destroy (inst->saved);
+	g_free (inst);
+}
+
+/* gives the job's param.NAME values to the template's parameters */
+static void
+instance_set_parameters (Instance *inst, GHashTable *params)
+{
+	GHashTableIter iter;
+	gpointer key;
+	gpointer value;
+	const GValue *gval;
+	GValue str = G_VALUE_INIT;
+
+	g_value_init (&str, G_TYPE_STRING);
+
+	g_hash_table_iter_init (&iter, params);
+	while (g_hash_table_iter_next (&iter, &key, &value))
+		{
+			gval = rpt_report_get_parameter (inst->report, (const gchar *)key);
+			if (gval == NULL)
+				{
+					/* only a field's value */
+					continue;
+				}
+
+			g_hash_table_insert (inst->saved, g_strdup ((const gchar *)key), gda_value_copy (gval));
+			g_value_set_string (&str, (const gchar *)value);
+			rpt_report_set_parameter (inst->report, (const gchar *)key, &str);
+		}
+
+	g_value_unset (&str);
+}
+
+/* gives back to the template's parameters the values they had */
+static void
+instance_reset_parameters (Instance *inst)
+{
+	GHashTableIter iter;
+	gpointer key;
+	gpointer value;
+
+	g_hash_table_iter_init (&iter, inst->saved);
+	while (g_hash_table_iter_next (&iter, &key, &value))
+		{
+			rpt_report_set_parameter (inst->report, (const gchar *)key, (const GValue *)value);
+		}
+	g_hash_table_remove_all (inst->saved);
+}
+
+static Template
+*template_load (const gchar *filename, GStatBuf *st, GError **error)
+{
+	Template *tpl;
+	Instance *inst;
+	RptReport *report;
+	gchar *sql;
+
+	tpl = g_new0 (Template, 1);
+	tpl->ref_count = 1;
+	tpl->filename = g_strdup (filename);
+	tpl->dirname = g_path_get_dirname (filename);
+	tpl->mtime = (gint64)st->st_mtime;
+	tpl->size = (goffset)st->st_size;
+	g_mutex_init (&tpl->lock);
+
+	inst = instance_new (tpl, error);
+	if (inst == NULL)
+		{
+			template_unref (tpl);
+			return NULL;
+		}
+
+	/* the template's data source, given back to an instance after a job
+	 * that replaced it; every run executes the query again, so the data is
+	 * never stale */
+	report = inst->report;
+	sql = g_strdup (rpt_report_database_get_sql (report));
+	if (sql != NULL && g_strcmp0 (g_strstrip (sql), "") != 0)
+		{
+			tpl->provider_id = g_strdup (rpt_report_database_get_provider (report));
+			tpl->connection_string = g_strdup (rpt_report_database_get_connection_string (report));
+			tpl->sql = sql;
+		}
+	else
+		{
+			g_free (sql);
+		}
+
+	tpl->idle = g_slist_prepend (tpl->idle, inst);
+
+	return tpl;
+}
+
+static void
+template_unref (Template *tpl)
+{
+	if (!g_atomic_int_dec_and_test (&tpl->ref_count))
+		{
+			return;
+		}
+
+	g_slist_free_full (tpl->idle, (GDestroyNotify)instance_free);
+	g_mutex_clear (&tpl->lock);
+	g_free (tpl->provider_id);
+	g_free (tpl->connection_string);
+	g_free (tpl->sql);
+	g_free (tpl->filename);
+	g_free (tpl->dirname);
+	g_free (tpl);
+}
+
+/* returns the template of filename, loading it again if the file changed */
+static Template
+*template_get (const gchar *filename, GError **error)
+{
+	Template *tpl;
+	GStatBuf st;
+
+	if (g_stat (filename, &st) != 0)
+		{
+			g_set_error (error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND,
+			             "unable to read «%s»", filename);
+			return NULL;
+		}
+
+	G_LOCK (templates);
+
+	tpl = (Template *)g_hash_table_lookup (templates, filename);
+	if (tpl == NULL
+	    || tpl->mtime != (gint64)st.st_mtime
+	    || tpl->size != (goffset)st.st_size)
+		{
+			tpl = template_load (filename, &st, error);
+			if (tpl != NULL)
+				{
+					g_hash_table_replace (templates, g_strdup (filename), tpl);
+				}
+			else
+				{
+					g_hash_table_remove (templates, filename);
+				}
+		}
+	if (tpl != NULL)
+		{
+			g_atomic_int_inc (&tpl->ref_count);
+		}
+
+	G_UNLOCK (templates);
+
+	return tpl;
+}
+
+/* takes an instance that isn't running, or loads a new one */
+static Instance
+*template_acquire (Template *tpl, GError **error)
+{
+	Instance *inst;
+
+	g_mutex_lock (&tpl->lock);
+	inst = NULL;
+	if (tpl->idle != NULL)
+		{
+			inst = (Instance *)tpl->idle->data;
+			tpl->idle = g_slist_delete_link (tpl->idle, tpl->idle);
+		}
+	g_mutex_unlock (&tpl->lock);
+
+	if (inst == NULL)
+		{
+			inst = instance_new (tpl, error);
+		}
+
+	return inst;
+}
+
+static void
+template_release (Template *tpl, Instance *inst)
+{
+	g_mutex_lock (&tpl->lock);
+	tpl->idle = g_slist_prepend (tpl->idle, inst);
+	g_mutex_unlock (&tpl->lock);
+}
+
+/* sets on the instance the rows of the job's csv, or of the job's or the
+ * template's query */
+static gboolean
+instance_set_data (Instance *inst, Template *tpl, ReptoolJob *job, GError **error)
+{
+	const gchar *provider_id;
+	const gchar *connection_string;
+	const gchar *sql;
+	RptDataSource *source;
+
+	/* the instance could have the rows of the last job that ran it */
+	if (inst->replaced)
+		{
+			if (tpl->sql != NULL)
+				{
+					rpt_report_set_database (inst->report, tpl->provider_id, tpl->connection_string, tpl->sql);
+				}
+			else
+				{
+					rpt_report_set_data_source (inst->report, NULL);
+				}
+			inst->replaced = FALSE;
+		}
+
+	if (job->csv != NULL)
+		{
+			source = rpt_data_source_csv_new (job->csv, '\0', error);
+			if (source == NULL)
+				{
+					return FALSE;
+				}
+			rpt_report_set_data_source (inst->report, source);
+			g_object_unref (source);
+			inst->replaced = TRUE;
+			return TRUE;
+		}
+
+	if (job->sql == NULL && job->provider_id == NULL && job->connection_string == NULL)
+		{
+			/* the template's query, already prepared on the instance */
+			return TRUE;
+		}
+
+	provider_id = job->provider_id != NULL ? job->provider_id : tpl->provider_id;
+	connection_string = job->connection_string != NULL ? job->connection_string : tpl->connection_string;
+	sql = job->sql != NULL ? job->sql : tpl->sql;
+	if (sql == NULL)
+		{
+			return TRUE;
+		}
+	if (provider_id == NULL)
+		{
+			g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+			             "the query needs a provider");
+			return FALSE;
+		}
+
+	rpt_report_set_database (inst->report, provider_id, connection_string != NULL ? connection_string : "", sql);
+	inst->replaced = TRUE;
+
+	return TRUE;
+}
+
+/**
+ * reptool_job_run:
+ * @job:
+ * @error:
+ *
+ * Generates and prints @job; it can be called by more threads at once.
+ *
+ * Returns: TRUE on success.
+ */
+gboolean
+reptool_job_run (ReptoolJob *job, GError **error)
+{
+	Template *tpl;
+	Instance *inst;
+	xmlDoc *xdoc;
+	RptPrint *rptp;
+	gboolean ok;
+
+	if (job->template == NULL || job->output == NULL)
+		{
+			g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+			             "template and output are mandatory");
+			return FALSE;
+		}
+	if (job->output_type == RPT_OUTPUT_GTK
+	    || job->output_type == RPT_OUTPUT_GTK_DEFAULT_PRINTER)
+		{
+			g_set_error (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+			             "gtk output isn't available");
+			return FALSE;
+		}
+
+	tpl = template_get (job->template, error);
+	if (tpl == NULL)
+		{
+			return FALSE;
+		}
+
+	inst = template_acquire (tpl, error);
+	if (inst == NULL)
+		{
+			template_unref (tpl);
+			return FALSE;
+		}
+
+	if (!instance_set_data (inst, tpl, job, error))
+		{
+			template_release (tpl, inst);
+			template_unref (tpl);
+			return FALSE;
+		}
+
+	inst->params = job->params;
+	instance_set_parameters (inst, job->params);
+	rpt_report_set_page_range (inst->report, job->page_first, job->page_last);
+	xdoc = rpt_report_get_xml_rptprint_full (inst->report, error);
+	rpt_report_set_page_range (inst->report, 0, 0);
+	instance_reset_parameters (inst);
+	inst->params = NULL;
+
+	template_release (tpl, inst);
+
+	if (xdoc == NULL)
+		{
+			g_prefix_error (error, "unable to generate «%s»: ", job->template);
+			template_unref (tpl);
+			return FALSE;
+		}
+
+	rptp = rpt_print_new_from_xml (xdoc);
+	g_object_set (G_OBJECT (rptp), "path-relatives-to", tpl->dirname, NULL);
+	rpt_print_set_output_type (rptp, job->output_type);
+	rpt_print_set_output_filename (rptp, job->output);
+	ok = rpt_print_print_full (rptp, NULL, error);
+	if (!ok)
+		{
+			g_prefix_error (error, "unable to print «%s»: ", job->output);
+		}
+
+	g_object_unref (rptp);
+	xmlFreeDoc (xdoc);
+	template_unref (tpl);
+
+	return ok;
+}
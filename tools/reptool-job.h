@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2014 Andrea Zagli <azagli@libero.it>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor Boston, MA 02110-1301,  USA
+ */
+
+#ifndef __REPTOOL_JOB_H__
+#define __REPTOOL_JOB_H__
+
+#include <glib.h>
+
+#include <rptcommon.h>
+
+G_BEGIN_DECLS
+
+
+typedef struct
+{
+	gchar *template;
+	eRptOutputType output_type;
+	gchar *output;
+
+	/* the pages generated, starting from 1; 0 for no limit */
+	guint page_first;
+	guint page_last;
+
+	/* the data source that replaces the template's one; NULL to keep it */
+	gchar *provider_id;
+	gchar *connection_string;
+	gchar *sql;
+
+	/* a csv (or tsv) file with the rows, instead of the query */
+	gchar *csv;
+
+	/* field's name -> value, for the fields the data source hasn't */
+	GHashTable *params;
+} ReptoolJob;
+
+void reptool_job_init (void);
+void reptool_job_shutdown (void);
+
+ReptoolJob *reptool_job_new (void);
+void reptool_job_free (ReptoolJob *job);
+
+gboolean reptool_job_set (ReptoolJob *job,
+                          const gchar *key,
+                          const gchar *value,
+                          GError **error);
+
+gboolean reptool_job_run (ReptoolJob *job, GError **error);
+
+
+G_END_DECLS
+
+#endif /* __REPTOOL_JOB_H__ */
@@ -0,0 +1,364 @@
+/*
+ * Copyright (C) 2014 Andrea Zagli <azagli@libero.it>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor Boston, MA 02110-1301,  USA
+ */
+
+/*
+ * reptool-renderd renders reports for the clients of a unix domain socket.
+ * Templates, database connections, fonts and images stay loaded between
+ * jobs, so a small report costs only its own layout.
+ *
+ * A job is a list of "key=value" lines ended by an empty line:
+ *
+ *   template=/path/of/report.rpt
+ *   output-type=pdf                 (png | pdf | ps | svg | pam | raw)
+ *   output=/path/of/report.pdf
+ *   pages=1-3                       (optional: N, FIRST-LAST, FIRST- or -LAST)
+ *   provider=SQLite                 (optional, the data source that
+ *   connection-string=DB_DIR=...;    replaces the template's one)
+ *   sql=SELECT ...
+ *   csv=/path/of/rows.csv           (optional, the rows instead of the query;
+ *                                    the first line has the fields' names,
+ *                                    tab separated if it ends with .tsv)
+ *   param.NAME=VALUE                (the value of the parameter NAME
+ *                                    declared by the template, or of the
+ *                                    field NAME when the data source
+ *                                    hasn't it)
+ *
+ * the answer is a line "OK <milliseconds>" or "ERROR <message>".
+ * A connection can send any number of jobs; they are run one at a time,
+ * in order, and a connection waiting for its next job takes no worker.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <sys/stat.h>
+
+#include <glib/gstdio.h>
+#include <glib-unix.h>
+#include <gio/gio.h>
+#include <gio/gunixsocketaddress.h>
+
+#include "reptool-job.h"
+
+static gchar *socket_path = NULL;
+static gint workers = 0;
+
+static GOptionEntry entries[] =
+{
+	{ "socket", 's', 0, G_OPTION_ARG_FILENAME, &socket_path, "Unix domain socket to listen to", "FILE" },
+	{ "workers", 'w', 0, G_OPTION_ARG_INT, &workers, "Number of jobs run at the same time (default: number of processors)", "N" },
+	{ NULL }
+};
+
+/* a client's connection; jobs are read on the main loop, so only the
+ * job being run takes a worker, never a connection waiting for one */
+typedef struct
+	{
+		GSocketConnection *connection;
+		GDataInputStream *input;
+		GThreadPool *pool;
+
+		/* the job being read, then the one being run */
+		ReptoolJob *job;
+	} Client;
+
+static void client_read (Client *client);
+
+/* cancels the clients' reads when the daemon stops */
+static GCancellable *cancellable = NULL;
+
+/* the clients not freed yet */
+static gint n_clients = 0;
+
+static void
+client_free (Client *client)
+{
+	if (client->job != NULL)
+		{
+			reptool_job_free (client->job);
+		}
+	g_object_unref (client->input);
+	g_io_stream_close (G_IO_STREAM (client->connection), NULL, NULL);
+	g_object_unref (client->connection);
+	g_free (client);
+
+	g_atomic_int_add (&n_clients, -1);
+}
+
+/* adds a "key=value" line to the job being read */
+static void
+client_job_add (Client *client, gchar *line)
+{
+	GError *key_error;
+	gchar *value;
+
+	if (client->job == NULL)
+		{
+			client->job = reptool_job_new ();
+		}
+
+	value = strchr (line, '=');
+	if (value != NULL)
+		{
+			*value++ = '\0';
+			key_error = NULL;
+			if (!reptool_job_set (client->job, line, value, &key_error))
+				{
+					g_warning ("Job's line ignored: %s.", key_error->message);
+					g_error_free (key_error);
+				}
+		}
+	else
+		{
+			g_warning ("Job's line without value «%s».", line);
+		}
+}
+
+static void
+client_line_read (GObject *source_object, GAsyncResult *res, gpointer user_data)
+{
+	Client *client = (Client *)user_data;
+
+	GError *error;
+	gchar *line;
+
+	error = NULL;
+	line = g_data_input_stream_read_line_finish (client->input, res, NULL, &error);
+	if (g_cancellable_is_cancelled (cancellable))
+		{
+			/* the daemon is stopping, the workers are gone */
+			g_free (line);
+			g_clear_error (&error);
+			client_free (client);
+			return;
+		}
+	if (line == NULL)
+		{
+			if (error != NULL)
+				{
+					g_warning ("Error on the client's connection: %s.", error->message);
+					g_error_free (error);
+				}
+			else if (client->job != NULL)
+				{
+					/* the last job can end with the connection */
+					g_thread_pool_push (client->pool, client, NULL);
+					return;
+				}
+			client_free (client);
+			return;
+		}
+
+	g_strstrip (line);
+	if (line[0] == '\0')
+		{
+			g_free (line);
+			if (client->job != NULL)
+				{
+					g_thread_pool_push (client->pool, client, NULL);
+					return;
+				}
+		}
+	else
+		{
+			client_job_add (client, line);
+			g_free (line);
+		}
+
+	client_read (client);
+}
+
+static void
+client_read (Client *client)
+{
+	g_data_input_stream_read_line_async (client->input, G_PRIORITY_DEFAULT, cancellable,
+	                                     client_line_read, client);
+}
+
+static gboolean
+client_read_next (gpointer user_data)
+{
+	client_read ((Client *)user_data);
+
+	return G_SOURCE_REMOVE;
+}
+
+/* runs on a worker: runs the client's job, answers, and goes back to the
+ * main loop to read the next one */
+static void
+job_handle (gpointer data, gpointer user_data)
+{
+	Client *client = (Client *)data;
+
+	GError *error;
+	gint64 start;
+	gchar *answer;
+	gboolean written;
+
+	error = NULL;
+	start = g_get_monotonic_time ();
+	if (reptool_job_run (client->job, &error))
+		{
+			answer = g_strdup_printf ("OK %.3f\n", (g_get_monotonic_time () - start) / 1000.0);
+		}
+	else
+		{
+			answer = g_strdup_printf ("ERROR %s\n",
+			                          error != NULL && error->message != NULL ? error->message : "no details");
+			g_clear_error (&error);
+		}
+	reptool_job_free (client->job);
+	client->job = NULL;
+
+	written = g_output_stream_write_all (g_io_stream_get_output_stream (G_IO_STREAM (client->connection)),
+	                                     answer, strlen (answer), NULL, NULL, &error);
+	g_free (answer);
+	if (!written)
+		{
+			g_warning ("Error on the client's connection: %s.", error->message);
+			g_error_free (error);
+			client_free (client);
+			return;
+		}
+
+	g_main_context_invoke (NULL, client_read_next, client);
+}
+
+static gboolean
+incoming (GSocketService *service,
+          GSocketConnection *connection,
+          GObject *source_object,
+          gpointer user_data)
+{
+	Client *client;
+
+	client = g_new0 (Client, 1);
+	client->connection = g_object_ref (connection);
+	client->input = g_data_input_stream_new (g_io_stream_get_input_stream (G_IO_STREAM (connection)));
+	g_data_input_stream_set_newline_type (client->input, G_DATA_STREAM_NEWLINE_TYPE_ANY);
+	client->pool = (GThreadPool *)user_data;
+	g_atomic_int_inc (&n_clients);
+
+	client_read (client);
+
+	return TRUE;
+}
+
+static gboolean
+quit (gpointer user_data)
+{
+	g_main_loop_quit ((GMainLoop *)user_data);
+
+	return G_SOURCE_REMOVE;
+}
+
+int
+main (int argc, char **argv)
+{
+	GError *error;
+	GOptionContext *context;
+
+	GSocketService *service;
+	GSocketAddress *address;
+	GThreadPool *pool;
+	GMainLoop *loop;
+	mode_t mask;
+
+	context = g_option_context_new ("- render reports for the clients of a unix socket");
+	g_option_context_add_main_entries (context, entries, NULL);
+
+	error = NULL;
+	if (!g_option_context_parse (context, &argc, &argv, &error))
+		{
+			g_printerr ("Error on command line parsing: %s\n", error->message);
+			return 1;
+		}
+	g_option_context_free (context);
+
+	if (socket_path == NULL)
+		{
+			socket_path = g_build_filename (g_get_user_runtime_dir (), "reptool-renderd.sock", NULL);
+		}
+	if (workers <= 0)
+		{
+			workers = g_get_num_processors ();
+		}
+
+	reptool_job_init ();
+
+	/* the workers live as long as the daemon, so their caches stay warm */
+	pool = g_thread_pool_new (job_handle, NULL, workers, TRUE, &error);
+	if (pool == NULL)
+		{
+			g_printerr ("Unable to start the workers: %s\n", error->message);
+			return 1;
+		}
+
+	g_unlink (socket_path);
+	address = g_unix_socket_address_new (socket_path);
+	service = g_socket_service_new ();
+
+	/* the socket is created only for the user, there's no moment another
+	 * one can connect to it */
+	mask = umask (0077);
+	if (!g_socket_listener_add_address (G_SOCKET_LISTENER (service), address,
+	                                    G_SOCKET_TYPE_STREAM, G_SOCKET_PROTOCOL_DEFAULT,
+	                                    NULL, NULL, &error))
+		{
+			g_printerr ("Unable to listen to «%s»: %s\n", socket_path, error->message);
+			return 1;
+		}
+	umask (mask);
+	g_object_unref (address);
+
+	loop = g_main_loop_new (NULL, FALSE);
+	cancellable = g_cancellable_new ();
+
+	g_signal_connect (service, "incoming", G_CALLBACK (incoming), pool);
+	g_unix_signal_add (SIGINT, quit, loop);
+	g_unix_signal_add (SIGTERM, quit, loop);
+
+	g_socket_service_start (service);
+	g_message ("Listening to «%s» with %d workers.", socket_path, workers);
+
+	g_main_loop_run (loop);
+
+	g_socket_service_stop (service);
+	g_socket_listener_close (G_SOCKET_LISTENER (service));
+	g_object_unref (service);
+	g_unlink (socket_path);
+
+	/* waits for the jobs already accepted; their clients' next reads end
+	 * cancelled */
+	g_cancellable_cancel (cancellable);
+	g_thread_pool_free (pool, FALSE, TRUE);
+
+	/* every read, and every read queued by a worker, comes back to the
+	 * main context, that frees its client */
+	while (g_atomic_int_get (&n_clients) > 0)
+		{
+			g_main_context_iteration (NULL, TRUE);
+		}
+	g_object_unref (cancellable);
+
+	reptool_job_shutdown ();
+	g_main_loop_unref (loop);
+	g_free (socket_path);
+
+	return 0;
+}
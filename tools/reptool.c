@@ -0,0 +1,569 @@
+/*
+ * Copyright (C) 2014 Andrea Zagli <azagli@libero.it>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor Boston, MA 02110-1301,  USA
+ */
+
+/*
+ * reptool render [-j N] MANIFEST
+ *
+ * renders every job of MANIFEST (or of the standard input, when it is "-")
+ * with N threads. A job is a line of "key=value" fields separated by tabs,
+ * with the same keys of reptool-renderd:
+ *
+ *   template=a.rpt<TAB>output=a.pdf<TAB>param.customer=42
+ *   template=b.rpt<TAB>output-type=png<TAB>output=b.png<TAB>sql=SELECT ...
+ *
+ * empty lines and lines starting with '#' are skipped.
+ *
+ * Every thread has its own queue of jobs, filled at the start with a slice
+ * of the manifest; a thread whose queue is empty steals half of the jobs
+ * of another queue, so a few long reports don't leave the other threads
+ * idle.
+ *
+ * reptool compile [-o OUTPUT] TEMPLATE
+ *
+ * checks TEMPLATE and writes it as a compiled template (by default with
+ * the extension changed to .rptc), that the library loads without parsing
+ * any xml; it must be compiled again after an upgrade of libreptool.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include <rptreport.h>
+
+#include "reptool-job.h"
+
+typedef struct
+{
+	ReptoolJob *job;
+	guint line;
+	gboolean ok;
+	gdouble ms;
+} Task;
+
+typedef struct _Batch Batch;
+
+typedef struct
+{
+	Batch *batch;
+	guint id;
+	GThread *thread;
+
+	/* Task; the owner takes from the head, the thieves from the tail */
+	GMutex lock;
+	GQueue tasks;
+} Worker;
+
+struct _Batch
+{
+	Worker *workers;
+	guint n_workers;
+	gboolean quiet;
+
+	GMutex output_lock;
+};
+
+static gint jobs = 0;
+static gboolean quiet = FALSE;
+static gchar *output = NULL;
+
+static GOptionEntry render_entries[] =
+{
+	{ "jobs", 'j', 0, G_OPTION_ARG_INT, &jobs, "Number of jobs run at the same time (default: number of processors)", "N" },
+	{ "quiet", 'q', 0, G_OPTION_ARG_NONE, &quiet, "Print only the failed jobs and the summary", NULL },
+	{ NULL }
+};
+
+static GOptionEntry compile_entries[] =
+{
+	{ "output", 'o', 0, G_OPTION_ARG_FILENAME, &output, "The compiled template to write (default: TEMPLATE with the extension .rptc)", "OUTPUT" },
+	{ NULL }
+};
+
+/* parses a manifest's line; returns NULL on error */
+static ReptoolJob
+*manifest_parse_line (gchar *line, GError **error)
+{
+	ReptoolJob *job;
+	gchar **fields;
+	gchar *value;
+	guint i;
+
+	job = reptool_job_new ();
+
+	fields = g_strsplit (line, "\t", -1);
+	for (i = 0; fields[i] != NULL; i++)
+		{
+			g_strstrip (fields[i]);
+			if (fields[i][0] == '\0')
+				{
+					continue;
+				}
+
+			value = strchr (fields[i], '=');
+			if (value == NULL)
+				{
+					g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+					             "field without value «%s»", fields[i]);
+					break;
+				}
+			*value++ = '\0';
+
+			if (!reptool_job_set (job, fields[i], value, error))
+				{
+					break;
+				}
+		}
+	if (fields[i] == NULL
+	    && (job->template == NULL || job->output == NULL))
+		{
+			g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+			             "template and output are mandatory");
+		}
+	else if (fields[i] == NULL)
+		{
+			g_strfreev (fields);
+			return job;
+		}
+
+	g_strfreev (fields);
+	reptool_job_free (job);
+
+	return NULL;
+}
+
+/* reads all the manifest's jobs; returns NULL on error */
+static GPtrArray
+*manifest_read (const gchar *filename, GError **error)
+{
+	GIOChannel *channel;
+	GPtrArray *tasks;
+	GIOStatus status;
+	ReptoolJob *job;
+	Task *task;
+	gchar *line;
+	guint n_line;
+
+	if (g_strcmp0 (filename, "-") == 0)
+		{
+			channel = g_io_channel_unix_new (0);
+		}
+	else
+		{
+			channel = g_io_channel_new_file (filename, "r", error);
+			if (channel == NULL)
+				{
+					return NULL;
+				}
+		}
+
+	tasks = g_ptr_array_new ();
+
+	n_line = 0;
+	while ((status = g_io_channel_read_line (channel, &line, NULL, NULL, error)) == G_IO_STATUS_NORMAL)
+		{
+			n_line++;
+
+			g_strstrip (line);
+			if (line[0] == '\0' || line[0] == '#')
+				{
+					g_free (line);
+					continue;
+				}
+
+			job = manifest_parse_line (line, error);
+			g_free (line);
+			if (job == NULL)
+				{
+					g_prefix_error (error, "line %u: ", n_line);
+					status = G_IO_STATUS_ERROR;
+					break;
+				}
+
+			task = g_new0 (Task, 1);
+			task->job = job;
+			task->line = n_line;
+			g_ptr_array_add (tasks, task);
+		}
+
+	g_io_channel_unref (channel);
+
+	if (status == G_IO_STATUS_ERROR)
+		{
+			for (n_line = 0; n_line < tasks->len; n_line++)
+				{
+					task = (Task *)g_ptr_array_index (tasks, n_line);
+					reptool_job_free (task->job);
+					g_free (task);
+				}
+			g_ptr_array_free (tasks, TRUE);
+			return NULL;
+		}
+
+	return tasks;
+}
+
+/* moves half of the jobs of another worker to worker's queue;
+ * returns the first of them, or NULL when all the queues are empty */
+static Task
+*worker_steal (Worker *worker)
+{
+	Batch *batch = worker->batch;
+
+	Worker *victim;
+	GQueue stolen;
+	Task *task;
+	guint n;
+	guint i;
+
+	for (i = 1; i < batch->n_workers; i++)
+		{
+			victim = &batch->workers[(worker->id + i) % batch->n_workers];
+
+			g_queue_init (&stolen);
+
+			g_mutex_lock (&victim->lock);
+			for (n = (victim->tasks.length + 1) / 2; n > 0; n--)
+				{
+					g_queue_push_head (&stolen, g_queue_pop_tail (&victim->tasks));
+				}
+			g_mutex_unlock (&victim->lock);
+
+			if (stolen.length == 0)
+				{
+					continue;
+				}
+
+			task = (Task *)g_queue_pop_head (&stolen);
+			if (stolen.length > 0)
+				{
+					g_mutex_lock (&worker->lock);
+					while (stolen.length > 0)
+						{
+							g_queue_push_tail (&worker->tasks, g_queue_pop_head (&stolen));
+						}
+					g_mutex_unlock (&worker->lock);
+				}
+
+			return task;
+		}
+
+	return NULL;
+}
+
+static Task
+*worker_next (Worker *worker)
+{
+	Task *task;
+
+	g_mutex_lock (&worker->lock);
+	task = (Task *)g_queue_pop_head (&worker->tasks);
+	g_mutex_unlock (&worker->lock);
+
+	if (task == NULL)
+		{
+			task = worker_steal (worker);
+		}
+
+	return task;
+}
+
+static gpointer
+worker_run (gpointer data)
+{
+	Worker *worker = (Worker *)data;
+	Batch *batch = worker->batch;
+
+	GError *error;
+	Task *task;
+	gint64 start;
+
+	while ((task = worker_next (worker)) != NULL)
+		{
+			error = NULL;
+			start = g_get_monotonic_time ();
+			task->ok = reptool_job_run (task->job, &error);
+			task->ms = (g_get_monotonic_time () - start) / 1000.0;
+
+			g_mutex_lock (&batch->output_lock);
+			if (!task->ok)
+				{
+					g_printerr ("FAILED  line %u: %s -> %s: %s\n",
+					            task->line, task->job->template, task->job->output,
+					            error != NULL && error->message != NULL ? error->message : "no details");
+				}
+			else if (!batch->quiet)
+				{
+					g_print ("%8.1f ms  %s -> %s\n",
+					         task->ms, task->job->template, task->job->output);
+				}
+			g_mutex_unlock (&batch->output_lock);
+
+			g_clear_error (&error);
+		}
+
+	return NULL;
+}
+
+static gint
+compare_ms (gconstpointer a, gconstpointer b)
+{
+	gdouble ma = *(const gdouble *)a;
+	gdouble mb = *(const gdouble *)b;
+
+	return ma < mb ? -1 : (ma > mb ? 1 : 0);
+}
+
+static void
+print_summary (GPtrArray *tasks, gdouble seconds)
+{
+	Task *task;
+	gdouble *ms;
+	gdouble total;
+	guint failed;
+	guint i;
+
+	if (tasks->len == 0)
+		{
+			g_print ("No jobs.\n");
+			return;
+		}
+
+	ms = g_new (gdouble, tasks->len);
+	total = 0.0;
+	failed = 0;
+	for (i = 0; i < tasks->len; i++)
+		{
+			task = (Task *)g_ptr_array_index (tasks, i);
+			ms[i] = task->ms;
+			total += task->ms;
+			if (!task->ok)
+				{
+					failed++;
+				}
+		}
+	qsort (ms, tasks->len, sizeof (gdouble), compare_ms);
+
+	g_print ("\n%u jobs, %u failed, in %.2f s: %.1f jobs/s\n",
+	         tasks->len, failed, seconds,
+	         seconds > 0.0 ? tasks->len / seconds : 0.0);
+	g_print ("per job: mean %.1f ms, median %.1f ms, 95%% %.1f ms, max %.1f ms\n",
+	         total / tasks->len,
+	         ms[tasks->len / 2],
+	         ms[MIN (tasks->len - 1, (guint)(tasks->len * 0.95))],
+	         ms[tasks->len - 1]);
+
+	g_free (ms);
+}
+
+static int
+render (int argc, char **argv)
+{
+	GError *error;
+	GOptionContext *context;
+
+	GPtrArray *tasks;
+	Batch batch;
+	Worker *worker;
+	Task *task;
+	guint chunk;
+	guint i;
+	guint t;
+	gint64 start;
+	gint ret;
+
+	context = g_option_context_new ("MANIFEST - render the jobs of MANIFEST (\"-\" for the standard input)");
+	g_option_context_add_main_entries (context, render_entries, NULL);
+
+	error = NULL;
+	if (!g_option_context_parse (context, &argc, &argv, &error))
+		{
+			g_printerr ("Error on command line parsing: %s\n", error->message);
+			return 1;
+		}
+	g_option_context_free (context);
+
+	if (argc != 2)
+		{
+			g_printerr ("Usage: reptool render [-j N] [-q] MANIFEST\n");
+			return 1;
+		}
+
+	tasks = manifest_read (argv[1], &error);
+	if (tasks == NULL)
+		{
+			g_printerr ("Unable to read the manifest «%s»: %s\n", argv[1],
+			            error != NULL && error->message != NULL ? error->message : "no details");
+			return 1;
+		}
+
+	if (jobs <= 0)
+		{
+			jobs = g_get_num_processors ();
+		}
+	batch.n_workers = MAX (1, MIN ((guint)jobs, tasks->len));
+	batch.workers = g_new0 (Worker, batch.n_workers);
+	batch.quiet = quiet;
+	g_mutex_init (&batch.output_lock);
+
+	reptool_job_init ();
+
+	/* every worker starts with a contiguous slice of the manifest */
+	chunk = (tasks->len + batch.n_workers - 1) / batch.n_workers;
+	for (i = 0; i < batch.n_workers; i++)
+		{
+			worker = &batch.workers[i];
+			worker->batch = &batch;
+			worker->id = i;
+			g_mutex_init (&worker->lock);
+			g_queue_init (&worker->tasks);
+			for (t = i * chunk; t < MIN ((i + 1) * chunk, tasks->len); t++)
+				{
+					g_queue_push_tail (&worker->tasks, g_ptr_array_index (tasks, t));
+				}
+		}
+
+	start = g_get_monotonic_time ();
+	for (i = 0; i < batch.n_workers; i++)
+		{
+			batch.workers[i].thread = g_thread_new ("reptool-render", worker_run, &batch.workers[i]);
+		}
+	for (i = 0; i < batch.n_workers; i++)
+		{
+			g_thread_join (batch.workers[i].thread);
+		}
+
+	print_summary (tasks, (g_get_monotonic_time () - start) / 1000000.0);
+
+	ret = 0;
+	for (i = 0; i < tasks->len; i++)
+		{
+			task = (Task *)g_ptr_array_index (tasks, i);
+			if (!task->ok)
+				{
+					ret = 1;
+				}
+			reptool_job_free (task->job);
+			g_free (task);
+		}
+	g_ptr_array_free (tasks, TRUE);
+
+	for (i = 0; i < batch.n_workers; i++)
+		{
+			g_mutex_clear (&batch.workers[i].lock);
+		}
+	g_free (batch.workers);
+	g_mutex_clear (&batch.output_lock);
+
+	reptool_job_shutdown ();
+
+	return ret;
+}
+
+static int
+compile (int argc, char **argv)
+{
+	GError *error;
+	GOptionContext *context;
+
+	gchar *output_filename;
+	gchar *dot;
+	gint ret;
+
+	context = g_option_context_new ("TEMPLATE - compile TEMPLATE for a faster load");
+	g_option_context_add_main_entries (context, compile_entries, NULL);
+
+	error = NULL;
+	if (!g_option_context_parse (context, &argc, &argv, &error))
+		{
+			g_printerr ("Error on command line parsing: %s\n", error->message);
+			return 1;
+		}
+	g_option_context_free (context);
+
+	if (argc != 2)
+		{
+			g_printerr ("Usage: reptool compile [-o OUTPUT] TEMPLATE\n");
+			return 1;
+		}
+
+	if (output != NULL)
+		{
+			output_filename = g_strdup (output);
+		}
+	else
+		{
+			/* only the extension of the file's name, not of a directory */
+			output_filename = g_strdup (argv[1]);
+			dot = strrchr (output_filename, '.');
+			if (dot != NULL && strchr (dot, G_DIR_SEPARATOR) == NULL)
+				{
+					*dot = '\0';
+				}
+			dot = output_filename;
+			output_filename = g_strconcat (dot, ".rptc", NULL);
+			g_free (dot);
+		}
+
+	ret = 0;
+	if (!rpt_report_compile_file (argv[1], output_filename, &error))
+		{
+			g_printerr ("Unable to compile «%s»: %s\n", argv[1],
+			            error != NULL && error->message != NULL ? error->message : "no details");
+			if (error != NULL) g_error_free (error);
+			ret = 1;
+		}
+
+	g_free (output_filename);
+
+	return ret;
+}
+
+static void
+usage (void)
+{
+	g_printerr ("Usage: reptool COMMAND [OPTION...]\n\n"
+	            "Commands:\n"
+	            "  render    render the jobs of a manifest\n"
+	            "  compile   compile a template for a faster load\n\n"
+	            "Use \"reptool COMMAND --help\" for the options of a command.\n");
+}
+
+int
+main (int argc, char **argv)
+{
+	if (argc < 2)
+		{
+			usage ();
+			return 1;
+		}
+
+	if (g_strcmp0 (argv[1], "render") == 0)
+		{
+			return render (argc - 1, argv + 1);
+		}
+	if (g_strcmp0 (argv[1], "compile") == 0)
+		{
+			return compile (argc - 1, argv + 1);
+		}
+
+	usage ();
+	return 1;
+}